@@ -25,6 +25,7 @@
 #include "OnDiskWrapper.h"
 #include "moses/Factor.h"
 #include "util/exception.hh"
+#include "util/file.hh"
 #include "util/string_stream.hh"
 
 using namespace std;
@@ -32,9 +33,19 @@ using namespace std;
 namespace OnDiskPt
 {
 
+namespace
+{
+void MapForLoad(const std::string &path, util::scoped_memory &mem)
+{
+  util::scoped_fd fd(util::OpenReadOrThrow(path.c_str()));
+  util::MapRead(util::LAZY, fd.get(), 0, util::SizeOrThrow(fd.get()), mem);
+}
+}
+
 int OnDiskWrapper::VERSION_NUM = 7;
 
 OnDiskWrapper::OnDiskWrapper()
+  : m_rootSourceNode(NULL)
 {
 }
 
@@ -58,20 +69,9 @@ void OnDiskWrapper::BeginLoad(const std::string &filePath)
 
 bool OnDiskWrapper::OpenForLoad(const std::string &filePath)
 {
-  m_fileSource.open((filePath + "/Source.dat").c_str(), ios::in | ios::binary);
-  UTIL_THROW_IF(!m_fileSource.is_open(),
-                util::FileOpenException,
-                "Couldn't open file " << filePath << "/Source.dat");
-
-  m_fileTargetInd.open((filePath + "/TargetInd.dat").c_str(), ios::in | ios::binary);
-  UTIL_THROW_IF(!m_fileTargetInd.is_open(),
-                util::FileOpenException,
-                "Couldn't open file " << filePath << "/TargetInd.dat");
-
-  m_fileTargetColl.open((filePath + "/TargetColl.dat").c_str(), ios::in | ios::binary);
-  UTIL_THROW_IF(!m_fileTargetColl.is_open(),
-                util::FileOpenException,
-                "Couldn't open file " << filePath << "/TargetColl.dat");
+  MapForLoad(filePath + "/Source.dat", m_memSource);
+  MapForLoad(filePath + "/TargetInd.dat", m_memTargetInd);
+  MapForLoad(filePath + "/TargetColl.dat", m_memTargetColl);
 
   m_fileVocab.open((filePath + "/Vocab.dat").c_str(), ios::in);
   UTIL_THROW_IF(!m_fileVocab.is_open(),
@@ -23,6 +23,7 @@
 #include "Vocab.h"
 #include "PhraseNode.h"
 #include "moses/Word.h"
+#include "util/mmap.hh"
 
 namespace OnDiskPt
 {
@@ -31,6 +32,10 @@ const float DEFAULT_COUNT = 66666;
 /** Global class with misc information need to create and use the on-disk rule table.
  * 1 object of this class should be instantiated per rule table.
  * Currently only hierarchical/syntax models use this, but can & should be used with pb models too
+ *
+ * For loading, the source trie, the target phrases and the target phrase
+ * collections are memory mapped read-only and read in place. A loaded
+ * object is not changed by lookups, so it can be shared between threads.
  */
 class OnDiskWrapper
 {
@@ -39,6 +44,7 @@ protected:
   std::string m_filePath;
   int m_numSourceFactors, m_numTargetFactors, m_numScores;
   std::fstream m_fileMisc, m_fileVocab, m_fileSource, m_fileTarget, m_fileTargetInd, m_fileTargetColl;
+  util::scoped_memory m_memSource, m_memTargetInd, m_memTargetColl;
 
   size_t m_defaultNodeSize;
   PhraseNode *m_rootSourceNode;
@@ -84,6 +90,17 @@ public:
     return m_fileVocab;
   }
 
+  //! mapped Source.dat, TargetInd.dat and TargetColl.dat of a loaded table
+  const char *GetMemSource() const {
+    return static_cast<const char*>(m_memSource.get());
+  }
+  const char *GetMemTargetInd() const {
+    return static_cast<const char*>(m_memTargetInd.get());
+  }
+  const char *GetMemTargetColl() const {
+    return static_cast<const char*>(m_memTargetColl.get());
+  }
+
   size_t GetNumSourceFactors() const {
     return m_numSourceFactors;
   }
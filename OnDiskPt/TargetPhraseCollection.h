@@ -80,7 +80,7 @@ public:
       , const std::vector<float> &weightT
       , Vocab &vocab
       , bool isSyntax) const;
-  void ReadFromFile(size_t tableLimit, uint64_t filePos, OnDiskWrapper &onDiskWrapper);
+  void ReadFromFile(size_t tableLimit, uint64_t filePos, const OnDiskWrapper &onDiskWrapper);
 
   const std::string GetDebugStr() const;
   void SetDebugStr(const std::string &str);
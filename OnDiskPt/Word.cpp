@@ -86,18 +86,6 @@ size_t Word::ReadFromMemory(const char *mem)
   return memUsed;
 }
 
-size_t Word::ReadFromFile(std::fstream &file)
-{
-  const size_t memAlloc = sizeof(uint64_t) + sizeof(char);
-  char mem[sizeof(uint64_t) + sizeof(char)];
-  file.read(mem, memAlloc);
-
-  size_t memUsed = ReadFromMemory(mem);
-  assert(memAlloc == memUsed);
-
-  return memAlloc;
-}
-
 void Word::ConvertToMoses(
   const std::vector<Moses::FactorType> &outputFactorsVec,
   const Vocab &vocab,
@@ -5,6 +5,7 @@
 #include "util/usage.hh"
 
 #include <stdint.h>
+#include <vector>
 
 namespace {
 
@@ -67,53 +68,117 @@ template <class Model, class Width> void QueryFromBytes(const Model &model, int
   std::cout << "RSSMax: " << util::RSSMax() << std::endl;
 }
 
-template <class Model, class Width> void DispatchFunction(const Model &model, bool query) {
-  if (query) {
-    QueryFromBytes<Model, Width>(model, 0);
-  } else {
-    ConvertToBytes<Model, Width>(model, 0);
+// Decoder-like access pattern: the state after every word of the text is a
+// hypothesis, which is extended by kExpansions different words as if by
+// that many translation options.  The extensions do not depend on each
+// other, so with a prefetch window the hash table entries of the queries
+// window ahead are requested while the current one is scored.
+const std::size_t kExpansions = 16;
+
+template <class Model, class Width> double TimeExpansions(const Model &model, const std::vector<Width> &text, const std::vector<lm::ngram::State> &states, std::size_t window) {
+  const uint64_t queries = static_cast<uint64_t>(states.size()) * kExpansions;
+  // Spread the extension words over the whole text so consecutive queries
+  // touch unrelated parts of the table.
+  const uint64_t kStride = 7919;
+  lm::ngram::State out;
+  double before = util::CPUTime();
+  float sum = 0.0;
+  for (uint64_t q = 0; q < window && q < queries; ++q) {
+    model.Prefetch(states[q / kExpansions], text[(q * kStride) % text.size()]);
+  }
+  for (uint64_t q = 0; q < queries; ++q) {
+    if (window && q + window < queries) {
+      const uint64_t ahead = q + window;
+      model.Prefetch(states[ahead / kExpansions], text[(ahead * kStride) % text.size()]);
+    }
+    sum += model.FullScore(states[q / kExpansions], text[(q * kStride) % text.size()], out).prob;
+  }
+  double after = util::CPUTime();
+  std::cerr << "Probability sum is " << sum << std::endl;
+  return after - before;
+}
+
+template <class Model, class Width> void ExpandFromBytes(const Model &model, int fd_in) {
+  std::vector<Width> text;
+  Width buf[4096];
+  while (std::size_t got = util::ReadOrEOF(fd_in, buf, sizeof(buf))) {
+    UTIL_THROW_IF2(got % sizeof(Width), "File size not a multiple of vocab id size " << sizeof(Width));
+    text.insert(text.end(), buf, buf + got / sizeof(Width));
+  }
+  UTIL_THROW_IF2(text.empty(), "No text to expand");
+
+  const Width kEOS = model.GetVocabulary().EndSentence();
+  std::vector<lm::ngram::State> states(text.size());
+  const lm::ngram::State *context = &model.BeginSentenceState();
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    model.FullScore(*context, text[i], states[i]);
+    context = (text[i] == kEOS) ? &model.BeginSentenceState() : &states[i];
+  }
+
+  const uint64_t queries = static_cast<uint64_t>(states.size()) * kExpansions;
+  std::cout << "Queries: " << queries << std::endl;
+  const std::size_t windows[] = {0, 4, 8, 16};
+  for (std::size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); ++w) {
+    double cpu = TimeExpansions<Model, Width>(model, text, states, windows[w]);
+    std::cout << "Prefetch_window: " << windows[w] << " CPU: " << cpu << " Queries_per_second: " << (static_cast<double>(queries) / cpu) << std::endl;
+  }
+  std::cout << "RSSMax: " << util::RSSMax() << std::endl;
+}
+
+enum Mode { VOCAB, QUERY, EXPAND };
+
+template <class Model, class Width> void DispatchFunction(const Model &model, Mode mode) {
+  switch (mode) {
+    case QUERY:
+      QueryFromBytes<Model, Width>(model, 0);
+      break;
+    case EXPAND:
+      ExpandFromBytes<Model, Width>(model, 0);
+      break;
+    default:
+      ConvertToBytes<Model, Width>(model, 0);
   }
 }
 
-template <class Model> void DispatchWidth(const char *file, bool query) {
+template <class Model> void DispatchWidth(const char *file, Mode mode) {
   lm::ngram::Config config;
   config.load_method = util::READ;
   std::cerr << "Using load_method = READ." << std::endl;
   Model model(file, config);
   lm::WordIndex bound = model.GetVocabulary().Bound();
   if (bound <= 256) {
-    DispatchFunction<Model, uint8_t>(model, query);
+    DispatchFunction<Model, uint8_t>(model, mode);
   } else if (bound <= 65536) {
-    DispatchFunction<Model, uint16_t>(model, query);
+    DispatchFunction<Model, uint16_t>(model, mode);
   } else if (bound <= (1ULL << 32)) {
-    DispatchFunction<Model, uint32_t>(model, query);
+    DispatchFunction<Model, uint32_t>(model, mode);
   } else {
-    DispatchFunction<Model, uint64_t>(model, query);
+    DispatchFunction<Model, uint64_t>(model, mode);
   }
 }
 
-void Dispatch(const char *file, bool query) {
+void Dispatch(const char *file, Mode mode) {
   using namespace lm::ngram;
   lm::ngram::ModelType model_type;
   if (lm::ngram::RecognizeBinary(file, model_type)) {
     switch(model_type) {
       case PROBING:
-        DispatchWidth<lm::ngram::ProbingModel>(file, query);
+        DispatchWidth<lm::ngram::ProbingModel>(file, mode);
         break;
       case REST_PROBING:
-        DispatchWidth<lm::ngram::RestProbingModel>(file, query);
+        DispatchWidth<lm::ngram::RestProbingModel>(file, mode);
         break;
       case TRIE:
-        DispatchWidth<lm::ngram::TrieModel>(file, query);
+        DispatchWidth<lm::ngram::TrieModel>(file, mode);
         break;
       case QUANT_TRIE:
-        DispatchWidth<lm::ngram::QuantTrieModel>(file, query);
+        DispatchWidth<lm::ngram::QuantTrieModel>(file, mode);
         break;
       case ARRAY_TRIE:
-        DispatchWidth<lm::ngram::ArrayTrieModel>(file, query);
+        DispatchWidth<lm::ngram::ArrayTrieModel>(file, mode);
         break;
       case QUANT_ARRAY_TRIE:
-        DispatchWidth<lm::ngram::QuantArrayTrieModel>(file, query);
+        DispatchWidth<lm::ngram::QuantArrayTrieModel>(file, mode);
         break;
       default:
         UTIL_THROW(util::Exception, "Unrecognized kenlm model type " << model_type);
@@ -126,7 +191,7 @@ void Dispatch(const char *file, bool query) {
 } // namespace
 
 int main(int argc, char *argv[]) {
-  if (argc != 3 || (strcmp(argv[1], "vocab") && strcmp(argv[1], "query"))) {
+  if (argc != 3 || (strcmp(argv[1], "vocab") && strcmp(argv[1], "query") && strcmp(argv[1], "expand"))) {
     std::cerr
       << "Benchmark program for KenLM.  Intended usage:\n"
       << "#Convert text to vocabulary ids offline.  These ids are tied to a model.\n"
@@ -134,9 +199,15 @@ int main(int argc, char *argv[]) {
       << "#Ensure files are in RAM.\n"
       << "cat $text.vocab $model >/dev/null\n"
       << "#Timed query against the model.\n"
-      << argv[0] << " query $model <$text.vocab\n";
+      << argv[0] << " query $model <$text.vocab\n"
+      << "#Timed decoder-like queries (many independent extensions of each state)\n"
+      << "#without and with prefetching ahead.\n"
+      << argv[0] << " expand $model <$text.vocab\n";
     return 1;
   }
-  Dispatch(argv[2], !strcmp(argv[1], "query"));
+  Mode mode = VOCAB;
+  if (!strcmp(argv[1], "query")) mode = QUERY;
+  if (!strcmp(argv[1], "expand")) mode = EXPAND;
+  Dispatch(argv[2], mode);
   return 0;
 }
@@ -125,6 +125,22 @@ template <class Value> class HashedSearch {
       return LongestPointer(found->value.prob);
     }
 
+    // Prefetch the entries that scoring word after the context
+    // [context_rbegin, context_rend) (most recent word first) will probe.
+    void Prefetch(WordIndex word, const WordIndex *context_rbegin, const WordIndex *context_rend) const {
+      unigram_.Prefetch(word);
+      Node node = static_cast<Node>(word);
+      unsigned char order_minus_2 = 0;
+      for (const WordIndex *i = context_rbegin; i < context_rend; ++i, ++order_minus_2) {
+        node = CombineWordHash(node, *i);
+        if (order_minus_2 == middle_.size()) {
+          longest_.Prefetch(node);
+          return;
+        }
+        middle_[order_minus_2].Prefetch(node);
+      }
+    }
+
     // Generate a node without necessarily checking that it actually exists.
     // Optionally return false if it's know to not exist.
     bool FastMakeNode(const WordIndex *begin, const WordIndex *end, Node &node) const {
@@ -164,6 +180,12 @@ template <class Value> class HashedSearch {
           return unigram_[index];
         }
 
+        void Prefetch(WordIndex index) const {
+#if defined(__GNUC__)
+          __builtin_prefetch(unigram_ + index, 0, 0);
+#endif
+        }
+
         typename Value::Weights &Unknown() { return unigram_[0]; }
 
         // For building.
@@ -8,15 +8,119 @@
 
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+#include "util/exception.hh"
 #include "FeatureArray.h"
 #include "FileStream.h"
 #include "Util.h"
 
 using namespace std;
 
+namespace
+{
+
+template <class T>
+void AppendBin(string& out, const T& value)
+{
+  out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+T ExtractBin(const string& data, size_t pos)
+{
+  UTIL_THROW_IF(pos + sizeof(T) > data.size(), util::Exception,
+                "Truncated sparse features in binary feature data");
+  T value;
+  memcpy(&value, data.data() + pos, sizeof(T));
+  return value;
+}
+
+} // namespace
+
 namespace MosesTuning
 {
 
+string EncodeSparseFeatures(const featarray_t& rows)
+{
+  map<size_t, uint32_t> columns; // sparse feature id -> index into names
+  vector<string> names;
+  vector<uint32_t> offsets(1, 0);
+  vector<uint32_t> entries;
+  vector<FeatureStatsType> values;
+  for (featarray_t::const_iterator i = rows.begin(); i != rows.end(); ++i) {
+    const SparseVector& sparse = i->getSparse();
+    const vector<size_t> feats = sparse.feats();
+    for (size_t k = 0; k < feats.size(); ++k) {
+      const FeatureStatsType value = sparse.get(feats[k]);
+      // SparseVector::write() drops these too
+      if (abs(value) < 0.00001) continue;
+      map<size_t, uint32_t>::iterator column = columns.find(feats[k]);
+      if (column == columns.end()) {
+        column = columns.insert(make_pair(feats[k], static_cast<uint32_t>(names.size()))).first;
+        // The extractor keeps the '=' between name and value in the name
+        // ("pp_a="), which the text readers drop. Any other '=' is part of
+        // the name ("wt_a=b=" is the feature "wt_a=b").
+        string name = SparseVector::decode(feats[k]);
+        if (!name.empty() && name[name.size() - 1] == '=')
+          name.erase(name.size() - 1);
+        names.push_back(name);
+      }
+      entries.push_back(column->second);
+      values.push_back(value);
+    }
+    offsets.push_back(entries.size());
+  }
+
+  string out;
+  AppendBin<uint32_t>(out, names.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    AppendBin<uint32_t>(out, names[i].size());
+    out += names[i];
+  }
+  for (size_t i = 0; i < offsets.size(); ++i)
+    AppendBin(out, offsets[i]);
+  for (size_t i = 0; i < entries.size(); ++i)
+    AppendBin(out, entries[i]);
+  for (size_t i = 0; i < values.size(); ++i)
+    AppendBin(out, values[i]);
+  return out;
+}
+
+void DecodeSparseFeatures(const string& data, vector<SparseVector>& sparse)
+{
+  size_t pos = 0;
+  vector<size_t> ids(ExtractBin<uint32_t>(data, pos));
+  pos += sizeof(uint32_t);
+  for (size_t i = 0; i < ids.size(); ++i) {
+    const uint32_t length = ExtractBin<uint32_t>(data, pos);
+    pos += sizeof(uint32_t);
+    UTIL_THROW_IF(pos + length > data.size(), util::Exception,
+                  "Truncated sparse features in binary feature data");
+    ids[i] = SparseVector::encode(data.substr(pos, length));
+    pos += length;
+  }
+
+  vector<uint32_t> offsets(sparse.size() + 1);
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    offsets[i] = ExtractBin<uint32_t>(data, pos);
+    pos += sizeof(uint32_t);
+  }
+
+  const size_t entries = pos;
+  const size_t values = entries + offsets.back() * sizeof(uint32_t);
+  for (size_t i = 0; i < sparse.size(); ++i) {
+    for (size_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+      const uint32_t column = ExtractBin<uint32_t>(data, entries + k * sizeof(uint32_t));
+      UTIL_THROW_IF(column >= ids.size(), util::Exception,
+                    "Unknown sparse feature in binary feature data");
+      sparse[i].set(ids[column], ExtractBin<FeatureStatsType>(data, values + k * sizeof(FeatureStatsType)));
+    }
+  }
+}
+
 
 FeatureArray::FeatureArray()
   : m_index(0), m_num_features(0) {}
@@ -36,12 +140,25 @@ void FeatureArray::savetxt(ostream* os)
 
 void FeatureArray::savebin(ostream* os)
 {
-  *os << FEATURES_BIN_BEGIN << " " << m_index << " " << m_array.size()
+  bool sparse = false;
+  for (featarray_t::iterator i = m_array.begin(); i != m_array.end() && !sparse; ++i)
+    sparse = i->getSparse().size() > 0;
+
+  // blocks without sparse features stay readable by older versions
+  *os << (sparse ? FEATURES_BIN_SPARSE_BEGIN : FEATURES_BIN_BEGIN)
+      << " " << m_index << " " << m_array.size()
       << " " << m_num_features << " " << m_features << endl;
   for (featarray_t::iterator i = m_array.begin(); i != m_array.end(); ++i)
     i->savebin(os);
 
-  *os << FEATURES_BIN_END << endl;
+  if (sparse) {
+    const string data = EncodeSparseFeatures(m_array);
+    const uint64_t bytes = data.size();
+    os->write(reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+    os->write(data.data(), static_cast<streamsize>(data.size()));
+  }
+
+  *os << (sparse ? FEATURES_BIN_SPARSE_END : FEATURES_BIN_END) << endl;
 }
 
 
@@ -72,13 +189,30 @@ void FeatureArray::save(bool bin)
   save(&cout, bin);
 }
 
-void FeatureArray::loadbin(istream* is, size_t n)
+void FeatureArray::loadbin(istream* is, const SparseVector& sparseWeights, size_t n, bool sparse)
 {
-  FeatureStats entry(m_num_features);
+  const size_t first = m_array.size();
   for (size_t i = 0 ; i < n; i++) {
+    FeatureStats entry(m_num_features);
     entry.loadbin(is);
     add(entry);
   }
+
+  vector<SparseVector> sparseFeatures(n);
+  if (sparse) {
+    uint64_t bytes = 0;
+    is->read(reinterpret_cast<char*>(&bytes), sizeof(bytes));
+    string data(bytes, '\0');
+    is->read(&data[0], static_cast<streamsize>(bytes));
+    DecodeSparseFeatures(data, sparseFeatures);
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    m_array[first + i].setSparse(sparseFeatures[i]);
+    // as FeatureStats::set() does for text
+    if (sparseWeights.size())
+      m_array[first + i].mergeSparse(sparseWeights);
+  }
 }
 
 void FeatureArray::loadtxt(istream* is, const SparseVector& sparseWeights, size_t n)
@@ -95,6 +229,7 @@ void FeatureArray::load(istream* is, const SparseVector& sparseWeights)
 {
   size_t number_of_entries = 0;
   bool binmode = false;
+  bool sparse = false;
 
   string substring, stringBuf;
   string::size_type loc;
@@ -109,6 +244,9 @@ void FeatureArray::load(istream* is, const SparseVector& sparseWeights)
       binmode = false;
     } else if ((loc = stringBuf.find(FEATURES_BIN_BEGIN)) == 0) {
       binmode = true;
+    } else if ((loc = stringBuf.find(FEATURES_BIN_SPARSE_BEGIN)) == 0) {
+      binmode = true;
+      sparse = true;
     } else {
       TRACE_ERR("ERROR: FeatureArray::load(): Wrong header");
       return;
@@ -124,7 +262,7 @@ void FeatureArray::load(istream* is, const SparseVector& sparseWeights)
   }
 
   if (binmode) {
-    loadbin(is, number_of_entries);
+    loadbin(is, sparseWeights, number_of_entries, sparse);
   } else {
     loadtxt(is, sparseWeights, number_of_entries);
   }
@@ -132,7 +270,8 @@ void FeatureArray::load(istream* is, const SparseVector& sparseWeights)
   getline(*is, stringBuf);
   if (!stringBuf.empty()) {
     if ((loc = stringBuf.find(FEATURES_TXT_END)) != 0 &&
-        (loc = stringBuf.find(FEATURES_BIN_END)) != 0) {
+        (loc = stringBuf.find(FEATURES_BIN_END)) != 0 &&
+        (loc = stringBuf.find(FEATURES_BIN_SPARSE_END)) != 0) {
       TRACE_ERR("ERROR: FeatureArray::load(): Wrong footer");
       return;
     }
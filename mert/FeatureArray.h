@@ -11,6 +11,7 @@
 
 #include <vector>
 #include <iosfwd>
+#include <string>
 #include "FeatureStats.h"
 
 namespace MosesTuning
@@ -21,6 +22,22 @@ const char FEATURES_TXT_BEGIN[] = "FEATURES_TXT_BEGIN_0";
 const char FEATURES_TXT_END[] = "FEATURES_TXT_END_0";
 const char FEATURES_BIN_BEGIN[] = "FEATURES_BIN_BEGIN_0";
 const char FEATURES_BIN_END[] = "FEATURES_BIN_END_0";
+// binary block whose dense features are followed by sparse features
+const char FEATURES_BIN_SPARSE_BEGIN[] = "FEATURES_BIN_BEGIN_1";
+const char FEATURES_BIN_SPARSE_END[] = "FEATURES_BIN_END_1";
+
+/**
+ * The sparse features of the rows of a binary block in CSR form:
+ * the feature names, the offset of the first entry of each row, the
+ * name index of each entry and the value of each entry.
+ */
+std::string EncodeSparseFeatures(const featarray_t& rows);
+
+/**
+ * Inverse of EncodeSparseFeatures(), the sparse features of row i
+ * are written to sparse[i].
+ */
+void DecodeSparseFeatures(const std::string& data, std::vector<SparseVector>& sparse);
 
 class FeatureArray
 {
@@ -96,7 +113,7 @@ public:
   void save(bool bin=false);
 
   void loadtxt(std::istream* is, const SparseVector& sparseWeights, std::size_t n);
-  void loadbin(std::istream* is, std::size_t n);
+  void loadbin(std::istream* is, const SparseVector& sparseWeights, std::size_t n, bool sparse);
   void load(std::istream* is, const SparseVector& sparseWeights);
 
   bool check_consistency() const;
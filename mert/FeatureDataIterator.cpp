@@ -18,6 +18,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 #include <iostream>
 #include <sstream>
+#include <stdint.h>
 #include <boost/functional/hash.hpp>
 
 #include "util/file_piece.hh"
@@ -55,6 +56,13 @@ float ParseFloat(const StringPiece& str)
   return value;
 }
 
+void ReadBinary(FilePiece& in, char* out, size_t bytes)
+{
+  for (size_t i = 0; i < bytes; ++i) {
+    out[i] = in.get();
+  }
+}
+
 bool operator==(FeatureDataItem const& item1, FeatureDataItem const& item2)
 {
   return item1.dense==item1.dense && item1.sparse==item1.sparse;
@@ -84,7 +92,9 @@ void FeatureDataIterator::readNext()
   m_next.clear();
   try {
     StringPiece marker = m_in->ReadDelimited();
-    if (marker != StringPiece(FEATURES_TXT_BEGIN)) {
+    const bool sparseBin = (marker == StringPiece(FEATURES_BIN_SPARSE_BEGIN));
+    const bool bin = sparseBin || marker == StringPiece(FEATURES_BIN_BEGIN);
+    if (!bin && marker != StringPiece(FEATURES_TXT_BEGIN)) {
       throw FileFormatException(m_in->FileName(), marker.as_string());
     }
     // size_t sentenceId =
@@ -92,31 +102,36 @@ void FeatureDataIterator::readNext()
     size_t count = m_in->ReadULong();
     size_t length = m_in->ReadULong();
     m_in->ReadLine(); //discard rest of line
-    for (size_t i = 0; i < count; ++i) {
-      StringPiece line = m_in->ReadLine();
-      m_next.push_back(FeatureDataItem());
-      for (TokenIter<AnyCharacter, true> token(line, AnyCharacter(" \t")); token; ++token) {
-        TokenIter<AnyCharacterLast,false> value(*token,AnyCharacterLast("="));
-        if (!value) throw FileFormatException(m_in->FileName(), line.as_string());
-        StringPiece first = *value;
-        ++value;
-        if (!value) {
-          //regular feature
-          float floatValue = ParseFloat(first);
-          m_next.back().dense.push_back(floatValue);
-        } else {
-          //sparse feature
-          StringPiece second = *value;
-          float floatValue = ParseFloat(second);
-          m_next.back().sparse.set(first.as_string(),floatValue);
+    if (bin) {
+      readBinary(count, length, sparseBin);
+    } else {
+      for (size_t i = 0; i < count; ++i) {
+        StringPiece line = m_in->ReadLine();
+        m_next.push_back(FeatureDataItem());
+        for (TokenIter<AnyCharacter, true> token(line, AnyCharacter(" \t")); token; ++token) {
+          TokenIter<AnyCharacterLast,false> value(*token,AnyCharacterLast("="));
+          if (!value) throw FileFormatException(m_in->FileName(), line.as_string());
+          StringPiece first = *value;
+          ++value;
+          if (!value) {
+            //regular feature
+            float floatValue = ParseFloat(first);
+            m_next.back().dense.push_back(floatValue);
+          } else {
+            //sparse feature
+            StringPiece second = *value;
+            float floatValue = ParseFloat(second);
+            m_next.back().sparse.set(first.as_string(),floatValue);
+          }
+        }
+        if (length != m_next.back().dense.size()) {
+          throw FileFormatException(m_in->FileName(), line.as_string());
         }
-      }
-      if (length != m_next.back().dense.size()) {
-        throw FileFormatException(m_in->FileName(), line.as_string());
       }
     }
     StringPiece line = m_in->ReadLine();
-    if (line != StringPiece(FEATURES_TXT_END)) {
+    if (line != StringPiece(sparseBin ? FEATURES_BIN_SPARSE_END :
+                            bin ? FEATURES_BIN_END : FEATURES_TXT_END)) {
       throw FileFormatException(m_in->FileName(), line.as_string());
     }
   } catch (EndOfFileException &e) {
@@ -124,6 +139,28 @@ void FeatureDataIterator::readNext()
   }
 }
 
+void FeatureDataIterator::readBinary(size_t count, size_t length, bool sparse)
+{
+  m_next.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    m_next[i].dense.resize(length);
+    if (length) {
+      ReadBinary(*m_in, reinterpret_cast<char*>(&m_next[i].dense[0]), length * sizeof(float));
+    }
+  }
+  if (sparse) {
+    uint64_t bytes = 0;
+    ReadBinary(*m_in, reinterpret_cast<char*>(&bytes), sizeof(bytes));
+    string data(bytes, '\0');
+    ReadBinary(*m_in, &data[0], bytes);
+    vector<SparseVector> sparseFeatures(count);
+    DecodeSparseFeatures(data, sparseFeatures);
+    for (size_t i = 0; i < count; ++i) {
+      m_next[i].sparse = sparseFeatures[i];
+    }
+  }
+}
+
 void FeatureDataIterator::increment()
 {
   readNext();
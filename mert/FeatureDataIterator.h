@@ -61,6 +61,9 @@ int ParseInt(const StringPiece& str );
 /** Assumes a delimiter, so only apply to tokens */
 float ParseFloat(const StringPiece& str);
 
+/** Reads the raw bytes of a binary block */
+void ReadBinary(util::FilePiece& in, char* out, std::size_t bytes);
+
 
 class FeatureDataItem
 {
@@ -95,6 +98,7 @@ private:
   const std::vector<FeatureDataItem>& dereference() const;
 
   void readNext();
+  void readBinary(std::size_t count, std::size_t length, bool sparse);
 
   boost::shared_ptr<util::FilePiece> m_in;
   std::vector<FeatureDataItem> m_next;
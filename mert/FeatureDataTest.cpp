@@ -1,8 +1,11 @@
 #include "FeatureData.h"
+#include "FeatureDataIterator.h"
 
 #define BOOST_TEST_MODULE FeatureData
 #include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
 
+#include <fstream>
 #include <sstream>
 
 using namespace MosesTuning;
@@ -23,6 +26,28 @@ void CheckFeatureMap(const FeatureData* feature_data,
   }
 }
 
+// three hypotheses with two dense features, two of them with sparse ones
+void MakeFeatureArray(FeatureArray* array)
+{
+  array->setIndex(3);
+  array->NumberOfFeatures(2);
+  array->Features("lm_0 tm_0");
+  for (int i = 0; i < 3; ++i) {
+    FeatureStats stats;
+    stats.add(0.5f * i);
+    stats.add(-1.25f);
+    if (i != 1) {
+      stats.addSparse("pp_a", 1.0f + i);
+    }
+    if (i == 2) {
+      stats.addSparse("pp_b", -3.0f);
+      // word features on a "=" token; the text format writes "wt_a=b=0.75"
+      stats.addSparse("wt_a=b", 0.75f);
+    }
+    array->add(stats);
+  }
+}
+
 } // namespace
 
 BOOST_AUTO_TEST_CASE(set_feature_map)
@@ -43,3 +68,80 @@ BOOST_AUTO_TEST_CASE(set_feature_map)
   BOOST_CHECK_EQUAL(feature_data.getFeatureIndex("w_0"), (std::size_t)cnt);
   BOOST_CHECK_EQUAL(feature_data.getFeatureName(cnt).c_str(), "w_0");
 }
+
+BOOST_AUTO_TEST_CASE(binary_sparse_features)
+{
+  FeatureArray array;
+  MakeFeatureArray(&array);
+  std::stringstream ss;
+  array.save(&ss, true);
+
+  FeatureArray loaded;
+  loaded.load(&ss, SparseVector());
+  BOOST_REQUIRE_EQUAL(loaded.size(), (std::size_t)3);
+  BOOST_CHECK_EQUAL(loaded.getIndex(), 3);
+  BOOST_CHECK_EQUAL(loaded.NumberOfFeatures(), (std::size_t)2);
+  for (std::size_t i = 0; i < 3; ++i) {
+    BOOST_CHECK_EQUAL(loaded.get(i).size(), (std::size_t)2);
+    BOOST_CHECK_EQUAL(loaded.get(i).get(0), array.get(i).get(0));
+    BOOST_CHECK_EQUAL(loaded.get(i).get(1), array.get(i).get(1));
+    BOOST_CHECK(loaded.get(i).getSparse() == array.get(i).getSparse());
+  }
+  BOOST_CHECK_EQUAL(loaded.get(1).getSparse().size(), (std::size_t)0);
+  BOOST_CHECK_EQUAL(loaded.get(2).getSparse().get("pp_b"), -3.0f);
+  BOOST_CHECK_EQUAL(loaded.get(2).getSparse().get("wt_a=b"), 0.75f);
+}
+
+BOOST_AUTO_TEST_CASE(binary_sparse_features_as_text)
+{
+  // names as the extractor stores them, with the '=' before the value
+  FeatureArray array;
+  array.setIndex(0);
+  array.NumberOfFeatures(1);
+  array.Features("lm_0");
+  FeatureStats stats;
+  stats.add(-2.5f);
+  stats.addSparse("pp_a=", 2.0f);
+  stats.addSparse("wt_a=b=", 0.5f);
+  array.add(stats);
+
+  std::stringstream text, bin;
+  array.save(&text, false);
+  array.save(&bin, true);
+  FeatureArray fromText, fromBin;
+  fromText.load(&text, SparseVector());
+  fromBin.load(&bin, SparseVector());
+  BOOST_REQUIRE_EQUAL(fromText.size(), (std::size_t)1);
+  BOOST_REQUIRE_EQUAL(fromBin.size(), (std::size_t)1);
+  BOOST_CHECK(fromBin.get(0).getSparse() == fromText.get(0).getSparse());
+  BOOST_CHECK_EQUAL(fromBin.get(0).getSparse().get("wt_a=b"), 0.5f);
+}
+
+BOOST_AUTO_TEST_CASE(binary_feature_data_iterator)
+{
+  const std::string file =
+    (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+  FeatureArray array;
+  MakeFeatureArray(&array);
+  {
+    std::ofstream out(file.c_str(), std::ios::binary);
+    array.save(&out, true);
+    array.save(&out, true);
+  }
+
+  FeatureDataIterator it(file);
+  for (int block = 0; block < 2; ++block) {
+    BOOST_REQUIRE(it != FeatureDataIterator::end());
+    BOOST_REQUIRE_EQUAL(it->size(), (std::size_t)3);
+    for (std::size_t i = 0; i < 3; ++i) {
+      const FeatureDataItem& item = (*it)[i];
+      BOOST_REQUIRE_EQUAL(item.dense.size(), (std::size_t)2);
+      BOOST_CHECK_EQUAL(item.dense[0], array.get(i).get(0));
+      BOOST_CHECK_EQUAL(item.dense[1], array.get(i).get(1));
+      BOOST_CHECK(item.sparse == array.get(i).getSparse());
+    }
+    ++it;
+  }
+  BOOST_CHECK(it == FeatureDataIterator::end());
+  boost::filesystem::remove(file);
+}
@@ -92,6 +92,14 @@ public:
   void expand();
   void add(FeatureStatsType v);
   void addSparse(const std::string& name, FeatureStatsType v);
+  void setSparse(const SparseVector& sparse) {
+    m_map = sparse;
+  }
+  /**
+   * Replace the sparse features by their inner product with the
+   * given weights, as an additional dense feature.
+   */
+  void mergeSparse(const SparseVector& sparseWeights);
 
   void clear() {
     memset((void*)m_array, 0, GetArraySizeWithBytes());
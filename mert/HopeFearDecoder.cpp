@@ -24,6 +24,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #define BOOST_FILESYSTEM_VERSION 3
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#endif
 
 #include "util/exception.hh"
 #include "util/file_piece.hh"
@@ -39,6 +44,121 @@ namespace MosesTuning
 
 static const ValType BLEU_RATIO = 5;
 
+namespace
+{
+
+// The current n-best list of an enumerator
+class CurrentHypPack
+{
+public:
+  explicit CurrentHypPack(HypPackEnumerator& train) : train_(train) {}
+  size_t size() const {
+    return train_.cur_size();
+  }
+  const MiraFeatureVector& featuresAt(size_t i) const {
+    return train_.featuresAt(i);
+  }
+  const ScoreDataItem& scoresAt(size_t i) const {
+    return train_.scoresAt(i);
+  }
+private:
+  HypPackEnumerator& train_;
+};
+
+// An n-best list held in memory
+class StoredHypPack
+{
+public:
+  StoredHypPack(const vector<MiraFeatureVector>& features, const vector<ScoreDataItem>& scores)
+    : features_(features), scores_(scores) {}
+  size_t size() const {
+    return features_.size();
+  }
+  const MiraFeatureVector& featuresAt(size_t i) const {
+    return features_[i];
+  }
+  const ScoreDataItem& scoresAt(size_t i) const {
+    return scores_[i];
+  }
+private:
+  const vector<MiraFeatureVector>& features_;
+  const vector<ScoreDataItem>& scores_;
+};
+
+template <class Pack> void NbestHopeFear(
+  const Pack& pack,
+  Scorer* scorer,
+  bool safe_hope,
+  const std::vector<ValType>& backgroundBleu,
+  const MiraWeightVector& wv,
+  HopeFearData* hopeFear
+)
+{
+  // Hope / fear decode
+  ValType hope_scale = 1.0;
+  size_t hope_index=0, fear_index=0, model_index=0;
+  ValType hope_score=0, fear_score=0, model_score=0;
+  for(size_t safe_loop=0; safe_loop<2; safe_loop++) {
+    ValType hope_bleu=0, hope_model=0;
+    for(size_t i=0; i< pack.size(); i++) {
+      const MiraFeatureVector& vec=pack.featuresAt(i);
+      ValType score = wv.score(vec);
+      ValType bleu = scorer->calculateSentenceLevelBackgroundScore(pack.scoresAt(i),backgroundBleu);
+      // Hope
+      if(i==0 || (hope_scale*score + bleu) > hope_score) {
+        hope_score = hope_scale*score + bleu;
+        hope_index = i;
+        hope_bleu = bleu;
+        hope_model = score;
+      }
+      // Fear
+      if(i==0 || (score - bleu) > fear_score) {
+        fear_score = score - bleu;
+        fear_index = i;
+      }
+      // Model
+      if(i==0 || score > model_score) {
+        model_score = score;
+        model_index = i;
+      }
+    }
+    // Outer loop rescales the contribution of model score to 'hope' in antagonistic cases
+    // where model score is having far more influence than BLEU
+    hope_bleu *= BLEU_RATIO; // We only care about cases where model has MUCH more influence than BLEU
+    if(safe_hope && safe_loop==0 && abs(hope_model)>1e-8 && abs(hope_bleu)/abs(hope_model)<hope_scale)
+      hope_scale = abs(hope_bleu) / abs(hope_model);
+    else break;
+  }
+  hopeFear->modelFeatures = pack.featuresAt(model_index);
+  hopeFear->hopeFeatures = pack.featuresAt(hope_index);
+  hopeFear->fearFeatures = pack.featuresAt(fear_index);
+
+  hopeFear->hopeStats = pack.scoresAt(hope_index);
+  hopeFear->hopeBleu = scorer->calculateSentenceLevelBackgroundScore(hopeFear->hopeStats, backgroundBleu);
+  const vector<float>& fear_stats = pack.scoresAt(fear_index);
+  hopeFear->fearBleu = scorer->calculateSentenceLevelBackgroundScore(fear_stats, backgroundBleu);
+
+  hopeFear->modelStats = pack.scoresAt(model_index);
+  hopeFear->hopeFearEqual = (hope_index == fear_index);
+}
+
+template <class Pack> void NbestMaxModel(const Pack& pack, const AvgWeightVector& wv, std::vector<ValType>* stats)
+{
+  // Find max model
+  size_t max_index=0;
+  ValType max_score=0;
+  for(size_t i=0; i<pack.size(); i++) {
+    ValType score = wv.score(pack.featuresAt(i));
+    if(i==0 || score > max_score) {
+      max_index = i;
+      max_score = score;
+    }
+  }
+  *stats = pack.scoresAt(max_index);
+}
+
+} // namespace
+
 std::pair<MiraWeightVector*,size_t>
 InitialiseWeights(const string& denseInitFile, const string& sparseInitFile,
                   const string& type, bool verbose)
@@ -132,10 +252,117 @@ InitialiseWeights(const string& denseInitFile, const string& sparseInitFile,
   return pair<MiraWeightVector*,size_t>(new MiraWeightVector(initParams), initDenseSize);
 }
 
+#ifdef WITH_THREADS
+namespace
+{
+typedef vector<boost::function<void ()> > Ranges;
+
+/** The ranges of a mini-batch still running on the pool, and the first
+  * error any of them ran into */
+struct RangesState {
+  explicit RangesState(size_t ranges) : remaining(ranges), failed(false) {}
+
+  void Wait() {
+    boost::mutex::scoped_lock lock(mutex);
+    while (remaining) done.wait(lock);
+  }
+
+  size_t remaining;
+  bool failed;
+  string error;
+  boost::mutex mutex;
+  boost::condition_variable done;
+};
+
+/** Runs one range of a mini-batch on the pool and counts it off, also if
+  * it throws: the pool does not catch exceptions, and the caller waits for
+  * every range before it rethrows. */
+class RangeTask : public Moses::Task
+{
+public:
+  RangeTask(const boost::function<void ()>& range, RangesState& state)
+    : range_(range), state_(state) {}
+
+  virtual void Run() {
+    bool failed = false;
+    string error;
+    try {
+      range_();
+    } catch (const std::exception& e) {
+      failed = true;
+      error = e.what();
+    } catch (...) {
+      failed = true;
+      error = "unknown exception";
+    }
+    boost::mutex::scoped_lock lock(state_.mutex);
+    if (failed && !state_.failed) {
+      state_.failed = true;
+      state_.error = error;
+    }
+    if (--state_.remaining == 0) state_.done.notify_all();
+  }
+
+private:
+  boost::function<void ()> range_;
+  RangesState& state_;
+};
+
+/** Runs the first range on the calling thread, the others on the pool, and
+  * returns (or throws) when all of them are done */
+void RunRanges(Moses::ThreadPool& pool, const Ranges& ranges)
+{
+  RangesState state(ranges.size() - 1);
+  for (size_t i = 1; i < ranges.size(); ++i) {
+    boost::shared_ptr<Moses::Task> task(new RangeTask(ranges[i], state));
+    pool.Submit(task);
+  }
+  try {
+    ranges[0]();
+  } catch (...) {
+    // the other ranges still use state
+    state.Wait();
+    throw;
+  }
+  state.Wait();
+  UTIL_THROW_IF(state.failed, util::Exception,
+                "Decoding on a helper thread failed: " << state.error);
+}
+}
+#endif
+
+void HopeFearDecoder::SetThreads(size_t threads)
+{
+  threads_ = threads;
+#ifdef WITH_THREADS
+  pool_.reset(threads_ > 1 ? new Moses::ThreadPool(threads_ - 1) : NULL);
+#endif
+}
+
 ValType HopeFearDecoder::Evaluate(const AvgWeightVector& wv)
 {
   vector<ValType> stats(scorer_->NumberOfScores(),0);
-  for(reset(); !finished(); next()) {
+  reset();
+#ifdef WITH_THREADS
+  const size_t remaining = Remaining();
+  if (threads_ > 1 && remaining > 1) {
+    vector<vector<ValType> > sents(remaining);
+    Ranges ranges;
+    for (size_t t = 0; t < min(threads_, remaining); ++t) {
+      ranges.push_back(boost::bind(&HopeFearDecoder::MaxModelRange, this, t, &wv, &sents));
+    }
+    RunRanges(*pool_, ranges);
+    // summed in order, as below
+    for (size_t j = 0; j < sents.size(); ++j) {
+      for(size_t i=0; i<sents[j].size(); i++) {
+        stats[i]+=sents[j][i];
+      }
+      next();
+    }
+    return scorer_->calculateScore(stats);
+  }
+#endif
+  for(; !finished(); next()) {
     vector<ValType> sent;
     MaxModel(wv,&sent);
     for(size_t i=0; i<sent.size(); i++) {
@@ -145,6 +372,56 @@ ValType HopeFearDecoder::Evaluate(const AvgWeightVector& wv)
   return scorer_->calculateScore(stats);
 }
 
+void HopeFearDecoder::HopeFear(
+  const std::vector<ValType>& backgroundBleu,
+  const MiraWeightVector& wv,
+  size_t batchSize,
+  vector<HopeFearData>* hopeFears
+)
+{
+  hopeFears->clear();
+#ifdef WITH_THREADS
+  const size_t batch = min(batchSize, Remaining());
+  if (threads_ > 1 && batch > 1) {
+    hopeFears->resize(batch);
+    Ranges ranges;
+    for (size_t t = 0; t < min(threads_, batch); ++t) {
+      ranges.push_back(boost::bind(&HopeFearDecoder::HopeFearRange, this, t, &backgroundBleu, &wv, hopeFears));
+    }
+    RunRanges(*pool_, ranges);
+    for (size_t i = 0; i < batch; ++i) next();
+    return;
+  }
+#endif
+  for (; hopeFears->size() < batchSize && !finished(); next()) {
+    hopeFears->push_back(HopeFearData());
+    HopeFear(backgroundBleu, wv, &hopeFears->back());
+  }
+}
+
+void HopeFearDecoder::HopeFearRange(
+  size_t first,
+  const vector<ValType>* backgroundBleu,
+  const MiraWeightVector* wv,
+  vector<HopeFearData>* hopeFears
+) const
+{
+  for (size_t i = first; i < hopeFears->size(); i += threads_) {
+    HopeFearAt(i, *backgroundBleu, *wv, &(*hopeFears)[i]);
+  }
+}
+
+void HopeFearDecoder::MaxModelRange(
+  size_t first,
+  const AvgWeightVector* wv,
+  vector<vector<ValType> >* stats
+) const
+{
+  for (size_t i = first; i < stats->size(); i += threads_) {
+    MaxModelAt(i, *wv, &(*stats)[i]);
+  }
+}
+
 NbestHopeFearDecoder::NbestHopeFearDecoder(
   const vector<string>& featureFiles,
   const vector<string>&  scoreFiles,
@@ -157,8 +434,10 @@ NbestHopeFearDecoder::NbestHopeFearDecoder(
   scorer_ = scorer;
   if (streaming) {
     train_.reset(new StreamingHypPackEnumerator(featureFiles, scoreFiles));
+    randomAccess_ = NULL;
   } else {
-    train_.reset(new RandomAccessHypPackEnumerator(featureFiles, scoreFiles, no_shuffle));
+    randomAccess_ = new RandomAccessHypPackEnumerator(featureFiles, scoreFiles, no_shuffle);
+    train_.reset(randomAccess_);
   }
 }
 
@@ -184,70 +463,34 @@ void NbestHopeFearDecoder::HopeFear(
   HopeFearData* hopeFear
 )
 {
+  NbestHopeFear(CurrentHypPack(*train_), scorer_, safe_hope_, backgroundBleu, wv, hopeFear);
+}
 
+void NbestHopeFearDecoder::MaxModel(const AvgWeightVector& wv, std::vector<ValType>* stats)
+{
+  NbestMaxModel(CurrentHypPack(*train_), wv, stats);
+}
 
-  // Hope / fear decode
-  ValType hope_scale = 1.0;
-  size_t hope_index=0, fear_index=0, model_index=0;
-  ValType hope_score=0, fear_score=0, model_score=0;
-  for(size_t safe_loop=0; safe_loop<2; safe_loop++) {
-    ValType hope_bleu=0, hope_model=0;
-    for(size_t i=0; i< train_->cur_size(); i++) {
-      const MiraFeatureVector& vec=train_->featuresAt(i);
-      ValType score = wv.score(vec);
-      ValType bleu = scorer_->calculateSentenceLevelBackgroundScore(train_->scoresAt(i),backgroundBleu);
-      // Hope
-      if(i==0 || (hope_scale*score + bleu) > hope_score) {
-        hope_score = hope_scale*score + bleu;
-        hope_index = i;
-        hope_bleu = bleu;
-        hope_model = score;
-      }
-      // Fear
-      if(i==0 || (score - bleu) > fear_score) {
-        fear_score = score - bleu;
-        fear_index = i;
-      }
-      // Model
-      if(i==0 || score > model_score) {
-        model_score = score;
-        model_index = i;
-      }
-    }
-    // Outer loop rescales the contribution of model score to 'hope' in antagonistic cases
-    // where model score is having far more influence than BLEU
-    hope_bleu *= BLEU_RATIO; // We only care about cases where model has MUCH more influence than BLEU
-    if(safe_hope_ && safe_loop==0 && abs(hope_model)>1e-8 && abs(hope_bleu)/abs(hope_model)<hope_scale)
-      hope_scale = abs(hope_bleu) / abs(hope_model);
-    else break;
-  }
-  hopeFear->modelFeatures = train_->featuresAt(model_index);
-  hopeFear->hopeFeatures = train_->featuresAt(hope_index);
-  hopeFear->fearFeatures = train_->featuresAt(fear_index);
-
-  hopeFear->hopeStats = train_->scoresAt(hope_index);
-  hopeFear->hopeBleu = scorer_->calculateSentenceLevelBackgroundScore(hopeFear->hopeStats, backgroundBleu);
-  const vector<float>& fear_stats = train_->scoresAt(fear_index);
-  hopeFear->fearBleu = scorer_->calculateSentenceLevelBackgroundScore(fear_stats, backgroundBleu);
+size_t NbestHopeFearDecoder::Remaining() const
+{
+  return randomAccess_ ? randomAccess_->num_left() : 0;
+}
 
-  hopeFear->modelStats = train_->scoresAt(model_index);
-  hopeFear->hopeFearEqual = (hope_index == fear_index);
+void NbestHopeFearDecoder::HopeFearAt(
+  size_t offset,
+  const std::vector<ValType>& backgroundBleu,
+  const MiraWeightVector& wv,
+  HopeFearData* hopeFear
+) const
+{
+  StoredHypPack pack(randomAccess_->featuresOf(offset), randomAccess_->scoresOf(offset));
+  NbestHopeFear(pack, scorer_, safe_hope_, backgroundBleu, wv, hopeFear);
 }
 
-void NbestHopeFearDecoder::MaxModel(const AvgWeightVector& wv, std::vector<ValType>* stats)
+void NbestHopeFearDecoder::MaxModelAt(size_t offset, const AvgWeightVector& wv, std::vector<ValType>* stats) const
 {
-  // Find max model
-  size_t max_index=0;
-  ValType max_score=0;
-  for(size_t i=0; i<train_->cur_size(); i++) {
-    MiraFeatureVector vec(train_->featuresAt(i));
-    ValType score = wv.score(vec);
-    if(i==0 || score > max_score) {
-      max_index = i;
-      max_score = score;
-    }
-  }
-  *stats = train_->scoresAt(max_index);
+  StoredHypPack pack(randomAccess_->featuresOf(offset), randomAccess_->scoresOf(offset));
+  NbestMaxModel(pack, wv, stats);
 }
 
 
@@ -328,16 +571,38 @@ bool HypergraphHopeFearDecoder::finished()
   return sentenceIdIter_ == sentenceIds_.end();
 }
 
+size_t HypergraphHopeFearDecoder::Remaining() const
+{
+  return sentenceIds_.end() - sentenceIdIter_;
+}
+
+const Graph& HypergraphHopeFearDecoder::GraphAt(size_t offset) const
+{
+  GraphColl::const_iterator graph = graphs_.find(*(sentenceIdIter_ + offset));
+  UTIL_THROW_IF(graph == graphs_.end(), HypergraphException, "No hypergraph for sentence " << *(sentenceIdIter_ + offset));
+  return *(graph->second);
+}
+
 void HypergraphHopeFearDecoder::HopeFear(
   const vector<ValType>& backgroundBleu,
   const MiraWeightVector& wv,
   HopeFearData* hopeFear
 )
 {
-  size_t sentenceId = *sentenceIdIter_;
+  HopeFearAt(0, backgroundBleu, wv, hopeFear);
+}
+
+void HypergraphHopeFearDecoder::HopeFearAt(
+  size_t offset,
+  const vector<ValType>& backgroundBleu,
+  const MiraWeightVector& wv,
+  HopeFearData* hopeFear
+) const
+{
+  size_t sentenceId = *(sentenceIdIter_ + offset);
   SparseVector weights;
   wv.ToSparse(&weights, num_dense_);
-  const Graph& graph = *(graphs_[sentenceId]);
+  const Graph& graph = GraphAt(offset);
 
   // ValType hope_scale = 1.0;
   HgHypothesis hopeHypo, fearHypo, modelHypo;
@@ -428,13 +693,18 @@ void HypergraphHopeFearDecoder::HopeFear(
 void HypergraphHopeFearDecoder::MaxModel(const AvgWeightVector& wv, vector<ValType>* stats)
 {
   assert(!finished());
+  MaxModelAt(0, wv, stats);
+}
+
+void HypergraphHopeFearDecoder::MaxModelAt(size_t offset, const AvgWeightVector& wv, vector<ValType>* stats) const
+{
   HgHypothesis bestHypo;
-  size_t sentenceId = *sentenceIdIter_;
+  size_t sentenceId = *(sentenceIdIter_ + offset);
   SparseVector weights;
   wv.ToSparse(&weights, num_dense_);
   vector<ValType> bg(scorer_->NumberOfScores());
   //cerr << "Calculating bleu on " << sentenceId << endl;
-  Viterbi(*(graphs_[sentenceId]), weights, 0, references_, sentenceId, bg, &bestHypo);
+  Viterbi(GraphAt(offset), weights, 0, references_, sentenceId, bg, &bestHypo);
   stats->resize(bestHypo.bleuStats.size());
   /*
   for (size_t i = 0; i < bestHypo.text.size(); ++i) {
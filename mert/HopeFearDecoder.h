@@ -23,6 +23,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include "moses/ThreadPool.h"
+
 #include "ForestRescore.h"
 #include "Hypergraph.h"
 #include "HypPackEnumerator.h"
@@ -64,6 +66,8 @@ struct HopeFearData {
 class HopeFearDecoder
 {
 public:
+  HopeFearDecoder() : scorer_(NULL), threads_(1) {}
+
   //iterator methods
   virtual void reset() = 0;
   virtual void next() = 0;
@@ -80,6 +84,18 @@ public:
     HopeFearData* hopeFear
   ) = 0;
 
+  /**
+    * Hope, fear and model hypotheses of the current sentence and the ones
+    * after it, up to batchSize of them, all with the same weights. Moves
+    * on past the last of them.
+    **/
+  void HopeFear(
+    const std::vector<ValType>& backgroundBleu,
+    const MiraWeightVector& wv,
+    std::size_t batchSize,
+    std::vector<HopeFearData>* hopeFears
+  );
+
   /** Max score decoding */
   virtual void MaxModel(const AvgWeightVector& wv, std::vector<ValType>* stats)
   = 0;
@@ -87,8 +103,42 @@ public:
   /** Calculate bleu on training set */
   ValType Evaluate(const AvgWeightVector& wv);
 
+  /** Number of sentences decoded at the same time */
+  void SetThreads(std::size_t threads);
+
 protected:
+  /**
+    * Number of sentences from the current one to the end of the epoch that
+    * HopeFearAt() and MaxModelAt() can decode, 0 without random access.
+    **/
+  virtual std::size_t Remaining() const = 0;
+
+  /**
+    * HopeFear() and MaxModel() of the sentence offset places after the
+    * current one. These may be called from several threads at once.
+    **/
+  virtual void HopeFearAt(
+    std::size_t offset,
+    const std::vector<ValType>& backgroundBleu,
+    const MiraWeightVector& wv,
+    HopeFearData* hopeFear
+  ) const = 0;
+  virtual void MaxModelAt(std::size_t offset, const AvgWeightVector& wv,
+                          std::vector<ValType>* stats) const = 0;
+
   Scorer* scorer_;
+
+private:
+  void HopeFearRange(std::size_t first, const std::vector<ValType>* backgroundBleu,
+                     const MiraWeightVector* wv, std::vector<HopeFearData>* hopeFears) const;
+  void MaxModelRange(std::size_t first, const AvgWeightVector* wv,
+                     std::vector<std::vector<ValType> >* stats) const;
+
+  std::size_t threads_;
+#ifdef WITH_THREADS
+  //! the calling thread decodes one range itself, so threads_ - 1 workers
+  boost::scoped_ptr<Moses::ThreadPool> pool_;
+#endif
 };
 
 
@@ -116,8 +166,22 @@ public:
 
   virtual void MaxModel(const AvgWeightVector& wv, std::vector<ValType>* stats);
 
+protected:
+  virtual std::size_t Remaining() const;
+
+  virtual void HopeFearAt(
+    std::size_t offset,
+    const std::vector<ValType>& backgroundBleu,
+    const MiraWeightVector& wv,
+    HopeFearData* hopeFear
+  ) const;
+
+  virtual void MaxModelAt(std::size_t offset, const AvgWeightVector& wv,
+                          std::vector<ValType>* stats) const;
+
 private:
   boost::scoped_ptr<HypPackEnumerator> train_;
+  RandomAccessHypPackEnumerator* randomAccess_; //train_ unless streaming
   bool safe_hope_;
 
 };
@@ -152,7 +216,22 @@ public:
 
   virtual void MaxModel(const AvgWeightVector& wv, std::vector<ValType>* stats);
 
+protected:
+  virtual std::size_t Remaining() const;
+
+  virtual void HopeFearAt(
+    std::size_t offset,
+    const std::vector<ValType>& backgroundBleu,
+    const MiraWeightVector& wv,
+    HopeFearData* hopeFear
+  ) const;
+
+  virtual void MaxModelAt(std::size_t offset, const AvgWeightVector& wv,
+                          std::vector<ValType>* stats) const;
+
 private:
+  const Graph& GraphAt(std::size_t offset) const;
+
   size_t num_dense_;
   //maps sentence Id to graph ptr
   typedef std::map<size_t, boost::shared_ptr<Graph> > GraphColl;
@@ -211,6 +211,19 @@ size_t RandomAccessHypPackEnumerator::cur_id()
 {
   return m_indexes[m_cur_index];
 }
+
+size_t RandomAccessHypPackEnumerator::num_left() const
+{
+  return m_indexes.size() - m_cur_index;
+}
+const vector<MiraFeatureVector>& RandomAccessHypPackEnumerator::featuresOf(size_t offset) const
+{
+  return m_features[m_indexes[m_cur_index + offset]];
+}
+const vector<ScoreDataItem>& RandomAccessHypPackEnumerator::scoresOf(size_t offset) const
+{
+  return m_scores[m_indexes[m_cur_index + offset]];
+}
 // --Emacs trickery--
 // Local Variables:
 // mode:c++
@@ -95,6 +95,12 @@ public:
   virtual const MiraFeatureVector& featuresAt(std::size_t i);
   virtual const ScoreDataItem& scoresAt(std::size_t i);
 
+  // The lists from the current one to the end of the epoch, offset
+  // counting from the current one.  Safe to call from several threads.
+  std::size_t num_left() const;
+  const std::vector<MiraFeatureVector>& featuresOf(std::size_t offset) const;
+  const std::vector<ScoreDataItem>& scoresOf(std::size_t offset) const;
+
 private:
   bool m_no_shuffle;
   std::size_t m_cur_index;
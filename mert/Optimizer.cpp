@@ -8,6 +8,12 @@
 #include <cfloat>
 #include <iostream>
 #include <stdint.h>
+#include <algorithm>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
 
 #include "Point.h"
 #include "Util.h"
@@ -39,7 +45,7 @@ namespace MosesTuning
 
 
 Optimizer::Optimizer(unsigned Pd, const vector<unsigned>& i2O, const vector<bool>& pos, const vector<parameter_t>& start, unsigned int nrandom)
-  : m_scorer(NULL), m_feature_data(), m_num_random_directions(nrandom), m_positive(pos)
+  : m_scorer(NULL), m_feature_data(), m_num_random_directions(nrandom), m_threads(1), m_positive(pos)
 {
   // Warning: the init vector is a full set of parameters, of dimension m_pdim!
   Point::m_pdim = Pd;
@@ -90,92 +96,146 @@ map<float,diff_t >::iterator AddThreshold(map<float,diff_t >& thresholdmap, floa
   return it;
 }
 
-statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction, Point& bestpoint) const
+void Optimizer::ComputeEnvelopes(const vector<unsigned>& indices,
+                                 const vector<parameter_t>& origin,
+                                 const vector<parameter_t>& direction,
+                                 size_t begin, size_t end,
+                                 vector<Envelope>& envelopes) const
 {
-  // We are looking for the best Point on the line y=Origin+x*direction
-  float min_int = 0.0001;
-  //typedef pair<unsigned,unsigned> diff;//first the sentence that changes, second is the new 1best for this sentence
-  //list<threshold> thresholdlist;
-
-  map<float,diff_t> thresholdmap;
-  thresholdmap[MIN_FLOAT] = diff_t();
-  vector<unsigned> first1best;       // the vector of nbests for x=-inf
-  for (unsigned int S = 0; S < size(); S++) {
-    map<float,diff_t >::iterator previnserted = thresholdmap.begin();
+  vector<pair<float, unsigned> > gradient;
+  vector<float> f0;
+  for (size_t S = begin; S < end; S++) {
     // First, we determine the translation with the best feature score
     // for each sentence and each value of x.
-    //cerr << "Sentence " << S << endl;
-    multimap<float, unsigned> gradient;
-    vector<float> f0;
-    f0.resize(m_feature_data->get(S).size());
-    for (unsigned j = 0; j < m_feature_data->get(S).size(); j++) {
+    const FeatureArray& candidates = m_feature_data->get(S);
+    gradient.resize(candidates.size());
+    f0.resize(candidates.size());
+    for (unsigned j = 0; j < candidates.size(); j++) {
+      // Both dot products in one pass over the features, summed up
+      // in the same order and precision as Point::operator*.
+      const FeatureStatsType* features = candidates.get(j).getArray();
+      double slope = 0.0;
+      double offset = 0.0;
+      for (size_t k = 0; k < indices.size(); k++) {
+        const FeatureStatsType feature = features[indices[k]];
+        slope += direction[k] * feature;
+        offset += origin[k] * feature;
+      }
       // gradient of the feature function for this particular target sentence
-      gradient.insert(pair<float, unsigned>(direction * (m_feature_data->get(S,j)), j));
-      // compute the feature function at the origin point
-      f0[j] = origin * m_feature_data->get(S, j);
+      gradient[j] = pair<float, unsigned>(slope, j);
+      // the feature function at the origin point
+      f0[j] = offset;
     }
-    // Now let's compute the 1best for each value of x.
-
-    //    vector<pair<float,unsigned> > onebest;
-
+    // ordered by gradient, then by candidate
+    sort(gradient.begin(), gradient.end());
 
-    multimap<float,unsigned>::iterator gradientit = gradient.begin();
-    multimap<float,unsigned>::iterator highest_f0 = gradient.begin();
-
-    float smallest = gradientit->first;//smallest gradient
+    // Now let's compute the 1best for each value of x.
+    size_t highest_f0 = 0;
+    float smallest = gradient[0].first;//smallest gradient
     // Several candidates can have the lowest slope (e.g., for word penalty where the gradient is an integer).
-
-    gradientit++;
-    while (gradientit != gradient.end() && gradientit->first == smallest) {
-      //   cerr<<"ni"<<gradientit->second<<endl;;
-      //cerr<<"fos"<<f0[gradientit->second]<<" "<<f0[index]<<" "<<index<<endl;
-      if (f0[gradientit->second] > f0[highest_f0->second])
-        highest_f0 = gradientit;//the highest line is the one with he highest f0
-      gradientit++;
+    for (size_t i = 1; i < gradient.size() && gradient[i].first == smallest; i++) {
+      if (f0[gradient[i].second] > f0[gradient[highest_f0].second])
+        highest_f0 = i;//the highest line is the one with he highest f0
     }
 
-    gradientit = highest_f0;
-    first1best.push_back(highest_f0->second);
+    Envelope& envelope = envelopes[S];
+    envelope.first1best = gradient[highest_f0].second;
+    envelope.changes.clear();
 
     // Now we look for the intersections points indicating a change of 1 best.
     // We use the fact that the function is convex, which means that the gradient can only go up.
-    while (gradientit != gradient.end()) {
-      map<float,unsigned>::iterator leftmost = gradientit;
-      float m = gradientit->first;
-      float b = f0[gradientit->second];
-      multimap<float,unsigned>::iterator gradientit2 = gradientit;
-      gradientit2++;
+    size_t current = highest_f0;
+    while (current < gradient.size()) {
+      size_t leftmost = current;
+      float m = gradient[current].first;
+      float b = f0[gradient[current].second];
       float leftmostx = MAX_FLOAT;
-      for (; gradientit2 != gradient.end(); gradientit2++) {
-        //cerr<<"--"<<d++<<' '<<gradientit2->first<<' '<<gradientit2->second<<endl;
+      for (size_t i = current + 1; i < gradient.size(); i++) {
         // Look for all candidate with a gradient bigger than the current one, and
         // find the one with the leftmost intersection.
-        float curintersect;
-        if (m != gradientit2->first) {
-          curintersect = intersect(m, b, gradientit2->first, f0[gradientit2->second]);
-          //cerr << "curintersect: " << curintersect << " leftmostx: " << leftmostx << endl;
+        if (m != gradient[i].first) {
+          float curintersect = intersect(m, b, gradient[i].first, f0[gradient[i].second]);
           if (curintersect<=leftmostx) {
             // We have found an intersection to the left of the leftmost we had so far.
             // We might have curintersect==leftmostx for example is 2 candidates are the same
-            // in that case its better its better to update leftmost to gradientit2 to avoid some recomputing later.
+            // in that case its better its better to update leftmost to i to avoid some recomputing later.
             leftmostx = curintersect;
-            leftmost = gradientit2; // this is the new reference
+            leftmost = i; // this is the new reference
           }
         }
       }
-      if (leftmost == gradientit) {
+      if (leftmost == current) {
         // We didn't find any more intersections.
         // The rightmost bestindex is the one with the highest slope.
 
         // They should be equal but there might be.
-        UTIL_THROW_IF(abs(leftmost->first-gradient.rbegin()->first) >= 0.0001,
+        UTIL_THROW_IF(abs(gradient[leftmost].first-gradient.back().first) >= 0.0001,
                       util::Exception, "Error");
         // A small difference due to rounding error
         break;
       }
       // We have found the next intersection!
+      envelope.changes.push_back(pair<float, unsigned>(leftmostx, gradient[leftmost].second));
+      current = leftmost;
+    }
+  }
+}
+
+statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction, Point& bestpoint) const
+{
+  // We are looking for the best Point on the line y=Origin+x*direction
+  float min_int = 0.0001;
+  //typedef pair<unsigned,unsigned> diff;//first the sentence that changes, second is the new 1best for this sentence
+  //list<threshold> thresholdlist;
+
+  // The weights in the order Point::operator* adds up the features:
+  // the optimized ones, then the fixed ones.
+  vector<unsigned> indices;
+  vector<parameter_t> originWeights;
+  vector<parameter_t> directionWeights;
+  for (unsigned i = 0; i < origin.size(); i++) {
+    indices.push_back(Point::OptimizeAll() ? i : Point::m_opt_indices[i]);
+    originWeights.push_back(origin[i]);
+    directionWeights.push_back(direction[i]);
+  }
+  if (!Point::OptimizeAll()) {
+    for (map<unsigned, parameter_t>::const_iterator it = Point::m_fixed_weights.begin();
+         it != Point::m_fixed_weights.end(); ++it) {
+      indices.push_back(it->first);
+      originWeights.push_back(it->second);
+      directionWeights.push_back(it->second);
+    }
+  }
 
-      pair<unsigned,unsigned> newd(S, leftmost->second);//new onebest for Sentence S is leftmost->second
+  // The envelopes of the sentences are independent of each other.
+  vector<Envelope> envelopes(size());
+#ifdef WITH_THREADS
+  const size_t threads = min(m_threads, static_cast<size_t>(size()));
+  if (threads > 1) {
+    boost::thread_group group;
+    for (size_t t = 0; t < threads; t++) {
+      group.create_thread(boost::bind(&Optimizer::ComputeEnvelopes, this,
+                                      boost::cref(indices), boost::cref(originWeights),
+                                      boost::cref(directionWeights),
+                                      size() * t / threads, size() * (t + 1) / threads,
+                                      boost::ref(envelopes)));
+    }
+    group.join_all();
+  } else
+#endif
+    ComputeEnvelopes(indices, originWeights, directionWeights, 0, size(), envelopes);
+
+  // Merge the changes of 1 best into the thresholds, sentence by sentence.
+  map<float,diff_t> thresholdmap;
+  thresholdmap[MIN_FLOAT] = diff_t();
+  vector<unsigned> first1best;       // the vector of nbests for x=-inf
+  for (unsigned int S = 0; S < size(); S++) {
+    map<float,diff_t >::iterator previnserted = thresholdmap.begin();
+    first1best.push_back(envelopes[S].first1best);
+    const vector<pair<float, unsigned> >& changes = envelopes[S].changes;
+    for (size_t c = 0; c < changes.size(); c++) {
+      float leftmostx = changes[c].first;
+      pair<unsigned,unsigned> newd(S, changes[c].second);//new onebest for Sentence S is changes[c].second
 
       if (leftmostx-previnserted->first < min_int) {
         // Require that the intersection Point be at least min_int to the right of the previous
@@ -221,8 +281,7 @@ statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction,
       } else { //normal insertion process
         previnserted = AddThreshold(thresholdmap, leftmostx, newd);
       }
-      gradientit = leftmost;
-    } // while (gradientit!=gradient.end()){
+    }
   }   // loop on S
 
   // Now the thresholdlist is up to date: it contains a list of all the parameter_ts where
@@ -25,9 +25,30 @@ protected:
   Scorer *m_scorer;      // no accessor for them only child can use them
   FeatureDataHandle m_feature_data;  // no accessor for them only child can use them
   unsigned int m_num_random_directions;
+  std::size_t m_threads;
 
   const std::vector<bool>& m_positive;
 
+  /**
+   * Upper envelope of the lines of one sentence along a direction:
+   * the best candidate at x=-inf, followed by the points where the best
+   * candidate changes, from left to right.
+   */
+  struct Envelope {
+    unsigned first1best;
+    std::vector<std::pair<float, unsigned> > changes;
+  };
+
+  /**
+   * Compute the envelopes of sentences [begin, end). The weights are
+   * given in the order in which Point::operator* sums them up.
+   */
+  void ComputeEnvelopes(const std::vector<unsigned>& indices,
+                        const std::vector<parameter_t>& origin,
+                        const std::vector<parameter_t>& direction,
+                        std::size_t begin, std::size_t end,
+                        std::vector<Envelope>& envelopes) const;
+
 public:
   Optimizer(unsigned Pd, const std::vector<unsigned>& i2O, const std::vector<bool>& positive, const std::vector<parameter_t>& start, unsigned int nrandom);
 
@@ -37,6 +58,12 @@ public:
   void SetFeatureData(FeatureDataHandle feature_data) {
     m_feature_data = feature_data;
   }
+  /**
+   * Number of threads a line search may split the sentences over.
+   */
+  void SetThreads(std::size_t threads) {
+    m_threads = threads;
+  }
   virtual ~Optimizer();
 
   unsigned size() const {
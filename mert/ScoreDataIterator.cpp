@@ -46,7 +46,8 @@ void ScoreDataIterator::readNext()
   m_next.clear();
   try {
     StringPiece marker = m_in->ReadDelimited();
-    if (marker != StringPiece(SCORES_TXT_BEGIN)) {
+    const bool bin = (marker == StringPiece(SCORES_BIN_BEGIN));
+    if (!bin && marker != StringPiece(SCORES_TXT_BEGIN)) {
       throw FileFormatException(m_in->FileName(), marker.as_string());
     }
     // size_t sentenceId =
@@ -55,6 +56,13 @@ void ScoreDataIterator::readNext()
     size_t length = m_in->ReadULong();
     m_in->ReadLine(); //ignore rest of line
     for (size_t i = 0; i < count; ++i) {
+      if (bin) {
+        m_next.push_back(ScoreDataItem(length));
+        if (length) {
+          ReadBinary(*m_in, reinterpret_cast<char*>(&m_next.back()[0]), length * sizeof(ScoreStatsType));
+        }
+        continue;
+      }
       StringPiece line = m_in->ReadLine();
       m_next.push_back(ScoreDataItem());
       for (TokenIter<AnyCharacter, true> token(line,AnyCharacter(" \t")); token; ++token) {
@@ -66,7 +74,7 @@ void ScoreDataIterator::readNext()
       }
     }
     StringPiece line = m_in->ReadLine();
-    if (line != StringPiece(SCORES_TXT_END)) {
+    if (line != StringPiece(bin ? SCORES_BIN_END : SCORES_TXT_END)) {
       throw FileFormatException(m_in->FileName(), line.as_string());
     }
   } catch (EndOfFileException& e) {
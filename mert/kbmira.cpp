@@ -79,6 +79,8 @@ int main(int argc, char** argv)
   bool verbose = false; // Verbose updates
   bool safe_hope = false; // Model score cannot have more than BLEU_RATIO times more influence than BLEU
   size_t hgPruning = 50; //prune hypergraphs to have this many edges per reference word
+  size_t threads = 1; // Sentences decoded at the same time
+  size_t batchSize = 0; // Sentences decoded with the same weights, defaults to threads
 
   // Command-line processing follows pro.cpp
   po::options_description desc("Allowed options");
@@ -105,6 +107,10 @@ int main(int argc, char** argv)
   ("verbose", po::value(&verbose)->zero_tokens()->default_value(false), "Verbose updates")
   ("safe-hope", po::value(&safe_hope)->zero_tokens()->default_value(false), "Mode score's influence on hope decoding is limited")
   ("hg-prune", po::value<size_t>(&hgPruning), "Prune hypergraphs to have this many edges per reference word")
+#ifdef WITH_THREADS
+  ("threads,T", po::value<size_t>(&threads), "Number of threads for hope/fear and model decoding (default 1)")
+#endif
+  ("batch-size,b", po::value<size_t>(&batchSize), "Number of sentences decoded with the same weights before their updates (default: the number of threads). Results only depend on this, not on the number of threads")
   ;
 
   po::options_description cmdline_options;
@@ -119,7 +125,12 @@ int main(int argc, char** argv)
     exit(0);
   }
 
+  if (threads < 1) threads = 1;
+  if (batchSize < 1) batchSize = threads;
+
   cerr << "kbmira with c=" << c << " decay=" << decay << " no_shuffle=" << no_shuffle << endl;
+  if (threads > 1 || batchSize > 1)
+    cerr << "Using " << threads << " threads and batches of " << batchSize << " sentences" << endl;
 
   if (vm.count("random-seed")) {
     cerr << "Initialising random seed to " << seed << endl;
@@ -151,6 +162,7 @@ int main(int argc, char** argv)
   } else {
     UTIL_THROW(util::Exception, "Unknown batch mira type: '" << type << "'");
   }
+  decoder->SetThreads(threads);
 
   // Training loop
   if (!streaming_out)
@@ -162,48 +174,52 @@ int main(int argc, char** argv)
     int iNumUpdates = 0;
     ValType totalLoss = 0.0;
     size_t sentenceIndex = 0;
-    for(decoder->reset(); !decoder->finished(); decoder->next()) {
-      HopeFearData hfd;
-      decoder->HopeFear(bg,*wv,&hfd);
+    vector<HopeFearData> batch;
+    for(decoder->reset(); !decoder->finished(); ) {
+      // Hope/fear of the whole batch with the same weights, then the updates in order
+      decoder->HopeFear(bg,*wv,batchSize,&batch);
+      for (size_t b = 0; b < batch.size(); ++b) {
+        const HopeFearData& hfd = batch[b];
 
-      // Update weights
-      if (!hfd.hopeFearEqual && hfd.hopeBleu  > hfd.fearBleu) {
-        // Vector difference
-        MiraFeatureVector diff = hfd.hopeFeatures - hfd.fearFeatures;
-        // Bleu difference
-        //assert(hfd.hopeBleu + 1e-8 >= hfd.fearBleu);
-        ValType delta = hfd.hopeBleu - hfd.fearBleu;
-        // Loss and update
-        ValType diff_score = wv->score(diff);
-        ValType loss = delta - diff_score;
-        if(verbose) {
-          cerr << "Updating sent " << sentenceIndex << endl;
-          cerr << "Wght: " << *wv << endl;
-          cerr << "Hope: " << hfd.hopeFeatures << " BLEU:" << hfd.hopeBleu << " Score:" << wv->score(hfd.hopeFeatures) << endl;
-          cerr << "Fear: " << hfd.fearFeatures << " BLEU:" << hfd.fearBleu << " Score:" << wv->score(hfd.fearFeatures) << endl;
-          cerr << "Diff: " << diff << " BLEU:" << delta << " Score:" << diff_score << endl;
-          cerr << "Loss: " << loss <<  " Scale: " << 1 << endl;
-          cerr << endl;
-        }
-        if(loss > 0) {
-          ValType eta = min(c, loss / diff.sqrNorm());
-          wv->update(diff,eta);
-          totalLoss+=loss;
-          iNumUpdates++;
-        }
-        // Update BLEU statistics
-        for(size_t k=0; k<bg.size(); k++) {
-          bg[k]*=decay;
-          if(model_bg)
-            bg[k]+=hfd.modelStats[k];
-          else
-            bg[k]+=hfd.hopeStats[k];
+        // Update weights
+        if (!hfd.hopeFearEqual && hfd.hopeBleu  > hfd.fearBleu) {
+          // Vector difference
+          MiraFeatureVector diff = hfd.hopeFeatures - hfd.fearFeatures;
+          // Bleu difference
+          //assert(hfd.hopeBleu + 1e-8 >= hfd.fearBleu);
+          ValType delta = hfd.hopeBleu - hfd.fearBleu;
+          // Loss and update
+          ValType diff_score = wv->score(diff);
+          ValType loss = delta - diff_score;
+          if(verbose) {
+            cerr << "Updating sent " << sentenceIndex << endl;
+            cerr << "Wght: " << *wv << endl;
+            cerr << "Hope: " << hfd.hopeFeatures << " BLEU:" << hfd.hopeBleu << " Score:" << wv->score(hfd.hopeFeatures) << endl;
+            cerr << "Fear: " << hfd.fearFeatures << " BLEU:" << hfd.fearBleu << " Score:" << wv->score(hfd.fearFeatures) << endl;
+            cerr << "Diff: " << diff << " BLEU:" << delta << " Score:" << diff_score << endl;
+            cerr << "Loss: " << loss <<  " Scale: " << 1 << endl;
+            cerr << endl;
+          }
+          if(loss > 0) {
+            ValType eta = min(c, loss / diff.sqrNorm());
+            wv->update(diff,eta);
+            totalLoss+=loss;
+            iNumUpdates++;
+          }
+          // Update BLEU statistics
+          for(size_t k=0; k<bg.size(); k++) {
+            bg[k]*=decay;
+            if(model_bg)
+              bg[k]+=hfd.modelStats[k];
+            else
+              bg[k]+=hfd.hopeStats[k];
+          }
         }
+        iNumExamples++;
+        ++sentenceIndex;
+        if (streaming_out)
+          cout << *wv << endl;
       }
-      iNumExamples++;
-      ++sentenceIndex;
-      if (streaming_out)
-        cout << *wv << endl;
     }
     // Training Epoch summary
     cerr << iNumUpdates << "/" << iNumExamples << " updates"
@@ -2,6 +2,7 @@
  * \description This is the main for the new version of the mert algorithm developed during the 2nd MT marathon
 */
 
+#include <algorithm>
 #include <limits>
 #include <unistd.h>
 #include <cstdlib>
@@ -461,6 +462,15 @@ int main(int argc, char **argv)
     allTasks.resize(option.shard_count);
   }
 
+#ifdef WITH_THREADS
+  // Threads not needed for the optimisations themselves split the
+  // sentences of each line search.
+  const size_t line_search_threads =
+    std::max<size_t>(1, option.num_threads / (allTasks.size() * startingPoints.size()));
+  if (line_search_threads > 1)
+    cerr << "Using " << line_search_threads << " threads in each line search" << endl;
+#endif
+
   // launch tasks
   for (size_t i = 0; i < allTasks.size(); ++i) {
     Data& data_ref = data;
@@ -471,6 +481,9 @@ int main(int argc, char **argv)
     Optimizer *optimizer = OptimizerFactory::BuildOptimizer(option.pdim, to_optimize, positive, start_list[0], option.optimize_type, option.nrandom);
     optimizer->SetScorer(data_ref.getScorer());
     optimizer->SetFeatureData(data_ref.getFeatureData());
+#ifdef WITH_THREADS
+    optimizer->SetThreads(line_search_threads);
+#endif
     // A task for each start point
     for (size_t j = 0; j < startingPoints.size(); ++j) {
       boost::shared_ptr<OptimizationTask>
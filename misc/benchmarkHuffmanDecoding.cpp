@@ -0,0 +1,175 @@
+// Benchmark the Huffman decoders of the compact phrase table.
+//
+// The target words and scores of a text phrase table are coded the way the
+// compact phrase table codes them: one canonical Huffman code for the
+// target symbols and one per score. The whole coded table is then decoded
+// once bit by bit, as the decoder used to do, and once with the lookup table
+// decoder, and the speed of both is reported in MB of coded data per second.
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include "util/exception.hh"
+#include "util/file_piece.hh"
+#include "util/tokenize_piece.hh"
+#include "util/usage.hh"
+#include "moses/TranslationModel/CompactPT/CanonicalHuffman.h"
+
+using namespace Moses;
+
+namespace
+{
+
+typedef boost::unordered_map<unsigned, size_t> SymbolCounts;
+typedef boost::unordered_map<float, size_t> ScoreCounts;
+
+struct Entry {
+  std::vector<unsigned> symbols;
+  std::vector<float> scores;
+};
+
+void ReadTable(const char *path, std::vector<Entry> &entries, size_t &numScores)
+{
+  util::FilePiece in(path);
+  boost::unordered_map<std::string, unsigned> vocab;
+  numScores = 0;
+  StringPiece line;
+  while (in.ReadLineOrEOF(line)) {
+    util::TokenIter<util::MultiCharacter> field(line, "|||");
+    UTIL_THROW_IF2(!field, "Empty line in phrase table");
+    ++field; // source
+    UTIL_THROW_IF2(!field, "No target phrase in line: " << line);
+
+    entries.push_back(Entry());
+    Entry &entry = entries.back();
+    for (util::TokenIter<util::SingleCharacter, true> word(*field, ' '); word; ++word) {
+      std::pair<boost::unordered_map<std::string, unsigned>::iterator, bool> ins
+      = vocab.insert(std::make_pair(word->as_string(), unsigned(vocab.size())));
+      entry.symbols.push_back(ins.first->second);
+    }
+
+    ++field;
+    UTIL_THROW_IF2(!field, "No scores in line: " << line);
+    for (util::TokenIter<util::SingleCharacter, true> score(*field, ' '); score; ++score)
+      entry.scores.push_back(std::atof(score->as_string().c_str()));
+    if (!numScores)
+      numScores = entry.scores.size();
+    UTIL_THROW_IF2(entry.scores.size() != numScores, "Inconsistent number of scores in line: " << line);
+  }
+}
+
+template <class Decode>
+double TimeDecoding(const std::string &coded, Decode &decode, size_t repeat)
+{
+  double best = 0;
+  for (size_t r = 0; r < repeat; ++r) {
+    std::string data(coded);
+    BitWrapper<> stream(data);
+    double start = util::WallTime();
+    decode(stream);
+    double seconds = util::WallTime() - start;
+    if (!r || seconds < best)
+      best = seconds;
+  }
+  return best;
+}
+
+// Decodes the whole stream into symbols and scores. Like the phrase
+// decoder it only knows the number of words of each target phrase.
+struct Decoder {
+  CanonicalHuffman<unsigned> *symbolTree;
+  std::vector<CanonicalHuffman<float>*> scoreTrees;
+  std::vector<unsigned> targetLengths;
+  std::vector<unsigned> symbols;
+  std::vector<float> scores;
+  bool bitwise;
+
+  void operator()(BitWrapper<> &stream) {
+    unsigned *symbol = &symbols[0];
+    float *score = &scores[0];
+    for (size_t e = 0; e < targetLengths.size(); ++e) {
+      for (size_t i = 0; i < targetLengths[e]; ++i)
+        *symbol++ = bitwise ? symbolTree->ReadBitwise(stream) : symbolTree->Read(stream);
+      for (size_t i = 0; i < scoreTrees.size(); ++i)
+        *score++ = bitwise ? scoreTrees[i]->ReadBitwise(stream) : scoreTrees[i]->Read(stream);
+    }
+  }
+};
+
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2 || argc > 3) {
+    std::cerr << "Usage: " << argv[0] << " phrase-table [repeat]" << std::endl;
+    return 1;
+  }
+  size_t repeat = argc == 3 ? std::atoi(argv[2]) : 3;
+
+  std::vector<Entry> entries;
+  size_t numScores;
+  ReadTable(argv[1], entries, numScores);
+
+  SymbolCounts symbolCounts;
+  std::vector<ScoreCounts> scoreCounts(numScores);
+  size_t numSymbols = 0;
+  for (std::vector<Entry>::const_iterator e = entries.begin(); e != entries.end(); ++e) {
+    for (size_t i = 0; i < e->symbols.size(); ++i)
+      symbolCounts[e->symbols[i]]++;
+    for (size_t i = 0; i < e->scores.size(); ++i)
+      scoreCounts[i][e->scores[i]]++;
+    numSymbols += e->symbols.size() + e->scores.size();
+  }
+  UTIL_THROW_IF2(symbolCounts.empty(), "No target words in " << argv[1]);
+
+  Decoder decoder;
+  decoder.symbolTree = new CanonicalHuffman<unsigned>(symbolCounts.begin(), symbolCounts.end());
+  for (size_t i = 0; i < numScores; ++i)
+    decoder.scoreTrees.push_back(new CanonicalHuffman<float>(scoreCounts[i].begin(), scoreCounts[i].end()));
+  std::vector<unsigned> expectedSymbols;
+  std::vector<float> expectedScores;
+  for (std::vector<Entry>::const_iterator e = entries.begin(); e != entries.end(); ++e) {
+    decoder.targetLengths.push_back(e->symbols.size());
+    expectedSymbols.insert(expectedSymbols.end(), e->symbols.begin(), e->symbols.end());
+    expectedScores.insert(expectedScores.end(), e->scores.begin(), e->scores.end());
+  }
+  // room to write into even if the table is all empty phrases or no scores
+  expectedSymbols.push_back(0);
+  expectedScores.push_back(0);
+
+  std::string coded;
+  BitWrapper<> out(coded);
+  for (std::vector<Entry>::const_iterator e = entries.begin(); e != entries.end(); ++e) {
+    for (size_t i = 0; i < e->symbols.size(); ++i)
+      decoder.symbolTree->Put(out, e->symbols[i]);
+    for (size_t i = 0; i < e->scores.size(); ++i)
+      decoder.scoreTrees[i]->Put(out, e->scores[i]);
+  }
+
+  double megabytes = coded.size() / (1024.0 * 1024.0);
+  std::cout << entries.size() << " phrase pairs, " << numSymbols << " symbols, "
+            << coded.size() << " bytes coded" << std::endl;
+
+  for (size_t method = 0; method < 2; ++method) {
+    const char *name = method ? "table" : "bitwise";
+    decoder.bitwise = !method;
+    decoder.symbols.assign(expectedSymbols.size(), 0);
+    decoder.scores.assign(expectedScores.size(), 0);
+    double seconds = TimeDecoding(coded, decoder, repeat);
+    UTIL_THROW_IF2(decoder.symbols != expectedSymbols || decoder.scores != expectedScores,
+                   name << " decoder returned wrong symbols");
+    std::cout << std::setw(8) << name << ": " << std::fixed << std::setprecision(3)
+              << seconds << " s, " << std::setprecision(1) << megabytes / seconds << " MB/s, "
+              << numSymbols / seconds / 1e6 << " M symbols/s" << std::endl;
+  }
+
+  delete decoder.symbolTree;
+  for (size_t i = 0; i < numScores; ++i)
+    delete decoder.scoreTrees[i];
+  return 0;
+}
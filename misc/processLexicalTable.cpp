@@ -4,6 +4,7 @@
 #include "moses/Timer.h"
 #include "moses/InputFileStream.h"
 #include "moses/FF/LexicalReordering/LexicalReorderingTable.h"
+#include "moses/FF/LexicalReordering/LexicalReorderingTableHashed.h"
 
 using namespace Moses;
 
@@ -15,6 +16,7 @@ void printHelp()
             "options: \n"
             "\t-in  string -- input table file name\n"
             "\t-out string -- prefix of binary table files\n"
+            "\t-hashed     -- write a hashed, quantised table (out.hashlexr)\n"
             "If -in is not specified reads from stdin\n"
             "\n";
 }
@@ -24,6 +26,7 @@ int main(int argc, char** argv)
   std::cerr << "processLexicalTable v0.1 by Konrad Rawlik\n";
   std::string inFilePath;
   std::string outFilePath("out");
+  bool hashed = false;
   if(1 >= argc) {
     printHelp();
     return 1;
@@ -36,6 +39,8 @@ int main(int argc, char** argv)
     } else if("-out" == arg && i+1 < argc) {
       ++i;
       outFilePath = argv[i];
+    } else if("-hashed" == arg) {
+      hashed = true;
     } else {
       //somethings wrong... print help
       printHelp();
@@ -47,11 +52,15 @@ int main(int argc, char** argv)
 
   if(inFilePath.empty()) {
     std::cerr << "processing stdin to " << outFilePath << ".*\n";
-    success = LexicalReorderingTableTree::Create(std::cin, outFilePath);
+    success = hashed
+              ? LexicalReorderingTableHashed::Create(std::cin, outFilePath)
+              : LexicalReorderingTableTree::Create(std::cin, outFilePath);
   } else {
     std::cerr << "processing " << inFilePath<< " to " << outFilePath << ".*\n";
     InputFileStream file(inFilePath);
-    success = LexicalReorderingTableTree::Create(file, outFilePath);
+    success = hashed
+              ? LexicalReorderingTableHashed::Create(file, outFilePath)
+              : LexicalReorderingTableTree::Create(file, outFilePath);
   }
 
   return (success ? 0 : 1);
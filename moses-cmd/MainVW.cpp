@@ -141,7 +141,8 @@ int main(int argc, char const** argv)
     }
 
 #ifdef WITH_THREADS
-    ThreadPool pool(staticData.ThreadCount());
+    ThreadPool pool(staticData.ThreadCount(), staticData.UseWorkStealing(),
+                    staticData.PinThreads());
 #endif
 
     // main loop over set of input sentences
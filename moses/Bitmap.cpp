@@ -27,65 +27,83 @@ namespace Moses
 
 TO_STRING_BODY(Bitmap);
 
-Bitmap::Bitmap(size_t size, const std::vector<bool>& initializer)
-  :m_bitmap(initializer.begin(), initializer.end())
+void Bitmap::Allocate(size_t size)
+{
+  m_size = size;
+  m_numBlocks = std::max<size_t>(1, (size + kBlockBits - 1) / kBlockBits);
+  m_blocks = (m_numBlocks <= kInlineBlocks) ? m_inline : new Block[m_numBlocks];
+}
+
+void Bitmap::UpdateHash()
 {
+  size_t seed = m_size;
+  boost::hash_range(seed, m_blocks, m_blocks + m_numBlocks);
+  m_hash = seed;
+}
 
-  // The initializer may not be of the same length.  Change to the desired
-  // length.  If we need to add any elements, initialize them to false.
-  m_bitmap.resize(size, false);
+Bitmap::Bitmap(size_t size, const std::vector<bool>& initializer)
+{
+  Allocate(size);
+  std::fill(m_blocks, m_blocks + m_numBlocks, Block(0));
+
+  // The initializer may not be of the same length. Positions it does not
+  // cover are false.
+  size_t n = std::min(size, initializer.size());
+  for (size_t pos = 0; pos < n; ++pos) {
+    if (initializer[pos])
+      m_blocks[pos / kBlockBits] |= Block(1) << (pos % kBlockBits);
+  }
 
-  m_numWordsCovered = std::count(m_bitmap.begin(), m_bitmap.end(), true);
+  m_numWordsCovered = 0;
+  for (size_t b = 0; b < m_numBlocks; ++b)
+    m_numWordsCovered += PopCount(m_blocks[b]);
 
   // Find the first gap, and cache it.
-  std::vector<char>::const_iterator first_gap = std::find(
-        m_bitmap.begin(), m_bitmap.end(), false);
-  m_firstGap = (
-                 (first_gap == m_bitmap.end()) ?
-                 NOT_FOUND : first_gap - m_bitmap.begin());
+  size_t gap = FindFrom(0, false);
+  m_firstGap = (gap == m_size) ? NOT_FOUND : gap;
+  UpdateHash();
 }
 
 //! Create Bitmap of length size and initialise.
 Bitmap::Bitmap(size_t size)
-  :m_bitmap(size, false)
-  ,m_firstGap(0)
+  :m_firstGap(0)
   ,m_numWordsCovered(0)
-
 {
+  Allocate(size);
+  std::fill(m_blocks, m_blocks + m_numBlocks, Block(0));
+  UpdateHash();
 }
 
 //! Deep copy.
 Bitmap::Bitmap(const Bitmap &copy)
-  :m_bitmap(copy.m_bitmap)
-  ,m_firstGap(copy.m_firstGap)
+  :m_firstGap(copy.m_firstGap)
   ,m_numWordsCovered(copy.m_numWordsCovered)
+  ,m_hash(copy.m_hash)
 {
+  Allocate(copy.m_size);
+  std::copy(copy.m_blocks, copy.m_blocks + m_numBlocks, m_blocks);
 }
 
 Bitmap::Bitmap(const Bitmap &copy, const Range &range)
-  :m_bitmap(copy.m_bitmap)
-  ,m_firstGap(copy.m_firstGap)
+  :m_firstGap(copy.m_firstGap)
   ,m_numWordsCovered(copy.m_numWordsCovered)
 {
+  Allocate(copy.m_size);
+  std::copy(copy.m_blocks, copy.m_blocks + m_numBlocks, m_blocks);
   SetValueNonOverlap(range);
 }
 
-// for unordered_set in stack
-size_t Bitmap::hash() const
-{
-  size_t ret = boost::hash_value(m_bitmap);
-  return ret;
-}
-
 bool Bitmap::operator==(const Bitmap& other) const
 {
-  return m_bitmap == other.m_bitmap;
+  return m_hash == other.m_hash
+         && m_size == other.m_size
+         && std::equal(m_blocks, m_blocks + m_numBlocks, other.m_blocks);
 }
 
 // friend
 std::ostream& operator<<(std::ostream& out, const Bitmap& bitmap)
 {
-  for (size_t i = 0 ; i < bitmap.m_bitmap.size() ; i++) {
+  for (size_t i = 0 ; i < bitmap.GetSize() ; i++) {
     out << int(bitmap.GetValue(i));
   }
   return out;
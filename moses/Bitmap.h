@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <cstring>
 #include <cmath>
 #include <cstdlib>
+#include <stdint.h>
 #include "TypeDef.h"
 #include "Range.h"
 
@@ -38,38 +39,106 @@ typedef unsigned long WordsBitmapID;
 
 /** Vector of boolean to represent whether a word has been translated or not.
  *
- * Implemented using a vector of char, which is usually the same representation
- * for the elements that a C array of bool would use.  A vector of bool, or a
- * Boost dynamic_bitset, could be much more efficient in theory.  Unfortunately
- * algorithms like std::find() are not optimized for vector<bool> on gcc or
- * clang, and dynamic_bitset lacks all the optimized search operations we want.
- * Only benchmarking will tell what works best.  Perhaps dynamic_bitset could
- * still be a dramatic improvement, if we flip the meaning of the bits around
- * so we can use its find_first() and find_next() for the most common searches.
+ * Bits are packed into 64-bit blocks. Bitmaps of up to 256 words keep their
+ * blocks inline, so that creating one does not touch the heap; longer inputs
+ * fall back to a heap-allocated array. Searches for gaps and edges use
+ * count-trailing/leading-zeros on whole blocks, and the hash used for
+ * recombination and by Bitmaps is computed once when the bitmap is built.
+ * Bits beyond GetSize() are always 0.
  */
 class Bitmap
 {
   friend std::ostream& operator<<(std::ostream& out, const Bitmap& bitmap);
 private:
-  std::vector<char> m_bitmap; //! Ticks of words in sentence that have been done.
+  typedef uint64_t Block;
+  static const size_t kBlockBits = 64;
+  static const size_t kInlineBlocks = 4;
+
+  size_t m_size; //! Number of words in sentence.
+  size_t m_numBlocks;
+  Block *m_blocks; //! Ticks of words in sentence that have been done; points to m_inline or the heap.
+  Block m_inline[kInlineBlocks];
   size_t m_firstGap; //! Cached position of first gap, or NOT_FOUND.
   size_t m_numWordsCovered;
+  size_t m_hash; //! Cached hash of the bits.
 
   Bitmap(); // not implemented
   Bitmap& operator= (const Bitmap& other);
 
+  void Allocate(size_t size);
+  void UpdateHash();
+
+  static size_t CountTrailingZeros(Block x) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    size_t n = 0;
+    while (!(x & 1)) {
+      x >>= 1;
+      ++n;
+    }
+    return n;
+#endif
+  }
+  static size_t HighestBit(Block x) {
+#if defined(__GNUC__)
+    return kBlockBits - 1 - __builtin_clzll(x);
+#else
+    size_t n = 0;
+    while (x >>= 1) ++n;
+    return n;
+#endif
+  }
+  static size_t PopCount(Block x) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(x);
+#else
+    size_t n = 0;
+    for (; x; x &= x - 1) ++n;
+    return n;
+#endif
+  }
+
+  //! bits [pos % 64, 63] of a block
+  static Block MaskFrom(size_t pos) {
+    return ~Block(0) << (pos % kBlockBits);
+  }
+  //! bits [0, pos % 64] of a block
+  static Block MaskTo(size_t pos) {
+    return ~Block(0) >> (kBlockBits - 1 - pos % kBlockBits);
+  }
+
+  //! first position >= pos with bit == value, or GetSize() if none
+  size_t FindFrom(size_t pos, bool value) const {
+    if (pos >= m_size) return m_size;
+    size_t b = pos / kBlockBits;
+    Block x = (value ? m_blocks[b] : ~m_blocks[b]) & MaskFrom(pos);
+    while (!x) {
+      if (++b == m_numBlocks) return m_size;
+      x = value ? m_blocks[b] : ~m_blocks[b];
+    }
+    return std::min(m_size, b * kBlockBits + CountTrailingZeros(x));
+  }
+
+  //! last position <= pos with bit == value, or NOT_FOUND if none
+  size_t FindBackFrom(size_t pos, bool value) const {
+    size_t b = pos / kBlockBits;
+    Block x = (value ? m_blocks[b] : ~m_blocks[b]) & MaskTo(pos);
+    while (!x) {
+      if (b == 0) return NOT_FOUND;
+      --b;
+      x = value ? m_blocks[b] : ~m_blocks[b];
+    }
+    return b * kBlockBits + HighestBit(x);
+  }
+
   /** Update the first gap, when bits are flipped */
   void UpdateFirstGap(size_t startPos, size_t endPos, bool value) {
     if (value) {
       //may remove gap
       if (startPos <= m_firstGap && m_firstGap <= endPos) {
-        m_firstGap = NOT_FOUND;
-        for (size_t i = endPos + 1 ; i < m_bitmap.size(); ++i) {
-          if (!m_bitmap[i]) {
-            m_firstGap = i;
-            break;
-          }
-        }
+        size_t gap = FindFrom(endPos + 1, false);
+        m_firstGap = (gap == m_size) ? NOT_FOUND : gap;
       }
 
     } else {
@@ -86,12 +155,18 @@ private:
     size_t startPos = range.GetStartPos();
     size_t endPos = range.GetEndPos();
 
-    for(size_t pos = startPos ; pos <= endPos ; pos++) {
-      m_bitmap[pos] = true;
+    size_t first = startPos / kBlockBits, last = endPos / kBlockBits;
+    if (first == last) {
+      m_blocks[first] |= MaskFrom(startPos) & MaskTo(endPos);
+    } else {
+      m_blocks[first] |= MaskFrom(startPos);
+      for (size_t b = first + 1; b < last; ++b) m_blocks[b] = ~Block(0);
+      m_blocks[last] |= MaskTo(endPos);
     }
 
     m_numWordsCovered += range.GetNumWordsCovered();
     UpdateFirstGap(startPos, endPos, true);
+    UpdateHash();
   }
 
 public:
@@ -106,6 +181,10 @@ public:
 
   explicit Bitmap(const Bitmap &copy, const Range &range);
 
+  ~Bitmap() {
+    if (m_blocks != m_inline) delete[] m_blocks;
+  }
+
   //! Count of words translated.
   size_t GetNumWordsCovered() const {
     return m_numWordsCovered;
@@ -119,44 +198,35 @@ public:
 
   //! position of last word not yet translated, or NOT_FOUND if everything already translated
   size_t GetLastGapPos() const {
-    for (int pos = int(m_bitmap.size()) - 1 ; pos >= 0 ; pos--) {
-      if (!m_bitmap[pos]) {
-        return pos;
-      }
-    }
-    // no starting pos
-    return NOT_FOUND;
+    if (m_size == 0) return NOT_FOUND;
+    return FindBackFrom(m_size - 1, false);
   }
 
 
   //! position of last translated word
   size_t GetLastPos() const {
-    for (int pos = int(m_bitmap.size()) - 1 ; pos >= 0 ; pos--) {
-      if (m_bitmap[pos]) {
-        return pos;
-      }
-    }
-    // no starting pos
-    return NOT_FOUND;
+    if (m_size == 0) return NOT_FOUND;
+    return FindBackFrom(m_size - 1, true);
   }
 
   //! whether a word has been translated at a particular position
   bool GetValue(size_t pos) const {
-    return bool(m_bitmap[pos]);
+    return (m_blocks[pos / kBlockBits] >> (pos % kBlockBits)) & 1;
   }
   //! set value at a particular position
   void SetValue( size_t pos, bool value ) {
-    bool origValue = m_bitmap[pos];
+    bool origValue = GetValue(pos);
     if (origValue == value) {
       // do nothing
     } else {
-      m_bitmap[pos] = value;
+      m_blocks[pos / kBlockBits] ^= Block(1) << (pos % kBlockBits);
       UpdateFirstGap(pos, pos, value);
       if (value) {
         ++m_numWordsCovered;
       } else {
         --m_numWordsCovered;
       }
+      UpdateHash();
     }
   }
 
@@ -166,40 +236,39 @@ public:
   }
   //! whether the wordrange overlaps with any translated word in this bitmap
   bool Overlap(const Range &compare) const {
-    for (size_t pos = compare.GetStartPos() ; pos <= compare.GetEndPos() ; pos++) {
-      if (m_bitmap[pos])
-        return true;
-    }
-    return false;
+    size_t startPos = compare.GetStartPos();
+    size_t endPos = compare.GetEndPos();
+    size_t first = startPos / kBlockBits, last = endPos / kBlockBits;
+    if (first == last)
+      return m_blocks[first] & MaskFrom(startPos) & MaskTo(endPos);
+    if (m_blocks[first] & MaskFrom(startPos)) return true;
+    for (size_t b = first + 1; b < last; ++b)
+      if (m_blocks[b]) return true;
+    return m_blocks[last] & MaskTo(endPos);
   }
   //! number of elements
   size_t GetSize() const {
-    return m_bitmap.size();
+    return m_size;
   }
 
   inline size_t GetEdgeToTheLeftOf(size_t l) const {
     if (l == 0) return l;
-    while (l && !m_bitmap[l-1]) {
-      --l;
-    }
-    return l;
+    size_t pos = FindBackFrom(l - 1, true);
+    return pos == NOT_FOUND ? 0 : pos + 1;
   }
 
   inline size_t GetEdgeToTheRightOf(size_t r) const {
-    if (r+1 == m_bitmap.size()) return r;
-    return (
-             std::find(m_bitmap.begin() + r + 1, m_bitmap.end(), true) -
-             m_bitmap.begin()
-           ) - 1;
+    if (r+1 == m_size) return r;
+    return FindFrom(r + 1, true) - 1;
   }
 
 
   //! converts bitmap into an integer ID: it consists of two parts: the first 16 bit are the pattern between the first gap and the last word-1, the second 16 bit are the number of filled positions. enforces a sentence length limit of 65535 and a max distortion of 16
   WordsBitmapID GetID() const {
-    assert(m_bitmap.size() < (1<<16));
+    assert(m_size < (1<<16));
 
     size_t start = GetFirstGapPos();
-    if (start == NOT_FOUND) start = m_bitmap.size(); // nothing left
+    if (start == NOT_FOUND) start = m_size; // nothing left
 
     size_t end = GetLastPos();
     if (end == NOT_FOUND) end = 0; // nothing translated yet
@@ -214,10 +283,10 @@ public:
 
   //! converts bitmap into an integer ID, with an additional span covered
   WordsBitmapID GetIDPlus( size_t startPos, size_t endPos ) const {
-    assert(m_bitmap.size() < (1<<16));
+    assert(m_size < (1<<16));
 
     size_t start = GetFirstGapPos();
-    if (start == NOT_FOUND) start = m_bitmap.size(); // nothing left
+    if (start == NOT_FOUND) start = m_size; // nothing left
 
     size_t end = GetLastPos();
     if (end == NOT_FOUND) end = 0; // nothing translated yet
@@ -236,7 +305,9 @@ public:
   }
 
   // for unordered_set in stack
-  size_t hash() const;
+  size_t hash() const {
+    return m_hash;
+  }
   bool operator==(const Bitmap& other) const;
   bool operator!=(const Bitmap& other) const {
     return !(*this == other);
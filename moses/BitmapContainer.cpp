@@ -195,8 +195,6 @@ BackwardsEdge::BackwardsEdge(const BitmapContainer &prevBitmapContainer
 
 BackwardsEdge::~BackwardsEdge()
 {
-  m_seenPosition.clear();
-  m_hypotheses.clear();
 }
 
 
@@ -208,6 +206,8 @@ BackwardsEdge::Initialize()
     return;
   }
 
+  m_seenPosition.resize(m_hypotheses.size() * m_translations.size());
+
   const Bitmap &bm = m_hypotheses[0]->GetWordsBitmap();
   const Range &newRange = m_translations.Get(0)->GetSourceWordsRange();
   m_estimatedScore = m_estimatedScores.CalcEstimatedScore(bm, newRange.GetStartPos(), newRange.GetEndPos());
@@ -237,17 +237,13 @@ Hypothesis *BackwardsEdge::CreateHypothesis(const Hypothesis &hypothesis, const
 bool
 BackwardsEdge::SeenPosition(const size_t x, const size_t y)
 {
-  boost::unordered_set< int >::iterator iter = m_seenPosition.find((x<<16) + y);
-  return (iter != m_seenPosition.end());
+  return m_seenPosition[x * m_translations.size() + y];
 }
 
 void
 BackwardsEdge::SetSeenPosition(const size_t x, const size_t y)
 {
-  UTIL_THROW_IF2(x >= (1<<17), "Error");
-  UTIL_THROW_IF2(y >= (1<<17), "Error");
-
-  m_seenPosition.insert((x<<16) + y);
+  m_seenPosition[x * m_translations.size() + y] = true;
 }
 
 
@@ -295,24 +291,17 @@ BitmapContainer::BitmapContainer(const Bitmap &bitmap
                                  , bool deterministic)
   : m_bitmap(bitmap)
   , m_stack(stack)
+  , m_queueOrderer(deterministic)
   , m_numStackInsertions(0)
   , m_deterministic(deterministic)
 {
-  m_hypotheses = HypothesisSet();
-  m_edges = BackwardsEdgeSet();
-  m_queue = HypothesisQueue();
 }
 
 BitmapContainer::~BitmapContainer()
 {
-  // As we have created the square position objects we clean up now.
-
-  while (!m_queue.empty()) {
-    HypothesisQueueItem *item = m_queue.top();
-    m_queue.pop();
-
-    delete item->GetHypothesis();
-    delete item;
+  // The hypotheses still queued were never added to a stack.
+  for (HypothesisQueue::const_iterator iter = m_queue.begin(); iter != m_queue.end(); ++iter) {
+    delete iter->GetHypothesis();
   }
 
   // Delete all edges.
@@ -329,42 +318,33 @@ BitmapContainer::Enqueue(int hypothesis_pos
                          , Hypothesis *hypothesis
                          , BackwardsEdge *edge)
 {
-  // Only supply target phrase if running deterministic search mode
-  const TargetPhrase *target_phrase = m_deterministic ? &(hypothesis->GetCurrTargetPhrase()) : NULL;
-  HypothesisQueueItem *item = new HypothesisQueueItem(hypothesis_pos
-      , translation_pos
-      , hypothesis
-      , edge
-      , target_phrase);
   IFVERBOSE(2) {
-    item->GetHypothesis()->GetManager().GetSentenceStats().StartTimeManageCubes();
+    hypothesis->GetManager().GetSentenceStats().StartTimeManageCubes();
   }
-  m_queue.push(item);
+  m_queue.push_back(HypothesisQueueItem(hypothesis_pos
+                                        , translation_pos
+                                        , hypothesis
+                                        , edge));
+  std::push_heap(m_queue.begin(), m_queue.end(), m_queueOrderer);
   IFVERBOSE(2) {
-    item->GetHypothesis()->GetManager().GetSentenceStats().StopTimeManageCubes();
+    hypothesis->GetManager().GetSentenceStats().StopTimeManageCubes();
   }
 }
 
-HypothesisQueueItem*
-BitmapContainer::Dequeue(bool keepValue)
+HypothesisQueueItem
+BitmapContainer::Dequeue()
 {
-  if (!m_queue.empty()) {
-    HypothesisQueueItem *item = m_queue.top();
-
-    if (!keepValue) {
-      m_queue.pop();
-    }
-
-    return item;
-  }
-
-  return NULL;
+  UTIL_THROW_IF2(m_queue.empty(), "Dequeue from an empty queue");
+  std::pop_heap(m_queue.begin(), m_queue.end(), m_queueOrderer);
+  HypothesisQueueItem item = m_queue.back();
+  m_queue.pop_back();
+  return item;
 }
 
-HypothesisQueueItem*
+const HypothesisQueueItem&
 BitmapContainer::Top() const
 {
-  return m_queue.top();
+  return m_queue.front();
 }
 
 size_t
@@ -437,12 +417,15 @@ BitmapContainer::InitializeEdges()
   }
 }
 
-void
+size_t
 BitmapContainer::EnsureMinStackHyps(const size_t minNumHyps)
 {
+  size_t numPops = 0;
   while ((!Empty()) && m_numStackInsertions < minNumHyps) {
     ProcessBestHypothesis();
+    ++numPops;
   }
+  return numPops;
 }
 
 void
@@ -453,27 +436,24 @@ BitmapContainer::ProcessBestHypothesis()
   }
 
   // Get the currently best hypothesis from the queue.
-  HypothesisQueueItem *item = Dequeue();
-
-  // If the priority queue is exhausted, we are done and should have exited
-  UTIL_THROW_IF2(item == NULL, "Null object");
+  const HypothesisQueueItem item = Dequeue();
 
   // check we are pulling things off of priority queue in right order
   if (!Empty()) {
-    HypothesisQueueItem *check = Dequeue(true);
-    UTIL_THROW_IF2(item->GetHypothesis()->GetFutureScore() < check->GetHypothesis()->GetFutureScore(),
+    const HypothesisQueueItem &check = Top();
+    UTIL_THROW_IF2(item.GetHypothesis()->GetFutureScore() < check.GetHypothesis()->GetFutureScore(),
                    "Non-monotonic total score: "
-                   << item->GetHypothesis()->GetFutureScore() << " vs. "
-                   << check->GetHypothesis()->GetFutureScore());
+                   << item.GetHypothesis()->GetFutureScore() << " vs. "
+                   << check.GetHypothesis()->GetFutureScore());
   }
 
   // Logging for the criminally insane
   IFVERBOSE(3) {
-    item->GetHypothesis()->PrintHypothesis();
+    item.GetHypothesis()->PrintHypothesis();
   }
 
   // Add best hypothesis to hypothesis stack.
-  const bool newstackentry = m_stack.AddPrune(item->GetHypothesis());
+  const bool newstackentry = m_stack.AddPrune(item.GetHypothesis());
   if (newstackentry)
     m_numStackInsertions++;
 
@@ -482,10 +462,7 @@ BitmapContainer::ProcessBestHypothesis()
   }
 
   // Create new hypotheses for the two successors of the hypothesis just added.
-  item->GetBackwardsEdge()->PushSuccessors(item->GetHypothesisPos(), item->GetTranslationPos());
-
-  // We are done with the queue item, we delete it.
-  delete item;
+  item.GetBackwardsEdge()->PushSuccessors(item.GetHypothesisPos(), item.GetTranslationPos());
 }
 
 void
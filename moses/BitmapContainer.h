@@ -22,7 +22,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_BitmapContainer_h
 #define moses_BitmapContainer_h
 
-#include <queue>
 #include <set>
 #include <vector>
 
@@ -33,8 +32,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TypeDef.h"
 #include "Bitmap.h"
 
-#include <boost/unordered_set.hpp>
-
 namespace Moses
 {
 
@@ -42,98 +39,89 @@ class BitmapContainer;
 class BackwardsEdge;
 class Hypothesis;
 class HypothesisStackCubePruning;
-class HypothesisQueueItem;
-class QueueItemOrderer;
 class TranslationOptionList;
 
 typedef std::vector< Hypothesis* > HypothesisSet;
 typedef std::set< BackwardsEdge* > BackwardsEdgeSet;
-typedef std::priority_queue< HypothesisQueueItem*, std::vector< HypothesisQueueItem* >, QueueItemOrderer> HypothesisQueue;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Hypothesis Priority Queue Code
 ////////////////////////////////////////////////////////////////////////////////
 
-//! 1 item in the priority queue for stack decoding (phrase-based)
+//! 1 item in the priority queue for stack decoding (phrase-based).
+//! Items are held by value in the queue, so queueing one allocates nothing.
 class HypothesisQueueItem
 {
 private:
   size_t m_hypothesis_pos, m_translation_pos;
   Hypothesis *m_hypothesis;
   BackwardsEdge *m_edge;
-  boost::shared_ptr<TargetPhrase> m_target_phrase;
-
-  HypothesisQueueItem();
 
 public:
   HypothesisQueueItem(const size_t hypothesis_pos
                       , const size_t translation_pos
                       , Hypothesis *hypothesis
-                      , BackwardsEdge *edge
-                      , const TargetPhrase *target_phrase = NULL)
+                      , BackwardsEdge *edge)
     : m_hypothesis_pos(hypothesis_pos)
     , m_translation_pos(translation_pos)
     , m_hypothesis(hypothesis)
     , m_edge(edge) {
-    if (target_phrase != NULL) {
-      m_target_phrase.reset(new TargetPhrase(*target_phrase));
-    }
-  }
-
-  ~HypothesisQueueItem() {
   }
 
-  int GetHypothesisPos() {
+  int GetHypothesisPos() const {
     return m_hypothesis_pos;
   }
 
-  int GetTranslationPos() {
+  int GetTranslationPos() const {
     return m_translation_pos;
   }
 
-  Hypothesis *GetHypothesis() {
+  Hypothesis *GetHypothesis() const {
     return m_hypothesis;
   }
 
-  BackwardsEdge *GetBackwardsEdge() {
+  BackwardsEdge *GetBackwardsEdge() const {
     return m_edge;
   }
-
-  boost::shared_ptr<TargetPhrase> GetTargetPhrase() {
-    return m_target_phrase;
-  }
 };
 
 //! Allows comparison of two HypothesisQueueItem objects by the corresponding scores.
 class QueueItemOrderer
 {
+private:
+  bool m_deterministic;
+
 public:
-  bool operator()(HypothesisQueueItem* itemA, HypothesisQueueItem* itemB) const {
-    float scoreA = itemA->GetHypothesis()->GetFutureScore();
-    float scoreB = itemB->GetHypothesis()->GetFutureScore();
+  QueueItemOrderer(const bool deterministic = false)
+    : m_deterministic(deterministic) {}
+
+  bool operator()(const HypothesisQueueItem &itemA, const HypothesisQueueItem &itemB) const {
+    float scoreA = itemA.GetHypothesis()->GetFutureScore();
+    float scoreB = itemB.GetHypothesis()->GetFutureScore();
 
     if (scoreA < scoreB) {
       return true;
     } else if (scoreA > scoreB) {
       return false;
     } else {
-      // Equal scores: break ties by comparing target phrases (if they exist)
-      // *Important*: these are pointers to copies of the target phrases from the
-      // hypotheses.  This class is used to keep priority queues ordered in the
-      // background, so comparisons made as those data structures are cleaned up
-      // may occur *after* the target phrases in hypotheses have been cleaned up,
-      // leading to segfaults if relying on hypotheses to provide target phrases.
-      boost::shared_ptr<TargetPhrase> phrA = itemA->GetTargetPhrase();
-      boost::shared_ptr<TargetPhrase> phrB = itemB->GetTargetPhrase();
-      if (!phrA || !phrB) {
-        // Fallback: scoreA < scoreB == false, non-deterministic sort
-        return false;
+      // Equal scores: break ties by comparing target phrases.  The queue
+      // never compares items once their hypotheses may have been deleted,
+      // so the target phrases of the hypotheses are safe to use.
+      if (m_deterministic) {
+        return (itemA.GetHypothesis()->GetCurrTargetPhrase().Compare(
+                  itemB.GetHypothesis()->GetCurrTargetPhrase()) > 0);
       }
-      return (phrA->Compare(*phrB) > 0);
+      // Fallback: scoreA < scoreB == false, non-deterministic sort
+      return false;
     }
   }
 };
 
+//! Binary heap of items, kept with the same algorithm as
+//! std::priority_queue so that equal scores pop in the same order, but
+//! giving access to the items for clean-up and reusing its storage.
+typedef std::vector< HypothesisQueueItem > HypothesisQueue;
+
 ////////////////////////////////////////////////////////////////////////////////
 // Hypothesis Orderer Code
 ////////////////////////////////////////////////////////////////////////////////
@@ -190,7 +178,8 @@ private:
   bool m_deterministic;
 
   std::vector< const Hypothesis* > m_hypotheses;
-  boost::unordered_set< int > m_seenPosition;
+  //! one flag per cell of the cube, hypothesis major
+  std::vector< bool > m_seenPosition;
 
   // We don't want to instantiate "empty" objects.
   BackwardsEdge();
@@ -233,6 +222,7 @@ private:
   HypothesisSet m_hypotheses;
   BackwardsEdgeSet m_edges;
   HypothesisQueue m_queue;
+  QueueItemOrderer m_queueOrderer;
   size_t m_numStackInsertions;
   bool m_deterministic;
 
@@ -249,8 +239,8 @@ public:
   ~BitmapContainer();
 
   void Enqueue(int hypothesis_pos, int translation_pos, Hypothesis *hypothesis, BackwardsEdge *edge);
-  HypothesisQueueItem *Dequeue(bool keepValue=false);
-  HypothesisQueueItem *Top() const;
+  HypothesisQueueItem Dequeue();
+  const HypothesisQueueItem &Top() const;
   size_t Size();
   bool Empty() const;
 
@@ -264,7 +254,8 @@ public:
 
   void InitializeEdges();
   void ProcessBestHypothesis();
-  void EnsureMinStackHyps(const size_t minNumHyps);
+  //! returns the number of hypotheses popped
+  size_t EnsureMinStackHyps(const size_t minNumHyps);
   void AddHypothesis(Hypothesis *hypothesis);
   void AddBackwardsEdge(BackwardsEdge *edge);
   void SortHypotheses();
@@ -22,14 +22,15 @@ Bitmaps::~Bitmaps()
 
 const Bitmap &Bitmaps::GetNextBitmap(const Bitmap &bm, const Range &range)
 {
-  Bitmap *newBM = new Bitmap(bm, range);
+  // build the candidate on the stack; only new bitmaps are copied to the heap
+  Bitmap candidate(bm, range);
 
-  Coll::const_iterator iter = m_coll.find(newBM);
+  Coll::const_iterator iter = m_coll.find(&candidate);
   if (iter == m_coll.end()) {
+    Bitmap *newBM = new Bitmap(candidate);
     m_coll[newBM] = NextBitmaps();
     return *newBM;
   } else {
-    delete newBM;
     return *iter->first;
   }
 }
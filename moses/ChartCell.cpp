@@ -54,7 +54,10 @@ ChartCell::ChartCell(size_t startPos, size_t endPos, ChartManager &manager) :
   m_nBestIsEnabled = manager.options()->nbest.enabled;
 }
 
-ChartCell::~ChartCell() {}
+ChartCell::~ChartCell()
+{
+  RemoveAllInColl(m_hypoColl);
+}
 
 /** Add the given hypothesis to the cell.
  *  Returns true if added, false if not. Maybe it already exists in the collection or score falls below threshold etc.
@@ -64,13 +67,15 @@ ChartCell::~ChartCell() {}
 bool ChartCell::AddHypothesis(ChartHypothesis *hypo)
 {
   const Word &targetLHS = hypo->GetTargetLHS();
-  MapType::iterator m = m_hypoColl.find(targetLHS);
-  if (m == m_hypoColl.end()) {
-    std::pair<Word, ChartHypothesisCollection>
-    e(targetLHS, ChartHypothesisCollection(*m_manager.options()));
-    m = m_hypoColl.insert(e).first;
+  size_t idx = targetLHS[0]->GetId();
+  if (idx >= m_hypoColl.size()) {
+    m_hypoColl.resize(idx + 1, NULL);
+  }
+  LabelledCollection *&m = m_hypoColl[idx];
+  if (m == NULL) {
+    m = new LabelledCollection(targetLHS, *m_manager.options());
   }
-  return m->second.AddHypothesis(hypo, m_manager);
+  return m->coll.AddHypothesis(hypo, m_manager);
 }
 
 /** Prune each collection in this cell to a particular size */
@@ -78,7 +83,8 @@ void ChartCell::PruneToSize()
 {
   MapType::iterator iter;
   for (iter = m_hypoColl.begin(); iter != m_hypoColl.end(); ++iter) {
-    ChartHypothesisCollection &coll = iter->second;
+    if (*iter == NULL) continue;
+    ChartHypothesisCollection &coll = (*iter)->coll;
     coll.PruneToSize(m_manager);
   }
 }
@@ -116,11 +122,12 @@ void ChartCell::SortHypotheses()
 
   MapType::iterator iter;
   for (iter = m_hypoColl.begin(); iter != m_hypoColl.end(); ++iter) {
-    ChartHypothesisCollection &coll = iter->second;
+    if (*iter == NULL) continue;
+    ChartHypothesisCollection &coll = (*iter)->coll;
 
     if (coll.GetSize()) {
       coll.SortHypotheses();
-      m_targetLabelSet.AddConstituent(iter->first, &coll.GetSortedHypotheses());
+      m_targetLabelSet.AddConstituent((*iter)->label, &coll.GetSortedHypotheses());
     }
   }
 }
@@ -133,7 +140,8 @@ const ChartHypothesis *ChartCell::GetBestHypothesis() const
 
   MapType::const_iterator iter;
   for (iter = m_hypoColl.begin(); iter != m_hypoColl.end(); ++iter) {
-    const HypoList &sortedList = iter->second.GetSortedHypotheses();
+    if (*iter == NULL) continue;
+    const HypoList &sortedList = (*iter)->coll.GetSortedHypotheses();
     if (sortedList.size() > 0) {
       const ChartHypothesis *hypo = sortedList[0];
       if (hypo->GetFutureScore() > bestScore) {
@@ -154,7 +162,8 @@ void ChartCell::CleanupArcList()
 
   MapType::iterator iter;
   for (iter = m_hypoColl.begin(); iter != m_hypoColl.end(); ++iter) {
-    ChartHypothesisCollection &coll = iter->second;
+    if (*iter == NULL) continue;
+    ChartHypothesisCollection &coll = (*iter)->coll;
     coll.CleanupArcList();
   }
 }
@@ -164,8 +173,9 @@ void ChartCell::OutputSizes(std::ostream &out) const
 {
   MapType::const_iterator iter;
   for (iter = m_hypoColl.begin(); iter != m_hypoColl.end(); ++iter) {
-    const Word &targetLHS = iter->first;
-    const ChartHypothesisCollection &coll = iter->second;
+    if (*iter == NULL) continue;
+    const Word &targetLHS = (*iter)->label;
+    const ChartHypothesisCollection &coll = (*iter)->coll;
 
     out << targetLHS << "=" << coll.GetSize() << " ";
   }
@@ -177,7 +187,8 @@ size_t ChartCell::GetSize() const
   size_t ret = 0;
   MapType::const_iterator iter;
   for (iter = m_hypoColl.begin(); iter != m_hypoColl.end(); ++iter) {
-    const ChartHypothesisCollection &coll = iter->second;
+    if (*iter == NULL) continue;
+    const ChartHypothesisCollection &coll = (*iter)->coll;
 
     ret += coll.GetSize();
   }
@@ -191,7 +202,8 @@ const HypoList *ChartCell::GetAllSortedHypotheses() const
 
   MapType::const_iterator iter;
   for (iter = m_hypoColl.begin(); iter != m_hypoColl.end(); ++iter) {
-    const ChartHypothesisCollection &coll = iter->second;
+    if (*iter == NULL) continue;
+    const ChartHypothesisCollection &coll = (*iter)->coll;
     const HypoList &list = coll.GetSortedHypotheses();
     std::copy(list.begin(), list.end(), std::inserter(*ret, ret->end()));
   }
@@ -203,7 +215,8 @@ void ChartCell::WriteSearchGraph(const ChartSearchGraphWriter& writer, const std
 {
   MapType::const_iterator iterOutside;
   for (iterOutside = m_hypoColl.begin(); iterOutside != m_hypoColl.end(); ++iterOutside) {
-    const ChartHypothesisCollection &coll = iterOutside->second;
+    if (*iterOutside == NULL) continue;
+    const ChartHypothesisCollection &coll = (*iterOutside)->coll;
     coll.WriteSearchGraph(writer, reachable);
   }
 }
@@ -212,10 +225,11 @@ std::ostream& operator<<(std::ostream &out, const ChartCell &cell)
 {
   ChartCell::MapType::const_iterator iterOutside;
   for (iterOutside = cell.m_hypoColl.begin(); iterOutside != cell.m_hypoColl.end(); ++iterOutside) {
-    const Word &targetLHS = iterOutside->first;
+    if (*iterOutside == NULL) continue;
+    const Word &targetLHS = (*iterOutside)->label;
     cerr << targetLHS << ":" << endl;
 
-    const ChartHypothesisCollection &coll = iterOutside->second;
+    const ChartHypothesisCollection &coll = (*iterOutside)->coll;
     cerr << coll;
   }
 
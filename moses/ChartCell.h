@@ -34,9 +34,6 @@
 #include "ChartCellLabelSet.h"
 
 #include <boost/scoped_ptr.hpp>
-#include <boost/functional/hash.hpp>
-#include <boost/unordered_map.hpp>
-#include <boost/version.hpp>
 
 namespace Moses
 {
@@ -76,15 +73,17 @@ class ChartCell : public ChartCellBase
 {
   friend std::ostream& operator<<(std::ostream&, const ChartCell&);
 public:
-#if defined(BOOST_VERSION) && (BOOST_VERSION >= 104200)
-  typedef boost::unordered_map<Word,
-          ChartHypothesisCollection,
-          NonTerminalHasher,
-          NonTerminalEqualityPred
-          > MapType;
-#else
-  typedef std::map<Word, ChartHypothesisCollection> MapType;
-#endif
+  //! hypotheses that have the same target LHS
+  struct LabelledCollection {
+    LabelledCollection(const Word &label, AllOptions const& opts)
+      : label(label), coll(opts) {}
+    Word label;
+    ChartHypothesisCollection coll;
+  };
+
+  //! indexed by the id of the target LHS non-terminal, like the target
+  //! label set; NULL for labels without hypotheses
+  typedef std::vector<LabelledCollection*> MapType;
 
 protected:
   MapType m_hypoColl;
@@ -92,6 +91,12 @@ protected:
   bool m_nBestIsEnabled; /**< flag to determine whether to keep track of old arcs */
   ChartManager &m_manager;
 
+private:
+  //! Non-copyable: m_hypoColl owns its collections.
+  ChartCell(const ChartCell &);
+  //! Non-copyable: m_hypoColl owns its collections.
+  ChartCell &operator=(const ChartCell &);
+
 public:
   ChartCell(size_t startPos, size_t endPos, ChartManager &manager);
   ~ChartCell();
@@ -101,8 +106,9 @@ public:
 
   //! Get all hypotheses in the cell that have the specified constituent label
   const HypoList *GetSortedHypotheses(const Word &constituentLabel) const {
-    MapType::const_iterator p = m_hypoColl.find(constituentLabel);
-    return (p == m_hypoColl.end()) ? NULL : &(p->second.GetSortedHypotheses());
+    size_t idx = constituentLabel[0]->GetId();
+    return (idx < m_hypoColl.size() && m_hypoColl[idx])
+           ? &(m_hypoColl[idx]->coll.GetSortedHypotheses()) : NULL;
   }
 
   //! for n-best list
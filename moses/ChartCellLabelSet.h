@@ -23,6 +23,9 @@
 #include "NonTerminal.h"
 #include "moses/FactorCollection.h"
 
+#include <algorithm>
+#include <vector>
+
 #include <boost/functional/hash.hpp>
 #include <boost/unordered_map.hpp>
 #include <boost/version.hpp>
@@ -32,7 +35,9 @@ namespace Moses
 
 class ChartHypothesisCollection;
 
-/** @todo I have no idea what's in here
+/** The labels of the constituents of a chart cell, indexed by the id of
+ *  their non-terminal factor.  Non-terminal ids are dense, so finding a
+ *  label is a bounds check and an array access.
  */
 class ChartCellLabelSet
 {
@@ -92,16 +97,13 @@ public:
     }
   }
 
-  // grow vector if necessary
+  // grow vector if necessary; non-terminals may be created after the cell
   bool ChartCellExists(size_t idx) {
-    try {
-      if (m_map.at(idx) != NULL) {
-        return true;
-      }
-    } catch (const std::out_of_range& oor) {
-      m_map.resize(FactorCollection::Instance().GetNumNonTerminals(), NULL);
+    if (idx >= m_map.size()) {
+      m_map.resize(std::max(idx + 1, FactorCollection::Instance().GetNumNonTerminals()), NULL);
+      return false;
     }
-    return false;
+    return m_map[idx] != NULL;
   }
 
   bool Empty() const {
@@ -113,20 +115,11 @@ public:
   }
 
   const ChartCellLabel *Find(const Word &w) const {
-    size_t idx = w[0]->GetId();
-    try {
-      return m_map.at(idx);
-    } catch (const std::out_of_range& oor) {
-      return NULL;
-    }
+    return Find(w[0]->GetId());
   }
 
   const ChartCellLabel *Find(size_t idx) const {
-    try {
-      return m_map.at(idx);
-    } catch (const std::out_of_range& oor) {
-      return NULL;
-    }
+    return idx < m_map.size() ? m_map[idx] : NULL;
   }
 
   ChartCellLabel::Stack &FindOrInsert(const Word &w) {
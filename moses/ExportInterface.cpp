@@ -195,7 +195,8 @@ batch_run()
   }
 
 #ifdef WITH_THREADS
-  ThreadPool pool(staticData.ThreadCount());
+  ThreadPool pool(staticData.ThreadCount(), staticData.UseWorkStealing(),
+                  staticData.PinThreads());
 #endif
 
   // using context for adaptation:
@@ -4,6 +4,7 @@
 #include <vector>
 #include <stddef.h>
 #include "util/exception.hh"
+#include "moses/SentenceArena.h"
 
 namespace Moses
 {
@@ -12,6 +13,15 @@ class FFState
 {
 public:
   virtual ~FFState();
+
+  //! states live in the sentence arena if one is active (see SentenceArena)
+  static void *operator new(size_t bytes) {
+    return SentenceArena::Allocate(bytes);
+  }
+  static void operator delete(void *p) {
+    SentenceArena::Free(p);
+  }
+
   virtual size_t hash() const = 0;
   virtual bool operator==(const FFState& other) const = 0;
 
@@ -148,6 +148,18 @@ void FeatureFunction::ReadParameters()
   }
 }
 
+void
+FeatureFunction::
+EvaluateInIsolationBatch(const std::vector<const Phrase*> &sources,
+                         const std::vector<TargetPhrase*> &targetPhrases,
+                         std::vector<ScoreComponentCollection> &estimatedScores) const
+{
+  for (size_t i = 0; i < targetPhrases.size(); ++i) {
+    TargetPhrase &tp = *targetPhrases[i];
+    EvaluateInIsolation(*sources[i], tp, tp.GetScoreBreakdown(), estimatedScores[i]);
+  }
+}
+
 std::vector<float> FeatureFunction::DefaultWeights() const
 {
   return std::vector<float>(this->m_numScoreComponents,1.0);
@@ -162,6 +162,16 @@ public:
                       ScoreComponentCollection& scoreBreakdown,
                       ScoreComponentCollection& estimatedScores) const = 0;
 
+  // batch version of EvaluateInIsolation(), called with many target phrases
+  // at once (e.g. all translations of all source phrases of a sentence) so
+  // that features can share work between them. sources[i] is the source of
+  // targetPhrases[i]; scores go to the target phrase's own score breakdown,
+  // estimates to estimatedScores[i]. The default evaluates one at a time.
+  virtual void
+  EvaluateInIsolationBatch(const std::vector<const Phrase*> &sources,
+                           const std::vector<TargetPhrase*> &targetPhrases,
+                           std::vector<ScoreComponentCollection> &estimatedScores) const;
+
   // for context-dependent processing
   static void SetupAll(TranslationTask const& task);
   virtual void Setup(TranslationTask const& task) const { };
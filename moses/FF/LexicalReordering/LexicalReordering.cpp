@@ -161,8 +161,30 @@ void
 LexicalReordering::
 SetCache(TranslationOptionList& tol) const
 {
-  BOOST_FOREACH(TranslationOption* to, tol)
-  this->SetCache(*to);
+  std::vector<TranslationOption*> tos(tol.begin(), tol.end());
+  this->SetCache(tos);
+}
+
+void
+LexicalReordering::
+SetCache(const std::vector<TranslationOption*>& tos) const
+{
+  if (!m_table) return; // e.g. OOV with Mmsapt
+
+  std::vector<TranslationOption*> todo;
+  std::vector<const Phrase*> sphrases, tphrases;
+  BOOST_FOREACH(TranslationOption* to, tos) {
+    // Scores were were set already (e.g., by sampling phrase table)
+    if (to->GetLexReorderingScores(this)) continue;
+    todo.push_back(to);
+    sphrases.push_back(&to->GetInputPath().GetPhrase());
+    tphrases.push_back(&to->GetTargetPhrase());
+  }
+
+  std::vector<Scores> scores;
+  m_table->GetScoreBatch(sphrases, tphrases, scores);
+  for (size_t i = 0; i < todo.size(); ++i)
+    todo[i]->CacheLexReorderingScores(*this, scores[i]);
 }
 
 
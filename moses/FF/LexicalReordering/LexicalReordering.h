@@ -82,6 +82,11 @@ public:
   void
   SetCache(TranslationOptionList& tol) const;
 
+  //! looks up the scores of all options in one batch, e.g. of a sentence
+  virtual
+  void
+  SetCache(const std::vector<TranslationOption*>& tos) const;
+
 private:
   bool DecodeCondition(std::string s);
   bool DecodeDirection(std::string s);
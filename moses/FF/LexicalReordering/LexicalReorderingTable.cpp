@@ -1,6 +1,7 @@
 // -*- c++ -*-
 
 #include "LexicalReorderingTable.h"
+#include "LexicalReorderingTableHashed.h"
 #include "moses/InputFileStream.h"
 #include "moses/StaticData.h"
 #include "moses/TranslationModel/PhraseDictionary.h"
@@ -60,7 +61,10 @@ LoadAvailable(const std::string& filePath,
     return compactLexr;
 #endif
   LexicalReorderingTable* ret;
-  if (FileExists(filePath+".binlexr.idx") )
+  if (FileExists(filePath+".hashlexr"))
+    ret = new LexicalReorderingTableHashed(filePath, f_factors,
+                                           e_factors, c_factors);
+  else if (FileExists(filePath+".binlexr.idx") )
     ret = new LexicalReorderingTableTree(filePath, f_factors,
                                          e_factors, c_factors);
   else
@@ -69,6 +73,18 @@ LoadAvailable(const std::string& filePath,
   return ret;
 }
 
+void
+LexicalReorderingTable::
+GetScoreBatch(const std::vector<const Phrase*>& f,
+              const std::vector<const Phrase*>& e,
+              std::vector<Scores>& scores)
+{
+  Phrase context(ARRAY_SIZE_INCR);
+  scores.resize(f.size());
+  for (size_t i = 0; i < f.size(); ++i)
+    scores[i] = GetScore(*f[i], *e[i], context);
+}
+
 LexicalReorderingTableMemory::
 LexicalReorderingTableMemory(const std::string& filePath,
                              const std::vector<FactorType>& f_factors,
@@ -52,6 +52,14 @@ public:
   Scores
   GetScore(const Phrase& f, const Phrase& e, const Phrase& c) = 0;
 
+  //! scores of many phrase pairs without context; tables that can overlap
+  //! their lookups override this
+  virtual
+  void
+  GetScoreBatch(const std::vector<const Phrase*>& f,
+                const std::vector<const Phrase*>& e,
+                std::vector<Scores>& scores);
+
   virtual
   void
   InitializeForInput(ttasksptr const& ttask) {
@@ -0,0 +1,321 @@
+// -*- c++ -*-
+
+#include "LexicalReorderingTableHashed.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "moses/Factor.h"
+#include "moses/Phrase.h"
+#include "moses/Util.h"
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/murmur_hash.hh"
+#include "util/tokenize_piece.hh"
+
+namespace Moses
+{
+
+namespace
+{
+
+const char Magic[] = "hashlex1";
+const size_t CodebookSize = 256;
+// mixed in between the source and the target phrase of a key
+const uint64_t PhraseSeparator = 0x5e9a2a7e;
+
+struct Header {
+  char magic[8];
+  uint32_t numScores;
+  uint32_t numKeyPhrases; // 1 if conditioned on f or e only, 2 if on both
+  uint64_t entries;
+  uint64_t tableSize; // in bytes
+};
+
+inline uint64_t MixIn(uint64_t key, uint64_t value)
+{
+  return util::MurmurHashNative(&value, sizeof(value), key);
+}
+
+// 0 marks an empty bucket
+inline uint64_t ValidKey(uint64_t key)
+{
+  return key ? key : 1;
+}
+
+// a word of the text table, factors separated by '|'
+uint64_t HashWord(const StringPiece &word)
+{
+  uint64_t hash = 0;
+  for (util::TokenIter<util::SingleCharacter> factor(word, '|'); factor; ++factor) {
+    hash = util::MurmurHashNative(factor->data(), factor->size(), hash);
+  }
+  return hash;
+}
+
+// must agree with HashWord() on the text of the factors
+uint64_t HashPhrase(uint64_t key, const Phrase &phrase, const FactorList &factors)
+{
+  for (size_t i = 0; i < phrase.GetSize(); ++i) {
+    const Word &word = phrase.GetWord(i);
+    uint64_t hash = 0;
+    for (size_t j = 0; j < factors.size(); ++j) {
+      const Factor *factor = word[factors[j]];
+      if (factor) {
+        StringPiece str = factor->GetString();
+        hash = util::MurmurHashNative(str.data(), str.size(), hash);
+      }
+    }
+    key = MixIn(key, hash);
+  }
+  return key;
+}
+
+// exact if there are few distinct values, otherwise the means of 256 bins
+// of equally many values
+void MakeCodebook(std::vector<float> values, float *codebook)
+{
+  std::sort(values.begin(), values.end());
+  std::vector<float> distinct(values.begin(), values.end());
+  distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+  if (distinct.size() <= CodebookSize) {
+    std::copy(distinct.begin(), distinct.end(), codebook);
+    std::fill(codebook + distinct.size(), codebook + CodebookSize, distinct.back());
+    return;
+  }
+  for (size_t bin = 0; bin < CodebookSize; ++bin) {
+    size_t begin = values.size() * bin / CodebookSize;
+    size_t end = values.size() * (bin + 1) / CodebookSize;
+    double sum = 0;
+    for (size_t i = begin; i < end; ++i) {
+      sum += values[i];
+    }
+    codebook[bin] = sum / (end - begin);
+  }
+}
+
+uint64_t Encode(const float *codebook, float value)
+{
+  size_t code = std::lower_bound(codebook, codebook + CodebookSize, value) - codebook;
+  if (code == CodebookSize || (code > 0 && value - codebook[code - 1] < codebook[code] - value)) {
+    --code;
+  }
+  return code;
+}
+
+}
+
+LexicalReorderingTableHashed::
+LexicalReorderingTableHashed(const std::string& filePath,
+                             const std::vector<FactorType>& f_factors,
+                             const std::vector<FactorType>& e_factors,
+                             const std::vector<FactorType>& c_factors)
+  : LexicalReorderingTable(f_factors, e_factors, c_factors)
+{
+  UTIL_THROW_IF2(!m_FactorsC.empty(),
+                 "The hashed lexical reordering table does not support context");
+
+  std::string path = filePath + ".hashlexr";
+  util::scoped_fd fd(util::OpenReadOrThrow(path.c_str()));
+  uint64_t size = util::SizeOrThrow(fd.get());
+  UTIL_THROW_IF2(size < sizeof(Header),
+                 path << " is not a hashed lexical reordering table");
+  util::MapRead(util::POPULATE_OR_READ, fd.get(), 0, size, m_mem);
+
+  const Header &header = *reinterpret_cast<const Header*>(m_mem.get());
+  UTIL_THROW_IF2(std::memcmp(header.magic, Magic, sizeof(header.magic)),
+                 path << " is not a hashed lexical reordering table");
+  size_t numKeyPhrases = (m_FactorsF.empty() ? 0 : 1) + (m_FactorsE.empty() ? 0 : 1);
+  UTIL_THROW_IF2(header.numKeyPhrases != numKeyPhrases,
+                 path << " is keyed on " << header.numKeyPhrases
+                 << " phrases but the model is conditioned on " << numKeyPhrases);
+
+  m_numScores = header.numScores;
+  char *codebooks = reinterpret_cast<char*>(m_mem.get()) + sizeof(Header);
+  char *table = codebooks + m_numScores * CodebookSize * sizeof(float);
+  UTIL_THROW_IF2(table + header.tableSize != reinterpret_cast<char*>(m_mem.get()) + size,
+                 path << " is truncated");
+  m_codebooks = reinterpret_cast<const float*>(codebooks);
+  m_table = Table(table, header.tableSize);
+}
+
+Scores
+LexicalReorderingTableHashed::
+GetScore(const Phrase& f, const Phrase& e, const Phrase& c)
+{
+  Scores scores;
+  if((!m_FactorsF.empty() && 0 == f.GetSize())
+      || (!m_FactorsE.empty() && 0 == e.GetSize())) {
+    return scores;
+  }
+  Table::ConstIterator it;
+  if (m_table.Find(MakeKey(f, e), it)) {
+    Decode(it->codes, scores);
+  }
+  return scores;
+}
+
+void
+LexicalReorderingTableHashed::
+GetScoreBatch(const std::vector<const Phrase*>& f,
+              const std::vector<const Phrase*>& e,
+              std::vector<Scores>& scores)
+{
+  // 0 marks pairs that are not proper keys
+  std::vector<uint64_t> keys(f.size(), 0);
+  for (size_t i = 0; i < f.size(); ++i) {
+    if((!m_FactorsF.empty() && 0 == f[i]->GetSize())
+        || (!m_FactorsE.empty() && 0 == e[i]->GetSize())) {
+      continue;
+    }
+    keys[i] = MakeKey(*f[i], *e[i]);
+    m_table.Prefetch(keys[i]);
+  }
+
+  scores.assign(f.size(), Scores());
+  Table::ConstIterator it;
+  for (size_t i = 0; i < f.size(); ++i) {
+    if (keys[i] && m_table.Find(keys[i], it)) {
+      Decode(it->codes, scores[i]);
+    }
+  }
+}
+
+uint64_t
+LexicalReorderingTableHashed::
+MakeKey(const Phrase& f, const Phrase& e) const
+{
+  uint64_t key = 0;
+  if (!m_FactorsF.empty()) {
+    key = HashPhrase(key, f, m_FactorsF);
+  }
+  if (!m_FactorsE.empty()) {
+    if (!m_FactorsF.empty()) {
+      key = MixIn(key, PhraseSeparator);
+    }
+    key = HashPhrase(key, e, m_FactorsE);
+  }
+  return ValidKey(key);
+}
+
+void
+LexicalReorderingTableHashed::
+Decode(uint64_t codes, Scores& scores) const
+{
+  scores.resize(m_numScores);
+  for (size_t i = 0; i < m_numScores; ++i, codes >>= 8) {
+    scores[i] = m_codebooks[i * CodebookSize + (codes & 0xff)];
+  }
+}
+
+bool
+LexicalReorderingTableHashed::
+Create(std::istream& inFile, const std::string& outFileName)
+{
+  std::vector<uint64_t> keys;
+  std::vector<float> scores; // numScores per key
+  size_t numScores = 0, numKeyPhrases = 0;
+
+  std::string line;
+  size_t lnc = 0;
+  while(getline(inFile, line)) {
+    ++lnc;
+    if(0 == lnc % 100000) TRACE_ERR(".");
+
+    std::vector<StringPiece> fields;
+    for (util::TokenIter<util::MultiCharacter> field(line, "|||"); field; ++field) {
+      fields.push_back(*field);
+    }
+    if(1 == lnc) {
+      // f ||| score or f ||| e ||| score
+      if(fields.size() != 2 && fields.size() != 3) {
+        TRACE_ERR("ERROR: expected 2 or 3 fields, context is not supported\n");
+        return false;
+      }
+      numKeyPhrases = fields.size() - 1;
+    } else if(fields.size() != numKeyPhrases + 1) {
+      TRACE_ERR("ERROR: lines do not have the same number of fields, line "
+                << lnc << ": '" << line << "'\n");
+      return false;
+    }
+
+    uint64_t key = 0;
+    bool empty = true;
+    for(size_t phrase = 0; phrase < numKeyPhrases; ++phrase) {
+      if(phrase >= 1) key = MixIn(key, PhraseSeparator);
+      for (util::TokenIter<util::AnyCharacter, true> word(fields[phrase], " \t"); word; ++word) {
+        key = MixIn(key, HashWord(*word));
+        if(0 == phrase) empty = false;
+      }
+    }
+    if(empty) {
+      TRACE_ERR("WARNING: empty source phrase in line '"<<line<<"'\n");
+      continue;
+    }
+
+    size_t numRead = 0;
+    for (util::TokenIter<util::AnyCharacter, true> score(fields[numKeyPhrases], " \t"); score; ++score, ++numRead) {
+      float prob = std::atof(score->as_string().c_str());
+      scores.push_back(FloorScore(TransformScore(prob)));
+    }
+    if(keys.empty()) {
+      numScores = numRead;
+      if(0 == numScores || numScores > MaxScores) {
+        TRACE_ERR("ERROR: " << numScores << " scores, expected 1 to " << MaxScores << "\n");
+        return false;
+      }
+    } else if(numRead != numScores) {
+      TRACE_ERR("ERROR: found inconsistent number of scores... found "
+                << numRead << " expected " << numScores << " in line " << lnc << "\n");
+      return false;
+    }
+    keys.push_back(ValidKey(key));
+  }
+  if(keys.empty()) {
+    TRACE_ERR("ERROR: empty lexicalised reordering file\n");
+    return false;
+  }
+
+  std::vector<float> codebooks(numScores * CodebookSize);
+  std::vector<float> column(keys.size());
+  for(size_t s = 0; s < numScores; ++s) {
+    for(size_t i = 0; i < keys.size(); ++i) {
+      column[i] = scores[i * numScores + s];
+    }
+    MakeCodebook(column, &codebooks[s * CodebookSize]);
+  }
+
+  Header header;
+  std::memcpy(header.magic, Magic, sizeof(header.magic));
+  header.numScores = numScores;
+  header.numKeyPhrases = numKeyPhrases;
+  header.entries = keys.size();
+  header.tableSize = Table::Size(keys.size(), 1.5);
+
+  // value initialised, so every bucket is empty
+  std::vector<Entry> buckets(header.tableSize / sizeof(Entry));
+  Table table(&buckets[0], header.tableSize);
+  size_t duplicates = 0;
+  for(size_t i = 0; i < keys.size(); ++i) {
+    Entry entry;
+    entry.key = keys[i];
+    entry.codes = 0;
+    for(size_t s = 0; s < numScores; ++s) {
+      entry.codes |= Encode(&codebooks[s * CodebookSize], scores[i * numScores + s]) << (8 * s);
+    }
+    Table::MutableIterator it;
+    if(table.FindOrInsert(entry, it)) ++duplicates;
+  }
+  if(duplicates) {
+    TRACE_ERR("WARNING: " << duplicates << " keys occurred more than once, kept the first\n");
+  }
+
+  util::scoped_fd out(util::CreateOrThrow((outFileName + ".hashlexr").c_str()));
+  util::WriteOrThrow(out.get(), &header, sizeof(header));
+  util::WriteOrThrow(out.get(), &codebooks[0], codebooks.size() * sizeof(float));
+  util::WriteOrThrow(out.get(), &buckets[0], header.tableSize);
+  return true;
+}
+
+}
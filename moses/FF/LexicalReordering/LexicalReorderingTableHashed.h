@@ -0,0 +1,82 @@
+// -*- c++ -*-
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "util/mmap.hh"
+#include "util/probing_hash_table.hh"
+#include "util/string_piece.hh"
+#include "LexicalReorderingTable.h"
+
+namespace Moses
+{
+
+/** lexical reordering table binarised with processLexicalTable -hashed.
+ *
+ * A phrase pair is keyed by a 64 bit hash of its words, the same murmur
+ * hash the probing phrase table uses for its vocabulary, so a lookup is a
+ * single probe into a hash table in a memory mapped file, without building
+ * a string key. The scores are quantised to one byte each, with one
+ * codebook of 256 values per score, and stored inline next to the key.
+ * Scores with at most 256 distinct values are kept exactly. Collisions of
+ * the hash are not detected, and conditioning on context is not supported.
+ */
+class LexicalReorderingTableHashed
+  : public LexicalReorderingTable
+{
+public:
+  //! scores per entry; bidirectional mslr, the largest model, has 8
+  static const size_t MaxScores = 8;
+
+  LexicalReorderingTableHashed(const std::string& filePath,
+                               const std::vector<FactorType>& f_factors,
+                               const std::vector<FactorType>& e_factors,
+                               const std::vector<FactorType>& c_factors);
+
+  //! write outFileName.hashlexr from a text table read from inFile
+  static
+  bool
+  Create(std::istream& inFile, const std::string& outFileName);
+
+  virtual
+  Scores
+  GetScore(const Phrase& f, const Phrase& e, const Phrase& c);
+
+  //! hashes all keys first and prefetches their buckets, then looks them up
+  virtual
+  void
+  GetScoreBatch(const std::vector<const Phrase*>& f,
+                const std::vector<const Phrase*>& e,
+                std::vector<Scores>& scores);
+
+private:
+  struct Entry {
+    typedef uint64_t Key;
+    uint64_t key;
+    uint64_t codes; // one byte per score, first score in the lowest byte
+
+    uint64_t GetKey() const {
+      return key;
+    }
+    void SetKey(uint64_t to) {
+      key = to;
+    }
+  };
+
+  // the keys already are hashes
+  typedef util::ProbingHashTable<Entry, util::IdentityHash> Table;
+
+  util::scoped_memory m_mem;
+  Table m_table;
+  size_t m_numScores;
+  const float *m_codebooks; // 256 values for each score
+
+  uint64_t MakeKey(const Phrase& f, const Phrase& e) const;
+  void Decode(uint64_t codes, Scores& scores) const;
+};
+
+}
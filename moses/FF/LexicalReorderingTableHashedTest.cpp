@@ -0,0 +1,177 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2013- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "moses/FactorCollection.h"
+#include "moses/Util.h"
+#include "LexicalReordering/LexicalReorderingTableHashed.h"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+Phrase MakePhrase(const string &text)
+{
+  Phrase phrase;
+  vector<string> words = Tokenize(text);
+  for (size_t i = 0; i < words.size(); ++i) {
+    phrase.AddWord()[0] = FactorCollection::Instance().AddFactor(words[i]);
+  }
+  return phrase;
+}
+
+struct TableFixture {
+  TableFixture()
+    : prefix((boost::filesystem::temp_directory_path()
+              / boost::filesystem::unique_path()).string()) {
+    factors.push_back(0);
+  }
+  ~TableFixture() {
+    remove((prefix + ".hashlexr").c_str());
+  }
+
+  void Build(const string &text) {
+    stringstream in(text);
+    BOOST_REQUIRE(LexicalReorderingTableHashed::Create(in, prefix));
+  }
+
+  string prefix;
+  vector<FactorType> factors;
+};
+
+}
+
+BOOST_FIXTURE_TEST_SUITE(lexical_reordering_table_hashed, TableFixture)
+
+BOOST_AUTO_TEST_CASE(exact_scores)
+{
+  Build("das haus ||| the house ||| 0.5 0.25 0.25\n"
+        "das ||| the ||| 0.7 0.2 0.1\n"
+        "haus ||| house ||| 1 0.5 0.5\n");
+  LexicalReorderingTableHashed table(prefix, factors, factors, vector<FactorType>());
+  Phrase context;
+
+  Scores scores = table.GetScore(MakePhrase("das haus"), MakePhrase("the house"), context);
+  BOOST_REQUIRE_EQUAL(3, scores.size());
+  BOOST_CHECK_EQUAL(FloorScore(TransformScore(0.5)), scores[0]);
+  BOOST_CHECK_EQUAL(FloorScore(TransformScore(0.25)), scores[1]);
+  BOOST_CHECK_EQUAL(FloorScore(TransformScore(0.25)), scores[2]);
+
+  scores = table.GetScore(MakePhrase("das"), MakePhrase("the"), context);
+  BOOST_REQUIRE_EQUAL(3, scores.size());
+  BOOST_CHECK_EQUAL(FloorScore(TransformScore(0.7)), scores[0]);
+  BOOST_CHECK_EQUAL(FloorScore(TransformScore(0.1)), scores[2]);
+
+  BOOST_CHECK(table.GetScore(MakePhrase("das"), MakePhrase("house"), context).empty());
+  BOOST_CHECK(table.GetScore(MakePhrase("das haus"), MakePhrase("the"), context).empty());
+  BOOST_CHECK(table.GetScore(Phrase(), MakePhrase("the"), context).empty());
+}
+
+BOOST_AUTO_TEST_CASE(source_only)
+{
+  Build("das haus ||| 0.5 0.5\n"
+        "das ||| 0.9 0.1\n");
+  vector<FactorType> none;
+  LexicalReorderingTableHashed table(prefix, factors, none, none);
+
+  Scores scores = table.GetScore(MakePhrase("das"), Phrase(), Phrase());
+  BOOST_REQUIRE_EQUAL(2, scores.size());
+  BOOST_CHECK_EQUAL(FloorScore(TransformScore(0.9)), scores[0]);
+
+  // keyed on one phrase, the model must not condition on both
+  BOOST_CHECK_THROW(LexicalReorderingTableHashed(prefix, factors, factors, none),
+                    util::Exception);
+}
+
+BOOST_AUTO_TEST_CASE(batch_matches_single_lookups)
+{
+  Build("a ||| x ||| 0.1 0.9\n"
+        "a b ||| x y ||| 0.3 0.7\n"
+        "b ||| y ||| 0.6 0.4\n");
+  LexicalReorderingTableHashed table(prefix, factors, factors, vector<FactorType>());
+
+  vector<Phrase> f, e;
+  f.push_back(MakePhrase("a"));
+  e.push_back(MakePhrase("x"));
+  f.push_back(MakePhrase("b"));
+  e.push_back(MakePhrase("x"));
+  f.push_back(MakePhrase("a b"));
+  e.push_back(MakePhrase("x y"));
+  f.push_back(Phrase());
+  e.push_back(MakePhrase("y"));
+  f.push_back(MakePhrase("b"));
+  e.push_back(MakePhrase("y"));
+
+  vector<const Phrase*> fp, ep;
+  for (size_t i = 0; i < f.size(); ++i) {
+    fp.push_back(&f[i]);
+    ep.push_back(&e[i]);
+  }
+  vector<Scores> batch;
+  table.GetScoreBatch(fp, ep, batch);
+  BOOST_REQUIRE_EQUAL(f.size(), batch.size());
+  for (size_t i = 0; i < f.size(); ++i) {
+    Scores single = table.GetScore(f[i], e[i], Phrase());
+    BOOST_CHECK_EQUAL_COLLECTIONS(single.begin(), single.end(),
+                                  batch[i].begin(), batch[i].end());
+  }
+  BOOST_CHECK(batch[1].empty());
+  BOOST_CHECK(batch[3].empty());
+  BOOST_CHECK_EQUAL(2, batch[4].size());
+}
+
+BOOST_AUTO_TEST_CASE(quantised_scores)
+{
+  // more distinct values than a codebook holds
+  stringstream text;
+  const size_t pairs = 2000;
+  for (size_t i = 0; i < pairs; ++i) {
+    text << "f" << i << " ||| e" << i << " ||| " << (i + 1.0) / (pairs + 1) << "\n";
+  }
+  Build(text.str());
+  LexicalReorderingTableHashed table(prefix, factors, factors, vector<FactorType>());
+
+  for (size_t i = 0; i < pairs; i += 97) {
+    ostringstream f, e;
+    f << "f" << i;
+    e << "e" << i;
+    Scores scores = table.GetScore(MakePhrase(f.str()), MakePhrase(e.str()), Phrase());
+    BOOST_REQUIRE_EQUAL(1, scores.size());
+    float expected = FloorScore(TransformScore((i + 1.0) / (pairs + 1)));
+    // each of the 256 bins holds 8 values, which are close except for the
+    // smallest probabilities, where the log changes fast
+    BOOST_CHECK_SMALL(scores[0] - expected, i < 50 ? 1.5f : 0.05f);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(rejects_inconsistent_scores)
+{
+  stringstream in("a ||| x ||| 0.1 0.9\n"
+                  "b ||| y ||| 0.6\n");
+  BOOST_CHECK(!LexicalReorderingTableHashed::Create(in, prefix));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -42,6 +42,18 @@ public:
     const FFState* prev_state,
     ScoreComponentCollection* accumulator) const = 0;
 
+  /**
+   * Hint that EvaluateWhenApplied() will soon be called for a hypothesis
+   * that extends one with state prev_state by targetPhrase. Features whose
+   * scoring does large random memory lookups (e.g. language models) can
+   * issue prefetches here, so that the cache misses of several upcoming
+   * hypotheses overlap. Must not change any state; the default does nothing.
+   */
+  virtual void PrefetchWhenApplied(
+    const FFState* /* prev_state */,
+    const TargetPhrase& /* targetPhrase */) const {
+  }
+
   // virtual FFState* EvaluateWhenAppliedWithContext(
   //   ttasksptr const& ttasks,
   //   const Hypothesis& cur_hypo,
@@ -20,9 +20,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 #include <boost/version.hpp>
-#ifdef WITH_THREADS
-#include <boost/thread/locks.hpp>
-#endif
 #include <ostream>
 #include <string>
 #include "FactorCollection.h"
@@ -35,47 +32,116 @@ namespace Moses
 {
 FactorCollection FactorCollection::s_instance;
 
-const Factor *FactorCollection::AddFactor(const StringPiece &factorString, bool isNonTerminal)
+FactorCollection::Index::Table::Table(std::size_t capacity)
+  : mask(capacity - 1), size(0), slots(new boost::atomic<const Factor*>[capacity])
+{
+  for (std::size_t i = 0; i < capacity; ++i) {
+    slots[i].store(NULL, boost::memory_order_relaxed);
+  }
+}
+
+FactorCollection::Index::Table::~Table()
+{
+  delete[] slots;
+}
+
+void FactorCollection::Index::Table::Insert(const Factor *factor, uint64_t hash)
+{
+  std::size_t i = hash & mask;
+  while (slots[i].load(boost::memory_order_relaxed)) {
+    i = (i + 1) & mask;
+  }
+  slots[i].store(factor, boost::memory_order_release);
+  ++size;
+}
+
+FactorCollection::Index::Index()
+{
+  m_table.store(new Table(1024), boost::memory_order_relaxed);
+}
+
+FactorCollection::Index::~Index()
+{
+  delete m_table.load(boost::memory_order_relaxed);
+  for (std::size_t i = 0; i < m_retired.size(); ++i) {
+    delete m_retired[i];
+  }
+}
+
+const Factor *FactorCollection::Index::Find(const StringPiece &str, uint64_t hash) const
 {
+  const Table *table = m_table.load(boost::memory_order_acquire);
+  for (std::size_t i = hash & table->mask; ; i = (i + 1) & table->mask) {
+    const Factor *factor = table->slots[i].load(boost::memory_order_acquire);
+    if (!factor) return NULL;
+    if (factor->GetString() == str) return factor;
+  }
+}
+
+void FactorCollection::Index::Insert(const Factor *factor, uint64_t hash)
+{
+  Table *table = m_table.load(boost::memory_order_relaxed);
+  if (2 * (table->size + 1) > table->mask + 1) {
+    Table *bigger = new Table(2 * (table->mask + 1));
+    for (std::size_t i = 0; i <= table->mask; ++i) {
+      const Factor *old = table->slots[i].load(boost::memory_order_relaxed);
+      if (old) {
+        StringPiece str = old->GetString();
+        bigger->Insert(old, util::MurmurHashNative(str.data(), str.size()));
+      }
+    }
+    m_retired.push_back(table);
+    m_table.store(bigger, boost::memory_order_release);
+    table = bigger;
+  }
+  table->Insert(factor, hash);
+}
+
+const Factor *FactorCollection::AddFactor(const StringPiece &factorString, bool isNonTerminal, bool copyString)
+{
+  const uint64_t hash = util::MurmurHashNative(factorString.data(), factorString.size());
+  Index &index = isNonTerminal ? m_indexNonTerminal : m_index;
+  // fast path for known factors: no lock
+  if (const Factor *found = index.Find(factorString, hash)) return found;
+
+#ifdef WITH_THREADS
+  // new factor, or one the index missed because it was added concurrently
+  boost::mutex::scoped_lock lock(m_accessLock);
+#endif // WITH_THREADS
   FactorFriend to_ins;
   to_ins.in.m_string = factorString;
   to_ins.in.m_id = (isNonTerminal) ? m_factorIdNonTerminal : m_factorId;
-  Set & set = (isNonTerminal) ? m_set : m_setNonTerminal;
-  // If we're threaded, hope a read-only lock is sufficient.
-#ifdef WITH_THREADS
-  {
-    // read=lock scope
-    boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
-    Set::const_iterator i = set.find(to_ins);
-    if (i != set.end()) return &i->in;
-  }
-  boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
-#endif // WITH_THREADS
+  Set & set = (isNonTerminal) ? m_setNonTerminal : m_set;
   std::pair<Set::iterator, bool> ret(set.insert(to_ins));
   if (ret.second) {
-    ret.first->in.m_string.set(
-      memcpy(m_string_backing.Allocate(factorString.size()), factorString.data(), factorString.size()),
-      factorString.size());
+    if (copyString) {
+      ret.first->in.m_string.set(
+        memcpy(m_string_backing.Allocate(factorString.size()), factorString.data(), factorString.size()),
+        factorString.size());
+    }
     if (isNonTerminal) {
       m_factorIdNonTerminal++;
       UTIL_THROW_IF2(m_factorIdNonTerminal >= moses_MaxNumNonterminals, "Number of non-terminals exceeds maximum size reserved. Adjust parameter moses_MaxNumNonterminals, then recompile");
     } else {
       m_factorId++;
     }
+    index.Insert(&ret.first->in, hash);
   }
   return &ret.first->in;
 }
 
 const Factor *FactorCollection::GetFactor(const StringPiece &factorString, bool isNonTerminal)
 {
+  const uint64_t hash = util::MurmurHashNative(factorString.data(), factorString.size());
+  Index &index = isNonTerminal ? m_indexNonTerminal : m_index;
+  if (const Factor *found = index.Find(factorString, hash)) return found;
+
   FactorFriend to_find;
   to_find.in.m_string = factorString;
-  to_find.in.m_id = (isNonTerminal) ? m_factorIdNonTerminal : m_factorId;
-  Set & set = (isNonTerminal) ? m_set : m_setNonTerminal;
+  Set & set = (isNonTerminal) ? m_setNonTerminal : m_set;
   {
-    // read=lock scope
 #ifdef WITH_THREADS
-    boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
+    boost::mutex::scoped_lock lock(m_accessLock);
 #endif // WITH_THREADS
     Set::const_iterator i = set.find(to_find);
     if (i != set.end()) return &i->in;
@@ -92,9 +158,10 @@ TO_STRING_BODY(FactorCollection);
 ostream& operator<<(ostream& out, const FactorCollection& factorCollection)
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(factorCollection.m_accessLock);
+  boost::mutex::scoped_lock lock(factorCollection.m_accessLock);
 #endif
-  for (FactorCollection::Set::const_iterator i = factorCollection.m_set.begin(); i != factorCollection.m_set.end(); ++i) {
+  // the non-terminals, which is what this printed when m_set held them
+  for (FactorCollection::Set::const_iterator i = factorCollection.m_setNonTerminal.begin(); i != factorCollection.m_setNonTerminal.end(); ++i) {
     out << i->in;
   }
   return out;
@@ -28,14 +28,16 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #endif
 
 #ifdef WITH_THREADS
-#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/mutex.hpp>
 #endif
 
 #include "util/murmur_hash.hh"
+#include <boost/atomic.hpp>
 #include <boost/unordered_set.hpp>
 
 #include <functional>
 #include <string>
+#include <vector>
 
 #include "util/string_piece.hh"
 #include "util/pool.hh"
@@ -78,20 +80,66 @@ class FactorCollection
     }
   };
   typedef boost::unordered_set<FactorFriend, HashFactor, EqualsFactor> Set;
+  // own the factors; only touched while holding m_accessLock
   Set m_set;
   Set m_setNonTerminal;
 
+  /** Open addressing hash table of the factors of one Set that can be read
+   * without any locking.
+   *
+   * Inserts are serialised by m_accessLock and publish the factor pointer
+   * with a release store after the factor is fully constructed, so a reader
+   * sees either a complete factor or an empty slot. When the table gets half
+   * full it is replaced by one of twice the size. Replaced tables are kept
+   * until destruction because readers may still be probing them; such a
+   * reader can miss a factor added after the switch, which only sends it to
+   * the locked path in AddFactor().
+   */
+  class Index
+  {
+  public:
+    Index();
+    ~Index();
+
+    //! the factor with this string, or NULL if it is not (yet) visible
+    const Factor *Find(const StringPiece &str, uint64_t hash) const;
+
+    //! call with m_accessLock held
+    void Insert(const Factor *factor, uint64_t hash);
+
+  private:
+    struct Table {
+      std::size_t mask;
+      std::size_t size;
+      boost::atomic<const Factor*> *slots;
+
+      explicit Table(std::size_t capacity);
+      ~Table();
+      void Insert(const Factor *factor, uint64_t hash);
+    };
+
+    boost::atomic<Table*> m_table;
+    std::vector<Table*> m_retired;
+
+    Index(const Index &);
+    void operator=(const Index &);
+  };
+  Index m_index;
+  Index m_indexNonTerminal;
+
   util::Pool m_string_backing;
 
   static FactorCollection s_instance;
 #ifdef WITH_THREADS
-  //reader-writer lock
-  mutable boost::shared_mutex m_accessLock;
+  // serialises inserts; lookups of known factors go through the Index
+  mutable boost::mutex m_accessLock;
 #endif
 
   size_t m_factorIdNonTerminal; /**< unique, contiguous ids, starting from 0, for each non-terminal factor */
   size_t m_factorId; /**< unique, contiguous ids, starting from moses_MaxNumNonterminals, for each terminal factor */
 
+  const Factor *AddFactor(const StringPiece &factorString, bool isNonTerminal, bool copyString);
+
   //! constructor. only the 1 static variable can be created
   FactorCollection()
     : m_factorIdNonTerminal(0)
@@ -108,7 +156,18 @@ public:
   /** returns a factor with the same direction, factorType and factorString.
   *	If a factor already exist in the collection, return the existing factor, if not create a new 1
   */
-  const Factor *AddFactor(const StringPiece &factorString, bool isNonTerminal = false);
+  const Factor *AddFactor(const StringPiece &factorString, bool isNonTerminal = false) {
+    return AddFactor(factorString, isNonTerminal, true);
+  }
+
+  /** as AddFactor(), but a newly created factor refers to factorString itself
+   * instead of a copy. The caller guarantees that the string stays valid for
+   * the lifetime of the collection, e.g. because it lives in a memory mapped
+   * ModelSnapshot.
+   */
+  const Factor *AddPersistentFactor(const StringPiece &factorString, bool isNonTerminal = false) {
+    return AddFactor(factorString, isNonTerminal, false);
+  }
 
   size_t GetNumNonTerminals() {
     return m_factorIdNonTerminal;
@@ -0,0 +1,129 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/lexical_cast.hpp>
+#include <boost/test/unit_test.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#endif
+
+#include "FactorCollection.h"
+
+using namespace Moses;
+
+namespace
+{
+
+std::vector<std::string> Words(const std::string &prefix, size_t n)
+{
+  std::vector<std::string> ret;
+  for (size_t i = 0; i < n; ++i)
+    ret.push_back(prefix + boost::lexical_cast<std::string>(i));
+  return ret;
+}
+
+// add the words starting at an offset, so that threads race for the same ones
+void AddAll(const std::vector<std::string> *words, size_t offset,
+            std::vector<const Factor*> *out)
+{
+  FactorCollection &fc = FactorCollection::Instance();
+  out->resize(words->size());
+  for (size_t i = 0; i < words->size(); ++i) {
+    size_t w = (i + offset) % words->size();
+    (*out)[w] = fc.AddFactor((*words)[w]);
+  }
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(factor_collection)
+
+BOOST_AUTO_TEST_CASE(add_and_get)
+{
+  FactorCollection &fc = FactorCollection::Instance();
+  BOOST_CHECK(fc.GetFactor("factor_collection_test_new") == NULL);
+  const Factor *term = fc.AddFactor("factor_collection_test_new");
+  BOOST_CHECK_EQUAL(term->GetString(), "factor_collection_test_new");
+  BOOST_CHECK(fc.AddFactor("factor_collection_test_new") == term);
+  BOOST_CHECK(fc.GetFactor("factor_collection_test_new") == term);
+
+  // non-terminals are kept apart
+  BOOST_CHECK(fc.GetFactor("factor_collection_test_new", true) == NULL);
+  const Factor *nonTerm = fc.AddFactor("factor_collection_test_new", true);
+  BOOST_CHECK(nonTerm != term);
+  BOOST_CHECK(nonTerm->GetId() < moses_MaxNumNonterminals);
+  BOOST_CHECK(term->GetId() >= moses_MaxNumNonterminals);
+}
+
+BOOST_AUTO_TEST_CASE(many_factors)
+{
+  // enough to make the lock-free index grow several times
+  std::vector<std::string> words = Words("factor_collection_test_many_", 20000);
+  std::vector<const Factor*> first, second;
+  AddAll(&words, 0, &first);
+  AddAll(&words, 123, &second);
+  BOOST_CHECK(first == second);
+  std::set<size_t> ids;
+  for (size_t i = 0; i < words.size(); ++i) {
+    BOOST_CHECK_EQUAL(first[i]->GetString(), words[i]);
+    ids.insert(first[i]->GetId());
+  }
+  BOOST_CHECK_EQUAL(ids.size(), words.size());
+}
+
+#ifdef WITH_THREADS
+BOOST_AUTO_TEST_CASE(concurrent_add)
+{
+  const size_t numThreads = 4;
+  std::vector<std::string> words = Words("factor_collection_test_concurrent_", 20000);
+  std::vector<std::vector<const Factor*> > results(numThreads);
+  boost::thread_group threads;
+  for (size_t t = 0; t < numThreads; ++t) {
+    threads.create_thread(boost::bind(&AddAll, &words, t * 997, &results[t]));
+  }
+  threads.join_all();
+
+  for (size_t t = 1; t < numThreads; ++t) {
+    BOOST_CHECK(results[t] == results[0]);
+  }
+  std::set<size_t> ids;
+  for (size_t i = 0; i < words.size(); ++i) {
+    BOOST_CHECK_EQUAL(results[0][i]->GetString(), words[i]);
+    ids.insert(results[0][i]->GetId());
+  }
+  BOOST_CHECK_EQUAL(ids.size(), words.size());
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(print_non_terminals)
+{
+  FactorCollection &fc = FactorCollection::Instance();
+  fc.AddFactor("print_terminal_xyzzy");
+  fc.AddFactor("PRINT_NT_XYZZY", true);
+  std::ostringstream out;
+  out << fc;
+  BOOST_CHECK(out.str().find("PRINT_NT_XYZZY") != std::string::npos);
+  BOOST_CHECK(out.str().find("print_terminal_xyzzy") == std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -42,12 +42,21 @@ FName::Name2Id FName::name2id;
 vector<string> FName::id2name;
 FName::Id2Count FName::id2hopeCount;
 FName::Id2Count FName::id2fearCount;
+const FName::Name2Id *FName::frozenName2id = NULL;
 #ifdef WITH_THREADS
 boost::shared_mutex FName::m_idLock;
 #endif
 
 void FName::init(const StringPiece &name)
 {
+  if (frozenName2id) {
+    Name2Id::const_iterator i = FindStringPiece(*frozenName2id, name);
+    if (i != frozenName2id->end()) {
+      m_id = i->second;
+      return;
+    }
+  }
+
 #ifdef WITH_THREADS
   //reader lock
   boost::shared_lock<boost::shared_mutex> lock(m_idLock);
@@ -73,6 +82,15 @@ void FName::init(const StringPiece &name)
   }
 }
 
+void FName::freeze()
+{
+#ifdef WITH_THREADS
+  boost::shared_lock<boost::shared_mutex> lock(m_idLock);
+#endif
+  delete frozenName2id;
+  frozenName2id = new Name2Id(name2id);
+}
+
 size_t FName::getId(const string& name)
 {
   Name2Id::iterator i = name2id.find(name);
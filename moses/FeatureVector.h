@@ -95,9 +95,17 @@ struct FName {
   static void incrementFearId(const std::string& name);
   static void eraseId(size_t id);
 
+  /** Take a read-only copy of the names known so far (-freeze-feature-names).
+   * These are then resolved without m_idLock, which the decoding threads
+   * otherwise take for every feature name they construct. Names first seen
+   * afterwards still go through the locked map. Call it while no other
+   * thread uses feature names, i.e. at the end of loading. */
+  static void freeze();
+
 private:
   void init(const StringPiece& name);
   size_t m_id;
+  static const Name2Id *frozenName2id;
 #ifdef WITH_THREADS
   //reader-writer lock
   static boost::shared_mutex m_idLock;
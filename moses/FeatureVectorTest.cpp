@@ -306,6 +306,22 @@ BOOST_AUTO_TEST_CASE(ip)
   BOOST_CHECK_CLOSE((FValue)p1, 1.1*0.5 + -0.1*0.25 + 2.2*2.4, TOL);
 }
 
+BOOST_AUTO_TEST_CASE(frozen_names)
+{
+  FName before("frozen_before");
+  FName::freeze();
+  // names known before and after the freeze keep their ids, and new ones
+  // still get fresh ids
+  FName again("frozen_before");
+  FName after("frozen_after");
+  FName afterAgain("frozen", "after");
+  BOOST_CHECK(before == again);
+  BOOST_CHECK(after != before);
+  BOOST_CHECK(after == afterAgain);
+  BOOST_CHECK_EQUAL(again.name(), "frozen_before");
+  BOOST_CHECK_EQUAL(afterAgain.name(), "frozen_after");
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -91,7 +91,6 @@ Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt, const
   , m_manager(prevHypo.GetManager())
   , m_id(id)
 {
-  m_currScoreBreakdown.PlusEquals(transOpt.GetScoreBreakdown());
   m_wordDeleted = transOpt.IsDeletionOption();
 }
 
@@ -139,6 +138,21 @@ AddArc(Hypothesis *loserHypo)
   m_arcList->push_back(loserHypo);
 }
 
+const ScoreComponentCollection&
+Hypothesis::
+GetScoreBreakdown() const
+{
+  if (!m_scoreBreakdown) {
+    m_scoreBreakdown.reset(new ScoreComponentCollection);
+    m_scoreBreakdown->PlusEquals(m_transOpt.GetScoreBreakdown());
+    m_scoreBreakdown->PlusEquals(m_currScoreBreakdown);
+    if (m_prevHypo) {
+      m_scoreBreakdown->PlusEquals(m_prevHypo->GetScoreBreakdown());
+    }
+  }
+  return *(m_scoreBreakdown.get());
+}
+
 /***
  * calculate the logarithm of our total translation score (sum up components)
  */
@@ -178,10 +192,25 @@ EvaluateWhenApplied(float estimatedScore)
   m_estimatedScore = estimatedScore;
 
   // TOTAL
-  m_futureScore = m_currScoreBreakdown.GetWeightedScore() + m_estimatedScore;
+  // the translation option's scores are weighted once, when it is created
+  m_futureScore = m_transOpt.GetWeightedScore()
+                  + m_currScoreBreakdown.GetWeightedScore() + m_estimatedScore;
   if (m_prevHypo) m_futureScore += m_prevHypo->GetScore();
 }
 
+void
+Hypothesis::
+PrefetchWhenApplied(const TranslationOption &transOpt) const
+{
+  // a hint only, so ignored feature functions need not be filtered out
+  const TargetPhrase &targetPhrase = transOpt.GetTargetPhrase();
+  const vector<const StatefulFeatureFunction*>& ffs =
+    StatefulFeatureFunction::GetStatefulFeatureFunctions();
+  for (unsigned i = 0; i < ffs.size(); ++i) {
+    ffs[i]->PrefetchWhenApplied(m_ffStates[i], targetPhrase);
+  }
+}
+
 const Hypothesis* Hypothesis::GetPrevHypo()const
 {
   return m_prevHypo;
@@ -223,7 +252,8 @@ PrintHypothesis() const
   //	TRACE_ERR( "\tlanguage model cost "); // <<m_score[ScoreType::LanguageModelScore]<<endl;
   //	TRACE_ERR( "\tword penalty "); // <<(m_score[ScoreType::WordPenalty]*weightWordPenalty)<<endl;
   TRACE_ERR( "\tscore "<<m_futureScore - m_estimatedScore<<" + future cost "<<m_estimatedScore<<" = "<<m_futureScore<<endl);
-  TRACE_ERR(  "\tunweighted feature scores: " << m_currScoreBreakdown << endl);
+  TRACE_ERR(  "\tunweighted feature scores: " << m_transOpt.GetScoreBreakdown()
+              << " + " << m_currScoreBreakdown << endl);
   //PrintLMScores();
 }
 
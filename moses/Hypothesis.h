@@ -36,6 +36,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "ScoreComponentCollection.h"
 #include "InputType.h"
 #include "ObjectPool.h"
+#include "SentenceArena.h"
 #include "xmlrpc-c.h"
 
 namespace Moses
@@ -76,7 +77,7 @@ protected:
   float							m_estimatedScore; /*! estimated future cost to translate rest of sentence */
   /*! sum of scores of this hypothesis, and previous hypotheses. Lazily initialised.  */
   mutable boost::scoped_ptr<ScoreComponentCollection> m_scoreBreakdown;
-  ScoreComponentCollection m_currScoreBreakdown; /*! scores for this hypothesis only */
+  ScoreComponentCollection m_currScoreBreakdown; /*! scores of the feature functions applied to this hypothesis, without those of the translation option */
   std::vector<const FFState*> m_ffStates;
   const Hypothesis 	*m_winningHypo;
   ArcList 					*m_arcList; /*! all arcs that end at the same trellis point as this hypothesis */
@@ -92,6 +93,14 @@ public:
   Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt, const Bitmap &bitmap, int id);
   ~Hypothesis();
 
+  //! hypotheses live in the sentence arena if one is active (see SentenceArena)
+  static void *operator new(size_t bytes) {
+    return SentenceArena::Allocate(bytes);
+  }
+  static void operator delete(void *p) {
+    SentenceArena::Free(p);
+  }
+
   void PrintHypothesis() const;
 
   const InputType& GetInput() const {
@@ -122,9 +131,17 @@ public:
 
   void EvaluateWhenApplied(float estimatedScore);
 
+  /** let the stateful feature functions prefetch what they will look up
+   * when a hypothesis extending this one by transOpt is scored */
+  void PrefetchWhenApplied(const TranslationOption &transOpt) const;
+
   int GetId()const {
     return m_id;
   }
+  //! for hypotheses built out of order, see SearchNormal::ExpandPendingInParallel()
+  void SetId(int id) {
+    m_id = id;
+  }
 
   const Hypothesis* GetPrevHypo() const;
 
@@ -208,16 +225,7 @@ public:
   inline const ArcList* GetArcList() const {
     return m_arcList;
   }
-  const ScoreComponentCollection& GetScoreBreakdown() const {
-    if (!m_scoreBreakdown) {
-      m_scoreBreakdown.reset(new ScoreComponentCollection);
-      m_scoreBreakdown->PlusEquals(m_currScoreBreakdown);
-      if (m_prevHypo) {
-        m_scoreBreakdown->PlusEquals(m_prevHypo->GetScoreBreakdown());
-      }
-    }
-    return *(m_scoreBreakdown.get());
-  }
+  const ScoreComponentCollection& GetScoreBreakdown() const;
   float GetFutureScore() const {
     return m_futureScore;
   }
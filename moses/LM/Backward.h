@@ -51,6 +51,12 @@ public:
 
   virtual void CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const;
 
+  // phrases are scored right to left, so the forward prefix trie of
+  // LanguageModelKen does not apply; score them one at a time
+  virtual void CalcScoreBatch(const std::vector<const Phrase*> &phrases, std::vector<float> &fullScores, std::vector<float> &ngramScores, std::vector<size_t> &oovCounts) const {
+    LanguageModel::CalcScoreBatch(phrases, fullScores, ngramScores, oovCounts);
+  }
+
   virtual FFState *Evaluate(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const;
 
   FFState *Evaluate(const Phrase &phrase, const FFState *ps, float &returnedScore) const;
@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/ChartManager.h"
 #include "moses/FactorCollection.h"
 #include "moses/Phrase.h"
+#include "moses/TargetPhrase.h"
 #include "util/exception.hh"
 
 using namespace std;
@@ -68,7 +69,32 @@ EvaluateInIsolation(Phrase const& source, TargetPhrase const& targetPhrase,
   size_t oovCount;
 
   CalcScore(targetPhrase, fullScore, nGramScore, oovCount);
+  AssignScores(fullScore, nGramScore, oovCount, scoreBreakdown, estimatedScores);
+}
+
+void
+LanguageModel::
+EvaluateInIsolationBatch(const std::vector<const Phrase*> &sources
+                         , const std::vector<TargetPhrase*> &targetPhrases
+                         , std::vector<ScoreComponentCollection> &estimatedScores) const
+{
+  std::vector<const Phrase*> phrases(targetPhrases.begin(), targetPhrases.end());
+  std::vector<float> fullScores, nGramScores;
+  std::vector<size_t> oovCounts;
+  CalcScoreBatch(phrases, fullScores, nGramScores, oovCounts);
+
+  for (size_t i = 0; i < targetPhrases.size(); ++i) {
+    AssignScores(fullScores[i], nGramScores[i], oovCounts[i],
+                 targetPhrases[i]->GetScoreBreakdown(), estimatedScores[i]);
+  }
+}
 
+void
+LanguageModel::
+AssignScores(float fullScore, float nGramScore, size_t oovCount
+             , ScoreComponentCollection &scoreBreakdown
+             , ScoreComponentCollection &estimatedScores) const
+{
   float estimateScore = fullScore - nGramScore;
 
   if (m_enableOOVFeature) {
@@ -86,6 +112,21 @@ EvaluateInIsolation(Phrase const& source, TargetPhrase const& targetPhrase,
   }
 }
 
+void
+LanguageModel::
+CalcScoreBatch(const std::vector<const Phrase*> &phrases,
+               std::vector<float> &fullScores,
+               std::vector<float> &ngramScores,
+               std::vector<size_t> &oovCounts) const
+{
+  fullScores.resize(phrases.size());
+  ngramScores.resize(phrases.size());
+  oovCounts.resize(phrases.size());
+  for (size_t i = 0; i < phrases.size(); ++i) {
+    CalcScore(*phrases[i], fullScores[i], ngramScores[i], oovCounts[i]);
+  }
+}
+
 const LanguageModel &LanguageModel::GetFirstLM()
 {
   static const LanguageModel *lmStatic = NULL;
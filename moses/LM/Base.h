@@ -70,6 +70,17 @@ public:
    */
   virtual void CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, std::size_t &oovCount) const = 0;
 
+  /* calc the scores of several phrases at once, e.g. all target phrases
+   * retrieved for one sentence. Results are returned in the i-th element
+   * of each output vector and are the same as CalcScore() would give for
+   * phrases[i]. Implementations may share the work for common prefixes;
+   * the default scores one phrase at a time.
+   */
+  virtual void CalcScoreBatch(const std::vector<const Phrase*> &phrases,
+                              std::vector<float> &fullScores,
+                              std::vector<float> &ngramScores,
+                              std::vector<std::size_t> &oovCounts) const;
+
   virtual void CalcScoreFromCache(const Phrase &phrase, float &fullScore, float &ngramScore, std::size_t &oovCount) const {
   }
 
@@ -90,6 +101,14 @@ public:
                                    , ScoreComponentCollection &scoreBreakdown
                                    , ScoreComponentCollection &estimatedScores) const;
 
+  virtual void EvaluateInIsolationBatch(const std::vector<const Phrase*> &sources
+                                        , const std::vector<TargetPhrase*> &targetPhrases
+                                        , std::vector<ScoreComponentCollection> &estimatedScores) const;
+
+private:
+  void AssignScores(float fullScore, float nGramScore, std::size_t oovCount
+                    , ScoreComponentCollection &scoreBreakdown
+                    , ScoreComponentCollection &estimatedScores) const;
 };
 
 }
@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <cstdlib>
 #include <boost/shared_ptr.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "lm/binary_format.hh"
 #include "lm/enumerate_vocab.hh"
@@ -242,6 +243,132 @@ template <class Model> void LanguageModelKen<Model>::CalcScore(const Phrase &phr
   fullScore = TransformLMScore(fullScore);
 }
 
+namespace
+{
+// Node of the prefix trie built by CalcScoreBatch(). Holds what RuleScore
+// would hold after scoring the words from the root down to this node.
+struct BatchNode {
+  size_t parent;
+  lm::WordIndex word;
+  lm::ngram::State right;
+  bool leftDone;
+  float prob;
+  // prob after the first Order() - 1 words (incl. <s>), the part of the
+  // score that CalcScore() does not count as full n-grams
+  float boundaryProb;
+  size_t oovCount;
+};
+
+// how many queries ahead of the one being scored to prefetch
+const size_t kBatchPrefetchDistance = 8;
+}
+
+/* Scores all phrases in one pass over a trie of their words. Phrases that
+ * share a prefix (very common among translations of the same source) have
+ * that prefix scored once. The trie is scored breadth-first: the nodes of
+ * one level are independent queries, so the LM can prefetch the hash table
+ * entries of the next few while the current one is scored.
+ *
+ * Phrases with non-terminals are passed on to CalcScore().
+ */
+template <class Model> void LanguageModelKen<Model>::CalcScoreBatch(const std::vector<const Phrase*> &phrases, std::vector<float> &fullScores, std::vector<float> &ngramScores, std::vector<size_t> &oovCounts) const
+{
+  fullScores.assign(phrases.size(), 0);
+  ngramScores.assign(phrases.size(), 0);
+  oovCounts.assign(phrases.size(), 0);
+
+  // two roots: the empty context and <s>
+  std::vector<BatchNode> nodes(2);
+  nodes[0].right = m_ngram->NullContextState();
+  nodes[0].leftDone = false;
+  nodes[1].right = m_ngram->BeginSentenceState();
+  nodes[1].leftDone = true;
+  for (size_t i = 0; i < 2; ++i) {
+    nodes[i].parent = i;
+    nodes[i].word = 0;
+    nodes[i].prob = nodes[i].boundaryProb = 0;
+    nodes[i].oovCount = 0;
+  }
+
+  typedef boost::unordered_map<std::pair<size_t, lm::WordIndex>, size_t> Children;
+  Children children;
+  std::vector<std::vector<size_t> > levels;
+  std::vector<size_t> ends(phrases.size(), 0);
+
+  for (size_t i = 0; i < phrases.size(); ++i) {
+    const Phrase &phrase = *phrases[i];
+    if (!phrase.GetSize()) continue;
+    if (phrase.GetNumNonTerminals()) {
+      CalcScore(phrase, fullScores[i], ngramScores[i], oovCounts[i]);
+      continue;
+    }
+
+    size_t node, depth;
+    if (m_beginSentenceFactor == phrase.GetWord(0).GetFactor(m_factorType)) {
+      node = 1;
+      depth = 1;
+    } else {
+      node = 0;
+      depth = 0;
+    }
+    for (size_t pos = depth; pos < phrase.GetSize(); ++pos, ++depth) {
+      lm::WordIndex index = TranslateID(phrase.GetWord(pos));
+      std::pair<Children::iterator, bool> ins
+      = children.insert(std::make_pair(std::make_pair(node, index), nodes.size()));
+      if (ins.second) {
+        BatchNode child;
+        child.parent = node;
+        child.word = index;
+        nodes.push_back(child);
+        if (levels.size() <= depth) levels.resize(depth + 1);
+        levels[depth].push_back(ins.first->second);
+      }
+      node = ins.first->second;
+    }
+    ends[i] = node;
+  }
+
+  // same arithmetic as RuleScore::Terminal() and CalcScore()
+  const size_t ngramBoundary = m_ngram->Order() - 1;
+  for (size_t depth = 0; depth < levels.size(); ++depth) {
+    const std::vector<size_t> &level = levels[depth];
+    for (size_t j = 0; j < level.size() && j < kBatchPrefetchDistance; ++j) {
+      const BatchNode &node = nodes[level[j]];
+      m_ngram->Prefetch(nodes[node.parent].right, node.word);
+    }
+    for (size_t j = 0; j < level.size(); ++j) {
+      if (j + kBatchPrefetchDistance < level.size()) {
+        const BatchNode &ahead = nodes[level[j + kBatchPrefetchDistance]];
+        m_ngram->Prefetch(nodes[ahead.parent].right, ahead.word);
+      }
+
+      BatchNode &node = nodes[level[j]];
+      const BatchNode &parent = nodes[node.parent];
+      lm::FullScoreReturn ret(m_ngram->FullScore(parent.right, node.word, node.right));
+      if (parent.leftDone) {
+        node.prob = parent.prob + ret.prob;
+        node.leftDone = true;
+      } else if (ret.independent_left) {
+        node.prob = parent.prob + ret.prob;
+        node.leftDone = true;
+      } else {
+        node.prob = parent.prob + ret.rest;
+        node.leftDone = (node.right.length != parent.right.length + 1);
+      }
+      node.boundaryProb = (depth + 1 <= ngramBoundary) ? node.prob : parent.boundaryProb;
+      node.oovCount = parent.oovCount + (node.word ? 0 : 1);
+    }
+  }
+
+  for (size_t i = 0; i < phrases.size(); ++i) {
+    if (!ends[i]) continue;
+    const BatchNode &node = nodes[ends[i]];
+    ngramScores[i] = TransformLMScore(node.prob - node.boundaryProb);
+    fullScores[i] = TransformLMScore(node.prob);
+    oovCounts[i] = node.oovCount;
+  }
+}
+
 template <class Model> FFState *LanguageModelKen<Model>::EvaluateWhenApplied(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const
 {
   const lm::ngram::State &in_state = static_cast<const KenLMState&>(*ps).state;
@@ -298,6 +425,15 @@ template <class Model> FFState *LanguageModelKen<Model>::EvaluateWhenApplied(con
   return ret.release();
 }
 
+template <class Model> void LanguageModelKen<Model>::PrefetchWhenApplied(const FFState *ps, const TargetPhrase &targetPhrase) const
+{
+  // Only the first word's lookups depend on nothing but the previous state;
+  // the later words depend on the result of the first.
+  if (!ps || !targetPhrase.GetSize()) return;
+  const lm::ngram::State &in_state = static_cast<const KenLMState&>(*ps).state;
+  m_ngram->Prefetch(in_state, TranslateID(targetPhrase.GetWord(0)));
+}
+
 class LanguageModelChartStateKenLM : public FFState
 {
 public:
@@ -55,8 +55,12 @@ public:
 
   virtual void CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const;
 
+  virtual void CalcScoreBatch(const std::vector<const Phrase*> &phrases, std::vector<float> &fullScores, std::vector<float> &ngramScores, std::vector<size_t> &oovCounts) const;
+
   virtual FFState *EvaluateWhenApplied(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const;
 
+  virtual void PrefetchWhenApplied(const FFState *ps, const TargetPhrase &targetPhrase) const;
+
   virtual FFState *EvaluateWhenApplied(const ChartHypothesis& cur_hypo, int featureID, ScoreComponentCollection *accumulator) const;
 
   virtual FFState *EvaluateWhenApplied(const Syntax::SHyperedge& hyperedge, int featureID, ScoreComponentCollection *accumulator) const;
@@ -0,0 +1,89 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2010 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#define BOOST_TEST_MODULE KenTest
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "moses/LM/Ken.h"
+#include "moses/Phrase.h"
+
+using namespace Moses;
+
+namespace
+{
+
+const char *FileLocation()
+{
+  if (boost::unit_test::framework::master_test_suite().argc < 2) {
+    BOOST_FAIL("Jamfile must specify arpa file for this test, but did not");
+  }
+  return boost::unit_test::framework::master_test_suite().argv[1];
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(batch_matches_single)
+{
+  std::auto_ptr<LanguageModel> lm(ConstructKenLM("LM0=1.0", FileLocation(), 0, false));
+
+  // overlapping prefixes, <s>, an unknown word and phrases longer than
+  // the order of the model
+  const char *strings[] = {
+    "the licenses for most software",
+    "the licenses for most",
+    "the licenses",
+    "the licenses for",
+    "the licenses are",
+    "<s> the licenses for most",
+    "<s> the",
+    "<s>",
+    "for most software are designed",
+    "xyzzy the licenses",
+    "the xyzzy licenses for",
+    "the",
+  };
+  const size_t n = sizeof(strings) / sizeof(strings[0]);
+
+  std::vector<FactorType> factorOrder(1, 0);
+  std::vector<Phrase> phrases(n);
+  std::vector<const Phrase*> batch;
+  for (size_t i = 0; i < n; ++i) {
+    phrases[i].CreateFromString(Output, factorOrder, strings[i], NULL);
+    batch.push_back(&phrases[i]);
+  }
+  Phrase empty;
+  batch.push_back(&empty);
+
+  std::vector<float> fullScores, ngramScores;
+  std::vector<size_t> oovCounts;
+  lm->CalcScoreBatch(batch, fullScores, ngramScores, oovCounts);
+  BOOST_REQUIRE_EQUAL(fullScores.size(), batch.size());
+
+  for (size_t i = 0; i < batch.size(); ++i) {
+    float fullScore, ngramScore;
+    size_t oovCount;
+    lm->CalcScore(*batch[i], fullScore, ngramScore, oovCount);
+    BOOST_CHECK_EQUAL(fullScore, fullScores[i]);
+    BOOST_CHECK_EQUAL(ngramScore, ngramScores[i]);
+    BOOST_CHECK_EQUAL(oovCount, oovCounts[i]);
+  }
+  BOOST_CHECK_EQUAL(oovCounts[9], 1);
+}
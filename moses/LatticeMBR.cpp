@@ -17,7 +17,7 @@ using namespace std;
 namespace Moses
 {
 
-size_t bleu_order = 4;
+const size_t bleu_order = 4;
 float UNKNGRAMLOGPROB = -20;
 void GetOutputWords(const TrellisPath &path, vector <Word> &translation)
 {
@@ -35,45 +35,179 @@ void GetOutputWords(const TrellisPath &path, vector <Word> &translation)
 }
 
 
-void extract_ngrams(const vector<Word >& sentence, map < Phrase, int >  & allngrams)
+void extract_ngrams(const vector<Word >& sentence, vector<boost::unordered_map<NgramId, int> >& allngrams)
 {
-  for (int k = 0; k < (int)bleu_order; k++) {
-    for(int i =0; i < max((int)sentence.size()-k,0); i++) {
-      Phrase ngram( k+1);
-      for ( int j = i; j<= i+k; j++) {
-        ngram.AddWord(sentence[j]);
-      }
-      ++allngrams[ngram];
+  allngrams.resize(bleu_order);
+  for (size_t i = 0; i < sentence.size(); ++i) {
+    NgramId ngram = 0;
+    for (size_t k = 0; k < bleu_order && i + k < sentence.size(); ++k) {
+      ngram = NgramHashExtend(ngram, sentence[i+k]);
+      ++allngrams[k][ngram];
     }
   }
 }
 
+namespace
+{
 
+/** An n-gram ending on an edge, with one of the paths of edges it spans.  The
+ * path ends with that edge. */
+struct NgramPath {
+  NgramId ngram;
+  size_t order;
+  const Word* words[bleu_order];
+  size_t length;
+  const Edge* path[bleu_order];
+  size_t count;
+};
+
+struct NgramPathHash {
+  size_t operator()(const NgramPath& ngramPath) const {
+    size_t seed = ngramPath.ngram;
+    for (size_t i = 0; i < ngramPath.length; ++i) {
+      boost::hash_combine(seed, ngramPath.path[i]);
+    }
+    return seed;
+  }
+};
+
+/** Same words on the same path, ignoring the count */
+struct NgramPathEqual {
+  bool operator()(const NgramPath& a, const NgramPath& b) const {
+    if (a.ngram != b.ngram || a.order != b.order || a.length != b.length) {
+      return false;
+    }
+    for (size_t i = 0; i < a.order; ++i) {
+      if (*a.words[i] != *b.words[i]) {
+        return false;
+      }
+    }
+    return std::equal(a.path, a.path + a.length, b.path);
+  }
+};
 
-void NgramScores::addScore(const Hypothesis* node, const Phrase& ngram, float score)
+/** The n-grams ending on an edge: those local to the edge, and those
+ * straddling it and the edges into its tail node */
+class EdgeNgrams
 {
-  set<Phrase>::const_iterator ngramIter = m_ngrams.find(ngram);
-  if (ngramIter == m_ngrams.end()) {
-    ngramIter = m_ngrams.insert(ngram).first;
-  }
-  map<const Phrase*,float>& ngramScores = m_scores[node];
-  map<const Phrase*,float>::iterator scoreIter = ngramScores.find(&(*ngramIter));
-  if (scoreIter == ngramScores.end()) {
-    ngramScores[&(*ngramIter)] = score;
-  } else {
-    ngramScores[&(*ngramIter)] = log_sum(score,scoreIter->second);
+public:
+  void Collect(const Edge& edge, const vector<Edge>& tailEdges, const vector<EdgeNgrams>& tailNgrams);
+
+  const vector<NgramPath>& GetNgrams() const {
+    return m_ngrams;
+  }
+
+  bool Contains(size_t order, NgramId ngram) const {
+    return binary_search(m_ids.begin(), m_ids.end(), make_pair(order, ngram));
   }
+
+private:
+  vector<NgramPath> m_ngrams;
+  vector<pair<size_t, NgramId> > m_ids; // sorted, for Contains()
+  boost::unordered_map<NgramPath, size_t, NgramPathHash, NgramPathEqual> m_index; // into m_ngrams, while collecting
+
+  //an n-gram found twice on the same path adds up its counts
+  void Store(const NgramPath& ngramPath) {
+    pair<boost::unordered_map<NgramPath, size_t, NgramPathHash, NgramPathEqual>::iterator, bool> inserted =
+      m_index.insert(make_pair(ngramPath, m_ngrams.size()));
+    if (inserted.second) {
+      m_ngrams.push_back(ngramPath);
+    } else {
+      m_ngrams[inserted.first->second].count += ngramPath.count;
+    }
+  }
+};
+
+void EdgeNgrams::Collect(const Edge& edge, const vector<Edge>& tailEdges, const vector<EdgeNgrams>& tailNgrams)
+{
+  const Phrase& currPhrase = edge.GetWords();
+  //Extract the n-grams local to this edge
+  for (size_t start = 0; start < currPhrase.GetSize(); ++start) {
+    NgramPath edgeNgram;
+    edgeNgram.ngram = 0;
+    edgeNgram.order = 0;
+    edgeNgram.length = 1;
+    edgeNgram.path[0] = &edge;
+    edgeNgram.count = 1;
+    for (size_t end = start; end < start + bleu_order && end < currPhrase.GetSize(); ++end) {
+      const Word& word = currPhrase.GetWord(end);
+      edgeNgram.ngram = NgramHashExtend(edgeNgram.ngram, word);
+      edgeNgram.words[edgeNgram.order++] = &word;
+      Store(edgeNgram);
+    }
+  }
+
+  //add the ngrams straddling prev and curr edge
+  for (size_t e = 0; e < tailEdges.size(); ++e) {
+    const Phrase& edgeWords = tailEdges[e].GetWords();
+    const vector<NgramPath>& edgeIncomingNgrams = tailNgrams[e].GetNgrams();
+    for (vector<NgramPath>::const_iterator edgeInNgram = edgeIncomingNgrams.begin(); edgeInNgram != edgeIncomingNgrams.end(); ++edgeInNgram) {
+      size_t edgeInNgramSize = edgeInNgram->order;
+      if (edgeInNgramSize >= bleu_order) {
+        continue;
+      }
+
+      //have we got the suffix of previous edge?
+      size_t back = min(edgeInNgramSize, edgeWords.GetSize());
+      bool isSuffix = true;
+      for (size_t i = 0; i < back && isSuffix; ++i) {
+        isSuffix = *edgeInNgram->words[edgeInNgramSize - back + i] == edgeWords.GetWord(edgeWords.GetSize() - back + i);
+      }
+      if (!isSuffix) {
+        continue;
+      }
+
+      NgramPath newNgram = *edgeInNgram;
+      newNgram.path[newNgram.length++] = &edge;
+      for (size_t i = 0; i < currPhrase.GetSize() && i + edgeInNgramSize < bleu_order ; ++i) {
+        const Word& word = currPhrase.GetWord(i);
+        newNgram.ngram = NgramHashExtend(newNgram.ngram, word);
+        newNgram.words[newNgram.order++] = &word;
+        Store(newNgram);
+      }
+    }
+  }
+
+  boost::unordered_map<NgramPath, size_t, NgramPathHash, NgramPathEqual>().swap(m_index);
+  m_ids.reserve(m_ngrams.size());
+  for (vector<NgramPath>::const_iterator it = m_ngrams.begin(); it != m_ngrams.end(); ++it) {
+    m_ids.push_back(make_pair(it->order, it->ngram));
+  }
+  sort(m_ids.begin(), m_ids.end());
+  m_ids.erase(unique(m_ids.begin(), m_ids.end()), m_ids.end());
 }
 
-NgramScores::NodeScoreIterator NgramScores::nodeBegin(const Hypothesis* node)
+struct AscendingCoverage {
+  const Lattice& lattice;
+  explicit AscendingCoverage(const Lattice& l) : lattice(l) {}
+  bool operator()(size_t a, size_t b) const {
+    return lattice[a]->GetWordsBitmap().GetNumWordsCovered() < lattice[b]->GetWordsBitmap().GetNumWordsCovered();
+  }
+};
+
+typedef boost::unordered_map<const Hypothesis*, size_t> HypIndex;
+
+//Whether hyp is in the lattice and made the cut
+bool IsSurviving(const HypIndex& hypIndex, const vector<char>& surviving, const Hypothesis* hyp)
 {
-  return m_scores[node].begin();
+  HypIndex::const_iterator it = hypIndex.find(hyp);
+  return it != hypIndex.end() && surviving[it->second];
+}
+
 }
 
+NgramScores::NgramScores(size_t numNodes) :
+  m_scores(numNodes, NgramScoreTables(bleu_order))
+{
+}
 
-NgramScores::NodeScoreIterator NgramScores::nodeEnd(const Hypothesis* node)
+void NgramScores::addScore(size_t node, size_t order, NgramId ngram, float score)
 {
-  return m_scores[node].end();
+  boost::unordered_map<NgramId, float>& ngramScores = m_scores[node][order-1];
+  pair<boost::unordered_map<NgramId, float>::iterator, bool> inserted = ngramScores.insert(make_pair(ngram, score));
+  if (!inserted.second) {
+    inserted.first->second = log_sum(score, inserted.first->second);
+  }
 }
 
 LatticeMBRSolution::LatticeMBRSolution(const TrellisPath& path, bool isMap) :
@@ -97,25 +231,26 @@ LatticeMBRSolution::LatticeMBRSolution(const TrellisPath& path, bool isMap) :
 }
 
 
-void LatticeMBRSolution::CalcScore(map<Phrase, float>& finalNgramScores, const vector<float>& thetas, float mapWeight)
+void LatticeMBRSolution::CalcScore(const NgramScoreTables& finalNgramScores, const vector<float>& thetas, float mapWeight)
 {
   m_ngramScores.assign(thetas.size()-1, -10000);
 
-  map < Phrase, int > counts;
+  vector<boost::unordered_map<NgramId, int> > counts;
   extract_ngrams(m_words,counts);
 
   //Now score this translation
   m_score = thetas[0] * m_words.size();
 
   //Calculate the ngramScores, working in log space at first
-  for (map < Phrase, int >::iterator ngrams = counts.begin(); ngrams != counts.end(); ++ngrams) {
-    float ngramPosterior = UNKNGRAMLOGPROB;
-    map<Phrase,float>::const_iterator ngramPosteriorIt = finalNgramScores.find(ngrams->first);
-    if (ngramPosteriorIt != finalNgramScores.end()) {
-      ngramPosterior = ngramPosteriorIt->second;
+  for (size_t order = 0; order < counts.size(); ++order) {
+    for (boost::unordered_map<NgramId, int>::const_iterator ngrams = counts[order].begin(); ngrams != counts[order].end(); ++ngrams) {
+      float ngramPosterior = UNKNGRAMLOGPROB;
+      boost::unordered_map<NgramId, float>::const_iterator ngramPosteriorIt = finalNgramScores[order].find(ngrams->first);
+      if (ngramPosteriorIt != finalNgramScores[order].end()) {
+        ngramPosterior = ngramPosteriorIt->second;
+      }
+      m_ngramScores[order] = log_sum(log((float)ngrams->second) + ngramPosterior,m_ngramScores[order]);
     }
-    size_t ngramSize = ngrams->first.GetSize();
-    m_ngramScores[ngramSize-1] = log_sum(log((float)ngrams->second) + ngramPosterior,m_ngramScores[ngramSize-1]);
   }
 
   //convert from log to probability and create weighted sum
@@ -130,8 +265,9 @@ void LatticeMBRSolution::CalcScore(map<Phrase, float>& finalNgramScores, const v
 }
 
 
-void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const Hypothesis* > > & outgoingHyps, map<const Hypothesis*, vector<Edge> >& incomingEdges,
-                    const vector< float> & estimatedScores, const Hypothesis* bestHypo, size_t edgeDensity, float scale)
+void pruneLatticeFB(Lattice & connectedHyp, const map < const Hypothesis*, set <const Hypothesis* > > & outgoingHyps,
+                    const vector< float> & estimatedScores, const Hypothesis* bestHypo, size_t edgeDensity, float scale,
+                    vector<vector<Edge> >& incomingEdges)
 {
 
   //Need hyp 0 in connectedHyp - Find empty hypothesis
@@ -142,33 +278,65 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
   }
   connectedHyp.push_back(emptyHyp); //Add it to list of hyps
 
+  //Number the hyps by their position in connectedHyp
+  const size_t numHyps = connectedHyp.size();
+  HypIndex hypIndex;
+  for (size_t i = 0; i < numHyps; ++i) {
+    hypIndex.insert(make_pair(connectedHyp[i], i));
+  }
+
   //Need hyp 0's outgoing Hyps
+  set<const Hypothesis*> emptyHypSuccessors;
+  map < const Hypothesis*, set < const Hypothesis* > >::const_iterator emptyOutgoingIt = outgoingHyps.find(emptyHyp);
+  if (emptyOutgoingIt != outgoingHyps.end()) {
+    emptyHypSuccessors = emptyOutgoingIt->second;
+  }
   for (size_t i = 0; i < connectedHyp.size(); ++i) {
     if (connectedHyp[i]->GetId() > 0 && connectedHyp[i]->GetPrevHypo()->GetId() == 0)
-      outgoingHyps[emptyHyp].insert(connectedHyp[i]);
+      emptyHypSuccessors.insert(connectedHyp[i]);
+  }
+
+  //successors of each hyp, by number
+  vector<vector<size_t> > successors(numHyps);
+  for (map < const Hypothesis*, set < const Hypothesis* > >::const_iterator outgoingIt = outgoingHyps.begin(); outgoingIt != outgoingHyps.end(); ++outgoingIt) {
+    HypIndex::const_iterator hyp = hypIndex.find(outgoingIt->first);
+    if (hyp == hypIndex.end() || outgoingIt->first == emptyHyp) {
+      continue;
+    }
+    for (set<const Hypothesis*>::const_iterator outHypIts = outgoingIt->second.begin(); outHypIts != outgoingIt->second.end(); ++outHypIts) {
+      HypIndex::const_iterator succ = hypIndex.find(*outHypIts);
+      if (succ != hypIndex.end()) {
+        successors[hyp->second].push_back(succ->second);
+      }
+    }
+  }
+  for (set<const Hypothesis*>::const_iterator outHypIts = emptyHypSuccessors.begin(); outHypIts != emptyHypSuccessors.end(); ++outHypIts) {
+    successors[numHyps-1].push_back(hypIndex.find(*outHypIts)->second);
   }
 
-  //sort hyps based on estimated scores - do so by copying to multimap
-  multimap<float, const Hypothesis*> sortHypsByVal;
+  //sort hyps based on estimated scores, ties in the order of connectedHyp
+  vector<pair<float, size_t> > sortHypsByVal;
+  sortHypsByVal.reserve(numHyps);
   for (size_t i =0; i < estimatedScores.size(); ++i) {
-    sortHypsByVal.insert(make_pair(estimatedScores[i], connectedHyp[i]));
+    sortHypsByVal.push_back(make_pair(estimatedScores[i], i));
   }
+  sort(sortHypsByVal.begin(), sortHypsByVal.end());
 
-  multimap<float, const Hypothesis*>::const_iterator it = --sortHypsByVal.end();
-  float bestScore = it->first;
-  //store best score as score of hyp 0
-  sortHypsByVal.insert(make_pair(bestScore, emptyHyp));
+  float bestScore = sortHypsByVal.back().first;
+  //store best score as score of hyp 0, so that it is visited first
+  sortHypsByVal.push_back(make_pair(bestScore, numHyps-1));
 
 
   IFVERBOSE(3) {
-    for (multimap<float, const Hypothesis*>::const_iterator it = --sortHypsByVal.end(); it != --sortHypsByVal.begin(); --it) {
-      const Hypothesis* currHyp =  it->second;
+    for (vector<pair<float, size_t> >::const_reverse_iterator it = sortHypsByVal.rbegin(); it != sortHypsByVal.rend(); ++it) {
+      const Hypothesis* currHyp =  connectedHyp[it->second];
       cerr << "Hyp " << currHyp->GetId() << ", estimated score: " << it->first << endl;
     }
   }
 
 
-  set <const Hypothesis*> survivingHyps; //store hyps that make the cut in this
+  vector<char> surviving(numHyps, 0); //hyps that make the cut
+  vector<vector<Edge> > hypEdges(numHyps); //incoming edges, between hyps numbered as in connectedHyp
 
   VERBOSE(2, "BEST HYPO TARGET LENGTH : " << bestHypo->GetSize() << endl)
   size_t numEdgesTotal = edgeDensity * bestHypo->GetSize(); //as per Shankar, aim for (density * target length of MAP solution) arcs
@@ -177,10 +345,11 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
 
   float prevScore = -999999;
 
-  //now iterate over multimap
-  for (multimap<float, const Hypothesis*>::const_iterator it = --sortHypsByVal.end(); it != --sortHypsByVal.begin(); --it) {
+  //now iterate over the hyps, best first
+  for (vector<pair<float, size_t> >::const_reverse_iterator it = sortHypsByVal.rbegin(); it != sortHypsByVal.rend(); ++it) {
     float currEstimatedScore = it->first;
-    const Hypothesis* currHyp =  it->second;
+    size_t curr = it->second;
+    const Hypothesis* currHyp =  connectedHyp[curr];
 
     if (numEdgesCreated >= numEdgesTotal && prevScore > currEstimatedScore) //if this hyp has equal estimated score to previous, include its edges too
       break;
@@ -189,13 +358,13 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
     VERBOSE(3, "Num edges created : "<< numEdgesCreated << ", numEdges wanted " << numEdgesTotal << endl)
     VERBOSE(3, "Considering hyp " << currHyp->GetId() << ", estimated score: " << it->first << endl)
 
-    survivingHyps.insert(currHyp); //CurrHyp made the cut
+    surviving[curr] = 1; //CurrHyp made the cut
 
     // is its best predecessor already included ?
-    if (survivingHyps.find(currHyp->GetPrevHypo()) != survivingHyps.end()) { //yes, then add an edge
-      vector <Edge>& edges = incomingEdges[currHyp];
-      Edge winningEdge(currHyp->GetPrevHypo(),currHyp,scale*(currHyp->GetScore() - currHyp->GetPrevHypo()->GetScore()),currHyp->GetCurrTargetPhrase());
-      edges.push_back(winningEdge);
+    const Hypothesis* prevHypo = currHyp->GetPrevHypo();
+    if (IsSurviving(hypIndex, surviving, prevHypo)) { //yes, then add an edge
+      Edge winningEdge(hypIndex.find(prevHypo)->second,curr,scale*(currHyp->GetScore() - prevHypo->GetScore()),currHyp->GetCurrTargetPhrase());
+      hypEdges[curr].push_back(winningEdge);
       ++numEdgesCreated;
     }
 
@@ -206,67 +375,80 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
       for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
         const Hypothesis *loserHypo = *iterArcList;
         const Hypothesis* loserPrevHypo = loserHypo->GetPrevHypo();
-        if (survivingHyps.find(loserPrevHypo) != survivingHyps.end()) { //found it, add edge
+        if (IsSurviving(hypIndex, surviving, loserPrevHypo)) { //found it, add edge
           double arcScore = loserHypo->GetScore() - loserPrevHypo->GetScore();
-          Edge losingEdge(loserPrevHypo, currHyp, arcScore*scale, loserHypo->GetCurrTargetPhrase());
-          vector <Edge>& edges = incomingEdges[currHyp];
-          edges.push_back(losingEdge);
+          Edge losingEdge(hypIndex.find(loserPrevHypo)->second, curr, arcScore*scale, loserHypo->GetCurrTargetPhrase());
+          hypEdges[curr].push_back(losingEdge);
           ++numEdgesCreated;
         }
       }
     }
 
     //Now if a successor node has already been visited, add an edge connecting the two
-    map < const Hypothesis*, set < const Hypothesis* > >::const_iterator outgoingIt = outgoingHyps.find(currHyp);
-
-    if (outgoingIt != outgoingHyps.end()) {//currHyp does have successors
-      const set<const Hypothesis*> & outHyps = outgoingIt->second; //the successors
-      for (set<const Hypothesis*>::const_iterator outHypIts = outHyps.begin(); outHypIts != outHyps.end(); ++outHypIts) {
-        const Hypothesis* succHyp = *outHypIts;
-
-        if (survivingHyps.find(succHyp) == survivingHyps.end()) //Have we encountered the successor yet?
-          continue; //No, move on to next
-
-        //Curr Hyp can be : a) the best predecessor  of succ b) or an arc attached to succ
-        if (succHyp->GetPrevHypo() == currHyp) { //best predecessor
-          vector <Edge>& succEdges = incomingEdges[succHyp];
-          Edge succWinningEdge(currHyp, succHyp, scale*(succHyp->GetScore() - currHyp->GetScore()), succHyp->GetCurrTargetPhrase());
-          succEdges.push_back(succWinningEdge);
-          survivingHyps.insert(succHyp);
-          ++numEdgesCreated;
-        }
+    const vector<size_t>& outHyps = successors[curr];
+    for (vector<size_t>::const_iterator outHypIts = outHyps.begin(); outHypIts != outHyps.end(); ++outHypIts) {
+      size_t succ = *outHypIts;
+      const Hypothesis* succHyp = connectedHyp[succ];
+
+      if (!surviving[succ]) //Have we encountered the successor yet?
+        continue; //No, move on to next
+
+      //Curr Hyp can be : a) the best predecessor  of succ b) or an arc attached to succ
+      if (succHyp->GetPrevHypo() == currHyp) { //best predecessor
+        Edge succWinningEdge(curr, succ, scale*(succHyp->GetScore() - currHyp->GetScore()), succHyp->GetCurrTargetPhrase());
+        hypEdges[succ].push_back(succWinningEdge);
+        ++numEdgesCreated;
+      }
 
-        //now, let's find an arc
-        const ArcList *arcList = succHyp->GetArcList();
-        if (arcList != NULL) {
-          ArcList::const_iterator iterArcList;
-          //QUESTION: What happens if there's more than one loserPrevHypo?
-          for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
-            const Hypothesis *loserHypo = *iterArcList;
-            const Hypothesis* loserPrevHypo = loserHypo->GetPrevHypo();
-            if (loserPrevHypo == currHyp) { //found it
-              vector <Edge>& succEdges = incomingEdges[succHyp];
-              double arcScore = loserHypo->GetScore() - currHyp->GetScore();
-              Edge losingEdge(currHyp, succHyp,scale* arcScore, loserHypo->GetCurrTargetPhrase());
-              succEdges.push_back(losingEdge);
-              ++numEdgesCreated;
-            }
+      //now, let's find an arc
+      const ArcList *arcList = succHyp->GetArcList();
+      if (arcList != NULL) {
+        ArcList::const_iterator iterArcList;
+        //QUESTION: What happens if there's more than one loserPrevHypo?
+        for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
+          const Hypothesis *loserHypo = *iterArcList;
+          const Hypothesis* loserPrevHypo = loserHypo->GetPrevHypo();
+          if (loserPrevHypo == currHyp) { //found it
+            double arcScore = loserHypo->GetScore() - currHyp->GetScore();
+            Edge losingEdge(curr, succ,scale* arcScore, loserHypo->GetCurrTargetPhrase());
+            hypEdges[succ].push_back(losingEdge);
+            ++numEdgesCreated;
           }
         }
       }
     }
   }
 
-  connectedHyp.clear();
-  for (set <const Hypothesis*>::iterator it =  survivingHyps.begin(); it != survivingHyps.end(); ++it) {
-    connectedHyp.push_back(*it);
+  //renumber the surviving hyps by increasing source word coverage
+  vector<size_t> survivingHyps;
+  for (size_t i = 0; i < numHyps; ++i) {
+    if (surviving[i]) {
+      survivingHyps.push_back(i);
+    }
+  }
+  stable_sort(survivingHyps.begin(), survivingHyps.end(), AscendingCoverage(connectedHyp));
+
+  vector<size_t> newIndex(numHyps);
+  for (size_t i = 0; i < survivingHyps.size(); ++i) {
+    newIndex[survivingHyps[i]] = i;
+  }
+  Lattice survivingLattice(survivingHyps.size());
+  incomingEdges.assign(survivingHyps.size(), vector<Edge>());
+  for (size_t i = 0; i < survivingHyps.size(); ++i) {
+    survivingLattice[i] = connectedHyp[survivingHyps[i]];
+    const vector<Edge>& edges = hypEdges[survivingHyps[i]];
+    incomingEdges[i].reserve(edges.size());
+    for (vector<Edge>::const_iterator edge = edges.begin(); edge != edges.end(); ++edge) {
+      incomingEdges[i].push_back(Edge(newIndex[edge->GetTailNode()], i, edge->GetScore(), edge->GetWords()));
+    }
   }
+  connectedHyp.swap(survivingLattice);
 
   VERBOSE(2, "Done! Num edges created : "<< numEdgesCreated << ", numEdges wanted " << numEdgesTotal << endl)
 
   IFVERBOSE(3) {
     cerr << "Surviving hyps: " ;
-    for (set <const Hypothesis*>::iterator it =  survivingHyps.begin(); it != survivingHyps.end(); ++it) {
+    for (Lattice::const_iterator it = connectedHyp.begin(); it != connectedHyp.end(); ++it) {
       cerr << (*it)->GetId() << " ";
     }
     cerr << endl;
@@ -275,87 +457,74 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
 
 }
 
-void calcNgramExpectations(Lattice & connectedHyp, map<const Hypothesis*, vector<Edge> >& incomingEdges,
-                           map<Phrase, float>& finalNgramScores, bool posteriors)
+void calcNgramExpectations(const Lattice & connectedHyp, const vector<vector<Edge> >& incomingEdges,
+                           NgramScoreTables& finalNgramScores, bool posteriors)
 {
+  const size_t numHyps = connectedHyp.size();
 
-  sort(connectedHyp.begin(),connectedHyp.end(),ascendingCoverageCmp); //sort by increasing source word cov
-
-  /*cerr << "Lattice:" << endl;
-  for (Lattice::const_iterator i = connectedHyp.begin(); i != connectedHyp.end(); ++i) {
-      const Hypothesis* h = *i;
-      cerr << *h << endl;
-      const vector<Edge>& edges = incomingEdges[h];
-      for (size_t e = 0; e < edges.size(); ++e) {
-          cerr << edges[e];
-      }
-  }*/
-
-  map<const Hypothesis*, float> forwardScore;
-  forwardScore[connectedHyp[0]] = 0.0f; //forward score of hyp 0 is 1 (or 0 in logprob space)
-  set< const Hypothesis *> finalHyps; //store completed hyps
+  vector<float> forwardScore(numHyps, 0.0f); //forward score of hyp 0 is 1 (or 0 in logprob space)
+  vector<char> hasForwardScore(numHyps, 0);
+  hasForwardScore[0] = 1;
+  vector<size_t> finalHyps; //store completed hyps
 
-  NgramScores ngramScores;//ngram scores for each hyp
+  NgramScores ngramScores(numHyps);//ngram scores for each hyp
+  vector<vector<EdgeNgrams> > edgeNgrams(numHyps); //parallel to incomingEdges
 
-  for (size_t i = 1; i < connectedHyp.size(); ++i) {
+  for (size_t i = 1; i < numHyps; ++i) {
     const Hypothesis* currHyp = connectedHyp[i];
     if (currHyp->GetWordsBitmap().IsComplete()) {
-      finalHyps.insert(currHyp);
+      finalHyps.push_back(i);
     }
 
     VERBOSE(3, "Processing hyp: " << currHyp->GetId() << ", num words cov= " << currHyp->GetWordsBitmap().GetNumWordsCovered() <<  endl)
 
-    vector <Edge> & edges = incomingEdges[currHyp];
+    const vector <Edge> & edges = incomingEdges[i];
     for (size_t e = 0; e < edges.size(); ++e) {
       const Edge& edge = edges[e];
-      if (forwardScore.find(currHyp) == forwardScore.end()) {
-        forwardScore[currHyp] = forwardScore[edge.GetTailNode()] + edge.GetScore();
-        VERBOSE(3, "Fwd score["<<currHyp->GetId()<<"] = fwdScore["<<edge.GetTailNode()->GetId() << "] + edge Score: " << edge.GetScore() << endl)
+      if (!hasForwardScore[i]) {
+        forwardScore[i] = forwardScore[edge.GetTailNode()] + edge.GetScore();
+        hasForwardScore[i] = 1;
+        VERBOSE(3, "Fwd score["<<currHyp->GetId()<<"] = fwdScore["<<connectedHyp[edge.GetTailNode()]->GetId() << "] + edge Score: " << edge.GetScore() << endl)
       } else {
-        forwardScore[currHyp] = log_sum(forwardScore[currHyp], forwardScore[edge.GetTailNode()] + edge.GetScore());
-        VERBOSE(3, "Fwd score["<<currHyp->GetId()<<"] += fwdScore["<<edge.GetTailNode()->GetId() << "] + edge Score: " << edge.GetScore() << endl)
+        forwardScore[i] = log_sum(forwardScore[i], forwardScore[edge.GetTailNode()] + edge.GetScore());
+        VERBOSE(3, "Fwd score["<<currHyp->GetId()<<"] += fwdScore["<<connectedHyp[edge.GetTailNode()]->GetId() << "] + edge Score: " << edge.GetScore() << endl)
       }
     }
 
     //Process ngrams now
+    edgeNgrams[i].resize(edges.size());
     for (size_t j =0 ; j < edges.size(); ++j) {
-      Edge& edge = edges[j];
-      const NgramHistory & incomingPhrases = edge.GetNgrams(incomingEdges);
+      const Edge& edge = edges[j];
+      size_t tail = edge.GetTailNode();
+      EdgeNgrams& incomingPhrases = edgeNgrams[i][j];
+      incomingPhrases.Collect(edge, incomingEdges[tail], edgeNgrams[tail]);
 
       //let's first score ngrams introduced by this edge
-      for (NgramHistory::const_iterator it = incomingPhrases.begin(); it != incomingPhrases.end(); ++it) {
-        const Phrase& ngram = it->first;
-        const PathCounts& pathCounts = it->second;
-        VERBOSE(4, "Calculating score for: " << it->first << endl)
-
-        for (PathCounts::const_iterator pathCountIt = pathCounts.begin(); pathCountIt != pathCounts.end(); ++pathCountIt) {
-          //Score of an n-gram is forward score of head node of leftmost edge + all edge scores
-          const Path&  path = pathCountIt->first;
-          //cerr << "path count for " << ngram << " is " << pathCountIt->second << endl;
-          float score = forwardScore[path[0]->GetTailNode()];
-          for (size_t i = 0; i < path.size(); ++i) {
-            score += path[i]->GetScore();
-          }
-          //if we're doing expectations, then the number of times the ngram
-          //appears on the path is relevant.
-          size_t count = posteriors ? 1 : pathCountIt->second;
-          for (size_t k = 0; k < count; ++k) {
-            ngramScores.addScore(currHyp,ngram,score);
-          }
+      const vector<NgramPath>& ngrams = incomingPhrases.GetNgrams();
+      for (vector<NgramPath>::const_iterator it = ngrams.begin(); it != ngrams.end(); ++it) {
+        //Score of an n-gram is forward score of head node of leftmost edge + all edge scores
+        float score = forwardScore[it->path[0]->GetTailNode()];
+        for (size_t k = 0; k < it->length; ++k) {
+          score += it->path[k]->GetScore();
+        }
+        //if we're doing expectations, then the number of times the ngram
+        //appears on the path is relevant.
+        size_t count = posteriors ? 1 : it->count;
+        for (size_t k = 0; k < count; ++k) {
+          ngramScores.addScore(i,it->order,it->ngram,score);
         }
       }
 
       //Now score ngrams that are just being propagated from the history
-      for (NgramScores::NodeScoreIterator it = ngramScores.nodeBegin(edge.GetTailNode());
-           it != ngramScores.nodeEnd(edge.GetTailNode()); ++it) {
-        const Phrase & currNgram = *(it->first);
-        float currNgramScore = it->second;
-        VERBOSE(4, "Calculating score for: " << currNgram << endl)
-
-        // For posteriors, don't double count ngrams
-        if (!posteriors || incomingPhrases.find(currNgram) == incomingPhrases.end()) {
-          float score = edge.GetScore() + currNgramScore;
-          ngramScores.addScore(currHyp,currNgram,score);
+      const NgramScoreTables& tailScores = ngramScores.nodeScores(tail);
+      for (size_t order = 1; order <= tailScores.size(); ++order) {
+        const boost::unordered_map<NgramId, float>& orderScores = tailScores[order-1];
+        for (boost::unordered_map<NgramId, float>::const_iterator it = orderScores.begin(); it != orderScores.end(); ++it) {
+          // For posteriors, don't double count ngrams
+          if (!posteriors || !incomingPhrases.Contains(order, it->first)) {
+            float score = edge.GetScore() + it->second;
+            ngramScores.addScore(i,order,it->first,score);
+          }
         }
       }
 
@@ -365,160 +534,61 @@ void calcNgramExpectations(Lattice & connectedHyp, map<const Hypothesis*, vector
   float Z = 9999999; //the total score of the lattice
 
   //Done - Print out ngram posteriors for final hyps
-  for (set< const Hypothesis *>::iterator finalHyp = finalHyps.begin(); finalHyp != finalHyps.end(); ++finalHyp) {
-    const Hypothesis* hyp = *finalHyp;
-
-    for (NgramScores::NodeScoreIterator it = ngramScores.nodeBegin(hyp); it != ngramScores.nodeEnd(hyp); ++it) {
-      const Phrase& ngram = *(it->first);
-      if (finalNgramScores.find(ngram) == finalNgramScores.end()) {
-        finalNgramScores[ngram] = it->second;
-      } else {
-        finalNgramScores[ngram] = log_sum(it->second,  finalNgramScores[ngram]);
+  finalNgramScores.assign(bleu_order, boost::unordered_map<NgramId, float>());
+  for (vector<size_t>::const_iterator finalHyp = finalHyps.begin(); finalHyp != finalHyps.end(); ++finalHyp) {
+    const NgramScoreTables& hypScores = ngramScores.nodeScores(*finalHyp);
+    for (size_t order = 0; order < hypScores.size(); ++order) {
+      for (boost::unordered_map<NgramId, float>::const_iterator it = hypScores[order].begin(); it != hypScores[order].end(); ++it) {
+        pair<boost::unordered_map<NgramId, float>::iterator, bool> inserted = finalNgramScores[order].insert(*it);
+        if (!inserted.second) {
+          inserted.first->second = log_sum(it->second, inserted.first->second);
+        }
       }
     }
 
     if (Z == 9999999) {
-      Z = forwardScore[hyp];
+      Z = forwardScore[*finalHyp];
     } else {
-      Z = log_sum(Z, forwardScore[hyp]);
+      Z = log_sum(Z, forwardScore[*finalHyp]);
     }
   }
 
   //Z *= scale;  //scale the score
 
-  for (map<Phrase, float>::iterator finalScoresIt = finalNgramScores.begin();  finalScoresIt != finalNgramScores.end(); ++finalScoresIt) {
-    finalScoresIt->second =  finalScoresIt->second - Z;
-    IFVERBOSE(2) {
-      VERBOSE(2,finalScoresIt->first << " [" << finalScoresIt->second << "]" << endl);
+  for (size_t order = 0; order < finalNgramScores.size(); ++order) {
+    for (boost::unordered_map<NgramId, float>::iterator finalScoresIt = finalNgramScores[order].begin();  finalScoresIt != finalNgramScores[order].end(); ++finalScoresIt) {
+      finalScoresIt->second =  finalScoresIt->second - Z;
+      VERBOSE(2,order+1 << "-gram " << finalScoresIt->first << " [" << finalScoresIt->second << "]" << endl);
     }
   }
 
 }
 
-const NgramHistory& Edge::GetNgrams(map<const Hypothesis*, vector<Edge> > & incomingEdges)
-{
-
-  if (m_ngrams.size() > 0)
-    return m_ngrams;
-
-  const Phrase& currPhrase = GetWords();
-  //Extract the n-grams local to this edge
-  for (size_t start = 0; start < currPhrase.GetSize(); ++start) {
-    for (size_t end = start; end < start + bleu_order; ++end) {
-      if (end < currPhrase.GetSize()) {
-        Phrase edgeNgram(end-start+1);
-        for (size_t index = start; index <= end; ++index) {
-          edgeNgram.AddWord(currPhrase.GetWord(index));
-        }
-        //cout << "Inserting Phrase : " << edgeNgram << endl;
-        vector<const Edge*> edgeHistory;
-        edgeHistory.push_back(this);
-        storeNgramHistory(edgeNgram, edgeHistory);
-      } else {
-        break;
-      }
-    }
-  }
-
-  map<const Hypothesis*, vector<Edge> >::iterator it = incomingEdges.find(m_tailNode);
-  if (it != incomingEdges.end()) { //node has incoming edges
-    vector<Edge> & inEdges = it->second;
-
-    for (vector<Edge>::iterator edge = inEdges.begin(); edge != inEdges.end(); ++edge) {//add the ngrams straddling prev and curr edge
-      const NgramHistory & edgeIncomingNgrams = edge->GetNgrams(incomingEdges);
-      for (NgramHistory::const_iterator edgeInNgramHist = edgeIncomingNgrams.begin(); edgeInNgramHist != edgeIncomingNgrams.end(); ++edgeInNgramHist) {
-        const Phrase& edgeIncomingNgram = edgeInNgramHist->first;
-        const PathCounts &  edgeIncomingNgramPaths = edgeInNgramHist->second;
-        size_t back = min(edgeIncomingNgram.GetSize(), edge->GetWordsSize());
-        const Phrase&  edgeWords = edge->GetWords();
-        IFVERBOSE(3) {
-          cerr << "Edge: "<< *edge <<endl;
-          cerr << "edgeWords: " << edgeWords << endl;
-          cerr << "edgeInNgram: " << edgeIncomingNgram << endl;
-        }
-
-        Phrase edgeSuffix(ARRAY_SIZE_INCR);
-        Phrase ngramSuffix(ARRAY_SIZE_INCR);
-        GetPhraseSuffix(edgeWords,back,edgeSuffix);
-        GetPhraseSuffix(edgeIncomingNgram,back,ngramSuffix);
-
-        if (ngramSuffix == edgeSuffix) { //we've got the suffix of previous edge
-          size_t  edgeInNgramSize =  edgeIncomingNgram.GetSize();
-
-          for (size_t i = 0; i < GetWordsSize() && i + edgeInNgramSize < bleu_order ; ++i) {
-            Phrase newNgram(edgeIncomingNgram);
-            for (size_t j = 0; j <= i ; ++j) {
-              newNgram.AddWord(GetWords().GetWord(j));
-            }
-            VERBOSE(3, "Inserting New Phrase : " << newNgram << endl)
-
-            for (PathCounts::const_iterator pathIt = edgeIncomingNgramPaths.begin(); pathIt !=  edgeIncomingNgramPaths.end(); ++pathIt) {
-              Path newNgramPath = pathIt->first;
-              newNgramPath.push_back(this);
-              storeNgramHistory(newNgram, newNgramPath, pathIt->second);
-            }
-          }
-        }
-      }
-    }
-  }
-  return m_ngrams;
-}
-
-//Add the last lastN words of origPhrase to targetPhrase
-void Edge::GetPhraseSuffix(const Phrase&  origPhrase, size_t lastN, Phrase& targetPhrase) const
-{
-  size_t origSize = origPhrase.GetSize();
-  size_t startIndex = origSize - lastN;
-  for (size_t index = startIndex; index < origPhrase.GetSize(); ++index) {
-    targetPhrase.AddWord(origPhrase.GetWord(index));
-  }
-}
-
-bool Edge::operator< (const Edge& compare ) const
-{
-  if (m_headNode->GetId() < compare.m_headNode->GetId())
-    return true;
-  if (compare.m_headNode->GetId() < m_headNode->GetId())
-    return false;
-  if (m_tailNode->GetId() < compare.m_tailNode->GetId())
-    return true;
-  if (compare.m_tailNode->GetId() < m_tailNode->GetId())
-    return false;
-  return GetScore() <  compare.GetScore();
-}
-
 ostream& operator<< (ostream& out, const Edge& edge)
 {
-  out << "Head: " << edge.m_headNode->GetId()
-      << ", Tail: " << edge.m_tailNode->GetId()
+  out << "Head: " << edge.m_headNode
+      << ", Tail: " << edge.m_tailNode
       << ", Score: " << edge.m_score
-      << ", Phrase: " << edge.m_targetPhrase << endl;
+      << ", Phrase: " << *edge.m_words << endl;
   return out;
 }
 
-bool ascendingCoverageCmp(const Hypothesis* a, const Hypothesis* b)
-{
-  return (a->GetWordsBitmap().GetNumWordsCovered()
-          <
-          b->GetWordsBitmap().GetNumWordsCovered());
-}
-
 void getLatticeMBRNBest(const Manager& manager, const TrellisPathList& nBestList,
                         vector<LatticeMBRSolution>& solutions, size_t n)
 {
   std::map < int, bool > connected;
   std::vector< const Hypothesis *> connectedList;
-  map<Phrase, float> ngramPosteriors;
+  NgramScoreTables ngramPosteriors;
   std::map < const Hypothesis*, set <const Hypothesis*> > outgoingHyps;
-  map<const Hypothesis*, vector<Edge> > incomingEdges;
+  vector<vector<Edge> > incomingEdges;
   vector< float> estimatedScores;
   manager.GetForwardBackwardSearchGraph(&connected, &connectedList,
                                         &outgoingHyps, &estimatedScores);
   LMBR_Options const& lmbr = manager.options()->lmbr;
   MBR_Options  const& mbr  = manager.options()->mbr;
-  pruneLatticeFB(connectedList, outgoingHyps, incomingEdges, estimatedScores,
-                 manager.GetBestHypothesis(), lmbr.pruning_factor, mbr.scale);
+  pruneLatticeFB(connectedList, outgoingHyps, estimatedScores,
+                 manager.GetBestHypothesis(), lmbr.pruning_factor, mbr.scale,
+                 incomingEdges);
   calcNgramExpectations(connectedList, incomingEdges, ngramPosteriors,true);
 
   vector<float> mbrThetas = lmbr.theta;
@@ -572,28 +642,25 @@ const TrellisPath doConsensusDecoding(const Manager& manager, const TrellisPathL
   const StaticData& staticData = StaticData::Instance();
   std::map < int, bool > connected;
   std::vector< const Hypothesis *> connectedList;
-  map<Phrase, float> ngramExpectations;
+  NgramScoreTables ngramExpectations;
   std::map < const Hypothesis*, set <const Hypothesis*> > outgoingHyps;
-  map<const Hypothesis*, vector<Edge> > incomingEdges;
+  vector<vector<Edge> > incomingEdges;
   vector< float> estimatedScores;
   manager.GetForwardBackwardSearchGraph(&connected, &connectedList, &outgoingHyps, &estimatedScores);
   LMBR_Options const& lmbr = manager.options()->lmbr;
   MBR_Options  const&  mbr = manager.options()->mbr;
-  pruneLatticeFB(connectedList, outgoingHyps, incomingEdges, estimatedScores,
-                 manager.GetBestHypothesis(), lmbr.pruning_factor, mbr.scale);
+  pruneLatticeFB(connectedList, outgoingHyps, estimatedScores,
+                 manager.GetBestHypothesis(), lmbr.pruning_factor, mbr.scale,
+                 incomingEdges);
   calcNgramExpectations(connectedList, incomingEdges, ngramExpectations,false);
 
   //expected length is sum of expected unigram counts
   //cerr << "Thread " << pthread_self() <<  " Ngram expectations size: " << ngramExpectations.size() << endl;
   float ref_length = 0.0f;
-  for (map<Phrase,float>::const_iterator ref_iter = ngramExpectations.begin();
-       ref_iter != ngramExpectations.end(); ++ref_iter) {
-    //cerr << "Ngram: " << ref_iter->first << " score: " <<
-    //    ref_iter->second << endl;
-    if (ref_iter->first.GetSize() == 1) {
-      ref_length += exp(ref_iter->second);
-      //    cerr << "Expected for " << ref_iter->first << " is " << exp(ref_iter->second) << endl;
-    }
+  const boost::unordered_map<NgramId, float>& unigramExpectations = ngramExpectations[0];
+  for (boost::unordered_map<NgramId, float>::const_iterator ref_iter = unigramExpectations.begin();
+       ref_iter != unigramExpectations.end(); ++ref_iter) {
+    ref_length += exp(ref_iter->second);
   }
 
   VERBOSE(2,"REF Length: " << ref_length << endl);
@@ -606,7 +673,7 @@ const TrellisPath doConsensusDecoding(const Manager& manager, const TrellisPathL
   for (iter = nBestList.begin() ; iter != nBestList.end() ; ++iter) {
     const TrellisPath &path = **iter;
     vector<Word> words;
-    map<Phrase,int> ngrams;
+    vector<boost::unordered_map<NgramId, int> > ngrams;
     GetOutputWords(path,words);
     /*for (size_t i = 0; i < words.size(); ++i) {
         cerr << words[i].GetFactor(0)->GetString() << " ";
@@ -624,13 +691,14 @@ const TrellisPath doConsensusDecoding(const Manager& manager, const TrellisPathL
       comps[2*i+1] = max(hyp_length-i,0);
     }
 
-    for (map<Phrase,int>::const_iterator hyp_iter = ngrams.begin();
-         hyp_iter != ngrams.end(); ++hyp_iter) {
-      map<Phrase,float>::const_iterator ref_iter = ngramExpectations.find(hyp_iter->first);
-      if (ref_iter != ngramExpectations.end()) {
-        comps[2*(hyp_iter->first.GetSize()-1)] += min(exp(ref_iter->second), (float)(hyp_iter->second));
+    for (size_t order = 0; order < ngrams.size(); ++order) {
+      for (boost::unordered_map<NgramId, int>::const_iterator hyp_iter = ngrams[order].begin();
+           hyp_iter != ngrams[order].end(); ++hyp_iter) {
+        boost::unordered_map<NgramId, float>::const_iterator ref_iter = ngramExpectations[order].find(hyp_iter->first);
+        if (ref_iter != ngramExpectations[order].end()) {
+          comps[2*order] += min(exp(ref_iter->second), (float)(hyp_iter->second));
+        }
       }
-
     }
     comps[comps.size()-1] = ref_length;
     /*for (size_t i = 0; i < comps.size(); ++i) {
@@ -13,6 +13,8 @@
 #include <map>
 #include <vector>
 #include <set>
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
 #include "moses/Hypothesis.h"
 #include "moses/Manager.h"
 #include "moses/TrellisPathList.h"
@@ -22,31 +24,39 @@
 namespace Moses
 {
 
-class Edge;
-
 typedef std::vector< const Moses::Hypothesis *> Lattice;
-typedef std::vector<const Edge*> Path;
-typedef std::map<Path, size_t> PathCounts;
-typedef std::map<Moses::Phrase, PathCounts > NgramHistory;
 
+/** Hash of an n-gram, equal to Phrase::hash() of its words.  It is built up a
+ * word at a time by NgramHashExtend(), starting from 0. */
+typedef size_t NgramId;
+
+inline NgramId NgramHashExtend(NgramId prefix, const Moses::Word& word)
+{
+  boost::hash_combine(prefix, word);
+  return prefix;
+}
+
+/** Log scores of n-grams, indexed by n-gram order - 1 */
+typedef std::vector<boost::unordered_map<NgramId, float> > NgramScoreTables;
+
+/** An edge of the pruned lattice.  Nodes are indices into the lattice, and the
+ * words belong to the hypothesis the edge was made from. */
 class Edge
 {
-  const Moses::Hypothesis* m_tailNode;
-  const Moses::Hypothesis* m_headNode;
+  size_t m_tailNode;
+  size_t m_headNode;
   float m_score;
-  Moses::TargetPhrase m_targetPhrase;
-  NgramHistory m_ngrams;
+  const Moses::Phrase* m_words;
 
 public:
-  Edge(const Moses::Hypothesis* from, const Moses::Hypothesis* to, float score, const Moses::TargetPhrase& targetPhrase) : m_tailNode(from), m_headNode(to), m_score(score), m_targetPhrase(targetPhrase) {
-    //cout << "Creating new edge from Node " << from->GetId() << ", to Node : " << to->GetId() << ", score: " << score << " phrase: " << targetPhrase << endl;
+  Edge(size_t from, size_t to, float score, const Moses::Phrase& words) : m_tailNode(from), m_headNode(to), m_score(score), m_words(&words) {
   }
 
-  const Moses::Hypothesis* GetHeadNode() const {
+  size_t GetHeadNode() const {
     return m_headNode;
   }
 
-  const Moses::Hypothesis* GetTailNode() const {
+  size_t GetTailNode() const {
     return m_tailNode;
   }
 
@@ -55,46 +65,34 @@ public:
   }
 
   size_t GetWordsSize() const {
-    return m_targetPhrase.GetSize();
+    return m_words->GetSize();
   }
 
   const Moses::Phrase& GetWords() const {
-    return m_targetPhrase;
+    return *m_words;
   }
 
   friend std::ostream& operator<< (std::ostream& out, const Edge& edge);
-
-  const NgramHistory&  GetNgrams(  std::map<const Moses::Hypothesis*, std::vector<Edge> > & incomingEdges) ;
-
-  bool operator < (const Edge & compare) const;
-
-  void GetPhraseSuffix(const Moses::Phrase& origPhrase, size_t lastN, Moses::Phrase& targetPhrase) const;
-
-  void storeNgramHistory(const Moses::Phrase& phrase, Path & path, size_t count = 1) {
-    m_ngrams[phrase][path]+= count;
-  }
-
 };
 
 /**
-* Data structure to hold the ngram scores as we traverse the lattice. Maps (hypo,ngram) to score
+* Data structure to hold the ngram scores as we traverse the lattice. Maps (node,ngram) to score
 */
 class NgramScores
 {
 public:
-  NgramScores() {}
+  explicit NgramScores(size_t numNodes);
 
   /** logsum this score to the existing score */
-  void addScore(const Moses::Hypothesis* node, const Moses::Phrase& ngram, float score);
+  void addScore(size_t node, size_t order, NgramId ngram, float score);
 
-  /** Iterate through ngrams for selected node */
-  typedef std::map<const Moses::Phrase*, float>::const_iterator NodeScoreIterator;
-  NodeScoreIterator nodeBegin(const Moses::Hypothesis* node);
-  NodeScoreIterator nodeEnd(const Moses::Hypothesis* node);
+  /** ngram scores of the selected node, by order */
+  const NgramScoreTables& nodeScores(size_t node) const {
+    return m_scores[node];
+  }
 
 private:
-  std::set<Moses::Phrase> m_ngrams;
-  std::map<const Moses::Hypothesis*, std::map<const Moses::Phrase*, float> > m_scores;
+  std::vector<NgramScoreTables> m_scores;
 };
 
 
@@ -118,7 +116,7 @@ public:
   }
 
   /** Initialise ngram scores */
-  void CalcScore(std::map<Moses::Phrase, float>& finalNgramScores, const std::vector<float>& thetas, float mapWeight);
+  void CalcScore(const NgramScoreTables& finalNgramScores, const std::vector<float>& thetas, float mapWeight);
 
 private:
   std::vector<Moses::Word> m_words;
@@ -133,17 +131,23 @@ struct LatticeMBRSolutionComparator {
   }
 };
 
-void pruneLatticeFB(Lattice & connectedHyp, std::map < const Moses::Hypothesis*, std::set <const Moses::Hypothesis* > > & outgoingHyps, std::map<const Moses::Hypothesis*, std::vector<Edge> >& incomingEdges,
-                    const std::vector< float> & estimatedScores, const Moses::Hypothesis*, size_t edgeDensity,float scale);
+/** Prune the search graph to edgeDensity times the length of the best
+ * translation in edges.  On return connectedHyp holds the surviving hypotheses
+ * by increasing source coverage, the empty hypothesis first, and
+ * incomingEdges[i] the edges into connectedHyp[i]. */
+void pruneLatticeFB(Lattice & connectedHyp, const std::map < const Moses::Hypothesis*, std::set <const Moses::Hypothesis* > > & outgoingHyps,
+                    const std::vector< float> & estimatedScores, const Moses::Hypothesis*, size_t edgeDensity,float scale,
+                    std::vector<std::vector<Edge> >& incomingEdges);
 
 //Use the ngram scores to rerank the nbest list, return at most n solutions
 void getLatticeMBRNBest(const Moses::Manager& manager, const Moses::TrellisPathList& nBestList, std::vector<LatticeMBRSolution>& solutions, size_t n);
 //calculate expectated ngram counts, clipping at 1 (ie calculating posteriors) if posteriors==true.
-void calcNgramExpectations(Lattice & connectedHyp, std::map<const Moses::Hypothesis*, std::vector<Edge> >& incomingEdges, std::map<Moses::Phrase,
-                           float>& finalNgramScores, bool posteriors);
+//The lattice is as left by pruneLatticeFB.
+void calcNgramExpectations(const Lattice & connectedHyp, const std::vector<std::vector<Edge> >& incomingEdges,
+                           NgramScoreTables& finalNgramScores, bool posteriors);
 void GetOutputFactors(const Moses::TrellisPath &path, std::vector <Moses::Word> &translation);
-void extract_ngrams(const std::vector<Moses::Word >& sentence, std::map < Moses::Phrase, int >  & allngrams);
-bool ascendingCoverageCmp(const Moses::Hypothesis* a, const Moses::Hypothesis* b);
+//counts of the ngrams of the sentence, by order
+void extract_ngrams(const std::vector<Moses::Word >& sentence, std::vector<boost::unordered_map<NgramId, int> >& allngrams);
 std::vector<Moses::Word> doLatticeMBR(const Moses::Manager& manager, const Moses::TrellisPathList& nBestList);
 const Moses::TrellisPath doConsensusDecoding(const Moses::Manager& manager, const Moses::TrellisPathList& nBestList);
 //std::vector<Moses::Word> doConsensusDecoding(Moses::Manager& manager, Moses::TrellisPathList& nBestList);
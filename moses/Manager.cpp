@@ -84,6 +84,9 @@ Manager::Manager(ttasksptr const& ttask)
     UTIL_THROW2("ERROR: search. Aborting\n");
   }
 
+  if (options()->search.sentence_arena)
+    m_arena.reset(new SentenceArena);
+
   StaticData::Instance().InitializeForInput(ttask);
 }
 
@@ -144,9 +147,19 @@ void Manager::Decode()
   // search for best translation with the specified algorithm
   Timer searchTime;
   searchTime.start();
-  m_search->Decode();
+  {
+    SentenceArena::Scope arenaScope(m_arena.get());
+    m_search->Decode();
+  }
   VERBOSE(1, "Line " << m_source.GetTranslationId()
           << ": Search took " << searchTime << " seconds" << endl);
+  if (m_arena) {
+    VERBOSE(2, "Line " << m_source.GetTranslationId()
+            << ": Sentence arena: " << m_arena->GetBytesAllocated()
+            << " bytes allocated, " << m_arena->GetBytesReserved()
+            << " bytes reserved in " << m_arena->GetNumBlocks()
+            << " blocks" << endl);
+  }
   IFVERBOSE(2) {
     GetSentenceStats().StopTimeTotal();
     TRACE_ERR(GetSentenceStats());
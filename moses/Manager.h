@@ -114,6 +114,7 @@ protected:
   // data
   TranslationOptionCollection *m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
   Search *m_search;
+  boost::scoped_ptr<SentenceArena> m_arena; /**< owns hypothesis and FF state memory if search.sentence_arena is set */
 
   HypothesisStack* actual_hypoStack; /**actual (full expanded) stack of hypotheses*/
   size_t interrupted_flag;
@@ -0,0 +1,401 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <sys/stat.h>
+
+#include "ModelSnapshot.h"
+#include "FactorCollection.h"
+#include "Phrase.h"
+#include "StaticData.h"
+#include "Util.h"
+#include "Word.h"
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/murmur_hash.hh"
+
+using namespace std;
+
+namespace Moses
+{
+
+namespace
+{
+// File layout (native byte order):
+//   magic, version, number of sections
+//   per section: fingerprint, body size, name size, padding, name, body
+// Names and bodies are padded to 8 bytes. A body is a sequence of 32-bit
+// values and strings (32-bit length, bytes, padding to 4 bytes):
+//   number of factors; per factor: is non-terminal, string
+//   number of rules; per rule:
+//     source LHS, source phrase, target LHS, target phrase,
+//     number of scores, scores, alignment, flags, [sparse], [properties]
+//   where an LHS is a presence flag and a word, a phrase is a word count
+//   and words, and a word is a non-terminal flag and one factor id (+1,
+//   0 for none) per factor in the table's input or output factor order.
+const char kMagic[8] = {'m', 'o', 's', 'e', 's', 'S', 'n', 'p'};
+const uint32_t kVersion = 1;
+
+const uint32_t kHasSparse = 1;
+const uint32_t kHasProperties = 2;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t numSections;
+};
+
+struct SectionHeader {
+  uint64_t fingerprint;
+  uint64_t bodySize;
+  uint32_t nameSize;
+  uint32_t padding;
+};
+
+SectionHeader MakeSectionHeader(uint64_t fingerprint, size_t bodySize, const string &name)
+{
+  UTIL_THROW_IF2(name.size() > std::numeric_limits<uint32_t>::max(),
+                 "Model snapshot section name too long: " << name.size() << " bytes");
+  SectionHeader header = { fingerprint, static_cast<uint64_t>(bodySize),
+                           static_cast<uint32_t>(name.size()), 0
+                         };
+  return header;
+}
+
+size_t Pad(size_t size, size_t to)
+{
+  return (size + to - 1) / to * to;
+}
+
+void PutInt(string &out, uint32_t value)
+{
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void PutString(string &out, const StringPiece &str)
+{
+  PutInt(out, str.size());
+  out.append(str.data(), str.size());
+  out.append(Pad(str.size(), 4) - str.size(), '\0');
+}
+
+void WritePadded(int fd, const void *data, size_t size, size_t to)
+{
+  static const char zeros[8] = {0};
+  util::WriteOrThrow(fd, data, size);
+  util::WriteOrThrow(fd, zeros, Pad(size, to) - size);
+}
+}
+
+ModelSnapshot::TableWriter::TableWriter(const std::vector<FactorType> &input,
+                                        const std::vector<FactorType> &output)
+  : m_input(input), m_output(output), m_numRules(0)
+{
+}
+
+void ModelSnapshot::TableWriter::PutWord(const Word *word,
+    const std::vector<FactorType> &factorOrder)
+{
+  PutInt(m_rules, word->IsNonTerminal());
+  for (size_t i = 0; i < factorOrder.size(); ++i) {
+    const Factor *factor = word->GetFactor(factorOrder[i]);
+    uint32_t id = 0;
+    if (factor) {
+      boost::unordered_map<const Factor*, uint32_t>::const_iterator iter
+      = m_factorIds.find(factor);
+      if (iter == m_factorIds.end()) {
+        m_factors.push_back(make_pair(factor, word->IsNonTerminal()));
+        id = m_factors.size();
+        m_factorIds[factor] = id;
+      } else {
+        id = iter->second;
+      }
+    }
+    PutInt(m_rules, id);
+  }
+}
+
+void ModelSnapshot::TableWriter::AddRule(const Phrase &source, const Word *sourceLHS,
+    const Phrase &target, const Word *targetLHS,
+    const RuleFields &fields)
+{
+  PutInt(m_rules, sourceLHS != NULL);
+  if (sourceLHS) PutWord(sourceLHS, m_input);
+  PutInt(m_rules, source.GetSize());
+  for (size_t i = 0; i < source.GetSize(); ++i)
+    PutWord(&source.GetWord(i), m_input);
+
+  PutInt(m_rules, targetLHS != NULL);
+  if (targetLHS) PutWord(targetLHS, m_output);
+  PutInt(m_rules, target.GetSize());
+  for (size_t i = 0; i < target.GetSize(); ++i)
+    PutWord(&target.GetWord(i), m_output);
+
+  PutInt(m_rules, fields.scores.size());
+  if (!fields.scores.empty())
+    m_rules.append(reinterpret_cast<const char*>(&fields.scores[0]),
+                   fields.scores.size() * sizeof(float));
+  PutString(m_rules, fields.alignment);
+  PutInt(m_rules, (fields.hasSparse ? kHasSparse : 0)
+         | (fields.hasProperties ? kHasProperties : 0));
+  if (fields.hasSparse) PutString(m_rules, fields.sparse);
+  if (fields.hasProperties) PutString(m_rules, fields.properties);
+  ++m_numRules;
+}
+
+void ModelSnapshot::TableWriter::Serialize(std::string &out) const
+{
+  out.clear();
+  PutInt(out, m_factors.size());
+  for (size_t i = 0; i < m_factors.size(); ++i) {
+    PutInt(out, m_factors[i].second);
+    PutString(out, m_factors[i].first->GetString());
+  }
+  PutInt(out, m_numRules);
+  out += m_rules;
+}
+
+ModelSnapshot::TableReader::TableReader(const char *begin, const char *end,
+                                        const std::vector<FactorType> &input,
+                                        const std::vector<FactorType> &output)
+  : m_cur(begin), m_end(end), m_input(input), m_output(output), m_read(0)
+{
+  FactorCollection &factorCollection = FactorCollection::Instance();
+  size_t numFactors = GetInt();
+  m_factors.reserve(numFactors + 1);
+  m_factors.push_back(NULL);
+  for (size_t i = 0; i < numFactors; ++i) {
+    bool isNonTerminal = GetInt();
+    m_factors.push_back(factorCollection.AddPersistentFactor(GetString(), isNonTerminal));
+  }
+  m_numRules = GetInt();
+}
+
+uint32_t ModelSnapshot::TableReader::GetInt()
+{
+  UTIL_THROW_IF2(m_end - m_cur < 4, "Truncated model snapshot");
+  uint32_t ret;
+  memcpy(&ret, m_cur, sizeof(ret));
+  m_cur += sizeof(ret);
+  return ret;
+}
+
+StringPiece ModelSnapshot::TableReader::GetString()
+{
+  size_t size = GetInt();
+  UTIL_THROW_IF2(static_cast<size_t>(m_end - m_cur) < Pad(size, 4),
+                 "Truncated model snapshot");
+  StringPiece ret(m_cur, size);
+  m_cur += Pad(size, 4);
+  return ret;
+}
+
+void ModelSnapshot::TableReader::GetWord(Word &word,
+    const std::vector<FactorType> &factorOrder)
+{
+  word.SetIsNonTerminal(GetInt());
+  for (size_t i = 0; i < factorOrder.size(); ++i) {
+    uint32_t id = GetInt();
+    UTIL_THROW_IF2(id >= m_factors.size(), "Bad factor id in model snapshot");
+    word.SetFactor(factorOrder[i], m_factors[id]);
+  }
+}
+
+bool ModelSnapshot::TableReader::Next(Phrase &source, Word *&sourceLHS,
+                                      Phrase &target, Word *&targetLHS,
+                                      RuleFields &fields)
+{
+  if (m_read == m_numRules) return false;
+  ++m_read;
+
+  sourceLHS = NULL;
+  if (GetInt()) {
+    sourceLHS = new Word(true);
+    GetWord(*sourceLHS, m_input);
+  }
+  for (size_t n = GetInt(); n; --n)
+    GetWord(source.AddWord(), m_input);
+
+  targetLHS = NULL;
+  if (GetInt()) {
+    targetLHS = new Word(true);
+    GetWord(*targetLHS, m_output);
+  }
+  for (size_t n = GetInt(); n; --n)
+    GetWord(target.AddWord(), m_output);
+
+  size_t numScores = GetInt();
+  UTIL_THROW_IF2(static_cast<size_t>(m_end - m_cur) < numScores * sizeof(float),
+                 "Truncated model snapshot");
+  fields.scores.resize(numScores);
+  if (numScores) memcpy(&fields.scores[0], m_cur, numScores * sizeof(float));
+  m_cur += numScores * sizeof(float);
+
+  fields.alignment = GetString();
+  uint32_t flags = GetInt();
+  fields.hasSparse = flags & kHasSparse;
+  fields.sparse = fields.hasSparse ? GetString() : StringPiece();
+  fields.hasProperties = flags & kHasProperties;
+  fields.properties = fields.hasProperties ? GetString() : StringPiece();
+  return true;
+}
+
+ModelSnapshot::ModelSnapshot(const std::string &path)
+  : m_path(path)
+{
+  if (!Map()) {
+    m_sections.clear();
+    m_mem.reset();
+  }
+  VERBOSE(1, "Model snapshot " << m_path << ": " << m_sections.size()
+          << " table(s)" << endl);
+}
+
+ModelSnapshot::~ModelSnapshot() {}
+
+bool ModelSnapshot::Map()
+{
+  struct stat st;
+  if (stat(m_path.c_str(), &st) != 0) return true; // written on Save()
+
+  util::scoped_fd fd(util::OpenReadOrThrow(m_path.c_str()));
+  uint64_t size = util::SizeFile(fd.get());
+  if (size < sizeof(FileHeader)) {
+    TRACE_ERR("Ignoring model snapshot " << m_path << ": too short" << endl);
+    return false;
+  }
+  util::MapRead(util::POPULATE_OR_LAZY, fd.get(), 0, size, m_mem);
+  const char *begin = static_cast<const char*>(m_mem.get());
+  const char *end = begin + size;
+
+  FileHeader header;
+  memcpy(&header, begin, sizeof(header));
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) || header.version != kVersion) {
+    TRACE_ERR("Ignoring model snapshot " << m_path
+              << ": not a snapshot or from another version" << endl);
+    return false;
+  }
+
+  const char *cur = begin + sizeof(header);
+  for (uint32_t i = 0; i < header.numSections; ++i) {
+    SectionHeader sh;
+    if (static_cast<size_t>(end - cur) < sizeof(sh)) break;
+    memcpy(&sh, cur, sizeof(sh));
+    cur += sizeof(sh);
+    if (static_cast<uint64_t>(end - cur) < Pad(sh.nameSize, 8) + Pad(sh.bodySize, 8)) {
+      cur = NULL;
+      break;
+    }
+    string name(cur, sh.nameSize);
+    cur += Pad(sh.nameSize, 8);
+    Section &section = m_sections[name];
+    section.fingerprint = sh.fingerprint;
+    section.begin = cur;
+    section.end = cur + sh.bodySize;
+    cur += Pad(sh.bodySize, 8);
+  }
+  if (cur == NULL || m_sections.size() != header.numSections) {
+    TRACE_ERR("Ignoring model snapshot " << m_path << ": truncated" << endl);
+    return false;
+  }
+  return true;
+}
+
+ModelSnapshot::TableReader *ModelSnapshot::OpenTable(const std::string &name,
+    uint64_t fingerprint,
+    const std::vector<FactorType> &input,
+    const std::vector<FactorType> &output) const
+{
+  std::map<std::string, Section>::const_iterator iter = m_sections.find(name);
+  if (iter == m_sections.end() || iter->second.fingerprint != fingerprint)
+    return NULL;
+  return new TableReader(iter->second.begin, iter->second.end, input, output);
+}
+
+ModelSnapshot::TableWriter &ModelSnapshot::RecordTable(const std::string &name,
+    uint64_t fingerprint,
+    const std::vector<FactorType> &input,
+    const std::vector<FactorType> &output)
+{
+  Recorded &recorded = m_recorded[name];
+  recorded.fingerprint = fingerprint;
+  recorded.writer.reset(new TableWriter(input, output));
+  return *recorded.writer;
+}
+
+void ModelSnapshot::Save()
+{
+  if (m_recorded.empty()) return;
+
+  // sections of this run, then the still valid ones of the old file
+  std::map<std::string, Section> kept;
+  std::map<std::string, Section>::const_iterator iter;
+  for (iter = m_sections.begin(); iter != m_sections.end(); ++iter) {
+    if (!m_recorded.count(iter->first)) kept.insert(*iter);
+  }
+
+  const string tmpPath = m_path + ".tmp";
+  {
+    util::scoped_fd fd(util::CreateOrThrow(tmpPath.c_str()));
+    FileHeader header;
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.numSections = m_recorded.size() + kept.size();
+    util::WriteOrThrow(fd.get(), &header, sizeof(header));
+
+    string body;
+    std::map<std::string, Recorded>::const_iterator rec;
+    for (rec = m_recorded.begin(); rec != m_recorded.end(); ++rec) {
+      rec->second.writer->Serialize(body);
+      SectionHeader sh = MakeSectionHeader(rec->second.fingerprint, body.size(), rec->first);
+      util::WriteOrThrow(fd.get(), &sh, sizeof(sh));
+      WritePadded(fd.get(), rec->first.data(), rec->first.size(), 8);
+      WritePadded(fd.get(), body.data(), body.size(), 8);
+    }
+    for (iter = kept.begin(); iter != kept.end(); ++iter) {
+      const Section &section = iter->second;
+      SectionHeader sh = MakeSectionHeader(section.fingerprint, section.end - section.begin, iter->first);
+      util::WriteOrThrow(fd.get(), &sh, sizeof(sh));
+      WritePadded(fd.get(), iter->first.data(), iter->first.size(), 8);
+      WritePadded(fd.get(), section.begin, section.end - section.begin, 8);
+    }
+  }
+  UTIL_THROW_IF2(std::rename(tmpPath.c_str(), m_path.c_str()) != 0,
+                 "Could not rename " << tmpPath << " to " << m_path);
+  VERBOSE(1, "Wrote model snapshot " << m_path << " with " << m_recorded.size()
+          << " new table(s)" << endl);
+
+  // the tables are loaded; the rules are not needed any more
+  m_recorded.clear();
+}
+
+uint64_t ModelSnapshot::FileFingerprint(const std::string &path)
+{
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) return 0;
+  uint64_t size = st.st_size, mtime = st.st_mtime;
+  uint64_t ret = util::MurmurHashNative(path.data(), path.size());
+  ret = util::MurmurHashNative(&size, sizeof(size), ret);
+  return util::MurmurHashNative(&mtime, sizeof(mtime), ret);
+}
+
+}
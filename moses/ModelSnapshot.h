@@ -0,0 +1,175 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_ModelSnapshot_h
+#define moses_ModelSnapshot_h
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "util/mmap.hh"
+#include "util/string_piece.hh"
+#include "TypeDef.h"
+
+namespace Moses
+{
+
+class Factor;
+class Phrase;
+class Word;
+
+/** Warm start image of the rule tables that are loaded into memory
+ * (-model-snapshot).
+ *
+ * The file holds one section per table, keyed by the feature name and a
+ * fingerprint of the table file and the options that affect parsing. A
+ * section is a binary copy of the rules as the text loader parsed them:
+ * the words as indices into the section's own vocabulary, the scores as
+ * floats and the alignment, sparse and property fields as raw strings.
+ * Replaying a section therefore builds exactly the table that parsing the
+ * text would have built, but without tokenising, converting numbers or
+ * hashing every word occurrence.
+ *
+ * The file is memory mapped and the vocabulary strings are handed to the
+ * FactorCollection without copying, so the mapping is kept for the
+ * lifetime of the object, which must be that of the process.
+ */
+class ModelSnapshot
+{
+public:
+  /** the fields of a rule besides its source and target phrases, as in the
+   * text format */
+  struct RuleFields {
+    std::vector<float> scores;
+    StringPiece alignment;
+    bool hasSparse, hasProperties;
+    StringPiece sparse, properties;
+
+    RuleFields() : hasSparse(false), hasProperties(false) {}
+  };
+
+  //! collects the rules of one table while it is loaded from text
+  class TableWriter
+  {
+  public:
+    TableWriter(const std::vector<FactorType> &input,
+                const std::vector<FactorType> &output);
+
+    void AddRule(const Phrase &source, const Word *sourceLHS,
+                 const Phrase &target, const Word *targetLHS,
+                 const RuleFields &fields);
+
+    //! vocabulary followed by the rules
+    void Serialize(std::string &out) const;
+
+  private:
+    std::vector<FactorType> m_input, m_output;
+    boost::unordered_map<const Factor*, uint32_t> m_factorIds;
+    std::vector<std::pair<const Factor*, bool> > m_factors; // factor, is non-terminal
+    std::string m_rules;
+    uint32_t m_numRules;
+
+    void PutWord(const Word *word, const std::vector<FactorType> &factorOrder);
+  };
+
+  //! replays the rules of one section
+  class TableReader
+  {
+  public:
+    TableReader(const char *begin, const char *end,
+                const std::vector<FactorType> &input,
+                const std::vector<FactorType> &output);
+
+    size_t GetNumRules() const {
+      return m_numRules;
+    }
+
+    /** read the next rule into the empty phrases source and target. The
+     * left-hand sides are allocated with new, or NULL. Returns false after
+     * the last rule. */
+    bool Next(Phrase &source, Word *&sourceLHS,
+              Phrase &target, Word *&targetLHS,
+              RuleFields &fields);
+
+  private:
+    const char *m_cur, *m_end;
+    std::vector<FactorType> m_input, m_output;
+    std::vector<const Factor*> m_factors; // index 0 is NULL
+    size_t m_numRules, m_read;
+
+    uint32_t GetInt();
+    StringPiece GetString();
+    void GetWord(Word &word, const std::vector<FactorType> &factorOrder);
+  };
+
+  //! map path if it exists and is a valid snapshot
+  explicit ModelSnapshot(const std::string &path);
+  ~ModelSnapshot();
+
+  const std::string &GetPath() const {
+    return m_path;
+  }
+
+  //! reader for the section of the named table, or NULL if there is none with this fingerprint
+  TableReader *OpenTable(const std::string &name, uint64_t fingerprint,
+                         const std::vector<FactorType> &input,
+                         const std::vector<FactorType> &output) const;
+
+  //! start a new section for the named table; it replaces any old one on Save()
+  TableWriter &RecordTable(const std::string &name, uint64_t fingerprint,
+                           const std::vector<FactorType> &input,
+                           const std::vector<FactorType> &output);
+
+  /** rewrite the file if any table was recorded in this run. The new file
+   * replaces the old one atomically; the old mapping stays valid. */
+  void Save();
+
+  //! fingerprint of a file's name, size and modification time
+  static uint64_t FileFingerprint(const std::string &path);
+
+private:
+  struct Section {
+    uint64_t fingerprint;
+    const char *begin, *end;
+  };
+
+  struct Recorded {
+    uint64_t fingerprint;
+    boost::shared_ptr<TableWriter> writer;
+  };
+
+  std::string m_path;
+  util::scoped_memory m_mem;
+  std::map<std::string, Section> m_sections;
+  std::map<std::string, Recorded> m_recorded;
+
+  bool Map();
+
+  ModelSnapshot(const ModelSnapshot &);
+  void operator=(const ModelSnapshot &);
+};
+
+}
+
+#endif
@@ -0,0 +1,120 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <cstdio>
+#include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "ModelSnapshot.h"
+#include "FactorCollection.h"
+#include "Phrase.h"
+#include "Word.h"
+
+using namespace Moses;
+
+namespace
+{
+std::string TempPath(const char *name)
+{
+  return (boost::filesystem::temp_directory_path() / name).string();
+}
+}
+
+BOOST_AUTO_TEST_SUITE(model_snapshot)
+
+BOOST_AUTO_TEST_CASE(save_and_replay)
+{
+  std::string path = TempPath("moses_snapshot_test");
+  std::remove(path.c_str());
+
+  std::vector<FactorType> factors(1, 0);
+  Phrase source, target;
+  source.CreateFromString(Input, factors, "das haus", NULL);
+  target.CreateFromString(Output, factors, "the house", NULL);
+  Word targetLHS(true);
+  targetLHS.CreateFromString(Output, factors, "NP", true);
+
+  ModelSnapshot::RuleFields fields;
+  fields.scores.push_back(-0.5);
+  fields.scores.push_back(-1.25);
+  fields.alignment = "0-0 1-1";
+  fields.hasProperties = true;
+  fields.properties = "{{Counts 1 2}}";
+  {
+    ModelSnapshot snapshot(path);
+    BOOST_CHECK(snapshot.OpenTable("TM0", 42, factors, factors) == NULL);
+    ModelSnapshot::TableWriter &writer = snapshot.RecordTable("TM0", 42, factors, factors);
+    writer.AddRule(source, NULL, target, &targetLHS, fields);
+    writer.AddRule(target, NULL, source, NULL, ModelSnapshot::RuleFields());
+    snapshot.Save();
+  }
+
+  ModelSnapshot snapshot(path);
+  BOOST_CHECK(snapshot.OpenTable("TM0", 43, factors, factors) == NULL);
+  BOOST_CHECK(snapshot.OpenTable("TM1", 42, factors, factors) == NULL);
+  boost::scoped_ptr<ModelSnapshot::TableReader> reader(
+    snapshot.OpenTable("TM0", 42, factors, factors));
+  BOOST_REQUIRE(reader);
+  BOOST_CHECK_EQUAL(reader->GetNumRules(), 2);
+
+  Phrase readSource, readTarget;
+  Word *readSourceLHS, *readTargetLHS;
+  ModelSnapshot::RuleFields readFields;
+  BOOST_REQUIRE(reader->Next(readSource, readSourceLHS, readTarget, readTargetLHS, readFields));
+  BOOST_CHECK(readSource == source);
+  BOOST_CHECK(readTarget == target);
+  BOOST_CHECK(readSourceLHS == NULL);
+  BOOST_REQUIRE(readTargetLHS != NULL);
+  BOOST_CHECK(*readTargetLHS == targetLHS);
+  BOOST_CHECK(readTargetLHS->IsNonTerminal());
+  // the factors are shared with the ones created from text
+  BOOST_CHECK(readTarget.GetWord(0).GetFactor(0) == target.GetWord(0).GetFactor(0));
+  delete readTargetLHS;
+  BOOST_CHECK(readFields.scores == fields.scores);
+  BOOST_CHECK_EQUAL(readFields.alignment, "0-0 1-1");
+  BOOST_CHECK(!readFields.hasSparse);
+  BOOST_CHECK(readFields.hasProperties);
+  BOOST_CHECK_EQUAL(readFields.properties, "{{Counts 1 2}}");
+
+  Phrase source2, target2;
+  BOOST_REQUIRE(reader->Next(source2, readSourceLHS, target2, readTargetLHS, readFields));
+  BOOST_CHECK(source2 == target);
+  BOOST_CHECK(target2 == source);
+  BOOST_CHECK(readFields.scores.empty());
+  BOOST_CHECK(!readFields.hasProperties);
+  BOOST_CHECK(!reader->Next(source2, readSourceLHS, target2, readTargetLHS, readFields));
+
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(ignore_garbage)
+{
+  std::string path = TempPath("moses_snapshot_garbage");
+  FILE *file = std::fopen(path.c_str(), "w");
+  std::fputs("this is not a snapshot", file);
+  std::fclose(file);
+
+  std::vector<FactorType> factors(1, 0);
+  ModelSnapshot snapshot(path);
+  BOOST_CHECK(snapshot.OpenTable("TM0", 42, factors, factors) == NULL);
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
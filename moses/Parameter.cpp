@@ -108,6 +108,11 @@ Parameter::Parameter()
   AddParam(search_opts,"disable-discarding", "dd", "disable hypothesis discarding"); // ??? memory management? UG
   AddParam(search_opts,"phrase-drop-allowed", "da", "if present, allow dropping of source words"); //da = drop any (word); see -du for comparison
   AddParam(search_opts,"threads","th", "number of threads to use in decoding (defaults to single-threaded)");
+  AddParam(search_opts,"work-stealing", "use a work-stealing thread pool with per-thread job queues instead of a single shared queue");
+  AddParam(search_opts,"pin-threads", "bind each decoding thread to one CPU core (Linux only)");
+  AddParam(search_opts,"expansion-threads", "number of threads expanding the hypotheses of one stack in parallel (normal search without early discarding; default 1)");
+  AddParam(search_opts,"prefetch-window", "number of translation options ahead of the one being scored for which feature functions may prefetch their state lookups (default 8, 0 disables)");
+  AddParam(search_opts,"sentence-arena", "allocate hypotheses and feature function states from a per-sentence memory arena that is freed in one go (phrase-based search only)");
 
   // distortion options
   po::options_description disto_opts("Distortion options");
@@ -122,6 +127,7 @@ Parameter::Parameter()
   AddParam(cube_opts,"cube-pruning-diversity", "cbd", "How many hypotheses should be created for each coverage. (default = 0)");
   AddParam(cube_opts,"cube-pruning-lazy-scoring", "cbls", "Don't fully score a hypothesis until it is popped");
   AddParam(cube_opts,"cube-pruning-deterministic-search", "cbds", "Break ties deterministically during search");
+  AddParam(cube_opts,"cube-pruning-stats", "cbs", "Report the number of hypotheses popped per second for each sentence");
 
   ///////////////////////////////////////////////////////////////////////////////////////
   // minimum bayes risk decoding
@@ -130,6 +136,7 @@ Parameter::Parameter()
   AddParam(mbr_opts,"minimum-bayes-risk", "mbr", "use miminum Bayes risk to determine best translation");
   AddParam(mbr_opts,"mbr-size", "number of translation candidates considered in MBR decoding (default 200)");
   AddParam(mbr_opts,"mbr-scale", "scaling factor to convert log linear score probability in MBR decoding (default 1.0)");
+  AddParam(mbr_opts,"mbr-threads", "number of threads comparing the translation candidates of one sentence in MBR decoding (default 1)");
 
   AddParam(mbr_opts,"lminimum-bayes-risk", "lmbr", "use lattice miminum Bayes risk to determine best translation");
   AddParam(mbr_opts,"consensus-decoding", "con", "use consensus decoding (De Nero et. al. 2009)");
@@ -253,6 +260,8 @@ Parameter::Parameter()
 
   po::options_description misc_opts("Miscellaneous Options");
   AddParam(misc_opts,"mira", "do mira training");
+  AddParam(misc_opts,"freeze-feature-names", "resolve the feature names known after loading without locking. Default = false");
+  AddParam(misc_opts,"model-snapshot", "warm start image of the text rule tables: tables are loaded from this file when it is up to date, and it is (re)written after loading them from text");
   AddParam(misc_opts,"description", "Source language, target language, description");
   AddParam(misc_opts,"no-cache", "Disable all phrase-table caching. Default = false (ie. enable caching)");
   AddParam(misc_opts,"default-non-term-for-empty-range-only", "Don't add [X] to all ranges, just ranges where there isn't a source non-term. Default = false (ie. add [X] everywhere)");
@@ -0,0 +1,61 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_PrefetchCursor_h
+#define moses_PrefetchCursor_h
+
+#include <cstddef>
+
+namespace Moses
+{
+
+/** Runs a fixed number of translation options ahead of an expansion loop
+ * and lets the feature functions prefetch the state lookups of those
+ * options, so that the cache misses of several hypotheses overlap with
+ * the scoring of the current one.  A window of 0 prefetches nothing.
+ *
+ * Hypo is normally Hypothesis and Iterator an iterator over a
+ * TranslationOptionList, whose elements are pointers to options. */
+template <class Hypo, class Iterator>
+class PrefetchCursor
+{
+public:
+  PrefetchCursor(const Hypo &hypothesis, Iterator begin, Iterator end,
+                 size_t window)
+    : m_hypothesis(hypothesis), m_ahead(begin), m_end(end), m_window(window) {
+    for (size_t i = 0; i < window && m_ahead != m_end; ++i) Advance();
+  }
+
+  //! call once per option expanded
+  void Advance() {
+    if (m_window == 0 || m_ahead == m_end) return;
+    m_hypothesis.PrefetchWhenApplied(**m_ahead);
+    ++m_ahead;
+  }
+
+private:
+  const Hypo &m_hypothesis;
+  Iterator m_ahead, m_end;
+  size_t m_window;
+};
+
+}
+
+#endif
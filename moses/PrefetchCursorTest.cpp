@@ -0,0 +1,81 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include "PrefetchCursor.h"
+
+using namespace Moses;
+
+namespace
+{
+
+// records the options it was asked to prefetch
+struct MockHypothesis {
+  mutable std::vector<int> prefetched;
+  void PrefetchWhenApplied(const int &option) const {
+    prefetched.push_back(option);
+  }
+};
+
+typedef PrefetchCursor<MockHypothesis, std::vector<const int*>::const_iterator> MockCursor;
+
+struct Options {
+  std::vector<int> values;
+  std::vector<const int*> list;
+  explicit Options(size_t n) : values(n) {
+    for (size_t i = 0; i < n; ++i) values[i] = i;
+    for (size_t i = 0; i < n; ++i) list.push_back(&values[i]);
+  }
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(prefetch_cursor)
+
+BOOST_AUTO_TEST_CASE(runs_ahead_by_window)
+{
+  Options options(5);
+  MockHypothesis hypo;
+  MockCursor cursor(hypo, options.list.begin(), options.list.end(), 2);
+  BOOST_CHECK_EQUAL(hypo.prefetched.size(), 2);
+
+  for (size_t i = 0; i < options.list.size(); ++i) {
+    cursor.Advance();
+    BOOST_CHECK_EQUAL(hypo.prefetched.size(), std::min<size_t>(i + 3, 5));
+  }
+  for (size_t i = 0; i < hypo.prefetched.size(); ++i) {
+    BOOST_CHECK_EQUAL(hypo.prefetched[i], (int)i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(window_zero_is_off)
+{
+  Options options(5);
+  MockHypothesis hypo;
+  MockCursor cursor(hypo, options.list.begin(), options.list.end(), 0);
+  for (size_t i = 0; i < options.list.size(); ++i) {
+    cursor.Advance();
+  }
+  BOOST_CHECK(hypo.prefetched.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,8 @@
 #include "StaticData.h"
 #include "InputType.h"
 #include "TranslationOptionCollection.h"
+#include "Timer.h"
+#include <queue>
 #include <boost/foreach.hpp>
 using namespace std;
 
@@ -11,7 +13,13 @@ namespace Moses
 {
 class BitmapContainerOrderer
 {
+private:
+  bool m_deterministic;
+
 public:
+  BitmapContainerOrderer(const bool deterministic = false)
+    : m_deterministic(deterministic) {}
+
   bool operator()(const BitmapContainer* A, const BitmapContainer* B) const {
     if (B->Empty()) {
       if (A->Empty()) {
@@ -24,27 +32,23 @@ public:
     }
 
     // Compare the top hypothesis of each bitmap container using the TotalScore, which includes future cost
-    const float scoreA = A->Top()->GetHypothesis()->GetFutureScore();
-    const float scoreB = B->Top()->GetHypothesis()->GetFutureScore();
+    const Hypothesis *hypoA = A->Top().GetHypothesis();
+    const Hypothesis *hypoB = B->Top().GetHypothesis();
+    const float scoreA = hypoA->GetFutureScore();
+    const float scoreB = hypoB->GetFutureScore();
 
     if (scoreA < scoreB) {
       return true;
     } else if (scoreA > scoreB) {
       return false;
     } else {
-      // Equal scores: break ties by comparing target phrases (if they exist)
-      // *Important*: these are pointers to copies of the target phrases from the
-      // hypotheses.  This class is used to keep priority queues ordered in the
-      // background, so comparisons made as those data structures are cleaned up
-      // may occur *after* the target phrases in hypotheses have been cleaned up,
-      // leading to segfaults if relying on hypotheses to provide target phrases.
-      boost::shared_ptr<TargetPhrase> phrA = A->Top()->GetTargetPhrase();
-      boost::shared_ptr<TargetPhrase> phrB = B->Top()->GetTargetPhrase();
-      if (!phrA || !phrB) {
+      // Equal scores: break ties by comparing target phrases.  The top
+      // hypotheses are still queued, so their target phrases are valid.
+      if (!m_deterministic) {
         // Fallback: compare pointers, non-deterministic sort
         return A < B;
       }
-      return (phrA->Compare(*phrB) > 0);
+      return (hypoA->GetCurrTargetPhrase().Compare(hypoB->GetCurrTargetPhrase()) > 0);
     }
   }
 };
@@ -95,6 +99,11 @@ void SearchCubePruning::Decode()
   VERBOSE(2,"Max Phrase length is "
           << m_manager.options()->search.max_phrase_length << std::endl);
 
+  const bool reportStats = m_manager.options()->cube.stats;
+  size_t totalPops = 0;
+  Timer searchTime;
+  if (reportStats) searchTime.start();
+
   // go through each stack
   size_t stackNo = 1;
   int timelimit = m_options.search.timeout;
@@ -109,7 +118,8 @@ void SearchCubePruning::Decode()
     // priority queue which has a single entry for each bitmap
     // container, sorted by score of top hyp
     std::priority_queue < BitmapContainer*, std::vector< BitmapContainer* >,
-        BitmapContainerOrderer > BCQueue;
+        BitmapContainerOrderer >
+        BCQueue(BitmapContainerOrderer(m_manager.options()->cube.deterministic_search));
 
     _BMType::const_iterator bmIter;
     const _BMType &accessor = sourceHypoColl.GetBitmapAccessor();
@@ -130,7 +140,8 @@ void SearchCubePruning::Decode()
     }
 
     // main search loop, pop k best hyps
-    for (size_t numpops = 1; numpops <= PopLimit && !BCQueue.empty(); numpops++) {
+    size_t numpops;
+    for (numpops = 1; numpops <= PopLimit && !BCQueue.empty(); numpops++) {
       // get currently best hypothesis in queue
       m_manager.GetSentenceStats().StartTimeManageCubes();
       BitmapContainer *bc = BCQueue.top();
@@ -153,6 +164,7 @@ void SearchCubePruning::Decode()
         BCQueue.push(bc);
       m_manager.GetSentenceStats().StopTimeManageCubes();
     }
+    totalPops += numpops - 1;
 
     // ensure diversity, a minimum number of inserted hyps for each bitmap container;
     //    NOTE: diversity doesn't ensure they aren't pruned at some later point
@@ -161,7 +173,7 @@ void SearchCubePruning::Decode()
         m_manager.GetSentenceStats().StartTimeOtherScore();
       }
       for(bmIter = accessor.begin(); bmIter != accessor.end(); ++bmIter) {
-        bmIter->second->EnsureMinStackHyps(Diversity);
+        totalPops += bmIter->second->EnsureMinStackHyps(Diversity);
       }
       IFVERBOSE(2) {
         m_manager.GetSentenceStats().StopTimeOtherScore();
@@ -190,6 +202,15 @@ void SearchCubePruning::Decode()
 
     stackNo++;
   }
+
+  if (reportStats) {
+    const double seconds = searchTime.get_elapsed_time();
+    TRACE_ERR("Line " << m_source.GetTranslationId()
+              << ": Cube pruning popped " << totalPops << " hypotheses in "
+              << seconds << " seconds ("
+              << (seconds > 0 ? totalPops / seconds : 0) << " pops/sec)"
+              << std::endl);
+  }
 }
 
 void SearchCubePruning::CreateForwardTodos(HypothesisStackCubePruning &stack)
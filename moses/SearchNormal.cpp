@@ -1,7 +1,9 @@
 #include "Manager.h"
+#include "PrefetchCursor.h"
 #include "Timer.h"
 #include "SearchNormal.h"
 #include "SentenceStats.h"
+#include "ThreadPool.h"
 
 #include <boost/foreach.hpp>
 
@@ -9,6 +11,35 @@ using namespace std;
 
 namespace Moses
 {
+
+#ifdef WITH_THREADS
+/** Builds and scores the pending expansions [begin, end) on a helper thread */
+class ExpansionTask : public Task
+{
+public:
+  ExpansionTask(SearchNormal &search, size_t begin, size_t end,
+                size_t &remaining, boost::mutex &mutex,
+                boost::condition_variable &done)
+    : m_search(search), m_begin(begin), m_end(end)
+    , m_remaining(remaining), m_mutex(mutex), m_done(done) {}
+
+  virtual void Run() {
+    m_search.ExpandPending(m_begin, m_end);
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (--m_remaining == 0) m_done.notify_all();
+  }
+
+private:
+  SearchNormal &m_search;
+  size_t m_begin, m_end;
+  size_t &m_remaining;
+  boost::mutex &m_mutex;
+  boost::condition_variable &m_done;
+};
+#endif
+
+typedef PrefetchCursor<Hypothesis, TranslationOptionList::const_iterator> OptionPrefetchCursor;
+
 /**
  * Organizing main function
  *
@@ -20,9 +51,20 @@ SearchNormal(Manager& manager, const TranslationOptionCollection &transOptColl)
   : Search(manager)
   , m_hypoStackColl(manager.GetSource().GetSize() + 1)
   , m_transOptColl(transOptColl)
+  , m_expansionThreads(1)
 {
   VERBOSE(1, "Translating: " << m_source << endl);
 
+#ifdef WITH_THREADS
+  // Parallel expansion builds all hypotheses of a stack before adding any
+  // of them, which is incompatible with early discarding (it depends on
+  // the state of the stacks after every single addition).
+  if (m_options.search.expansion_threads > 1
+      && !m_options.search.UseEarlyDiscarding()) {
+    m_expansionThreads = m_options.search.expansion_threads;
+  }
+#endif
+
   // initialize the stacks: create data structure and set limits
   std::vector < HypothesisStackNormal >::iterator iterStack;
   for (size_t ind = 0 ; ind < m_hypoStackColl.size() ; ++ind) {
@@ -62,6 +104,9 @@ ProcessOneStack(HypothesisStack* hstack)
   HypothesisStackNormal::const_iterator h;
   for (h = sourceHypoColl.begin(); h != sourceHypoColl.end(); ++h)
     ProcessOneHypothesis(**h);
+
+  // with parallel expansion, the above only collected the work
+  if (m_expansionThreads > 1) ExpandPendingInParallel();
   return true;
 }
 
@@ -258,13 +303,135 @@ ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos
   const Range &nextRange = transOpt.GetSourceWordsRange();
   const Bitmap &nextBitmap = m_bitmaps.GetBitmap(sourceCompleted, nextRange);
 
+  if (m_expansionThreads > 1) {
+    PendingExpansion pending = { &hypothesis, tol, estimatedScore, &nextBitmap };
+    m_pending.push_back(pending);
+    return;
+  }
+
+  OptionPrefetchCursor prefetch(hypothesis, tol->begin(), tol->end(),
+                               m_options.search.prefetch_window);
   TranslationOptionList::const_iterator iter;
   for (iter = tol->begin() ; iter != tol->end() ; ++iter) {
+    prefetch.Advance();
     const TranslationOption &transOpt = **iter;
     ExpandHypothesis(hypothesis, transOpt, expectedScore, estimatedScore, nextBitmap);
   }
 }
 
+/**
+ * Build and score the hypotheses of m_pending[begin, end).
+ * Runs concurrently on disjoint ranges; hypothesis ids are assigned later.
+ */
+void
+SearchNormal::
+ExpandPending(size_t begin, size_t end)
+{
+  for (size_t i = begin; i < end; ++i) {
+    PendingExpansion &pending = m_pending[i];
+    pending.expanded.reserve(pending.tol->size());
+    OptionPrefetchCursor prefetch(*pending.hypothesis, pending.tol->begin(),
+                                  pending.tol->end(), m_options.search.prefetch_window);
+    // SentenceStats is not thread-safe; its timers are updated after the join
+    Timer buildHyp, otherScore;
+    TranslationOptionList::const_iterator iter;
+    for (iter = pending.tol->begin(); iter != pending.tol->end(); ++iter) {
+      prefetch.Advance();
+      IFVERBOSE(2) {
+        buildHyp.start();
+      }
+      Hypothesis *newHypo = new Hypothesis(*pending.hypothesis, **iter,
+                                           *pending.bitmap, 0);
+      IFVERBOSE(2) {
+        buildHyp.stop();
+        otherScore.start();
+      }
+      newHypo->EvaluateWhenApplied(pending.estimatedScore);
+      IFVERBOSE(2) {
+        otherScore.stop();
+      }
+      pending.expanded.push_back(newHypo);
+    }
+    pending.timeBuildHyp = buildHyp.get_elapsed_time();
+    pending.timeOtherScore = otherScore.get_elapsed_time();
+  }
+}
+
+/**
+ * Expand all pending hypothesis/span pairs of the current stack on
+ * m_expansionThreads threads, then add the new hypotheses to their stacks
+ * in exactly the order (and with the ids) the serial search would have
+ * used, so that the output does not depend on the number of threads.
+ */
+void
+SearchNormal::
+ExpandPendingInParallel()
+{
+#ifdef WITH_THREADS
+  // partition by source hypothesis, balancing the number of expansions
+  size_t total = 0;
+  for (size_t i = 0; i < m_pending.size(); ++i)
+    total += m_pending[i].tol->size();
+
+  std::vector<size_t> bounds(1, 0);
+  size_t done = 0;
+  for (size_t i = 0; i < m_pending.size(); ++i) {
+    if (i > 0 && bounds.size() < m_expansionThreads
+        && done * m_expansionThreads >= total * bounds.size()
+        && m_pending[i].hypothesis != m_pending[i - 1].hypothesis) {
+      bounds.push_back(i);
+    }
+    done += m_pending[i].tol->size();
+  }
+  bounds.push_back(m_pending.size());
+
+  size_t remaining = bounds.size() - 2;
+  boost::mutex mutex;
+  boost::condition_variable finished;
+  if (remaining) {
+    // the decoding thread takes the first partition itself
+    ThreadPool &pool = ThreadPool::Shared(m_expansionThreads - 1);
+    for (size_t p = 1; p + 1 < bounds.size(); ++p) {
+      boost::shared_ptr<Task> task(new ExpansionTask(*this, bounds[p], bounds[p + 1],
+                                   remaining, mutex, finished));
+      pool.Submit(task);
+    }
+  }
+  ExpandPending(bounds[0], bounds[1]);
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    while (remaining) finished.wait(lock);
+  }
+#else
+  ExpandPending(0, m_pending.size());
+#endif
+
+  SentenceStats &stats = m_manager.GetSentenceStats();
+  for (size_t i = 0; i < m_pending.size(); ++i) {
+    IFVERBOSE(2) {
+      stats.AddTimeBuildHyp(m_pending[i].timeBuildHyp);
+      stats.AddTimeOtherScore(m_pending[i].timeOtherScore);
+    }
+    std::vector<Hypothesis*> &expanded = m_pending[i].expanded;
+    for (size_t j = 0; j < expanded.size(); ++j) {
+      Hypothesis *newHypo = expanded[j];
+      newHypo->SetId(m_manager.GetNextHypoId());
+      IFVERBOSE(3) {
+        newHypo->PrintHypothesis();
+      }
+      size_t wordsTranslated = newHypo->GetWordsBitmap().GetNumWordsCovered();
+      IFVERBOSE(2) {
+        stats.StartTimeStack();
+      }
+      m_hypoStackColl[wordsTranslated]->AddPrune(newHypo);
+      IFVERBOSE(2) {
+        stats.StopTimeStack();
+      }
+    }
+  }
+  m_pending.clear();
+}
+
 /**
  * Expand one hypothesis with a translation option.
  * this involves initial creation, scoring and adding it to the proper stack
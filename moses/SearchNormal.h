@@ -12,6 +12,7 @@ namespace Moses
 
 class Manager;
 class TranslationOptionCollection;
+class ExpansionTask;
 
 /** Functions and variables you need to decoder an input using the
  *  phrase-based decoder (NO cube-pruning)
@@ -19,6 +20,8 @@ class TranslationOptionCollection;
  */
 class SearchNormal: public Search
 {
+  friend class ExpansionTask;
+
 protected:
   //! stacks to store hypotheses (partial translations)
   // no of elements = no of words in source + 1
@@ -48,6 +51,25 @@ protected:
                    float estimatedScore,
                    const Bitmap &bitmap);
 
+  //! one hypothesis/span pair whose expansions are built in parallel
+  struct PendingExpansion {
+    const Hypothesis *hypothesis;
+    const TranslationOptionList *tol;
+    float estimatedScore;
+    const Bitmap *bitmap;
+    std::vector<Hypothesis*> expanded;
+    //! seconds spent building/scoring the expansions (measured if verbose >= 2)
+    double timeBuildHyp, timeOtherScore;
+  };
+
+  //! number of threads expanding one stack (search.expansion_threads)
+  size_t m_expansionThreads;
+  //! expansions of the current stack, in serial order; used if m_expansionThreads > 1
+  std::vector<PendingExpansion> m_pending;
+
+  void ExpandPending(size_t begin, size_t end);
+  void ExpandPendingInParallel();
+
 public:
   SearchNormal(Manager& manager, const TranslationOptionCollection &transOptColl);
   ~SearchNormal();
@@ -0,0 +1,138 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+#include <cstdlib>
+#include <new>
+#include "SentenceArena.h"
+
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#endif
+
+namespace Moses
+{
+
+namespace
+{
+// Every allocation is preceded by a header that records the arena it came
+// from (NULL for heap memory), so that Free() can tell the two apart no
+// matter which arena is active when the object is deleted. The header size
+// keeps the payload aligned as malloc would.
+const size_t kHeaderSize = 16;
+const size_t kMaxBlockSize = 1 << 24;
+
+inline size_t RoundUp(size_t bytes)
+{
+  return (bytes + kHeaderSize - 1) & ~(kHeaderSize - 1);
+}
+
+#ifdef WITH_THREADS
+void NoCleanup(SentenceArena *) {}
+boost::thread_specific_ptr<SentenceArena> s_current(&NoCleanup);
+#else
+SentenceArena *s_current = NULL;
+#endif
+}
+
+SentenceArena::
+SentenceArena(size_t initialBlockSize)
+  : m_cur(NULL)
+  , m_end(NULL)
+  , m_nextBlockSize(RoundUp(initialBlockSize))
+  , m_bytesAllocated(0)
+  , m_bytesReserved(0)
+{ }
+
+SentenceArena::
+~SentenceArena()
+{
+  for (size_t i = 0; i < m_blocks.size(); ++i)
+    std::free(m_blocks[i]);
+}
+
+void
+SentenceArena::
+NewBlock(size_t minSize)
+{
+  size_t size = m_nextBlockSize;
+  while (size < minSize) size *= 2;
+  char *block = static_cast<char*>(std::malloc(size));
+  if (!block) throw std::bad_alloc();
+  m_blocks.push_back(block);
+  m_cur = block;
+  m_end = block + size;
+  m_bytesReserved += size;
+  if (m_nextBlockSize < kMaxBlockSize) m_nextBlockSize *= 2;
+}
+
+void *
+SentenceArena::
+Alloc(size_t bytes)
+{
+  size_t need = kHeaderSize + RoundUp(bytes);
+  if (static_cast<size_t>(m_end - m_cur) < need) NewBlock(need);
+  char *mem = m_cur;
+  m_cur += need;
+  m_bytesAllocated += need;
+  *reinterpret_cast<SentenceArena**>(mem) = this;
+  return mem + kHeaderSize;
+}
+
+void *
+SentenceArena::
+Allocate(size_t bytes)
+{
+  SentenceArena *arena = Current();
+  if (arena) return arena->Alloc(bytes);
+
+  char *mem = static_cast<char*>(std::malloc(kHeaderSize + bytes));
+  if (!mem) throw std::bad_alloc();
+  *reinterpret_cast<SentenceArena**>(mem) = NULL;
+  return mem + kHeaderSize;
+}
+
+void
+SentenceArena::
+Free(void *p)
+{
+  if (!p) return;
+  char *mem = static_cast<char*>(p) - kHeaderSize;
+  // arena memory is reclaimed in bulk by ~SentenceArena()
+  if (*reinterpret_cast<SentenceArena**>(mem) == NULL)
+    std::free(mem);
+}
+
+SentenceArena *
+SentenceArena::
+Current()
+{
+#ifdef WITH_THREADS
+  return s_current.get();
+#else
+  return s_current;
+#endif
+}
+
+void
+SentenceArena::
+SetCurrent(SentenceArena *arena)
+{
+#ifdef WITH_THREADS
+  s_current.reset(arena);
+#else
+  s_current = arena;
+#endif
+}
+
+SentenceArena::Scope::
+Scope(SentenceArena *arena)
+  : m_prev(SentenceArena::Current())
+{
+  SentenceArena::SetCurrent(arena);
+}
+
+SentenceArena::Scope::
+~Scope()
+{
+  SentenceArena::SetCurrent(m_prev);
+}
+
+}
@@ -0,0 +1,101 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_SentenceArena_h
+#define moses_SentenceArena_h
+
+#include <cstddef>
+#include <vector>
+
+namespace Moses
+{
+
+/** Bump allocator owning the memory of the objects created while one
+ * sentence is searched (Hypothesis and FFState in phrase-based decoding).
+ *
+ * Like ObjectPool, memory is taken from the system in large blocks whose
+ * size doubles with every new block. Unlike ObjectPool, the arena serves
+ * objects of any size and never recycles memory: deleting an object
+ * allocated here runs its destructor but does not free anything. All blocks
+ * are released at once when the arena is destroyed, i.e. when the Manager
+ * that owns it goes away at the end of TranslationTask::Run().
+ *
+ * Classes opt in by forwarding their operator new / operator delete to
+ * SentenceArena::Allocate() / SentenceArena::Free(). Allocate() uses the
+ * arena installed for the calling thread with SentenceArena::Scope and
+ * falls back to the heap if there is none, so objects created outside
+ * of search (or on other threads) behave as before.
+ */
+class SentenceArena
+{
+public:
+  explicit SentenceArena(size_t initialBlockSize = 1 << 16);
+  ~SentenceArena();
+
+  //! bump-allocate memory, released when the arena is destroyed
+  void *Alloc(size_t bytes);
+
+  size_t GetBytesAllocated() const {
+    return m_bytesAllocated;
+  }
+  size_t GetBytesReserved() const {
+    return m_bytesReserved;
+  }
+  size_t GetNumBlocks() const {
+    return m_blocks.size();
+  }
+
+  //! allocate from the current thread's arena, or the heap if none is set
+  static void *Allocate(size_t bytes);
+  //! release memory obtained from Allocate(); no-op for arena memory
+  static void Free(void *p);
+
+  static SentenceArena *Current();
+
+  /** installs an arena for the current thread for the lifetime of the
+   * Scope object and restores the previous one afterwards. Passing NULL
+   * disables arena allocation within the scope. */
+  class Scope
+  {
+  public:
+    explicit Scope(SentenceArena *arena);
+    ~Scope();
+  private:
+    SentenceArena *m_prev;
+    Scope(Scope const&);
+    void operator=(Scope const&);
+  };
+
+private:
+  std::vector<char*> m_blocks;
+  char *m_cur, *m_end;
+  size_t m_nextBlockSize;
+  size_t m_bytesAllocated, m_bytesReserved;
+
+  void NewBlock(size_t minSize);
+  static void SetCurrent(SentenceArena *arena);
+
+  SentenceArena(SentenceArena const&);
+  void operator=(SentenceArena const&);
+};
+
+}
+
+#endif
@@ -0,0 +1,70 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/test/unit_test.hpp>
+
+#include "SentenceArena.h"
+
+using namespace Moses;
+
+BOOST_AUTO_TEST_SUITE(sentence_arena)
+
+BOOST_AUTO_TEST_CASE(scope)
+{
+  BOOST_CHECK(SentenceArena::Current() == NULL);
+  {
+    SentenceArena arena;
+    SentenceArena::Scope scope(&arena);
+    BOOST_CHECK(SentenceArena::Current() == &arena);
+    {
+      SentenceArena::Scope off(NULL);
+      BOOST_CHECK(SentenceArena::Current() == NULL);
+    }
+    BOOST_CHECK(SentenceArena::Current() == &arena);
+  }
+  BOOST_CHECK(SentenceArena::Current() == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(allocate)
+{
+  SentenceArena arena(64);
+  void *heap = SentenceArena::Allocate(24);
+  char *p[100];
+  {
+    SentenceArena::Scope scope(&arena);
+    for (size_t i = 0; i < 100; ++i) {
+      p[i] = static_cast<char*>(SentenceArena::Allocate(i + 1));
+      BOOST_CHECK_EQUAL(reinterpret_cast<size_t>(p[i]) % 16, 0);
+      for (size_t j = 0; j <= i; ++j) p[i][j] = static_cast<char>(i);
+    }
+  }
+  for (size_t i = 0; i < 100; ++i) {
+    for (size_t j = 0; j <= i; ++j)
+      BOOST_CHECK_EQUAL(p[i][j], static_cast<char>(i));
+    SentenceArena::Free(p[i]);
+  }
+  BOOST_CHECK(arena.GetNumBlocks() > 1);
+  BOOST_CHECK(arena.GetBytesAllocated() <= arena.GetBytesReserved());
+
+  // heap memory is freed no matter which arena is current
+  SentenceArena::Scope scope(&arena);
+  SentenceArena::Free(heap);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -176,6 +176,9 @@ public:
   void StopTimeBuildHyp() {
     m_timeBuildHyp.stop();
   }
+  void AddTimeBuildHyp(double seconds) {
+    m_timeBuildHyp.add(seconds);
+  }
   void StartTimeCalcLM() {
     m_timeCalcLM.start();
   }
@@ -188,6 +191,9 @@ public:
   void StopTimeOtherScore() {
     m_timeOtherScore.stop();
   }
+  void AddTimeOtherScore(double seconds) {
+    m_timeOtherScore.add(seconds);
+  }
   void StartTimeEstimateScore() {
     m_timeEstimateScore.start();
   }
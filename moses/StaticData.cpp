@@ -38,6 +38,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "StaticData.h"
 #include "Util.h"
 #include "FactorCollection.h"
+#include "ModelSnapshot.h"
 #include "Timer.h"
 #include "TranslationOption.h"
 #include "DecodeGraph.h"
@@ -171,6 +172,8 @@ StaticData
 #endif
     }
   }
+  m_parameter->SetParameter(m_workStealing, "work-stealing", false);
+  m_parameter->SetParameter(m_pinThreads, "pin-threads", false);
   return true;
 }
 
@@ -209,9 +212,16 @@ bool StaticData::LoadData(Parameter *parameter)
 
   initialize_features();
 
-  if (m_parameter->GetParam("show-weights") == NULL)
+  if (m_parameter->GetParam("show-weights") == NULL) {
+    string snapshotPath;
+    m_parameter->SetParameter<string>(snapshotPath, "model-snapshot", "");
+    if (!snapshotPath.empty()) m_modelSnapshot.reset(new ModelSnapshot(snapshotPath));
+
     LoadFeatureFunctions();
 
+    if (m_modelSnapshot) m_modelSnapshot->Save();
+  }
+
   LoadDecodeGraphs();
 
   // sanity check that there are no weights without an associated FF
@@ -247,6 +257,11 @@ bool StaticData::LoadData(Parameter *parameter)
   if (params && params->size() && !LoadAlternateWeightSettings())
     return false;
 
+  // all names of the model and the weights are known now
+  bool freezeFeatureNames;
+  m_parameter->SetParameter(freezeFeatureNames, "freeze-feature-names", false);
+  if (freezeFeatureNames) FName::freeze();
+
   return true;
 }
 
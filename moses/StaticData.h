@@ -56,6 +56,7 @@ class DecodeStep;
 
 class DynamicCacheBasedLanguageModel;
 class PhraseDictionaryDynamicCacheBased;
+class ModelSnapshot;
 
 typedef std::pair<std::string, float> UnknownLHSEntry;
 typedef std::vector<UnknownLHSEntry>  UnknownLHSList;
@@ -111,6 +112,9 @@ protected:
   UnknownLHSList m_unknownLHS;
 
   int m_threadCount;
+  bool m_workStealing; //! use work-stealing ThreadPool
+  bool m_pinThreads; //! bind ThreadPool workers to cores
+  boost::shared_ptr<ModelSnapshot> m_modelSnapshot; //! warm start image of the rule tables, if any
   // long m_startTranslationId;
 
   // alternate weight settings
@@ -258,6 +262,17 @@ public:
   int ThreadCount() const {
     return m_threadCount;
   }
+  bool UseWorkStealing() const {
+    return m_workStealing;
+  }
+  bool PinThreads() const {
+    return m_pinThreads;
+  }
+
+  //! the -model-snapshot image that rule tables are loaded from and saved to, or NULL
+  ModelSnapshot *GetModelSnapshot() const {
+    return m_modelSnapshot.get();
+  }
 
   void SetExecPath(const std::string &path);
   const std::string &GetBinDirectory() const;
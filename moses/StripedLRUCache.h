@@ -0,0 +1,210 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_StripedLRUCache_h
+#define moses_StripedLRUCache_h
+
+#include <list>
+#include <ostream>
+#include <vector>
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+namespace Moses
+{
+
+/** Counters of a StripedLRUCache, summed over all stripes. */
+struct StripedLRUCacheStats {
+  size_t entries, bytes;
+  size_t hits, misses, evictions;
+
+  StripedLRUCacheStats()
+    : entries(0), bytes(0), hits(0), misses(0), evictions(0) {}
+};
+
+inline std::ostream &operator<<(std::ostream &out,
+                                StripedLRUCacheStats const &stats)
+{
+  size_t lookups = stats.hits + stats.misses;
+  out << stats.entries << " entries, " << stats.bytes << " bytes, "
+      << stats.hits << " hits, " << stats.misses << " misses";
+  if (lookups)
+    out << " (" << (100.0 * stats.hits / lookups) << "% hit rate)";
+  out << ", " << stats.evictions << " evictions";
+  return out;
+}
+
+/** Process-wide key/value cache with least-recently-used eviction, safe to
+ * share between decoding threads.
+ *
+ * Keys are spread over a fixed number of stripes by their hash; each stripe
+ * is an independent LRU list guarded by its own mutex, so threads only
+ * contend when they touch the same stripe. The capacity is given as a number
+ * of entries and, optionally, a number of bytes (as estimated by the caller
+ * on Insert()); both are divided evenly among the stripes and enforced when
+ * inserting. A limit of 0 means unlimited.
+ *
+ * Values are handed out by copy, so they should be cheap to copy, e.g.
+ * shared pointers to immutable data.
+ */
+template<typename Key, typename Value, typename Hash = boost::hash<Key> >
+class StripedLRUCache
+{
+public:
+  explicit StripedLRUCache(size_t maxEntries = 0, size_t maxBytes = 0,
+                           size_t numStripes = 32)
+    : m_stripes(numStripes ? numStripes : 1) {
+    SetCapacity(maxEntries, maxBytes);
+  }
+
+  //! not thread-safe; call before the cache is shared
+  void SetCapacity(size_t maxEntries, size_t maxBytes) {
+    size_t n = m_stripes.size();
+    m_maxEntriesPerStripe = maxEntries ? (maxEntries + n - 1) / n : 0;
+    m_maxBytesPerStripe = maxBytes ? (maxBytes + n - 1) / n : 0;
+  }
+
+  //! copy the cached value for key into value and mark it most recently used
+  bool Find(Key const &key, Value &value) {
+    Stripe &s = GetStripe(key);
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(s.mutex);
+#endif
+    typename Stripe::Index::iterator it = s.index.find(key);
+    if (it == s.index.end()) {
+      ++s.misses;
+      return false;
+    }
+    ++s.hits;
+    s.lru.splice(s.lru.begin(), s.lru, it->second);
+    value = it->second->value;
+    return true;
+  }
+
+  /** add or replace the value for key; bytes is the caller's estimate of
+   * the memory held by the entry. Evicts least recently used entries of the
+   * same stripe while it is over budget, but never the new entry itself. */
+  void Insert(Key const &key, Value const &value, size_t bytes = 0) {
+    Stripe &s = GetStripe(key);
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(s.mutex);
+#endif
+    typename Stripe::Index::iterator it = s.index.find(key);
+    if (it != s.index.end()) {
+      Entry &entry = *it->second;
+      s.bytes = s.bytes - entry.bytes + bytes;
+      entry.value = value;
+      entry.bytes = bytes;
+      s.lru.splice(s.lru.begin(), s.lru, it->second);
+    } else {
+      s.lru.push_front(Entry(key, value, bytes));
+      s.index[key] = s.lru.begin();
+      s.bytes += bytes;
+    }
+
+    while (s.lru.size() > 1
+           && ((m_maxEntriesPerStripe && s.lru.size() > m_maxEntriesPerStripe)
+               || (m_maxBytesPerStripe && s.bytes > m_maxBytesPerStripe))) {
+      Entry &victim = s.lru.back();
+      s.bytes -= victim.bytes;
+      s.index.erase(victim.key);
+      s.lru.pop_back();
+      ++s.evictions;
+    }
+  }
+
+  void Clear() {
+    for (size_t i = 0; i < m_stripes.size(); ++i) {
+      Stripe &s = m_stripes[i];
+#ifdef WITH_THREADS
+      boost::mutex::scoped_lock lock(s.mutex);
+#endif
+      s.lru.clear();
+      s.index.clear();
+      s.bytes = 0;
+    }
+  }
+
+  StripedLRUCacheStats GetStats() const {
+    StripedLRUCacheStats ret;
+    for (size_t i = 0; i < m_stripes.size(); ++i) {
+      Stripe const &s = m_stripes[i];
+#ifdef WITH_THREADS
+      boost::mutex::scoped_lock lock(s.mutex);
+#endif
+      ret.entries += s.lru.size();
+      ret.bytes += s.bytes;
+      ret.hits += s.hits;
+      ret.misses += s.misses;
+      ret.evictions += s.evictions;
+    }
+    return ret;
+  }
+
+private:
+  struct Entry {
+    Key key;
+    Value value;
+    size_t bytes;
+    Entry(Key const &k, Value const &v, size_t b)
+      : key(k), value(v), bytes(b) {}
+  };
+
+  struct Stripe {
+    typedef std::list<Entry> List;
+    typedef boost::unordered_map<Key, typename List::iterator, Hash> Index;
+
+    List lru; // most recently used first
+    Index index;
+    size_t bytes;
+    size_t hits, misses, evictions;
+#ifdef WITH_THREADS
+    mutable boost::mutex mutex;
+#endif
+
+    Stripe() : bytes(0), hits(0), misses(0), evictions(0) {}
+    // boost::mutex is not copyable; stripes are only copied while empty,
+    // when the vector is created
+    Stripe(Stripe const &) : bytes(0), hits(0), misses(0), evictions(0) {}
+  };
+
+  std::vector<Stripe> m_stripes;
+  size_t m_maxEntriesPerStripe, m_maxBytesPerStripe;
+
+  Stripe &GetStripe(Key const &key) {
+    // mix the hash so that stripes and the per-stripe buckets do not both
+    // key off the same low bits
+    size_t h = Hash()(key);
+    h ^= h >> 17;
+    h *= 0x9E3779B1u;
+    return m_stripes[(h >> 7) % m_stripes.size()];
+  }
+
+  StripedLRUCache(StripedLRUCache const&);
+  void operator=(StripedLRUCache const&);
+};
+
+}
+
+#endif
@@ -0,0 +1,88 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/test/unit_test.hpp>
+
+#include "StripedLRUCache.h"
+
+using namespace Moses;
+
+BOOST_AUTO_TEST_SUITE(striped_lru_cache)
+
+BOOST_AUTO_TEST_CASE(find_insert)
+{
+  StripedLRUCache<size_t, int> cache(100);
+  int value = 0;
+  BOOST_CHECK(!cache.Find(1, value));
+  cache.Insert(1, 10);
+  cache.Insert(2, 20);
+  BOOST_CHECK(cache.Find(1, value));
+  BOOST_CHECK_EQUAL(value, 10);
+  cache.Insert(1, 11);
+  BOOST_CHECK(cache.Find(1, value));
+  BOOST_CHECK_EQUAL(value, 11);
+
+  StripedLRUCacheStats stats = cache.GetStats();
+  BOOST_CHECK_EQUAL(stats.entries, 2);
+  BOOST_CHECK_EQUAL(stats.hits, 2);
+  BOOST_CHECK_EQUAL(stats.misses, 1);
+  BOOST_CHECK_EQUAL(stats.evictions, 0);
+
+  cache.Clear();
+  BOOST_CHECK(!cache.Find(2, value));
+  BOOST_CHECK_EQUAL(cache.GetStats().entries, 0);
+}
+
+BOOST_AUTO_TEST_CASE(lru_eviction)
+{
+  // a single stripe makes the eviction order fully predictable
+  StripedLRUCache<size_t, int> cache(3, 0, 1);
+  cache.Insert(1, 1);
+  cache.Insert(2, 2);
+  cache.Insert(3, 3);
+  int value;
+  BOOST_CHECK(cache.Find(1, value)); // 2 is now least recently used
+  cache.Insert(4, 4);
+  BOOST_CHECK(!cache.Find(2, value));
+  BOOST_CHECK(cache.Find(1, value));
+  BOOST_CHECK(cache.Find(3, value));
+  BOOST_CHECK(cache.Find(4, value));
+  BOOST_CHECK_EQUAL(cache.GetStats().evictions, 1);
+}
+
+BOOST_AUTO_TEST_CASE(byte_budget)
+{
+  StripedLRUCache<size_t, int> cache(0, 100, 1);
+  cache.Insert(1, 1, 40);
+  cache.Insert(2, 2, 40);
+  BOOST_CHECK_EQUAL(cache.GetStats().bytes, 80);
+  cache.Insert(3, 3, 40);
+  StripedLRUCacheStats stats = cache.GetStats();
+  BOOST_CHECK_EQUAL(stats.entries, 2);
+  BOOST_CHECK_EQUAL(stats.bytes, 80);
+  int value;
+  BOOST_CHECK(!cache.Find(1, value));
+
+  // an entry over budget on its own is still kept
+  cache.Insert(4, 4, 500);
+  BOOST_CHECK(cache.Find(4, value));
+  BOOST_CHECK_EQUAL(cache.GetStats().entries, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -199,6 +199,31 @@ void TargetPhrase::EvaluateInIsolation(const Phrase &source, const std::vector<F
   }
 }
 
+void
+TargetPhrase::
+EvaluateInIsolation(const std::vector<const Phrase*> &sources,
+                    const std::vector<TargetPhrase*> &targetPhrases,
+                    const std::vector<FeatureFunction*> &ffs)
+{
+  if (ffs.empty() || targetPhrases.empty()) return;
+
+  const StaticData &staticData = StaticData::Instance();
+  std::vector<ScoreComponentCollection> estimatedScores(targetPhrases.size());
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    const FeatureFunction &ff = *ffs[i];
+    if (! staticData.IsFeatureFunctionIgnored( ff )) {
+      ff.EvaluateInIsolationBatch(sources, targetPhrases, estimatedScores);
+    }
+  }
+
+  for (size_t i = 0; i < targetPhrases.size(); ++i) {
+    TargetPhrase &tp = *targetPhrases[i];
+    float weightedScore = tp.m_scoreBreakdown.GetWeightedScore();
+    tp.m_estimatedScore += estimatedScores[i].GetWeightedScore();
+    tp.m_futureScore = weightedScore + tp.m_estimatedScore;
+  }
+}
+
 void TargetPhrase::EvaluateWithSourceContext(const InputType &input, const InputPath &inputPath)
 {
   const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
@@ -105,6 +105,13 @@ public:
   // Used only for OOV processing. Doesn't have a phrase table connect with it
   void EvaluateInIsolation(const Phrase &source);
 
+  // as the 1st method, for many target phrases at once so that feature
+  // functions can share work between them. sources[i] is the source phrase
+  // of targetPhrases[i].
+  static void EvaluateInIsolation(const std::vector<const Phrase*> &sources,
+                                  const std::vector<TargetPhrase*> &targetPhrases,
+                                  const std::vector<FeatureFunction*> &ffs);
+
   // 'inputPath' is guaranteed to be the raw substring from the input. No factors were added or taken away
   void EvaluateWithSourceContext(const InputType &input, const InputPath &inputPath);
 
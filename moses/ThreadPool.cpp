@@ -20,6 +20,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 
+#include <deque>
+#include <map>
+
 #include "ThreadPool.h"
 
 #ifdef WITH_THREADS
@@ -30,16 +33,78 @@ using namespace Moses;
 namespace Moses
 {
 
-ThreadPool::ThreadPool( size_t numThreads )
+struct ThreadPool::Worker {
+  ThreadPool *pool;
+  size_t id;
+  WorkStealingDeque<TaskPtr> deque;  // jobs submitted by this worker
+  boost::mutex inboxMutex;
+  std::deque<TaskPtr*> inbox;        // jobs submitted from outside the pool
+
+  Worker(ThreadPool *p, size_t i) : pool(p), id(i) {}
+};
+
+boost::thread_specific_ptr<ThreadPool::Worker>
+ThreadPool::s_currentWorker(&ThreadPool::NoCleanup);
+
+ThreadPool::ThreadPool( size_t numThreads, bool workStealing, bool pinThreads )
   : m_stopped(false), m_stopping(false), m_queueLimit(0)
+  , m_pinThreads(pinThreads)
+  , m_queued(0), m_unfinished(0), m_sleeping(0), m_nextInbox(0)
+  , m_closed(false), m_halt(false)
 {
+  if (workStealing) {
+    for (size_t i = 0; i < numThreads; ++i) {
+      m_workers.push_back(new Worker(this, i));
+    }
+    for (size_t i = 0; i < numThreads; ++i) {
+      m_threads.create_thread(boost::bind(&ThreadPool::ExecuteStealing,this,i));
+    }
+    return;
+  }
   for (size_t i = 0; i < numThreads; ++i) {
-    m_threads.create_thread(boost::bind(&ThreadPool::Execute,this));
+    m_threads.create_thread(boost::bind(&ThreadPool::Execute,this,i));
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  Stop();
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    delete m_workers[i];
+  }
+}
+
+namespace
+{
+boost::mutex s_sharedPoolsMutex;
+std::map<size_t, boost::shared_ptr<ThreadPool> > s_sharedPools;
+}
+
+ThreadPool &ThreadPool::Shared(size_t numThreads)
+{
+  boost::mutex::scoped_lock lock(s_sharedPoolsMutex);
+  boost::shared_ptr<ThreadPool> &pool = s_sharedPools[numThreads];
+  if (!pool) pool.reset(new ThreadPool(numThreads));
+  return *pool;
+}
+
+void ThreadPool::PinThread(size_t i)
+{
+#if defined(__linux__) && defined(BOOST_HAS_PTHREADS)
+  size_t cores = boost::thread::hardware_concurrency();
+  if (!cores) return;
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(i % cores, &cpus);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) {
+    cerr << "ThreadPool: unable to pin thread " << i << " to a core" << endl;
   }
+#endif
 }
 
-void ThreadPool::Execute()
+void ThreadPool::Execute(size_t i)
 {
+  if (m_pinThreads) PinThread(i);
   do {
     boost::shared_ptr<Task> task;
     {
@@ -61,8 +126,82 @@ void ThreadPool::Execute()
   } while (!m_stopped);
 }
 
+void ThreadPool::ExecuteStealing(size_t i)
+{
+  Worker &self = *m_workers[i];
+  s_currentWorker.reset(&self);
+  if (m_pinThreads) PinThread(i);
+  while (!m_halt.load()) {
+    TaskPtr *task = FindTask(self);
+    if (task) {
+      m_queued.fetch_sub(1);
+      if (m_queueLimit > 0) {
+        // someone may be waiting in Submit()
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_threadAvailable.notify_all();
+      }
+      (*task)->Run();
+      delete task;
+      if (m_unfinished.fetch_sub(1) == 1 && m_closed.load()) {
+        // Stop() may be waiting for the last job to finish
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_threadAvailable.notify_all();
+      }
+      continue;
+    }
+    if (m_queued.load() > 0) {
+      // a job exists but we lost the race for it; look again
+      boost::this_thread::yield();
+      continue;
+    }
+    // Nothing to do: sleep until a job is submitted. Submitters bump
+    // m_queued before reading m_sleeping, we bump m_sleeping before
+    // reading m_queued, so at least one of us sees the other.
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_sleeping.fetch_add(1);
+    while (m_queued.load() <= 0 && !m_halt.load()) {
+      m_threadNeeded.wait(lock);
+    }
+    m_sleeping.fetch_sub(1);
+  }
+  s_currentWorker.reset();
+}
+
+ThreadPool::TaskPtr *ThreadPool::FindTask(Worker &self)
+{
+  // own jobs first, newest first (cache-warm), then own inbox
+  TaskPtr *task = self.deque.Pop();
+  if (task) return task;
+  {
+    boost::mutex::scoped_lock lock(self.inboxMutex);
+    if (!self.inbox.empty()) {
+      task = self.inbox.front();
+      self.inbox.pop_front();
+      return task;
+    }
+  }
+  // steal, oldest first
+  size_t n = m_workers.size();
+  for (size_t k = 1; k < n; ++k) {
+    Worker &victim = *m_workers[(self.id + k) % n];
+    task = victim.deque.Steal();
+    if (task) return task;
+    boost::unique_lock<boost::mutex> lock(victim.inboxMutex, boost::try_to_lock);
+    if (lock.owns_lock() && !victim.inbox.empty()) {
+      task = victim.inbox.front();
+      victim.inbox.pop_front();
+      return task;
+    }
+  }
+  return NULL;
+}
+
 void ThreadPool::Submit(boost::shared_ptr<Task> task)
 {
+  if (!m_workers.empty()) {
+    SubmitStealing(task);
+    return;
+  }
   boost::mutex::scoped_lock lock(m_mutex);
   if (m_stopping) {
     throw runtime_error("ThreadPool stopping - unable to accept new jobs");
@@ -74,8 +213,48 @@ void ThreadPool::Submit(boost::shared_ptr<Task> task)
   m_threadNeeded.notify_all();
 }
 
+void ThreadPool::SubmitStealing(boost::shared_ptr<Task> task)
+{
+  Worker *self = s_currentWorker.get();
+  if (self && self->pool != this) self = NULL;
+
+  // running jobs may still spawn sub-jobs while the pool drains
+  if (m_closed.load() && !self) {
+    throw runtime_error("ThreadPool stopping - unable to accept new jobs");
+  }
+
+  // the queue limit only throttles outside producers; a worker waiting
+  // for its own pool to drain could deadlock
+  if (!self && m_queueLimit > 0
+      && m_queued.load() >= static_cast<long>(m_queueLimit)) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_queued.load() >= static_cast<long>(m_queueLimit)) {
+      m_threadAvailable.wait(lock);
+    }
+  }
+
+  TaskPtr *item = new TaskPtr(task);
+  m_unfinished.fetch_add(1);
+  if (self) {
+    self->deque.Push(item);
+  } else {
+    Worker &w = *m_workers[m_nextInbox.fetch_add(1) % m_workers.size()];
+    boost::mutex::scoped_lock lock(w.inboxMutex);
+    w.inbox.push_back(item);
+  }
+  m_queued.fetch_add(1);
+  if (m_sleeping.load() > 0) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_threadNeeded.notify_one();
+  }
+}
+
 void ThreadPool::Stop(bool processRemainingJobs)
 {
+  if (!m_workers.empty()) {
+    StopStealing(processRemainingJobs);
+    return;
+  }
   {
     //prevent more jobs from being added to the queue
     boost::mutex::scoped_lock lock(m_mutex);
@@ -99,6 +278,41 @@ void ThreadPool::Stop(bool processRemainingJobs)
   m_threads.join_all();
 }
 
+void ThreadPool::StopStealing(bool processRemainingJobs)
+{
+  {
+    //prevent more jobs from being added to the queues
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_stopped) return;
+    m_stopping = true;
+    m_closed.store(true);
+  }
+  if (processRemainingJobs) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    //wait for all jobs, including those they spawn, to finish.
+    while (m_unfinished.load() > 0) {
+      m_threadAvailable.wait(lock);
+    }
+  }
+  //tell all threads to stop
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_stopped = true;
+    m_halt.store(true);
+  }
+  m_threadNeeded.notify_all();
+
+  m_threads.join_all();
+
+  // discard jobs that were never started
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    Worker &w = *m_workers[i];
+    while (TaskPtr *task = w.deque.Pop()) delete task;
+    for (size_t j = 0; j < w.inbox.size(); ++j) delete w.inbox[j];
+    w.inbox.clear();
+  }
+}
+
 }
 #endif //WITH_THREADS
 
@@ -31,6 +31,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifdef WITH_THREADS
 #include <boost/bind.hpp>
 #include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+#include "WorkStealingDeque.h"
 #endif
 
 #ifdef BOOST_HAS_PTHREADS
@@ -63,12 +65,27 @@ class ThreadPool
 public:
   /**
    * Construct a thread pool of a fixed size.
+   *
+   * By default all jobs go through one shared, mutex-protected queue.
+   * With workStealing, every worker owns a deque: jobs submitted from
+   * a worker (e.g. sub-tasks of a running job) are pushed onto its own
+   * deque without locking, jobs submitted from outside are spread
+   * round-robin over per-worker inboxes, and idle workers steal from
+   * the others. With pinThreads, worker i is bound to core
+   * i mod (number of cores) where the platform supports it.
    **/
-  explicit ThreadPool(size_t numThreads);
+  explicit ThreadPool(size_t numThreads, bool workStealing = false,
+                      bool pinThreads = false);
 
-  ~ThreadPool() {
-    Stop();
-  }
+  ~ThreadPool();
+
+  /**
+   * A process-wide pool with numThreads workers, created on first use
+   * and kept until exit. Callers asking for the same number of workers
+   * share one pool, so different sentences (or components) may use
+   * different thread counts without resizing each other's pool.
+   **/
+  static ThreadPool &Shared(size_t numThreads);
 
   /**
    * Add a job to the threadpool.
@@ -90,9 +107,23 @@ public:
 
 private:
   /**
-   * The main loop executed by each thread.
+   * The main loop executed by thread i.
    **/
-  void Execute();
+  void Execute(size_t i);
+
+  /**
+   * The main loop of worker i in work-stealing mode.
+   **/
+  void ExecuteStealing(size_t i);
+
+  struct Worker;
+  typedef boost::shared_ptr<Task> TaskPtr;
+  void SubmitStealing(boost::shared_ptr<Task> task);
+  TaskPtr *FindTask(Worker &self);
+  void StopStealing(bool processRemainingJobs);
+  static void PinThread(size_t i);
+  static void NoCleanup(Worker *) {}
+  static boost::thread_specific_ptr<Worker> s_currentWorker;
 
   std::queue<boost::shared_ptr<Task> > m_tasks;
   boost::thread_group m_threads;
@@ -102,6 +133,16 @@ private:
   bool m_stopped;
   bool m_stopping;
   size_t m_queueLimit;
+  bool m_pinThreads;
+
+  // work-stealing mode
+  std::vector<Worker*> m_workers;
+  boost::atomic<long> m_queued;     // submitted but not yet started
+  boost::atomic<long> m_unfinished; // submitted but not yet finished
+  boost::atomic<long> m_sleeping;   // workers waiting on m_threadNeeded
+  boost::atomic<size_t> m_nextInbox;
+  boost::atomic<bool> m_closed;     // mirrors m_stopping for lock-free reads
+  boost::atomic<bool> m_halt;       // mirrors m_stopped for lock-free reads
 };
 
 class TestTask : public Task
@@ -0,0 +1,104 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/test/unit_test.hpp>
+
+#include "ThreadPool.h"
+
+#ifdef WITH_THREADS
+
+using namespace Moses;
+
+namespace
+{
+class CountTask : public Task
+{
+public:
+  CountTask(boost::atomic<int> &count, ThreadPool *pool, int children)
+    : m_count(count), m_pool(pool), m_children(children) {}
+
+  virtual void Run() {
+    ++m_count;
+    // submit sub-tasks from inside the pool
+    for (int i = 0; i < m_children; ++i) {
+      boost::shared_ptr<Task> t(new CountTask(m_count, NULL, 0));
+      m_pool->Submit(t);
+    }
+  }
+
+private:
+  boost::atomic<int> &m_count;
+  ThreadPool *m_pool;
+  int m_children;
+};
+
+void RunJobs(bool workStealing, size_t queueLimit, int children)
+{
+  boost::atomic<int> count(0);
+  ThreadPool pool(4, workStealing);
+  pool.SetQueueLimit(queueLimit);
+  for (int i = 0; i < 500; ++i) {
+    boost::shared_ptr<Task> t(new CountTask(count, &pool, children));
+    pool.Submit(t);
+  }
+  pool.Stop(true);
+  BOOST_CHECK_EQUAL(count.load(), 500 * (children + 1));
+}
+}
+
+BOOST_AUTO_TEST_SUITE(thread_pool)
+
+BOOST_AUTO_TEST_CASE(single_queue)
+{
+  RunJobs(false, 0, 0);
+  RunJobs(false, 8, 0);
+}
+
+BOOST_AUTO_TEST_CASE(work_stealing)
+{
+  // sub-tasks may be submitted even while Stop() drains the pool
+  RunJobs(true, 0, 3);
+  RunJobs(true, 8, 3);
+}
+
+BOOST_AUTO_TEST_CASE(shared_per_size)
+{
+  // a later caller asking for more workers must not get the first pool
+  ThreadPool &two = ThreadPool::Shared(2);
+  BOOST_CHECK(&ThreadPool::Shared(2) == &two);
+  BOOST_CHECK(&ThreadPool::Shared(3) != &two);
+}
+
+BOOST_AUTO_TEST_CASE(deque)
+{
+  WorkStealingDeque<int> dq(2);
+  int items[100];
+  for (int i = 0; i < 100; ++i) dq.Push(&items[i]);
+  BOOST_CHECK(dq.Steal() == &items[0]);
+  BOOST_CHECK(dq.Pop() == &items[99]);
+  int n = 2;
+  while (dq.Pop()) ++n;
+  BOOST_CHECK_EQUAL(n, 100);
+  BOOST_CHECK(dq.Empty());
+  BOOST_CHECK(dq.Steal() == NULL);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
@@ -85,6 +85,23 @@ void Timer::stop(const char* msg)
   stopped = true;
 }
 
+/***
+ * Add time measured elsewhere (e.g. by a timer on another thread),
+ * as if this timer had been running that much longer.
+ */
+void Timer::add(double seconds)
+{
+  // A timer that was never started becomes a stopped one
+  if (!running) {
+    start_time = 0;
+    stop_time = seconds;
+    running = true;
+    stopped = true;
+    return;
+  }
+  start_time -= seconds;
+}
+
 /***
  * Print out an optional message followed by the current timer timing.
  */
@@ -51,6 +51,7 @@ public:
   void start(const char* msg = 0);
   void stop(const char* msg = 0);
   void check(const char* msg = 0);
+  void add(double seconds);
   double get_elapsed_time() const;
 };
 
@@ -39,6 +39,8 @@ BlockHashIndex::BlockHashIndex(size_t orderBits, size_t fingerPrintBits,
     m_lastSaved(-1), m_lastDropped(-1), m_numLoadedRanges(0),
     m_threadPool(threadsNum)
 {
+  // each queued range holds a copy of its keys
+  m_threadPool.SetQueueLimit(2 * threadsNum);
 #ifndef HAVE_CMPH
   std::cerr << "minphr: CMPH support not compiled in." << std::endl;
   exit(1);
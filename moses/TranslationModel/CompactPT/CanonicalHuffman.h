@@ -24,9 +24,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <string>
 #include <algorithm>
+#include <cstring>
+#include <stdint.h>
 #include <boost/dynamic_bitset.hpp>
+#include <boost/type_traits/make_unsigned.hpp>
 #include <boost/unordered_map.hpp>
 
+#include "util/bit_packing.hh"
 #include "ThrowingFwrite.h"
 
 namespace Moses
@@ -43,6 +47,21 @@ private:
   typedef boost::unordered_map<Data, boost::dynamic_bitset<> > EncodeMap;
   EncodeMap m_encodeMap;
 
+  // Decoding table indexed by the next m_tableBits bits of the stream, in
+  // stream order (the first bit is the least significant one). If a code
+  // fits into these bits, length is its length and index the position of
+  // its symbol in m_symbols. Otherwise length is 0 and index is the integer
+  // value of the m_tableBits long prefix.
+  struct TableEntry {
+    uint32_t index;
+    uint32_t length;
+  };
+  std::vector<TableEntry> m_decodeTable;
+  size_t m_tableBits;
+  size_t m_maxLength;
+
+  static const size_t kMaxTableBits = 10;
+
   struct MinHeapSorter {
     std::vector<size_t>& m_vec;
 
@@ -163,6 +182,44 @@ private:
     return it->second;
   }
 
+  void CreateDecodeTable() {
+    m_decodeTable.clear();
+    m_tableBits = m_maxLength = 0;
+    if(m_firstCodes.size() < 2)
+      return;
+
+    m_maxLength = m_firstCodes.size() - 1;
+    m_tableBits = m_maxLength < kMaxTableBits ? m_maxLength : kMaxTableBits;
+    m_decodeTable.resize(size_t(1) << m_tableBits);
+
+    for(size_t bits = 0; bits < m_decodeTable.size(); bits++) {
+      // same walk as ReadBitwise, with the bits taken from the index
+      size_t intCode = bits & 1;
+      size_t len = 1;
+      while(len < m_tableBits && intCode < m_firstCodes[len]) {
+        intCode = 2 * intCode + ((bits >> len) & 1);
+        len++;
+      }
+
+      TableEntry &entry = m_decodeTable[bits];
+      if(intCode < m_firstCodes[len]) {
+        entry.index = intCode;
+        entry.length = 0;
+      } else {
+        entry.index = m_lengthIndex[len] + (intCode - m_firstCodes[len]);
+        entry.length = len;
+      }
+    }
+  }
+
+  static uint32_t ReverseBits(uint32_t x) {
+    x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+    x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F) | ((x & 0x0F0F0F0F) << 4);
+    x = ((x >> 8) & 0x00FF00FF) | ((x & 0x00FF00FF) << 8);
+    return (x >> 16) | (x << 16);
+  }
+
   template <class BitWrapper>
   void PutCode(BitWrapper& bitWrapper, const boost::dynamic_bitset<>& code) {
     for(int j = code.size()-1; j >= 0; j--)
@@ -176,6 +233,7 @@ public:
     std::vector<size_t> lengths;
     CalcLengths(begin, end, lengths);
     CalcCodes(lengths);
+    CreateDecodeTable();
 
     if(forEncoding)
       CreateCodeMap();
@@ -183,6 +241,7 @@ public:
 
   CanonicalHuffman(std::FILE* pFile, bool forEncoding = false) {
     Load(pFile);
+    CreateDecodeTable();
 
     if(forEncoding)
       CreateCodeMap();
@@ -193,8 +252,39 @@ public:
     PutCode(bitWrapper, Encode(data));
   }
 
+  /** decode the next symbol: codes of up to kMaxTableBits bits with a
+   * single table lookup, longer ones from one read of all their bits */
   template <class BitWrapper>
   Data Read(BitWrapper& bitWrapper) {
+    if(bitWrapper.TellFromEnd()) {
+      const TableEntry &entry = m_decodeTable[bitWrapper.Peek(m_tableBits)];
+      if(entry.length) {
+        bitWrapper.Skip(entry.length);
+        return m_symbols[entry.index];
+      }
+
+      if(m_maxLength > 32)
+        return ReadBitwise(bitWrapper);
+
+      // A longer code: take all the bits it can have at once, turn them
+      // around so that the first one is the most significant, and find the
+      // length by comparing ever longer prefixes with the first codes.
+      uint32_t bits = ReverseBits(bitWrapper.Peek(m_maxLength)) >> (32 - m_maxLength);
+      size_t len = m_tableBits + 1;
+      size_t intCode = bits >> (m_maxLength - len);
+      while(intCode < m_firstCodes[len]) {
+        len++;
+        intCode = bits >> (m_maxLength - len);
+      }
+      bitWrapper.Skip(len);
+      return m_symbols[m_lengthIndex[len] + (intCode - m_firstCodes[len])];
+    }
+    return Data();
+  }
+
+  //! decode the next symbol one bit at a time
+  template <class BitWrapper>
+  Data ReadBitwise(BitWrapper& bitWrapper) {
     if(bitWrapper.TellFromEnd()) {
       size_t intCode = bitWrapper.Read();
       size_t len = 1;
@@ -250,10 +340,9 @@ template <class Container = std::string>
 class BitWrapper
 {
 private:
-  Container& m_data;
+  typedef typename boost::make_unsigned<typename Container::value_type>::type Value;
 
-  typename Container::iterator m_iterator;
-  typename Container::value_type m_currentValue;
+  Container& m_data;
 
   size_t m_valueBits;
   typename Container::value_type m_mask;
@@ -262,19 +351,44 @@ private:
 public:
 
   BitWrapper(Container &data)
-    : m_data(data), m_iterator(m_data.begin()), m_currentValue(0),
+    : m_data(data),
       m_valueBits(sizeof(typename Container::value_type) * 8),
       m_mask(1), m_bitPos(0) { }
 
   bool Read() {
-    if(m_bitPos % m_valueBits == 0) {
-      if(m_iterator != m_data.end())
-        m_currentValue = *m_iterator++;
-    } else
-      m_currentValue = m_currentValue >> 1;
+    size_t index = m_bitPos / m_valueBits;
+    bool bit = false;
+    if(index < m_data.size())
+      bit = (static_cast<Value>(m_data[index]) >> (m_bitPos % m_valueBits)) & 1;
 
     m_bitPos++;
-    return (m_currentValue & m_mask);
+    return bit;
+  }
+
+  /** the next bits (at most 32) without consuming them, the first one as
+   * the least significant bit. Bits past the end are zero. The bits are
+   * gathered a whole value at a time rather than bit by bit, which assumes
+   * values of at most 32 bits; bytes are read as one 64 bit word where the
+   * byte order allows it. */
+  size_t Peek(size_t bits) const {
+    size_t index = m_bitPos / m_valueBits;
+    size_t shift = m_bitPos % m_valueBits;
+    uint64_t word = 0;
+#if defined(BYTE_ORDER) && defined(LITTLE_ENDIAN) && BYTE_ORDER == LITTLE_ENDIAN
+    if(m_valueBits == 8 && index + sizeof(word) <= m_data.size()) {
+      std::memcpy(&word, &m_data[index], sizeof(word));
+      return (word >> shift) & ((uint64_t(1) << bits) - 1);
+    }
+#endif
+    for(size_t have = 0; have < shift + bits && have < 64 && index < m_data.size();
+        have += m_valueBits, index++)
+      word |= uint64_t(static_cast<Value>(m_data[index])) << have;
+
+    return (word >> shift) & ((uint64_t(1) << bits) - 1);
+  }
+
+  void Skip(size_t bits) {
+    m_bitPos += bits;
   }
 
   void Put(bool bit) {
@@ -299,9 +413,6 @@ public:
 
   void Seek(size_t bitPos) {
     m_bitPos = bitPos;
-    m_iterator = m_data.begin() + int((m_bitPos-1)/m_valueBits);
-    m_currentValue = (*m_iterator) >> ((m_bitPos-1) % m_valueBits);
-    m_iterator++;
   }
 
   void SeekFromEnd(size_t bitPosFromEnd) {
@@ -310,8 +421,6 @@ public:
   }
 
   void Reset() {
-    m_iterator = m_data.begin();
-    m_currentValue = 0;
     m_bitPos = 0;
   }
 
@@ -0,0 +1,116 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "CanonicalHuffman.h"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+typedef CanonicalHuffman<uint32_t> Huffman;
+
+// Fibonacci frequencies make the code as deep as possible: with n symbols
+// the longest codes have n - 1 bits.
+vector<pair<uint32_t, size_t> > FibonacciCounts(size_t n)
+{
+  vector<pair<uint32_t, size_t> > counts;
+  size_t a = 1, b = 1;
+  for (size_t i = 0; i < n; ++i) {
+    counts.push_back(make_pair(uint32_t(i), a));
+    size_t c = a + b;
+    a = b;
+    b = c;
+  }
+  return counts;
+}
+
+// Encode every prefix of symbols, so that the streams end at all kinds of
+// positions inside the lookahead window, and check that the table decoder
+// reads the same symbols and consumes the same bits as the bitwise one.
+void CheckAgainstBitwise(size_t numSymbols, const vector<uint32_t> &symbols)
+{
+  vector<pair<uint32_t, size_t> > counts = FibonacciCounts(numSymbols);
+  Huffman huffman(counts.begin(), counts.end());
+
+  for (size_t n = 1; n <= symbols.size(); ++n) {
+    string data;
+    BitWrapper<> encoder(data);
+    for (size_t i = 0; i < n; ++i)
+      huffman.Put(encoder, symbols[i]);
+
+    BitWrapper<> table(data), bitwise(data);
+    for (size_t i = 0; i < n; ++i) {
+      BOOST_CHECK_EQUAL(huffman.Read(table), symbols[i]);
+      BOOST_CHECK_EQUAL(huffman.ReadBitwise(bitwise), symbols[i]);
+      BOOST_REQUIRE_EQUAL(table.Tell(), bitwise.Tell());
+    }
+  }
+}
+
+vector<uint32_t> Mixed(size_t numSymbols)
+{
+  // long and short codes in turn, rarest first
+  vector<uint32_t> symbols;
+  for (size_t i = 0; i < numSymbols; ++i) {
+    symbols.push_back(uint32_t(i));
+    symbols.push_back(uint32_t(numSymbols - 1 - i));
+    symbols.push_back(uint32_t(numSymbols - 1));
+  }
+  return symbols;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(canonical_huffman)
+
+BOOST_AUTO_TEST_CASE(short_codes)
+{
+  // all codes fit into the table
+  CheckAgainstBitwise(8, Mixed(8));
+}
+
+BOOST_AUTO_TEST_CASE(codes_longer_than_table)
+{
+  // up to 20 bits: the table prefix plus one read of the remaining bits
+  CheckAgainstBitwise(21, Mixed(21));
+}
+
+BOOST_AUTO_TEST_CASE(codes_longer_than_32_bits)
+{
+  // up to 39 bits: falls back to reading bit by bit
+  CheckAgainstBitwise(40, Mixed(40));
+}
+
+BOOST_AUTO_TEST_CASE(stream_ends_inside_window)
+{
+  // a one bit code after a long one leaves most of the window past the end
+  vector<uint32_t> symbols;
+  symbols.push_back(0);
+  symbols.push_back(20);
+  CheckAgainstBitwise(21, symbols);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -271,6 +271,9 @@ TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
 
   size_t srcSize = sourcePhrase.GetSize();
 
+  // new target phrases are evaluated together once all are decoded
+  size_t firstNew = tpv->size();
+
   TargetPhrase* targetPhrase = NULL;
   while(encodedBitStream.TellFromEnd()) {
 
@@ -423,10 +426,6 @@ TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
         targetPhrase->SetAlignTerm(alignment);
       }
 
-      if(eval) {
-        targetPhrase->EvaluateInIsolation(sourcePhrase, m_phraseDictionary.GetFeaturesToApply());
-      }
-
       if(m_coding == PREnc) {
         if(!m_maxRank || tpv->size() <= m_maxRank)
           bitsLeft = encodedBitStream.TellFromEnd();
@@ -442,6 +441,14 @@ TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
     }
   }
 
+  if(eval && tpv->size() > firstNew) {
+    std::vector<const Phrase*> sources(tpv->size() - firstNew, &sourcePhrase);
+    std::vector<TargetPhrase*> targets;
+    for(size_t i = firstNew; i < tpv->size(); i++)
+      targets.push_back(&(*tpv)[i]);
+    TargetPhrase::EvaluateInIsolation(sources, targets, m_phraseDictionary.GetFeaturesToApply());
+  }
+
   if(m_coding == PREnc && !extending) {
     bitsLeft = bitsLeft > 8 ? bitsLeft : 0;
     m_decodingCache.Cache(sourcePhrase, tpv, bitsLeft, m_maxRank);
@@ -453,6 +460,8 @@ TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
 void PhraseDecoder::PruneCache()
 {
   m_decodingCache.Prune();
+  VERBOSE(2, "Decoding cache of " << m_phraseDictionary.GetScoreProducerDescription()
+          << ": " << m_decodingCache.GetStats() << std::endl);
 }
 
 }
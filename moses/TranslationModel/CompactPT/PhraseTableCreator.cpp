@@ -19,7 +19,9 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
+#include <algorithm>
 #include <cstdio>
+#include <cstdlib>
 
 #include "PhraseTableCreator.h"
 #include "ConsistentPhrases.h"
@@ -66,7 +68,8 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
     m_quantize(quantize), m_maxRank(maxRank),
 #ifdef WITH_THREADS
     m_threads(threads),
-    m_srcHash(m_orderBits, m_fingerPrintBits, 1),
+    m_maxQueuedLines(8 * 1000 * m_threads),
+    m_srcHash(m_orderBits, m_fingerPrintBits, m_threads),
     m_rnkHash(10, 24, m_threads),
 #else
     m_srcHash(m_orderBits, m_fingerPrintBits),
@@ -379,11 +382,12 @@ void PhraseTableCreator::CompressTargetPhrases()
 
 void PhraseTableCreator::CalcHuffmanCodes()
 {
+  std::vector<boost::shared_ptr<Task> > tasks;
+
   std::cerr << "\tCreating Huffman codes for " << m_symbolCounter.Size()
             << " target phrase symbols" << std::endl;
-
-  m_symbolTree = new SymbolTree(m_symbolCounter.Begin(),
-                                m_symbolCounter.End());
+  tasks.push_back(boost::shared_ptr<Task>(
+                    new HuffmanTask<unsigned>(m_symbolCounter, m_symbolTree)));
 
   std::vector<ScoreTree*>::iterator treeIt = m_scoreTrees.begin();
   for(std::vector<ScoreCounter*>::iterator it = m_scoreCounters.begin();
@@ -394,15 +398,28 @@ void PhraseTableCreator::CalcHuffmanCodes()
     std::cerr << "\tCreating Huffman codes for " << (*it)->Size()
               << " scores" << std::endl;
 
-    *treeIt = new ScoreTree((*it)->Begin(), (*it)->End());
+    tasks.push_back(boost::shared_ptr<Task>(
+                      new HuffmanTask<float>(**it, *treeIt)));
     treeIt++;
   }
 
   if(m_useAlignmentInfo) {
     std::cerr << "\tCreating Huffman codes for " << m_alignCounter.Size()
               << " alignment points" << std::endl;
-    m_alignTree = new AlignTree(m_alignCounter.Begin(), m_alignCounter.End());
+    tasks.push_back(boost::shared_ptr<Task>(
+                      new HuffmanTask<AlignPoint>(m_alignCounter, m_alignTree)));
   }
+
+#ifdef WITH_THREADS
+  // The trees do not depend on each other
+  ThreadPool pool(std::min(m_threads, tasks.size()));
+  for(size_t i = 0; i < tasks.size(); i++)
+    pool.Submit(tasks[i]);
+  pool.Stop(true);
+#else
+  for(size_t i = 0; i < tasks.size(); i++)
+    tasks[i]->Run();
+#endif
   std::cerr << std::endl;
 }
 
@@ -579,10 +596,10 @@ void PhraseTableCreator::EncodeTargetPhraseREnc(std::vector<std::string>& s,
         if(r < bestRank) {
           bestRank = r;
           bestSrcPos = *it;
-          bestDiff = abs(*it-i);
-        } else if(r == bestRank && unsigned(abs(*it-i)) < bestDiff) {
+          bestDiff = std::abs(long(*it) - long(i));
+        } else if(r == bestRank && unsigned(std::abs(long(*it) - long(i))) < bestDiff) {
           bestSrcPos = *it;
-          bestDiff = abs(*it-i);
+          bestDiff = std::abs(long(*it) - long(i));
         }
       }
     }
@@ -1019,11 +1036,23 @@ size_t RankingTask::m_lineNum = 0;
 #ifdef WITH_THREADS
 boost::mutex RankingTask::m_mutex;
 boost::mutex RankingTask::m_fileMutex;
+boost::condition_variable RankingTask::m_flushed;
 #endif
 
 RankingTask::RankingTask(InputFileStream& inFile, PhraseTableCreator& creator)
   : m_inFile(inFile), m_creator(creator) {}
 
+#ifdef WITH_THREADS
+void RankingTask::WaitForFlush()
+{
+  // see EncodingTask::WaitForFlush()
+  boost::mutex::scoped_lock lock(m_mutex);
+  while(long(m_lineNum) > m_creator.m_lastFlushedLine + 1
+        + long(m_creator.m_maxQueuedLines))
+    m_flushed.wait(lock);
+}
+#endif
+
 void RankingTask::operator()()
 {
   size_t lineNum = 0;
@@ -1035,6 +1064,7 @@ void RankingTask::operator()()
   {
 #ifdef WITH_THREADS
     boost::mutex::scoped_lock lock(m_fileMutex);
+    WaitForFlush();
 #endif
     std::string line;
     while(lines.size() < max_lines && std::getline(m_inFile, line))
@@ -1098,6 +1128,9 @@ void RankingTask::operator()()
       for(size_t i = 0; i < result.size(); i++)
         m_creator.AddRankedLine(result[i]);
       m_creator.FlushRankedQueue();
+#ifdef WITH_THREADS
+      m_flushed.notify_all();
+#endif
     }
 
     result.clear();
@@ -1106,6 +1139,7 @@ void RankingTask::operator()()
 
 #ifdef WITH_THREADS
     boost::mutex::scoped_lock lock(m_fileMutex);
+    WaitForFlush();
 #endif
     std::string line;
     while(lines.size() < max_lines && std::getline(m_inFile, line))
@@ -1119,11 +1153,25 @@ size_t EncodingTask::m_lineNum = 0;
 #ifdef WITH_THREADS
 boost::mutex EncodingTask::m_mutex;
 boost::mutex EncodingTask::m_fileMutex;
+boost::condition_variable EncodingTask::m_flushed;
 #endif
 
 EncodingTask::EncodingTask(InputFileStream& inFile, PhraseTableCreator& creator)
   : m_inFile(inFile), m_creator(creator) {}
 
+#ifdef WITH_THREADS
+void EncodingTask::WaitForFlush()
+{
+  // A block that is done waits in the creator's queue until all earlier
+  // blocks are done as well, so reading far ahead of a slow block would
+  // fill memory. Called with m_fileMutex held.
+  boost::mutex::scoped_lock lock(m_mutex);
+  while(long(m_lineNum) > m_creator.m_lastFlushedLine + 1
+        + long(m_creator.m_maxQueuedLines))
+    m_flushed.wait(lock);
+}
+#endif
+
 void EncodingTask::operator()()
 {
   size_t lineNum = 0;
@@ -1135,6 +1183,7 @@ void EncodingTask::operator()()
   {
 #ifdef WITH_THREADS
     boost::mutex::scoped_lock lock(m_fileMutex);
+    WaitForFlush();
 #endif
     std::string line;
     while(lines.size() < max_lines && std::getline(m_inFile, line))
@@ -1190,6 +1239,9 @@ void EncodingTask::operator()()
       for(size_t i = 0; i < result.size(); i++)
         m_creator.AddEncodedLine(result[i]);
       m_creator.FlushEncodedQueue();
+#ifdef WITH_THREADS
+      m_flushed.notify_all();
+#endif
     }
 
     result.clear();
@@ -1198,6 +1250,7 @@ void EncodingTask::operator()()
 
 #ifdef WITH_THREADS
     boost::mutex::scoped_lock lock(m_fileMutex);
+    WaitForFlush();
 #endif
     std::string line;
     while(lines.size() < max_lines && std::getline(m_inFile, line))
@@ -205,6 +205,8 @@ private:
 #ifdef WITH_THREADS
   size_t m_threads;
   boost::mutex m_mutex;
+  // lines read ahead of the last flushed line, see RankingTask and EncodingTask
+  size_t m_maxQueuedLines;
 #endif
 
   BlockHashIndex m_srcHash;
@@ -355,12 +357,31 @@ public:
   friend class CompressionTask;
 };
 
+template <typename DataType>
+class HuffmanTask : public Task
+{
+private:
+  Counter<DataType>& m_counter;
+  CanonicalHuffman<DataType>*& m_tree;
+
+public:
+  HuffmanTask(Counter<DataType>& counter, CanonicalHuffman<DataType>*& tree)
+    : m_counter(counter), m_tree(tree) {}
+
+  virtual void Run() {
+    m_tree = new CanonicalHuffman<DataType>(m_counter.Begin(), m_counter.End());
+  }
+};
+
 class RankingTask
 {
 private:
 #ifdef WITH_THREADS
   static boost::mutex m_mutex;
   static boost::mutex m_fileMutex;
+  static boost::condition_variable m_flushed;
+
+  void WaitForFlush();
 #endif
   static size_t m_lineNum;
   InputFileStream& m_inFile;
@@ -377,6 +398,9 @@ private:
 #ifdef WITH_THREADS
   static boost::mutex m_mutex;
   static boost::mutex m_fileMutex;
+  static boost::condition_variable m_flushed;
+
+  void WaitForFlush();
 #endif
   static size_t m_lineNum;
   static size_t m_sourcePhraseNum;
@@ -39,6 +39,8 @@ PhraseDictionary::PhraseDictionary(const std::string &line, bool registerNow)
   : DecodeFeature(line, registerNow)
   , m_tableLimit(20) // default
   , m_maxCacheSize(DEFAULT_MAX_TRANS_OPT_CACHE_SIZE)
+  , m_maxCacheBytes(0)
+  , m_cache(DEFAULT_MAX_TRANS_OPT_CACHE_SIZE)
 {
   m_id = s_staticColl.size();
   s_staticColl.push_back(this);
@@ -56,25 +58,15 @@ PhraseDictionary::
 GetTargetPhraseCollectionLEGACY(const Phrase& src) const
 {
   TargetPhraseCollection::shared_ptr ret;
-  typedef std::pair<TargetPhraseCollection::shared_ptr , clock_t> entry;
   if (m_maxCacheSize) {
-    CacheColl &cache = GetCache();
-
     size_t hash = hash_value(src);
-
-    CacheColl::iterator iter;
-    iter = cache.find(hash);
-
-    if (iter == cache.end()) {
+    if (!FindInCache(hash, ret)) {
       // not in cache, need to look up from phrase table
       ret = GetTargetPhraseCollectionNonCacheLEGACY(src);
       if (ret) { // make a copy
         ret.reset(new TargetPhraseCollection(*ret));
       }
-      cache[hash] = entry(ret, clock());
-    } else { // in cache. just use it
-      iter->second.second = clock();
-      ret = iter->second.first;
+      AddToCache(hash, ret);
     }
   } else {
     // don't use cache. look up from phrase table
@@ -105,6 +97,10 @@ SetParameter(const std::string& key, const std::string& value)
 {
   if (key == "cache-size") {
     m_maxCacheSize = Scan<size_t>(value);
+    m_cache.SetCapacity(m_maxCacheSize, m_maxCacheBytes);
+  } else if (key == "cache-bytes") {
+    m_maxCacheBytes = Scan<size_t>(value);
+    m_cache.SetCapacity(m_maxCacheSize, m_maxCacheBytes);
   } else if (key == "path") {
     m_filePath = value;
   } else if (key == "table-limit") {
@@ -164,51 +160,48 @@ GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
   }
 }
 
-// reduce presistent cache by half of maximum size
+// the cache evicts least recently used entries as new ones come in, so
+// there is nothing left to prune here; just report how well it is doing
 void PhraseDictionary::ReduceCache() const
 {
-  Timer reduceCacheTime;
-  reduceCacheTime.start();
-  CacheColl &cache = GetCache();
-  if (cache.size() <= m_maxCacheSize) return; // not full
-
-  // find cutoff for last used time
-  priority_queue< clock_t > lastUsedTimes;
-  CacheColl::iterator iter;
-  iter = cache.begin();
-  while( iter != cache.end() ) {
-    lastUsedTimes.push( iter->second.second );
-    iter++;
+  IFVERBOSE(2) {
+    if (m_maxCacheSize) {
+      TRACE_ERR("Translation option cache of " << GetScoreProducerDescription()
+                << ": " << m_cache.GetStats() << std::endl);
+    }
   }
-  for( size_t i=0; i < lastUsedTimes.size()-m_maxCacheSize/2; i++ )
-    lastUsedTimes.pop();
-  clock_t cutoffLastUsedTime = lastUsedTimes.top();
-
-  // remove all old entries
-  iter = cache.begin();
-  while( iter != cache.end() ) {
-    if (iter->second.second < cutoffLastUsedTime) {
-      CacheColl::iterator iterRemove = iter++;
-      // delete iterRemove->second.first;
-      cache.erase(iterRemove);
-    } else iter++;
+}
+
+namespace
+{
+// rough number of bytes held by a cached collection, for the byte budget
+size_t EstimateCacheBytes(TargetPhraseCollection const* tpc)
+{
+  size_t ret = sizeof(TargetPhraseCollection);
+  if (tpc == NULL) return ret;
+  TargetPhraseCollection::const_iterator iter;
+  for (iter = tpc->begin(); iter != tpc->end(); ++iter) {
+    const TargetPhrase &tp = **iter;
+    ret += sizeof(TargetPhrase) + tp.GetSize() * sizeof(Word)
+           + tp.GetScoreBreakdown().Size() * sizeof(FValue);
   }
-  VERBOSE(2,"Reduced persistent translation option cache in "
-          << reduceCacheTime << " seconds." << std::endl);
+  return ret;
+}
 }
 
-CacheColl &
+bool
 PhraseDictionary::
-GetCache() const
+FindInCache(size_t key, TargetPhraseCollection::shared_ptr &ret) const
 {
-  CacheColl *cache;
-  cache = m_cache.get();
-  if (cache == NULL) {
-    cache = new CacheColl;
-    m_cache.reset(cache);
-  }
-  assert(cache);
-  return *cache;
+  return m_maxCacheSize && m_cache.Find(key, ret);
+}
+
+void
+PhraseDictionary::
+AddToCache(size_t key, TargetPhraseCollection::shared_ptr const& tpc) const
+{
+  if (m_maxCacheSize)
+    m_cache.Insert(key, tpc, EstimateCacheBytes(tpc.get()));
 }
 
 bool PhraseDictionary::SatisfyBackoff(const InputPath &inputPath) const
@@ -45,6 +45,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/InputPath.h"
 #include "moses/FF/DecodeFeature.h"
 #include "moses/ContextScope.h"
+#include "moses/StripedLRUCache.h"
 
 namespace Moses
 {
@@ -56,9 +57,8 @@ class ChartCellCollectionBase;
 class ChartRuleLookupManager;
 class ChartParser;
 
-// typedef std::pair<TargetPhraseCollection::shared_ptr, clock_t> TPCollLastUse;
-typedef std::pair<TargetPhraseCollection::shared_ptr, clock_t> CacheCollEntry;
-typedef boost::unordered_map<size_t, CacheCollEntry> CacheColl;
+//! persistent translation option cache, shared by all decoding threads
+typedef StripedLRUCache<size_t, TargetPhraseCollection::shared_ptr> CacheColl;
 
 /**
   * Abstract base class for phrase dictionaries (tables).
@@ -170,22 +170,19 @@ protected:
 
   // cache
   size_t m_maxCacheSize; // 0 = no caching
-
-#ifdef WITH_THREADS
-  //reader-writer lock
-  mutable boost::thread_specific_ptr<CacheColl> m_cache;
-#else
-  mutable boost::scoped_ptr<CacheColl> m_cache;
-#endif
+  size_t m_maxCacheBytes; // 0 = no byte limit
+  mutable CacheColl m_cache;
 
   virtual
   TargetPhraseCollection::shared_ptr
   GetTargetPhraseCollectionNonCacheLEGACY(const Phrase& src) const;
 
+  // eviction happens on insertion; this only reports the cache counters
   void ReduceCache() const;
 
 protected:
-  CacheColl &GetCache() const;
+  bool FindInCache(size_t key, TargetPhraseCollection::shared_ptr &ret) const;
+  void AddToCache(size_t key, TargetPhraseCollection::shared_ptr const& tpc) const;
   size_t m_id;
 
 };
@@ -62,14 +62,9 @@ GetTargetPhraseCollection(InputPath &inputPath) const
   const Phrase &sourcePhrase = inputPath.GetPhrase();
   size_t hash = hash_value(sourcePhrase);
 
-  CacheColl &cache = GetCache();
-
-  CacheColl::iterator iter;
-  iter = cache.find(hash);
-
-  if (iter != cache.end()) {
+  TargetPhraseCollection::shared_ptr tpColl;
+  if (FindInCache(hash, tpColl)) {
     // already in cache
-    TargetPhraseCollection::shared_ptr tpColl = iter->second.first;
     inputPath.SetTargetPhrases(*this, tpColl, NULL);
   } else {
     // TRANSLITERATE
@@ -92,7 +87,7 @@ GetTargetPhraseCollection(InputPath &inputPath) const
     int ret = system(cmd.c_str());
     UTIL_THROW_IF2(ret != 0, "Transliteration script error");
 
-    TargetPhraseCollection::shared_ptr tpColl(new TargetPhraseCollection);
+    tpColl.reset(new TargetPhraseCollection);
     vector<TargetPhrase*> targetPhrases
     = CreateTargetPhrases(sourcePhrase, outDir.path());
     vector<TargetPhrase*>::const_iterator iter;
@@ -100,7 +95,7 @@ GetTargetPhraseCollection(InputPath &inputPath) const
       TargetPhrase *tp = *iter;
       tpColl->Add(tp);
     }
-    cache[hash] = CacheCollEntry(tpColl, clock());
+    AddToCache(hash, tpColl);
     inputPath.SetTargetPhrases(*this, tpColl, NULL);
   }
 }
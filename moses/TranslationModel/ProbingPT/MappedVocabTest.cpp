@@ -0,0 +1,141 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "util/exception.hh"
+#include "vocabid.hh"
+
+using namespace std;
+
+namespace
+{
+
+struct VocabFixture {
+  VocabFixture()
+    : filename((boost::filesystem::temp_directory_path()
+                / boost::filesystem::unique_path()).string()) {}
+  ~VocabFixture() {
+    remove(filename.c_str());
+  }
+
+  string filename;
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(mapped_vocab)
+
+BOOST_FIXTURE_TEST_CASE(dense_ids, VocabFixture)
+{
+  // ids from 1, as the target words and alignments have
+  map<unsigned int, string> words;
+  words[1] = "the";
+  words[2] = "";
+  words[3] = "house";
+  write_vocab(words, filename.c_str());
+
+  MappedVocab vocab;
+  vocab.load(filename.c_str());
+  BOOST_REQUIRE_EQUAL(vocab.size(), 3);
+  StringPiece word;
+  for (map<unsigned int, string>::const_iterator it = words.begin(); it != words.end(); ++it) {
+    BOOST_REQUIRE(vocab.find(it->first, word));
+    BOOST_CHECK_EQUAL(word.as_string(), it->second);
+  }
+  BOOST_CHECK(!vocab.find(0, word));
+  BOOST_CHECK(!vocab.find(4, word));
+}
+
+BOOST_FIXTURE_TEST_CASE(sparse_ids, VocabFixture)
+{
+  // hashes, as the source words have
+  map<uint64_t, vector<unsigned char> > words;
+  words[2].push_back(0);
+  words[17].push_back(1);
+  words[17].push_back(2);
+  words[0xfffffffffffffffULL].push_back(255);
+  write_vocab(words, filename.c_str());
+
+  MappedVocab vocab;
+  vocab.load(filename.c_str());
+  BOOST_REQUIRE_EQUAL(vocab.size(), 3);
+  size_t i = 0;
+  for (map<uint64_t, vector<unsigned char> >::const_iterator it = words.begin(); it != words.end(); ++it, ++i) {
+    BOOST_CHECK_EQUAL(vocab.get_id(i), it->first);
+    string expected(it->second.begin(), it->second.end());
+    BOOST_CHECK_EQUAL(vocab.get_word(i).as_string(), expected);
+    StringPiece word;
+    BOOST_REQUIRE(vocab.find(it->first, word));
+    BOOST_CHECK_EQUAL(word.as_string(), expected);
+  }
+  StringPiece word;
+  BOOST_CHECK(!vocab.find(1, word));
+  BOOST_CHECK(!vocab.find(18, word));
+}
+
+BOOST_FIXTURE_TEST_CASE(empty, VocabFixture)
+{
+  write_vocab(map<uint64_t, string>(), filename.c_str());
+
+  MappedVocab vocab;
+  vocab.load(filename.c_str());
+  BOOST_CHECK_EQUAL(vocab.size(), 0);
+  StringPiece word;
+  BOOST_CHECK(!vocab.find(1, word));
+}
+
+BOOST_FIXTURE_TEST_CASE(corrupt_offsets, VocabFixture)
+{
+  map<unsigned int, string> words;
+  words[1] = "a";
+  words[2] = "bc";
+  words[3] = "def";
+  write_vocab(words, filename.c_str());
+
+  // count, 3 ids, then the offsets 0, 1, 3, 6: make the second one 6, so that
+  // "bc" would end before it starts
+  {
+    fstream file(filename.c_str(), ios::in | ios::out | ios::binary);
+    file.seekp(5 * sizeof(uint64_t));
+    uint64_t offset = 6;
+    file.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+  }
+  MappedVocab vocab;
+  BOOST_CHECK_THROW(vocab.load(filename.c_str()), util::Exception);
+}
+
+BOOST_FIXTURE_TEST_CASE(truncated, VocabFixture)
+{
+  map<unsigned int, string> words;
+  words[1] = "the";
+  write_vocab(words, filename.c_str());
+  boost::filesystem::resize_file(filename, boost::filesystem::file_size(filename) - 1);
+
+  MappedVocab vocab;
+  BOOST_CHECK_THROW(vocab.load(filename.c_str()), util::Exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
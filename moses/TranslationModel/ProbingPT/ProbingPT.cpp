@@ -35,31 +35,21 @@ void ProbingPT::Load(AllOptions::ptr const& opts)
   m_unkId = 456456546456;
 
   // source vocab
-  const std::map<uint64_t, std::string> &sourceVocab = m_engine->getSourceVocab();
-  std::map<uint64_t, std::string>::const_iterator iterSource;
-  for (iterSource = sourceVocab.begin(); iterSource != sourceVocab.end(); ++iterSource) {
-    const string &wordStr = iterSource->second;
-    const Factor *factor = FactorCollection::Instance().AddFactor(wordStr);
-
-    uint64_t probingId = iterSource->first;
-
-    SourceVocabMap::value_type entry(factor, probingId);
-    m_sourceVocabMap.insert(entry);
-
+  const MappedVocab &sourceVocab = m_engine->getSourceVocab();
+  m_sourceVocabMap.rehash(sourceVocab.size());
+  for (size_t i = 0; i < sourceVocab.size(); ++i) {
+    const Factor *factor = FactorCollection::Instance().AddFactor(sourceVocab.get_word(i));
+    m_sourceVocabMap[factor] = sourceVocab.get_id(i);
   }
 
   // target vocab
-  const std::map<unsigned int, std::string> &probingVocab = m_engine->getVocab();
-  std::map<unsigned int, std::string>::const_iterator iter;
-  for (iter = probingVocab.begin(); iter != probingVocab.end(); ++iter) {
-    const string &wordStr = iter->second;
-    const Factor *factor = FactorCollection::Instance().AddFactor(wordStr);
-
-    unsigned int probingId = iter->first;
-
-    TargetVocabMap::value_type entry(factor, probingId);
-    m_vocabMap.insert(entry);
-
+  const MappedVocab &probingVocab = m_engine->getVocab();
+  for (size_t i = 0; i < probingVocab.size(); ++i) {
+    uint64_t probingId = probingVocab.get_id(i);
+    if (probingId >= m_targetFactors.size()) {
+      m_targetFactors.resize(probingId + 1, NULL);
+    }
+    m_targetFactors[probingId] = FactorCollection::Instance().AddFactor(probingVocab.get_word(i));
   }
 }
 
@@ -70,7 +60,14 @@ void ProbingPT::InitializeForInput(ttasksptr const& ttask)
 
 void ProbingPT::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
 {
-  CacheColl &cache = GetCache();
+  // Look up all source phrases of the sentence first, then evaluate the
+  // new target phrases in one batch so that feature functions (the LM in
+  // particular) can share work between them.
+  std::vector<InputPath*> newPaths;
+  std::vector<TargetPhraseCollection::shared_ptr> newColls;
+  std::vector<const Phrase*> sources;
+  std::vector<TargetPhrase*> targets;
+  std::vector<target_text> decoded; // decoding buffers, reused for every phrase
 
   InputPathList::const_iterator iter;
   for (iter = inputPathQueue.begin(); iter != inputPathQueue.end(); ++iter) {
@@ -81,13 +78,33 @@ void ProbingPT::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQue
       continue;
     }
 
-    TargetPhraseCollection::shared_ptr tpColl = CreateTargetPhrase(sourcePhrase);
-
-    // add target phrase to phrase-table cache
+    // the cache is shared by all threads, so a phrase looked up for one
+    // sentence is not decoded again for the next
     size_t hash = hash_value(sourcePhrase);
-    std::pair<TargetPhraseCollection::shared_ptr , clock_t> value(tpColl, clock());
-    cache[hash] = value;
+    TargetPhraseCollection::shared_ptr tpColl;
+    if (FindInCache(hash, tpColl)) {
+      inputPath.SetTargetPhrases(*this, tpColl, NULL);
+      continue;
+    }
 
+    tpColl = CreateTargetPhrase(sourcePhrase, decoded, targets);
+    sources.resize(targets.size(), &sourcePhrase);
+    newPaths.push_back(&inputPath);
+    newColls.push_back(tpColl);
+  }
+
+  // score of all other ff when this rule is being loaded
+  TargetPhrase::EvaluateInIsolation(sources, targets, GetFeaturesToApply());
+
+  for (size_t i = 0; i < newPaths.size(); ++i) {
+    InputPath &inputPath = *newPaths[i];
+    TargetPhraseCollection::shared_ptr tpColl = newColls[i];
+    if (tpColl) {
+      tpColl->Prune(true, m_tableLimit);
+    }
+
+    // add target phrase to phrase-table cache
+    AddToCache(hash_value(inputPath.GetPhrase()), tpColl);
     inputPath.SetTargetPhrases(*this, tpColl, NULL);
   }
 }
@@ -111,7 +128,7 @@ std::vector<uint64_t> ProbingPT::ConvertToProbingSourcePhrase(const Phrase &sour
   return ret;
 }
 
-TargetPhraseCollection::shared_ptr ProbingPT::CreateTargetPhrase(const Phrase &sourcePhrase) const
+TargetPhraseCollection::shared_ptr ProbingPT::CreateTargetPhrase(const Phrase &sourcePhrase, std::vector<target_text> &decoded, std::vector<TargetPhrase*> &toEvaluate) const
 {
   // create a target phrase from the 1st word of the source, prefix with 'ProbingPT:'
   assert(sourcePhrase.GetSize());
@@ -125,24 +142,18 @@ TargetPhraseCollection::shared_ptr ProbingPT::CreateTargetPhrase(const Phrase &s
     return tpColl;
   }
 
-  std::pair<bool, std::vector<target_text> > query_result;
-
   //Actual lookup
-  query_result = m_engine->query(probingSource);
-
-  if (query_result.first) {
-    //m_engine->printTargetInfo(query_result.second);
+  size_t numTargets;
+  if (m_engine->query(probingSource, decoded, numTargets)) {
     tpColl.reset(new TargetPhraseCollection());
 
-    const std::vector<target_text> &probingTargetPhrases = query_result.second;
-    for (size_t i = 0; i < probingTargetPhrases.size(); ++i) {
-      const target_text &probingTargetPhrase = probingTargetPhrases[i];
+    for (size_t i = 0; i < numTargets; ++i) {
+      const target_text &probingTargetPhrase = decoded[i];
       TargetPhrase *tp = CreateTargetPhrase(sourcePhrase, probingTargetPhrase);
 
       tpColl->Add(tp);
+      toEvaluate.push_back(tp);
     }
-
-    tpColl->Prune(true, m_tableLimit);
   }
 
   return tpColl;
@@ -172,7 +183,7 @@ TargetPhrase *ProbingPT::CreateTargetPhrase(const Phrase &sourcePhrase, const ta
 
   // alignment
   /*
-  const std::vector<unsigned char> &alignments = probingTargetPhrase.word_all1;
+  const StringPiece &alignments = probingTargetPhrase.word_all1;
 
   AlignmentInfo &aligns = tp->GetAlignTerm();
   for (size_t i = 0; i < alignS.size(); i += 2 ) {
@@ -180,17 +191,14 @@ TargetPhrase *ProbingPT::CreateTargetPhrase(const Phrase &sourcePhrase, const ta
   }
   */
 
-  // score of all other ff when this rule is being loaded
-  tp->EvaluateInIsolation(sourcePhrase, GetFeaturesToApply());
+  // other ff are evaluated by the caller, in batch
   return tp;
 }
 
 const Factor *ProbingPT::GetTargetFactor(uint64_t probingId) const
 {
-  TargetVocabMap::right_map::const_iterator iter;
-  iter = m_vocabMap.right.find(probingId);
-  if (iter != m_vocabMap.right.end()) {
-    return iter->second;
+  if (probingId < m_targetFactors.size()) {
+    return m_targetFactors[probingId];
   } else {
     // not in mapping. Must be UNK
     return NULL;
@@ -199,9 +207,8 @@ const Factor *ProbingPT::GetTargetFactor(uint64_t probingId) const
 
 uint64_t ProbingPT::GetSourceProbingId(const Factor *factor) const
 {
-  SourceVocabMap::left_map::const_iterator iter;
-  iter = m_sourceVocabMap.left.find(factor);
-  if (iter != m_sourceVocabMap.left.end()) {
+  SourceVocabMap::const_iterator iter = m_sourceVocabMap.find(factor);
+  if (iter != m_sourceVocabMap.end()) {
     return iter->second;
   } else {
     // not in mapping. Must be UNK
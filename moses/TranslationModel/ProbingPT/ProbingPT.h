@@ -1,7 +1,8 @@
 
 #pragma once
 
-#include <boost/bimap.hpp>
+#include <vector>
+#include <boost/unordered_map.hpp>
 #include "../PhraseDictionary.h"
 
 class QueryEngine;
@@ -40,13 +41,15 @@ public:
 protected:
   QueryEngine *m_engine;
 
-  typedef boost::bimap<const Factor *, uint64_t> SourceVocabMap;
-  mutable SourceVocabMap m_sourceVocabMap;
+  typedef boost::unordered_map<const Factor *, uint64_t> SourceVocabMap;
+  SourceVocabMap m_sourceVocabMap;
 
-  typedef boost::bimap<const Factor *, unsigned int> TargetVocabMap;
-  mutable TargetVocabMap m_vocabMap;
+  // indexed by the probing id of the target word; the ids are dense
+  std::vector<const Factor *> m_targetFactors;
 
-  TargetPhraseCollection::shared_ptr CreateTargetPhrase(const Phrase &sourcePhrase) const;
+  // target phrases are added unevaluated to toEvaluate, and not pruned;
+  // decoded holds the decoding buffers, which are reused from call to call
+  TargetPhraseCollection::shared_ptr CreateTargetPhrase(const Phrase &sourcePhrase, std::vector<target_text> &decoded, std::vector<TargetPhrase*> &toEvaluate) const;
   TargetPhrase *CreateTargetPhrase(const Phrase &sourcePhrase, const target_text &probingTargetPhrase) const;
   const Factor *GetTargetFactor(uint64_t probingId) const;
   uint64_t GetSourceProbingId(const Factor *factor) const;
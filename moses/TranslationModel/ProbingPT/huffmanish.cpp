@@ -121,21 +121,11 @@ void Huffman::serialize_maps(const char * dirname)
 {
   //Note that directory name should exist.
   std::string basedir(dirname);
-  std::string target_phrase_path(basedir + "/target_phrases");
-  std::string probabilities_path(basedir + "/probs");
-  std::string word_all1_path(basedir + "/Wall1");
-
-  //Target phrase
-  std::ofstream os (target_phrase_path.c_str(), std::ios::binary);
-  boost::archive::text_oarchive oarch(os);
-  oarch << lookup_target_phrase;
-  os.close();
-
-  //Word all1
-  std::ofstream os2 (word_all1_path.c_str(), std::ios::binary);
-  boost::archive::text_oarchive oarch2(os2);
-  oarch2 << lookup_word_all1;
-  os2.close();
+  std::string target_phrase_path(basedir + "/target_vocab.dat");
+  std::string word_all1_path(basedir + "/word_all1.dat");
+
+  write_vocab(lookup_target_phrase, target_phrase_path.c_str());
+  write_vocab(lookup_word_all1, word_all1_path.c_str());
 }
 
 std::vector<unsigned char> Huffman::full_encode_line(line_text line)
@@ -189,149 +179,79 @@ void Huffman::produce_lookups()
 
 }
 
-HuffmanDecoder::HuffmanDecoder (const char * dirname)
+void HuffmanDecoder::load(const char * dirname)
 {
-  //Read the maps from disk
-
   //Note that directory name should exist.
   std::string basedir(dirname);
-  std::string target_phrase_path(basedir + "/target_phrases");
-  std::string word_all1_path(basedir + "/Wall1");
-
-  //Target phrases
-  std::ifstream is (target_phrase_path.c_str(), std::ios::binary);
-  boost::archive::text_iarchive iarch(is);
-  iarch >> lookup_target_phrase;
-  is.close();
-
-  //Word allignment 1
-  std::ifstream is2 (word_all1_path.c_str(), std::ios::binary);
-  boost::archive::text_iarchive iarch2(is2);
-  iarch2 >> lookup_word_all1;
-  is2.close();
-
+  lookup_target_phrase.load((basedir + "/target_vocab.dat").c_str());
+  lookup_word_all1.load((basedir + "/word_all1.dat").c_str());
 }
 
-HuffmanDecoder::HuffmanDecoder (std::map<unsigned int, std::string> * lookup_target,
-                                std::map<unsigned int, std::vector<unsigned char> > * lookup_word1)
+//Reads one variable byte encoded number and advances it past it
+inline unsigned int vbyte_read(const unsigned char *& it, const unsigned char * end)
 {
-  lookup_target_phrase = *lookup_target;
-  lookup_word_all1 = *lookup_word1;
-}
-
-std::vector<target_text> HuffmanDecoder::full_decode_line (std::vector<unsigned char> lines, int num_scores)
-{
-  std::vector<target_text> retvector; //All target phrases
-  std::vector<unsigned int> decoded_lines = vbyte_decode_line(lines); //All decoded lines
-  std::vector<unsigned int>::iterator it = decoded_lines.begin(); //Iterator for them
-  std::vector<unsigned int> current_target_phrase; //Current target phrase decoded
-
-  short zero_count = 0; //Count home many zeroes we have met. so far. Every 3 zeroes mean a new target phrase.
-  while(it != decoded_lines.end()) {
-    if (zero_count == 1) {
-      //We are extracting scores. we know how many scores there are so we can push them
-      //to the vector. This is done in case any of the scores is 0, because it would mess
-      //up the state machine.
-      for (int i = 0; i < num_scores; i++) {
-        current_target_phrase.push_back(*it);
-        it++;
-      }
-    }
-
-    if (zero_count == 3) {
-      //We have finished with this entry, decode it, and add it to the retvector.
-      retvector.push_back(decode_line(current_target_phrase, num_scores));
-      current_target_phrase.clear(); //Clear the current target phrase and the zero_count
-      zero_count = 0; //So that we can reuse them for the next target phrase
-    }
-    //Add to the next target_phrase, number by number.
-    current_target_phrase.push_back(*it);
-    if (*it == 0) {
-      zero_count++;
+  unsigned int retvalue = 0;
+  unsigned char shift = 0;
+  while (it != end) {
+    unsigned char byte = *it++;
+    retvalue |= (byte & 0x7f) << shift;
+    if ((byte >> 7) != 1) {
+      break;
     }
-    it++; //Go to the next word/symbol
-  }
-  //Don't forget the last remaining line!
-  if (zero_count == 3) {
-    //We have finished with this entry, decode it, and add it to the retvector.
-    retvector.push_back(decode_line(current_target_phrase, num_scores));
-    current_target_phrase.clear(); //Clear the current target phrase and the zero_count
-    zero_count = 0; //So that we can reuse them for the next target phrase
+    shift += 7;
   }
-
-  return retvector;
-
+  return retvalue;
 }
 
-target_text HuffmanDecoder::decode_line (std::vector<unsigned int> input, int num_scores)
+size_t HuffmanDecoder::full_decode_line (const unsigned char * begin, const unsigned char * end, int num_scores, std::vector<target_text> &targets) const
 {
-  //demo decoder
-  target_text ret;
-  //Split everything
-  std::vector<unsigned int> target_phrase;
-  std::vector<unsigned int> probs;
-  unsigned int wAll;
-
-  //Split the line into the proper arrays
-  short num_zeroes = 0;
-  int counter = 0;
-  while (num_zeroes < 3) {
-    unsigned int num = input[counter];
-    if (num == 0) {
-      num_zeroes++;
-    } else if (num_zeroes == 0) {
-      target_phrase.push_back(num);
-    } else if (num_zeroes == 1) {
-      //Push exactly num_scores scores
-      for (int i = 0; i < num_scores; i++) {
-        probs.push_back(num);
-        counter++;
-        num = input[counter];
-      }
-      continue;
-    } else if (num_zeroes == 2) {
-      wAll = num;
+  size_t decoded = 0;
+  const unsigned char * it = begin;
+
+  //Every target phrase is its words, a zero, exactly num_scores scores (any of
+  //which may be zero), a zero, the word allignment and a final zero.
+  while (it != end) {
+    if (decoded == targets.size()) {
+      targets.push_back(target_text());
     }
-    counter++;
-  }
-
-  ret.target_phrase = target_phrase;
-  ret.word_all1 = lookup_word_all1.find(wAll)->second;
-
-  //Decode probabilities
-  for (std::vector<unsigned int>::iterator it = probs.begin(); it != probs.end(); it++) {
-    ret.prob.push_back(reinterpret_uint(&(*it)));
-  }
-
-  return ret;
+    target_text &ret = targets[decoded++];
 
-}
+    ret.target_phrase.clear();
+    unsigned int num;
+    while ((num = vbyte_read(it, end)) != 0) {
+      ret.target_phrase.push_back(num);
+    }
 
-inline std::string HuffmanDecoder::getTargetWordFromID(unsigned int id)
-{
-  return lookup_target_phrase.find(id)->second;
-}
+    ret.prob.resize(num_scores);
+    for (int i = 0; i < num_scores; i++) {
+      num = vbyte_read(it, end);
+      ret.prob[i] = reinterpret_uint(&num);
+    }
+    vbyte_read(it, end);
 
-std::string HuffmanDecoder::getTargetWordsFromIDs(std::vector<unsigned int> ids)
-{
-  std::string returnstring;
-  for (std::vector<unsigned int>::iterator it = ids.begin(); it != ids.end(); it++) {
-    returnstring.append(getTargetWordFromID(*it) + " ");
+    unsigned int wAll = vbyte_read(it, end);
+    vbyte_read(it, end);
+    ret.word_all1 = StringPiece();
+    lookup_word_all1.find(wAll, ret.word_all1);
   }
 
-  return returnstring;
+  return decoded;
 }
 
-inline std::string getTargetWordFromID(unsigned int id, std::map<unsigned int, std::string> * lookup_target_phrase)
+StringPiece HuffmanDecoder::getTargetWordFromID(unsigned int id) const
 {
-  return lookup_target_phrase->find(id)->second;
+  StringPiece word;
+  lookup_target_phrase.find(id, word);
+  return word;
 }
 
-std::string getTargetWordsFromIDs(std::vector<unsigned int> ids, std::map<unsigned int, std::string> * lookup_target_phrase)
+std::string HuffmanDecoder::getTargetWordsFromIDs(const std::vector<unsigned int> &ids) const
 {
   std::string returnstring;
-  for (std::vector<unsigned int>::iterator it = ids.begin(); it != ids.end(); it++) {
-    returnstring.append(getTargetWordFromID(*it, lookup_target_phrase) + " ");
+  for (std::vector<unsigned int>::const_iterator it = ids.begin(); it != ids.end(); it++) {
+    StringPiece word = getTargetWordFromID(*it);
+    returnstring.append(word.data(), word.size());
+    returnstring.append(" ");
   }
 
   return returnstring;
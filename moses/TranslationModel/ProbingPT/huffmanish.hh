@@ -3,15 +3,11 @@
 //Huffman encodes a line and also produces the vocabulary ids
 #include "hash.hh"
 #include "line_splitter.hh"
+#include "vocabid.hh"
 #include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <sstream>
-#include <boost/serialization/serialization.hpp>
-#include <boost/serialization/vector.hpp>
-#include <boost/serialization/map.hpp>
-#include <boost/archive/text_iarchive.hpp>
-#include <boost/archive/text_oarchive.hpp>
 
 //Sorting for the second
 struct sort_pair {
@@ -73,35 +69,30 @@ public:
 
 class HuffmanDecoder
 {
-  std::map<unsigned int, std::string> lookup_target_phrase;
-  std::map<unsigned int, std::vector<unsigned char> > lookup_word_all1;
+  MappedVocab lookup_target_phrase;
+  MappedVocab lookup_word_all1;
 
 public:
-  HuffmanDecoder (const char *);
-  HuffmanDecoder (std::map<unsigned int, std::string> *, std::map<unsigned int, std::vector<unsigned char> > *);
+  //mmaps the lookups written by Huffman::serialize_maps
+  void load(const char * dirname);
 
   //Getters
-  const std::map<unsigned int, std::string> get_target_lookup_map() const {
+  const MappedVocab &get_target_lookup_map() const {
     return lookup_target_phrase;
   }
-  const std::map<unsigned int, std::vector<unsigned char> > get_word_all1_lookup_map() const {
+  const MappedVocab &get_word_all1_lookup_map() const {
     return lookup_word_all1;
   }
 
-  inline std::string getTargetWordFromID(unsigned int id);
+  StringPiece getTargetWordFromID(unsigned int id) const;
 
-  std::string getTargetWordsFromIDs(std::vector<unsigned int> ids);
+  std::string getTargetWordsFromIDs(const std::vector<unsigned int> &ids) const;
 
-  target_text decode_line (std::vector<unsigned int> input, int num_scores);
-
-  //Variable byte decodes a all target phrases contained here and then passes them to decode_line
-  std::vector<target_text> full_decode_line (std::vector<unsigned char> lines, int num_scores);
+  //Variable byte decodes all target phrases stored between begin and end, in place,
+  //into the first entries of targets, reusing their buffers. Returns how many there are.
+  size_t full_decode_line (const unsigned char * begin, const unsigned char * end, int num_scores, std::vector<target_text> &targets) const;
 };
 
-std::string getTargetWordsFromIDs(std::vector<unsigned int> ids, std::map<unsigned int, std::string> * lookup_target_phrase);
-
-inline std::string getTargetWordFromID(unsigned int id, std::map<unsigned int, std::string> * lookup_target_phrase);
-
 inline unsigned int reinterpret_float(float * num);
 
 inline float reinterpret_uint(unsigned int * num);
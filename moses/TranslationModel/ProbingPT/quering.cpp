@@ -23,20 +23,14 @@ unsigned char * read_binary_file(const char * filename, size_t filesize)
   return map;
 }
 
-QueryEngine::QueryEngine(const char * filepath) : decoder(filepath)
+QueryEngine::QueryEngine(const char * filepath)
 {
 
   //Create filepaths
   std::string basepath(filepath);
   std::string path_to_hashtable = basepath + "/probing_hash.dat";
   std::string path_to_data_bin = basepath + "/binfile.dat";
-  std::string path_to_source_vocabid = basepath + "/source_vocabids";
-
-  ///Source phrase vocabids
-  read_map(&source_vocabids, path_to_source_vocabid.c_str());
-
-  //Target phrase vocabIDs
-  vocabids = decoder.get_target_lookup_map();
+  std::string path_to_source_vocabid = basepath + "/source_vocab.dat";
 
   //Read config file
   std::string line;
@@ -63,6 +57,12 @@ QueryEngine::QueryEngine(const char * filepath) : decoder(filepath)
   }
   config.close();
 
+  ///Source phrase vocabids
+  source_vocabids.load(path_to_source_vocabid.c_str());
+
+  //Target phrase vocabIDs and word allignments
+  decoder.load(filepath);
+
   //Mmap binary table
   struct stat filestatus;
   stat(path_to_data_bin.c_str(), &filestatus);
@@ -86,10 +86,9 @@ QueryEngine::~QueryEngine()
 
 }
 
-std::pair<bool, std::vector<target_text> > QueryEngine::query(std::vector<uint64_t> source_phrase)
+bool QueryEngine::query(const std::vector<uint64_t> &source_phrase, std::vector<target_text> &targets, size_t &num_targets)
 {
   bool found;
-  std::vector<target_text> translation_entries;
   const Entry * entry;
   //TOO SLOW
   //uint64_t key = util::MurmurHashNative(&source_phrase[0], source_phrase.size());
@@ -108,21 +107,15 @@ std::pair<bool, std::vector<target_text> > QueryEngine::query(std::vector<uint64
     uint64_t initial_index = entry -> GetValue();
     unsigned int bytes_toread = entry -> bytes_toread;
 
-    //ASK HIEU FOR MORE EFFICIENT WAY TO DO THIS!
-    std::vector<unsigned char> encoded_text; //Assign to the vector the relevant portion of the array.
-    encoded_text.reserve(bytes_toread);
-    for (int i = 0; i < bytes_toread; i++) {
-      encoded_text.push_back(binary_mmaped[i+initial_index]);
-    }
-
-    //Get only the translation entries necessary
-    translation_entries = decoder.full_decode_line(encoded_text, num_scores);
+    //Get only the translation entries necessary, decoding straight from the mmaped file
+    const unsigned char * encoded_text = binary_mmaped + initial_index;
+    num_targets = decoder.full_decode_line(encoded_text, encoded_text + bytes_toread, num_scores, targets);
 
+  } else {
+    num_targets = 0;
   }
 
-  std::pair<bool, std::vector<target_text> > output (found, translation_entries);
-
-  return output;
+  return found;
 
 }
 
@@ -152,15 +145,9 @@ std::pair<bool, std::vector<target_text> > QueryEngine::query(StringPiece source
     //At the end of the file we can't readd + largest_entry cause we get a segfault.
     std::cerr << "Entry size is bytes is: " << bytes_toread << std::endl;
 
-    //ASK HIEU FOR MORE EFFICIENT WAY TO DO THIS!
-    std::vector<unsigned char> encoded_text; //Assign to the vector the relevant portion of the array.
-    encoded_text.reserve(bytes_toread);
-    for (int i = 0; i < bytes_toread; i++) {
-      encoded_text.push_back(binary_mmaped[i+initial_index]);
-    }
-
-    //Get only the translation entries necessary
-    translation_entries = decoder.full_decode_line(encoded_text, num_scores);
+    //Get only the translation entries necessary, decoding straight from the mmaped file
+    const unsigned char * encoded_text = binary_mmaped + initial_index;
+    translation_entries.resize(decoder.full_decode_line(encoded_text, encoded_text + bytes_toread, num_scores, translation_entries));
 
   }
 
@@ -177,7 +164,7 @@ void QueryEngine::printTargetInfo(std::vector<target_text> target_phrases)
   for (int i = 0; i<entries; i++) {
     std::cout << "Entry " << i+1 << " of " << entries << ":" << std::endl;
     //Print text
-    std::cout << getTargetWordsFromIDs(target_phrases[i].target_phrase, &vocabids) << "\t";
+    std::cout << decoder.getTargetWordsFromIDs(target_phrases[i].target_phrase) << "\t";
 
     //Print probabilities:
     for (int j = 0; j<target_phrases[i].prob.size(); j++) {
@@ -188,9 +175,9 @@ void QueryEngine::printTargetInfo(std::vector<target_text> target_phrases)
     //Print word_all1
     for (int j = 0; j<target_phrases[i].word_all1.size(); j++) {
       if (j%2 == 0) {
-        std::cout << (short)target_phrases[i].word_all1[j] << "-";
+        std::cout << (short)(unsigned char)target_phrases[i].word_all1[j] << "-";
       } else {
-        std::cout << (short)target_phrases[i].word_all1[j] << " ";
+        std::cout << (short)(unsigned char)target_phrases[i].word_all1[j] << " ";
       }
     }
     std::cout << std::endl;
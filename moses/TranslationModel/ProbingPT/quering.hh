@@ -6,7 +6,7 @@
 #include <sys/stat.h> //For finding size of file
 #include "vocabid.hh"
 #include <algorithm> //toLower
-#define API_VERSION 3
+#define API_VERSION 4
 
 
 char * read_binary_file(char * filename);
@@ -14,8 +14,7 @@ char * read_binary_file(char * filename);
 class QueryEngine
 {
   unsigned char * binary_mmaped; //The binari phrase table file
-  std::map<unsigned int, std::string> vocabids;
-  std::map<uint64_t, std::string> source_vocabids;
+  MappedVocab source_vocabids;
 
   Table table;
   char *mem; //Memory for the table, necessary so that we can correctly destroy the object
@@ -30,13 +29,15 @@ public:
   QueryEngine (const char *);
   ~QueryEngine();
   std::pair<bool, std::vector<target_text> > query(StringPiece source_phrase);
-  std::pair<bool, std::vector<target_text> > query(std::vector<uint64_t> source_phrase);
+  //Decodes the translations of source_phrase into the first num_targets entries
+  //of targets, reusing their buffers
+  bool query(const std::vector<uint64_t> &source_phrase, std::vector<target_text> &targets, size_t &num_targets);
   void printTargetInfo(std::vector<target_text> target_phrases);
-  const std::map<unsigned int, std::string> getVocab() const {
+  const MappedVocab &getVocab() const {
     return decoder.get_target_lookup_map();
   }
 
-  const std::map<uint64_t, std::string> getSourceVocab() const {
+  const MappedVocab &getSourceVocab() const {
     return source_vocabids;
   }
 
@@ -146,7 +146,7 @@ void createProbingPT(const char * phrasetable_path, const char * target_path,
 
   serialize_table(mem, size, (basepath + "/probing_hash.dat").c_str());
 
-  serialize_map(&source_vocabids, (basepath + "/source_vocabids").c_str());
+  write_vocab(source_vocabids, (basepath + "/source_vocab.dat").c_str());
 
   delete[] mem;
 
@@ -1,5 +1,9 @@
 #include "vocabid.hh"
 
+#include <algorithm>
+#include "util/exception.hh"
+#include "util/file.hh"
+
 void add_to_map(std::map<uint64_t, std::string> *karta, StringPiece textin)
 {
   //Tokenize
@@ -11,22 +15,49 @@ void add_to_map(std::map<uint64_t, std::string> *karta, StringPiece textin)
   }
 }
 
-void serialize_map(std::map<uint64_t, std::string> *karta, const char* filename)
+MappedVocab::MappedVocab() : entries(0), ids(NULL), offsets(NULL), pool(NULL) {}
+
+void MappedVocab::load(const char * filename)
 {
-  std::ofstream os (filename, std::ios::binary);
-  boost::archive::text_oarchive oarch(os);
+  util::scoped_fd fd(util::OpenReadOrThrow(filename));
+  uint64_t filesize = util::SizeOrThrow(fd.get());
+  UTIL_THROW_IF(filesize < 2 * sizeof(uint64_t), util::Exception,
+                filename << " is too small to be a vocabulary.");
+  util::MapRead(util::LAZY, fd.get(), 0, filesize, mem);
 
-  oarch << *karta;  //Serialise map
-  os.close();
+  const uint64_t * header = reinterpret_cast<const uint64_t *>(mem.get());
+  entries = header[0];
+  //The count, ids and offsets take 2 * entries + 2 words; compared without
+  //multiplying, so that a corrupt count cannot overflow
+  uint64_t words = filesize / sizeof(uint64_t);
+  UTIL_THROW_IF(entries > (words - 2) / 2, util::Exception,
+                filename << " is truncated or not a vocabulary.");
+  ids = header + 1;
+  offsets = ids + entries;
+  pool = reinterpret_cast<const char *>(offsets + entries + 1);
+  //Words are read as [offsets[i], offsets[i + 1]) of the pool, so the
+  //offsets must not decrease and the last one must end the pool
+  uint64_t poolsize = filesize - (pool - (const char *)mem.get());
+  for (uint64_t i = 0; i < entries; ++i) {
+    UTIL_THROW_IF(offsets[i] > offsets[i + 1], util::Exception,
+                  filename << " has a decreasing offset at entry " << i << ".");
+  }
+  UTIL_THROW_IF(offsets[entries] != poolsize, util::Exception,
+                filename << " is truncated or not a vocabulary.");
 }
 
-void read_map(std::map<uint64_t, std::string> *karta, const char* filename)
+bool MappedVocab::find(uint64_t id, StringPiece &word) const
 {
-  std::ifstream is (filename, std::ios::binary);
-  boost::archive::text_iarchive iarch(is);
-
-  iarch >> *karta;
-
-  //Close the stream after we are done.
-  is.close();
+  size_t i;
+  if (id >= 1 && id <= entries && ids[id - 1] == id) {
+    i = id - 1;
+  } else {
+    const uint64_t * found = std::lower_bound(ids, ids + entries, id);
+    if (found == ids + entries || *found != id) {
+      return false;
+    }
+    i = found - ids;
+  }
+  word = get_word(i);
+  return true;
 }
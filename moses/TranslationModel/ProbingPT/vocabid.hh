@@ -1,8 +1,6 @@
-//Serialization
-#include <boost/serialization/serialization.hpp>
-#include <boost/serialization/map.hpp>
-#include <boost/archive/text_iarchive.hpp>
-#include <boost/archive/text_oarchive.hpp>
+#pragma once
+
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <vector>
@@ -10,11 +8,69 @@
 #include <map> //Container
 #include "hash.hh" //Hash of elements
 
+#include "util/mmap.hh"
 #include "util/string_piece.hh"  //Tokenization and work with StringPiece
 #include "util/tokenize_piece.hh"
 
 void add_to_map(std::map<uint64_t, std::string> *karta, StringPiece textin);
 
-void serialize_map(std::map<uint64_t, std::string> *karta, const char* filename);
+/*Vocabulary stored as one contiguous string pool, so that it is mmapped on load
+ instead of deserialised. The file holds the number of entries, their ids in
+ increasing order, the offsets of their strings in the pool (one more than
+ there are entries) and then the pool itself.*/
+class MappedVocab
+{
+  util::scoped_memory mem;
+  uint64_t entries;
+  const uint64_t * ids;
+  const uint64_t * offsets;
+  const char * pool;
+
+public:
+  MappedVocab();
+  void load(const char * filename);
+
+  size_t size() const {
+    return entries;
+  }
+
+  uint64_t get_id(size_t i) const {
+    return ids[i];
+  }
+
+  StringPiece get_word(size_t i) const {
+    return StringPiece(pool + offsets[i], offsets[i + 1] - offsets[i]);
+  }
+
+  //Returns false if there is no such id. Dense ids starting from 1, as the
+  //huffman codes are, are found without searching.
+  bool find(uint64_t id, StringPiece &word) const;
+};
+
+//Writes a map from ids to strings (or byte vectors) in the format of MappedVocab
+template <class Map>
+void write_vocab(const Map &karta, const char * filename)
+{
+  std::vector<uint64_t> ids;
+  std::vector<uint64_t> offsets(1, 0);
+  std::string pool;
+  for (typename Map::const_iterator it = karta.begin(); it != karta.end(); it++) {
+    ids.push_back(it->first);
+    pool.append(it->second.begin(), it->second.end());
+    offsets.push_back(pool.size());
+  }
 
-void read_map(std::map<uint64_t, std::string> *karta, const char* filename);
+  uint64_t entries = ids.size();
+  std::ofstream os (filename, std::ios::binary);
+  os.write((const char *)&entries, sizeof(uint64_t));
+  if (entries) {
+    os.write((const char *)&ids[0], entries * sizeof(uint64_t));
+  }
+  os.write((const char *)&offsets[0], offsets.size() * sizeof(uint64_t));
+  os.write(pool.data(), pool.size());
+  os.close();
+  if (!os) {
+    std::cerr << "Error writing " << filename << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
@@ -0,0 +1,82 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "LoaderSnapshot.h"
+
+#include "Trie.h"
+#include "moses/Phrase.h"
+#include "moses/TargetPhrase.h"
+#include "moses/Timer.h"
+#include "moses/Util.h"
+#include "moses/Word.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+// Does exactly what RuleTableLoaderStandard does with each rule, minus the
+// parsing.
+bool RuleTableLoaderSnapshot::Load(AllOptions const& opts,
+                                   const std::vector<FactorType> &input,
+                                   const std::vector<FactorType> &output,
+                                   const std::string &inFile,
+                                   size_t /* tableLimit */,
+                                   RuleTableTrie &ruleTable)
+{
+  PrintUserTime("Start loading phrase table " + inFile + " from model snapshot");
+
+  ModelSnapshot::RuleFields fields;
+  while (true) {
+    Phrase sourcePhrase;
+    Word *sourceLHS, *targetLHS;
+    TargetPhrase *targetPhrase = new TargetPhrase(&ruleTable);
+    if (!m_reader.Next(sourcePhrase, sourceLHS, *targetPhrase, targetLHS, fields)) {
+      delete targetPhrase;
+      break;
+    }
+
+    targetPhrase->SetAlignmentInfo(fields.alignment);
+    targetPhrase->SetTargetLHS(targetLHS);
+    if (fields.hasSparse) {
+      targetPhrase->SetSparseScore(&ruleTable, fields.sparse);
+    }
+    if (fields.hasProperties) {
+      targetPhrase->SetProperties(fields.properties);
+    }
+
+    UTIL_THROW_IF2(fields.scores.size() != ruleTable.GetNumScoreComponents(),
+                   "Model snapshot does not match " << inFile);
+    targetPhrase->GetScoreBreakdown().Assign(&ruleTable, fields.scores);
+    targetPhrase->EvaluateInIsolation(sourcePhrase, ruleTable.GetFeaturesToApply());
+
+    TargetPhraseCollection::shared_ptr phraseColl
+    = GetOrCreateTargetPhraseCollection(ruleTable, sourcePhrase,
+                                        *targetPhrase, sourceLHS);
+    phraseColl->Add(targetPhrase);
+
+    delete sourceLHS;
+  }
+
+  SortAndPrune(ruleTable);
+
+  return true;
+}
+
+}  // namespace Moses
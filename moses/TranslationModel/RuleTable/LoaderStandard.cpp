@@ -160,6 +160,7 @@ bool RuleTableLoaderStandard::Load(AllOptions const& opts, FormatType format
 
   // reused variables
   vector<float> scoreVector;
+  ModelSnapshot::RuleFields snapshotFields;
   StringPiece line;
   std::string hiero_before, hiero_after;
 
@@ -227,16 +228,31 @@ bool RuleTableLoaderStandard::Load(AllOptions const& opts, FormatType format
 
     ++pipes;  // skip over counts field
 
+    bool hasSparse = false, hasProperties = false;
+    StringPiece sparseString, propertiesString;
     if (++pipes) {
-      StringPiece sparseString(*pipes);
+      hasSparse = true;
+      sparseString = *pipes;
       targetPhrase->SetSparseScore(&ruleTable, sparseString);
     }
 
     if (++pipes) {
-      StringPiece propertiesString(*pipes);
+      hasProperties = true;
+      propertiesString = *pipes;
       targetPhrase->SetProperties(propertiesString);
     }
 
+    if (m_snapshotWriter) {
+      snapshotFields.scores = scoreVector;
+      snapshotFields.alignment = alignString;
+      snapshotFields.hasSparse = hasSparse;
+      snapshotFields.sparse = sparseString;
+      snapshotFields.hasProperties = hasProperties;
+      snapshotFields.properties = propertiesString;
+      m_snapshotWriter->AddRule(sourcePhrase, sourceLHS, *targetPhrase, targetLHS,
+                                snapshotFields);
+    }
+
     targetPhrase->GetScoreBreakdown().Assign(&ruleTable, scoreVector);
     targetPhrase->EvaluateInIsolation(sourcePhrase, ruleTable.GetFeaturesToApply());
 
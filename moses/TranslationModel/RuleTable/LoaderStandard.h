@@ -20,6 +20,7 @@
 #pragma once
 
 #include "Loader.h"
+#include "moses/ModelSnapshot.h"
 
 namespace Moses
 {
@@ -28,6 +29,7 @@ namespace Moses
 class RuleTableLoaderStandard : public RuleTableLoader
 {
 protected:
+  ModelSnapshot::TableWriter *m_snapshotWriter;
 
   bool Load(AllOptions const& opts,
             FormatType format,
@@ -37,6 +39,13 @@ protected:
             size_t tableLimit,
             RuleTableTrie &);
 public:
+  RuleTableLoaderStandard() : m_snapshotWriter(NULL) {}
+
+  //! also record the parsed rules into a warm start image (-model-snapshot)
+  void SetSnapshotWriter(ModelSnapshot::TableWriter *writer) {
+    m_snapshotWriter = writer;
+  }
+
   bool Load(AllOptions const& opts,
             const std::vector<FactorType> &input,
             const std::vector<FactorType> &output,
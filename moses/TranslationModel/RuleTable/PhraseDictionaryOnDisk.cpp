@@ -51,6 +51,27 @@ void PhraseDictionaryOnDisk::Load(AllOptions::ptr const& opts)
 {
   m_options = opts;
   SetFeaturesToApply();
+
+  OnDiskPt::OnDiskWrapper *obj = new OnDiskPt::OnDiskWrapper();
+  obj->BeginLoad(m_filePath);
+
+  UTIL_THROW_IF2(obj->GetMisc("Version") != OnDiskPt::OnDiskWrapper::VERSION_NUM,
+                 "On-disk phrase table is version " <<  obj->GetMisc("Version")
+                 << ". It is not compatible with version " << OnDiskPt::OnDiskWrapper::VERSION_NUM);
+
+  UTIL_THROW_IF2(obj->GetMisc("NumSourceFactors") != m_input.size(),
+                 "On-disk phrase table has " <<  obj->GetMisc("NumSourceFactors") << " source factors."
+                 << ". The ini file specified " << m_input.size() << " source factors");
+
+  UTIL_THROW_IF2(obj->GetMisc("NumTargetFactors") != m_output.size(),
+                 "On-disk phrase table has " <<  obj->GetMisc("NumTargetFactors") << " target factors."
+                 << ". The ini file specified " << m_output.size() << " target factors");
+
+  UTIL_THROW_IF2(obj->GetMisc("NumScores") != m_numScoreComponents,
+                 "On-disk phrase table has " <<  obj->GetMisc("NumScores") << " scores."
+                 << ". The ini file specified " << m_numScoreComponents << " scores");
+
+  m_implementation.reset(obj);
 }
 
 ChartRuleLookupManager *PhraseDictionaryOnDisk::CreateRuleLookupManager(
@@ -68,7 +89,7 @@ OnDiskPt::OnDiskWrapper &PhraseDictionaryOnDisk::GetImplementation()
 {
   OnDiskPt::OnDiskWrapper* dict;
   dict = m_implementation.get();
-  UTIL_THROW_IF2(dict == NULL, "Dictionary object not yet created for this thread");
+  UTIL_THROW_IF2(dict == NULL, "Dictionary object not yet loaded");
   return *dict;
 }
 
@@ -76,35 +97,13 @@ const OnDiskPt::OnDiskWrapper &PhraseDictionaryOnDisk::GetImplementation() const
 {
   OnDiskPt::OnDiskWrapper* dict;
   dict = m_implementation.get();
-  UTIL_THROW_IF2(dict == NULL, "Dictionary object not yet created for this thread");
+  UTIL_THROW_IF2(dict == NULL, "Dictionary object not yet loaded");
   return *dict;
 }
 
 void PhraseDictionaryOnDisk::InitializeForInput(ttasksptr const& ttask)
 {
-  InputType const& source = *ttask->GetSource();
   ReduceCache();
-
-  OnDiskPt::OnDiskWrapper *obj = new OnDiskPt::OnDiskWrapper();
-  obj->BeginLoad(m_filePath);
-
-  UTIL_THROW_IF2(obj->GetMisc("Version") != OnDiskPt::OnDiskWrapper::VERSION_NUM,
-                 "On-disk phrase table is version " <<  obj->GetMisc("Version")
-                 << ". It is not compatible with version " << OnDiskPt::OnDiskWrapper::VERSION_NUM);
-
-  UTIL_THROW_IF2(obj->GetMisc("NumSourceFactors") != m_input.size(),
-                 "On-disk phrase table has " <<  obj->GetMisc("NumSourceFactors") << " source factors."
-                 << ". The ini file specified " << m_input.size() << " source factors");
-
-  UTIL_THROW_IF2(obj->GetMisc("NumTargetFactors") != m_output.size(),
-                 "On-disk phrase table has " <<  obj->GetMisc("NumTargetFactors") << " target factors."
-                 << ". The ini file specified " << m_output.size() << " target factors");
-
-  UTIL_THROW_IF2(obj->GetMisc("NumScores") != m_numScoreComponents,
-                 "On-disk phrase table has " <<  obj->GetMisc("NumScores") << " scores."
-                 << ". The ini file specified " << m_numScoreComponents << " scores");
-
-  m_implementation.reset(obj);
 }
 
 void PhraseDictionaryOnDisk::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
@@ -171,23 +170,12 @@ GetTargetPhraseCollection(const OnDiskPt::PhraseNode *ptNode) const
 {
   TargetPhraseCollection::shared_ptr ret;
 
-  CacheColl &cache = GetCache();
   size_t hash = (size_t) ptNode->GetFilePos();
 
-  CacheColl::iterator iter;
-
-  iter = cache.find(hash);
-
-  if (iter == cache.end()) {
+  if (!FindInCache(hash, ret)) {
     // not in cache, need to look up from phrase table
     ret = GetTargetPhraseCollectionNonCache(ptNode);
-
-    std::pair<TargetPhraseCollection::shared_ptr , clock_t> value(ret, clock());
-    cache[hash] = value;
-  } else {
-    // in cache. just use it
-    iter->second.second = clock();
-    ret = iter->second.first;
+    AddToCache(hash, ret);
   }
 
   return ret;
@@ -29,11 +29,7 @@
 #include "OnDiskPt/Word.h"
 #include "OnDiskPt/PhraseNode.h"
 
-#ifdef WITH_THREADS
-#include <boost/thread/tss.hpp>
-#else
 #include <boost/scoped_ptr.hpp>
-#endif
 
 namespace Moses
 {
@@ -51,11 +47,8 @@ class PhraseDictionaryOnDisk : public PhraseDictionary
   friend class ChartRuleLookupManagerOnDisk;
 
 protected:
-#ifdef WITH_THREADS
-  boost::thread_specific_ptr<OnDiskPt::OnDiskWrapper> m_implementation;
-#else
+  // loaded tables are mapped read-only, so one is shared by all threads
   boost::scoped_ptr<OnDiskPt::OnDiskWrapper> m_implementation;
-#endif
 
   size_t m_maxSpanDefault, m_maxSpanLabelled;
 
@@ -21,15 +21,43 @@
 #include "moses/InputFileStream.h"
 #include "moses/Util.h"
 #include "moses/StaticData.h"
+#include "moses/ModelSnapshot.h"
 #include "Trie.h"
 #include "Loader.h"
 #include "LoaderFactory.h"
+#include "LoaderSnapshot.h"
+#include "LoaderStandard.h"
+#include "util/murmur_hash.hh"
+
+#include <boost/scoped_ptr.hpp>
 
 using namespace std;
 
 namespace Moses
 {
 
+namespace
+{
+// everything besides the rule table file itself that changes how its text
+// is turned into rules
+uint64_t SnapshotFingerprint(const std::string &filePath,
+                             const std::vector<FactorType> &input,
+                             const std::vector<FactorType> &output,
+                             size_t numScoreComponents,
+                             bool wordDeletionEnabled)
+{
+  uint64_t ret = ModelSnapshot::FileFingerprint(filePath);
+  if (!input.empty())
+    ret = util::MurmurHashNative(&input[0], input.size() * sizeof(FactorType), ret);
+  if (!output.empty())
+    ret = util::MurmurHashNative(&output[0], output.size() * sizeof(FactorType), ret);
+  ret = util::MurmurHashNative(&numScoreComponents, sizeof(numScoreComponents), ret);
+  ret = util::MurmurHashNative(&wordDeletionEnabled, sizeof(wordDeletionEnabled), ret);
+  const std::string &delimiter = StaticData::Instance().GetFactorDelimiter();
+  return util::MurmurHashNative(delimiter.data(), delimiter.size(), ret);
+}
+}
+
 RuleTableTrie::~RuleTableTrie()
 {
 }
@@ -39,12 +67,37 @@ void RuleTableTrie::Load(AllOptions::ptr const& opts)
   m_options = opts;
   SetFeaturesToApply();
 
+  ModelSnapshot *snapshot = StaticData::Instance().GetModelSnapshot();
+  uint64_t fingerprint = 0;
+  if (snapshot) {
+    fingerprint = SnapshotFingerprint(m_filePath, m_input, m_output,
+                                      GetNumScoreComponents(),
+                                      opts->unk.word_deletion_enabled);
+    boost::scoped_ptr<ModelSnapshot::TableReader> reader(
+      snapshot->OpenTable(GetScoreProducerDescription(), fingerprint,
+                          m_input, m_output));
+    if (reader) {
+      RuleTableLoaderSnapshot loader(*reader);
+      if (!loader.Load(*opts, m_input, m_output, m_filePath, m_tableLimit, *this)) {
+        throw runtime_error("Error: Loading " + m_filePath);
+      }
+      return;
+    }
+  }
+
   std::auto_ptr<Moses::RuleTableLoader> loader =
     Moses::RuleTableLoaderFactory::Create(m_filePath);
   if (!loader.get()) {
     throw runtime_error("Error: Loading " + m_filePath);
   }
 
+  // only text tables are worth a snapshot
+  RuleTableLoaderStandard *text = dynamic_cast<RuleTableLoaderStandard*>(loader.get());
+  if (snapshot && text) {
+    text->SetSnapshotWriter(&snapshot->RecordTable(GetScoreProducerDescription(),
+                            fingerprint, m_input, m_output));
+  }
+
   bool ret = loader->Load(*opts, m_input, m_output, m_filePath, m_tableLimit, *this);
   if (!ret) {
     throw runtime_error("Error: Loading " + m_filePath);
@@ -25,8 +25,6 @@ void SkeletonPT::InitializeForInput(ttasksptr const& ttask)
 
 void SkeletonPT::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
 {
-  CacheColl &cache = GetCache();
-
   InputPathList::const_iterator iter;
   for (iter = inputPathQueue.begin(); iter != inputPathQueue.end(); ++iter) {
     InputPath &inputPath = **iter;
@@ -38,9 +36,7 @@ void SkeletonPT::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQu
 
     // add target phrase to phrase-table cache
     size_t hash = hash_value(sourcePhrase);
-    std::pair<TargetPhraseCollection::shared_ptr, clock_t>
-    value(tpColl, clock());
-    cache[hash] = value;
+    AddToCache(hash, tpColl);
 
     inputPath.SetTargetPhrases(*this, tpColl, NULL);
   }
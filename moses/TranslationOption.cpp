@@ -36,6 +36,8 @@ TranslationOption::TranslationOption()
   :m_targetPhrase(NULL)
   ,m_inputPath(NULL)
   ,m_sourceWordsRange(NOT_FOUND, NOT_FOUND)
+  ,m_futureScore(0)
+  ,m_weightedScore(0)
 { }
 
 //TODO this should be a factory function!
@@ -45,6 +47,7 @@ TranslationOption::TranslationOption(const Range &range
   , m_inputPath(NULL)
   , m_sourceWordsRange(range)
   , m_futureScore(targetPhrase.GetFutureScore())
+  , m_weightedScore(targetPhrase.GetScoreBreakdown().GetWeightedScore())
 {
 }
 
@@ -80,6 +83,7 @@ void TranslationOption::EvaluateWithSourceContext(const InputType &input)
 {
   const InputPath &inputPath = GetInputPath();
   m_targetPhrase.EvaluateWithSourceContext(input, inputPath);
+  m_weightedScore = GetScoreBreakdown().GetWeightedScore();
 }
 
 const InputPath &TranslationOption::GetInputPath() const
@@ -69,6 +69,7 @@ protected:
   const InputPath		*m_inputPath;
   const Range	m_sourceWordsRange; /*< word position in the input that are covered by this translation option */
   float             m_futureScore; /*< estimate of total cost when using this translation option, includes language model probabilities */
+  float             m_weightedScore; /*< weighted sum of the score breakdown, added to every hypothesis that uses this option */
 
   // typedef std::map<const LexicalReordering*, Scores> _ScoreCacheMap;
   // _ScoreCacheMap m_lexReorderingScores;
@@ -135,6 +136,13 @@ public:
     return m_futureScore;
   }
 
+  /** weighted score of GetScoreBreakdown(), kept up to date by the
+   * evaluation methods of this class. Whoever changes the breakdown through
+   * the non-const accessor must call UpdateScore() afterwards. */
+  inline float GetWeightedScore() const {
+    return m_weightedScore;
+  }
+
   /** return true if the source phrase translates into nothing */
   inline bool IsDeletionOption() const {
     return m_targetPhrase.GetSize() == 0;
@@ -153,6 +161,7 @@ public:
 
   void UpdateScore(ScoreComponentCollection *futureScoreBreakdown = NULL) {
     m_targetPhrase.UpdateScore(futureScoreBreakdown);
+    m_weightedScore = GetScoreBreakdown().GetWeightedScore();
   }
 
   /** returns cached scores */
@@ -614,13 +614,18 @@ TranslationOptionCollection::
 CacheLexReordering()
 {
   size_t const stop = m_source.GetSize();
+  // all options of the sentence, so that a table can batch their lookups
+  vector<TranslationOption*> tos;
   typedef StatefulFeatureFunction sfFF;
   BOOST_FOREACH(sfFF const* ff, sfFF::GetStatefulFeatureFunctions()) {
     if (typeid(*ff) != typeid(LexicalReordering)) continue;
     LexicalReordering const& lr = static_cast<const LexicalReordering&>(*ff);
-    for (size_t s = 0 ; s < stop ; s++)
-      BOOST_FOREACH(TranslationOptionList& tol, m_collection[s])
-      lr.SetCache(tol);
+    if (tos.empty()) {
+      for (size_t s = 0 ; s < stop ; s++)
+        BOOST_FOREACH(TranslationOptionList& tol, m_collection[s])
+        tos.insert(tos.end(), tol.begin(), tol.end());
+    }
+    lr.SetCache(tos);
   }
 }
 
@@ -148,5 +148,61 @@ BOOST_AUTO_TEST_CASE(positions)
 }
 
 
+BOOST_AUTO_TEST_CASE(packed)
+{
+  // compare against a plain vector<bool>, across block boundaries and
+  // beyond the inline storage
+  size_t sizes[] = {1, 63, 64, 65, 130, 256, 257, 300};
+  for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k) {
+    size_t size = sizes[k];
+    vector<bool> ref(size);
+    for (size_t i = 0; i < size; ++i) ref[i] = (i * 7 + size) % 5 < 2;
+    Bitmap wbm(size, ref);
+
+    size_t covered = 0, firstGap = NOT_FOUND, lastGap = NOT_FOUND, last = NOT_FOUND;
+    for (size_t i = 0; i < size; ++i) {
+      BOOST_CHECK_EQUAL(wbm.GetValue(i), ref[i]);
+      if (ref[i]) {
+        ++covered;
+        last = i;
+      } else {
+        if (firstGap == NOT_FOUND) firstGap = i;
+        lastGap = i;
+      }
+    }
+    BOOST_CHECK_EQUAL(wbm.GetNumWordsCovered(), covered);
+    BOOST_CHECK_EQUAL(wbm.GetFirstGapPos(), firstGap);
+    BOOST_CHECK_EQUAL(wbm.GetLastGapPos(), lastGap);
+    BOOST_CHECK_EQUAL(wbm.GetLastPos(), last);
+
+    for (size_t i = 0; i < size; ++i) {
+      size_t left = i;
+      while (left && !ref[left - 1]) --left;
+      BOOST_CHECK_EQUAL(wbm.GetEdgeToTheLeftOf(i), left);
+      size_t right = i + 1;
+      while (right < size && !ref[right]) ++right;
+      BOOST_CHECK_EQUAL(wbm.GetEdgeToTheRightOf(i), right - 1);
+    }
+
+    // fill the first gap with a range spanning blocks where possible
+    if (firstGap != NOT_FOUND) {
+      size_t end = firstGap;
+      while (end + 1 < size && !ref[end + 1] && end - firstGap < 70) ++end;
+      Range range(firstGap, end);
+      BOOST_CHECK(!wbm.Overlap(range));
+      Bitmap next(wbm, range);
+      BOOST_CHECK(next.Overlap(range));
+      BOOST_CHECK_EQUAL(next.GetNumWordsCovered(), covered + end - firstGap + 1);
+
+      for (size_t i = firstGap; i <= end; ++i) ref[i] = true;
+      Bitmap same(size, ref);
+      BOOST_CHECK(same == next);
+      BOOST_CHECK_EQUAL(same.hash(), next.hash());
+      BOOST_CHECK_EQUAL(same.GetFirstGapPos(), next.GetFirstGapPos());
+      BOOST_CHECK(!(same == wbm));
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -0,0 +1,152 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2009 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_WorkStealingDeque_h
+#define moses_WorkStealingDeque_h
+
+#ifdef WITH_THREADS
+
+#include <vector>
+#include <boost/atomic.hpp>
+
+namespace Moses
+{
+
+/** Lock-free work-stealing deque of pointers (Chase & Lev, 2005, with the
+ * memory orderings of Le et al., 2013).
+ *
+ * Only the owning thread may call Push() and Pop(), which work on the
+ * bottom end without locking. Any thread may call Steal(), which takes
+ * from the top end. The buffer grows on demand; retired buffers are kept
+ * until the deque is destroyed, so that concurrent thieves never read
+ * freed memory.
+ */
+template<typename T>
+class WorkStealingDeque
+{
+public:
+  explicit WorkStealingDeque(size_t initialCapacity = 64)
+    : m_top(0), m_bottom(0) {
+    size_t cap = 1;
+    while (cap < initialCapacity) cap *= 2;
+    m_buffer.store(new Buffer(cap), boost::memory_order_relaxed);
+  }
+
+  ~WorkStealingDeque() {
+    delete m_buffer.load(boost::memory_order_relaxed);
+    for (size_t i = 0; i < m_retired.size(); ++i) delete m_retired[i];
+  }
+
+  //! owner only: add an item at the bottom
+  void Push(T *item) {
+    long b = m_bottom.load(boost::memory_order_relaxed);
+    long t = m_top.load(boost::memory_order_acquire);
+    Buffer *buf = m_buffer.load(boost::memory_order_relaxed);
+    if (b - t > static_cast<long>(buf->mask)) {
+      buf = Grow(buf, b, t);
+    }
+    buf->Put(b, item);
+    boost::atomic_thread_fence(boost::memory_order_release);
+    m_bottom.store(b + 1, boost::memory_order_relaxed);
+  }
+
+  //! owner only: take the most recently pushed item, or NULL if empty
+  T *Pop() {
+    long b = m_bottom.load(boost::memory_order_relaxed) - 1;
+    Buffer *buf = m_buffer.load(boost::memory_order_relaxed);
+    m_bottom.store(b, boost::memory_order_relaxed);
+    boost::atomic_thread_fence(boost::memory_order_seq_cst);
+    long t = m_top.load(boost::memory_order_relaxed);
+    if (t > b) {
+      m_bottom.store(b + 1, boost::memory_order_relaxed);
+      return NULL;
+    }
+    T *item = buf->Get(b);
+    if (t == b) {
+      // last item: race against thieves
+      if (!m_top.compare_exchange_strong(t, t + 1,
+                                         boost::memory_order_seq_cst,
+                                         boost::memory_order_relaxed))
+        item = NULL;
+      m_bottom.store(b + 1, boost::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  //! any thread: take the oldest item, or NULL if empty or lost a race
+  T *Steal() {
+    long t = m_top.load(boost::memory_order_acquire);
+    boost::atomic_thread_fence(boost::memory_order_seq_cst);
+    long b = m_bottom.load(boost::memory_order_acquire);
+    if (t >= b) return NULL;
+    Buffer *buf = m_buffer.load(boost::memory_order_acquire);
+    T *item = buf->Get(t);
+    if (!m_top.compare_exchange_strong(t, t + 1,
+                                       boost::memory_order_seq_cst,
+                                       boost::memory_order_relaxed))
+      return NULL;
+    return item;
+  }
+
+  //! approximate; exact only when called by the owner with no thieves
+  bool Empty() const {
+    return m_bottom.load(boost::memory_order_relaxed)
+           <= m_top.load(boost::memory_order_relaxed);
+  }
+
+private:
+  struct Buffer {
+    size_t mask;
+    boost::atomic<T*> *slots;
+
+    explicit Buffer(size_t capacity)
+      : mask(capacity - 1), slots(new boost::atomic<T*>[capacity]) {}
+    ~Buffer() {
+      delete[] slots;
+    }
+    T *Get(long i) const {
+      return slots[i & mask].load(boost::memory_order_relaxed);
+    }
+    void Put(long i, T *item) {
+      slots[i & mask].store(item, boost::memory_order_relaxed);
+    }
+  };
+
+  Buffer *Grow(Buffer *old, long b, long t) {
+    Buffer *buf = new Buffer(2 * (old->mask + 1));
+    for (long i = t; i < b; ++i) buf->Put(i, old->Get(i));
+    m_retired.push_back(old);
+    m_buffer.store(buf, boost::memory_order_release);
+    return buf;
+  }
+
+  boost::atomic<long> m_top;
+  boost::atomic<long> m_bottom;
+  boost::atomic<Buffer*> m_buffer;
+  std::vector<Buffer*> m_retired; // owner only
+
+  WorkStealingDeque(WorkStealingDeque const&);
+  void operator=(WorkStealingDeque const&);
+};
+
+}
+
+#endif // WITH_THREADS
+#endif
@@ -8,9 +8,11 @@
 #include <cmath>
 #include <algorithm>
 #include <cstdio>
+#include <boost/functional/hash.hpp>
 #include "moses/TrellisPathList.h"
 #include "moses/TrellisPath.h"
 // #include "moses/StaticData.h"
+#include "moses/ThreadPool.h"
 #include "moses/Util.h"
 #include "mbr.h"
 
@@ -35,21 +37,36 @@ using namespace Moses;
 int BLEU_ORDER = 4;
 int SMOOTH = 1;
 float min_interval = 1e-4;
-void extract_ngrams(const vector<const Factor* >& sentence, map < vector < const Factor* >, int >  & allngrams)
+void extract_ngrams(const vector<const Factor* >& sentence, NgramCounts& allngrams)
 {
-  vector< const Factor* > ngram;
+  allngrams.assign(BLEU_ORDER, vector<pair<size_t, int> >());
+  for(int i =0; i < (int)sentence.size(); i++) {
+    size_t ngram = 0;
+    for (int k = 0; k < BLEU_ORDER && i+k < (int)sentence.size(); k++) {
+      boost::hash_combine(ngram, sentence[i+k]);
+      allngrams[k].push_back(make_pair(ngram, 1));
+    }
+  }
+
+  // sort by hash and add up the counts of repeated n-grams
   for (int k = 0; k < BLEU_ORDER; k++) {
-    for(int i =0; i < max((int)sentence.size()-k,0); i++) {
-      for ( int j = i; j<= i+k; j++) {
-        ngram.push_back(sentence[j]);
+    vector<pair<size_t, int> >& ngrams = allngrams[k];
+    sort(ngrams.begin(), ngrams.end());
+    size_t last = 0;
+    for (size_t i = 1; i < ngrams.size(); i++) {
+      if (ngrams[i].first == ngrams[last].first) {
+        ngrams[last].second += ngrams[i].second;
+      } else {
+        ngrams[++last] = ngrams[i];
       }
-      ++allngrams[ngram];
-      ngram.clear();
+    }
+    if (!ngrams.empty()) {
+      ngrams.resize(last + 1);
     }
   }
 }
 
-float calculate_score(const vector< vector<const Factor*> > & sents, int ref, int hyp,  vector < map < vector < const Factor *>, int > > & ngram_stats )
+float calculate_score(const vector< vector<const Factor*> > & sents, int ref, int hyp,  const vector<NgramCounts> & ngram_stats )
 {
   int comps_n = 2*BLEU_ORDER+1;
   vector<int> comps(comps_n);
@@ -62,14 +79,22 @@ float calculate_score(const vector< vector<const Factor*> > & sents, int ref, in
     comps[2*i+1] = max(hyp_length-i,0);
   }
 
-  map< vector < const Factor * > ,int > & hyp_ngrams = ngram_stats[hyp] ;
-  map< vector < const Factor * >, int > & ref_ngrams = ngram_stats[ref] ;
-
-  for (map< vector< const Factor * >, int >::iterator it = hyp_ngrams.begin();
-       it != hyp_ngrams.end(); it++) {
-    map< vector< const Factor * >, int >::iterator ref_it = ref_ngrams.find(it->first);
-    if(ref_it != ref_ngrams.end()) {
-      comps[2* (it->first.size()-1)] += min(ref_it->second,it->second);
+  // clipped counts, intersecting the sorted n-grams of both sides
+  for (int i =0; i<BLEU_ORDER; i++) {
+    const vector<pair<size_t, int> > & hyp_ngrams = ngram_stats[hyp][i];
+    const vector<pair<size_t, int> > & ref_ngrams = ngram_stats[ref][i];
+    vector<pair<size_t, int> >::const_iterator it = hyp_ngrams.begin();
+    vector<pair<size_t, int> >::const_iterator ref_it = ref_ngrams.begin();
+    while (it != hyp_ngrams.end() && ref_it != ref_ngrams.end()) {
+      if (it->first < ref_it->first) {
+        ++it;
+      } else if (ref_it->first < it->first) {
+        ++ref_it;
+      } else {
+        comps[2*i] += min(ref_it->second,it->second);
+        ++it;
+        ++ref_it;
+      }
     }
   }
   comps[comps_n-1] = sents[ref].size();
@@ -89,6 +114,74 @@ float calculate_score(const vector< vector<const Factor*> > & sents, int ref, in
   return exp(logbleu);
 }
 
+namespace
+{
+
+/* The expected loss of the candidates first, first+stride, ... and the
+   least of them, as (loss, index).  A candidate is dropped as soon as its
+   loss exceeds the least one so far. */
+void min_mbr_loss(const vector< vector<const Factor*> > & translations, const vector<NgramCounts> & ngram_stats,
+                  const vector<float> & joint_prob_vec, float marginal, size_t first, size_t stride,
+                  pair<float, int> & best)
+{
+  float bleu, weightedLoss;
+  float weightedLossCumul = 0;
+  float minMBRLoss = 1000000;
+  int minMBRLossIdx = -1;
+
+  for (size_t i = first; i < translations.size(); i += stride) {
+    weightedLossCumul = 0;
+    for (size_t j = 0; j < translations.size(); j++) {
+      if ( i != j) {
+        bleu = calculate_score(translations, j, i,ngram_stats );
+        weightedLoss = ( 1 - bleu) * ( joint_prob_vec[j]/marginal);
+        weightedLossCumul += weightedLoss;
+        if (weightedLossCumul > minMBRLoss)
+          break;
+      }
+    }
+    if (weightedLossCumul < minMBRLoss) {
+      minMBRLoss = weightedLossCumul;
+      minMBRLossIdx = i;
+    }
+  }
+  best = make_pair(minMBRLoss, minMBRLossIdx);
+}
+
+#ifdef WITH_THREADS
+/** Computes min_mbr_loss for one share of the candidates on a helper thread */
+class MBRLossTask : public Task
+{
+public:
+  MBRLossTask(const vector< vector<const Factor*> > & translations, const vector<NgramCounts> & ngram_stats,
+              const vector<float> & joint_prob_vec, float marginal, size_t first, size_t stride,
+              pair<float, int> & best, size_t &remaining, boost::mutex &mutex,
+              boost::condition_variable &done)
+    : m_translations(translations), m_ngramStats(ngram_stats), m_jointProbs(joint_prob_vec)
+    , m_marginal(marginal), m_first(first), m_stride(stride), m_best(best)
+    , m_remaining(remaining), m_mutex(mutex), m_done(done) {}
+
+  virtual void Run() {
+    min_mbr_loss(m_translations, m_ngramStats, m_jointProbs, m_marginal, m_first, m_stride, m_best);
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (--m_remaining == 0) m_done.notify_all();
+  }
+
+private:
+  const vector< vector<const Factor*> > & m_translations;
+  const vector<NgramCounts> & m_ngramStats;
+  const vector<float> & m_jointProbs;
+  float m_marginal;
+  size_t m_first, m_stride;
+  pair<float, int> & m_best;
+  size_t &m_remaining;
+  boost::mutex &m_mutex;
+  boost::condition_variable &m_done;
+};
+#endif
+
+}
+
 const TrellisPath doMBR(const TrellisPathList& nBestList, AllOptions const& opts)
 {
   float marginal = 0;
@@ -96,7 +189,7 @@ const TrellisPath doMBR(const TrellisPathList& nBestList, AllOptions const& opts
   vector<float> joint_prob_vec;
   vector< vector<const Factor*> > translations;
   float joint_prob;
-  vector< map < vector <const Factor *>, int > > ngram_stats;
+  vector<NgramCounts> ngram_stats;
 
   TrellisPathList::const_iterator iter;
 
@@ -121,37 +214,49 @@ const TrellisPath doMBR(const TrellisPathList& nBestList, AllOptions const& opts
     GetOutputFactors(path, oFactors[0], translation);
 
     // collect n-gram counts
-    map < vector < const Factor *>, int > counts;
-    extract_ngrams(translation,counts);
+    ngram_stats.push_back(NgramCounts());
+    extract_ngrams(translation,ngram_stats.back());
 
-    ngram_stats.push_back(counts);
     translations.push_back(translation);
   }
 
-  vector<float> mbr_loss;
-  float bleu, weightedLoss;
-  float weightedLossCumul = 0;
+  /* Main MBR computation done here, the candidates shared out among the threads */
+  size_t shares = 1;
+#ifdef WITH_THREADS
+  shares = max<size_t>(min(opts.mbr.threads, translations.size()), 1);
+#endif
+  vector<pair<float, int> > best(shares);
+#ifdef WITH_THREADS
+  size_t remaining = shares - 1;
+  boost::mutex mutex;
+  boost::condition_variable finished;
+  if (remaining) {
+    // the decoding thread takes the first share itself
+    ThreadPool &pool = ThreadPool::Shared(opts.mbr.threads - 1);
+    for (size_t s = 1; s < shares; ++s) {
+      boost::shared_ptr<Task> task(new MBRLossTask(translations, ngram_stats, joint_prob_vec, marginal,
+                                   s, shares, best[s], remaining, mutex, finished));
+      pool.Submit(task);
+    }
+  }
+#endif
+  min_mbr_loss(translations, ngram_stats, joint_prob_vec, marginal, 0, shares, best[0]);
+#ifdef WITH_THREADS
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    while (remaining) finished.wait(lock);
+  }
+#endif
+
+  // the first candidate with the least loss, whatever the number of shares
   float minMBRLoss = 1000000;
   int minMBRLossIdx = -1;
-
-  /* Main MBR computation done here */
-  iter = nBestList.begin();
-  for (unsigned int i = 0; i < nBestList.GetSize(); i++) {
-    weightedLossCumul = 0;
-    for (unsigned int j = 0; j < nBestList.GetSize(); j++) {
-      if ( i != j) {
-        bleu = calculate_score(translations, j, i,ngram_stats );
-        weightedLoss = ( 1 - bleu) * ( joint_prob_vec[j]/marginal);
-        weightedLossCumul += weightedLoss;
-        if (weightedLossCumul > minMBRLoss)
-          break;
-      }
-    }
-    if (weightedLossCumul < minMBRLoss) {
-      minMBRLoss = weightedLossCumul;
-      minMBRLossIdx = i;
+  for (size_t s = 0; s < shares; ++s) {
+    if (best[s].second >= 0 && (minMBRLossIdx < 0 || best[s].first < minMBRLoss
+                                || (best[s].first == minMBRLoss && best[s].second < minMBRLossIdx))) {
+      minMBRLoss = best[s].first;
+      minMBRLossIdx = best[s].second;
     }
-    iter++;
   }
   /* Find sentence that minimises Bayes Risk under 1- BLEU loss */
   return nBestList.at(minMBRLossIdx);
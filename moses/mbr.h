@@ -23,6 +23,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #define moses_cmd_mbr_h
 #include "moses/parameters/AllOptions.h"
 
+//! n-gram counts of a translation for each order: (hash of the n-gram, count), sorted by hash
+typedef std::vector<std::vector<std::pair<size_t, int> > > NgramCounts;
+
 Moses::TrellisPath const
 doMBR(Moses::TrellisPathList const& nBestList, Moses::AllOptions const& opts);
 
@@ -33,7 +36,6 @@ GetOutputFactors(const Moses::TrellisPath &path, Moses::FactorType const f,
 float
 calculate_score(const std::vector< std::vector<const Moses::Factor*> > & sents,
                 int ref, int hyp,
-                std::vector<std::map<std::vector<const Moses::Factor*>,int> > &
-                ngram_stats );
+                const std::vector<NgramCounts> & ngram_stats );
 
 #endif
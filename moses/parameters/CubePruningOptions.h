@@ -13,6 +13,7 @@ namespace Moses
     size_t  diversity;
     bool lazy_scoring;
     bool deterministic_search;
+    bool stats; // report pops per second for each sentence
 
     bool init(Parameter const& param);
     CubePruningOptions(Parameter const& param);
@@ -16,6 +16,9 @@ namespace Moses
     , beam_width(DEFAULT_BEAM_WIDTH)
     , timeout(0)
     , consensus(false)
+    , sentence_arena(false)
+    , expansion_threads(1)
+    , prefetch_window(8)
     , early_discarding_threshold(DEFAULT_EARLY_DISCARDING_THRESHOLD)
     , trans_opt_threshold(DEFAULT_TRANSLATION_OPTION_THRESHOLD)
   { }
@@ -49,6 +52,9 @@ namespace Moses
 
     param.SetParameter(consensus, "consensus-decoding", false);
     param.SetParameter(disable_discarding, "disable-discarding", false);
+    param.SetParameter(sentence_arena, "sentence-arena", false);
+    param.SetParameter(expansion_threads, "expansion-threads", size_t(1));
+    param.SetParameter(prefetch_window, "prefetch-window", size_t(8));
     
     // transformation to log of a few scores
     beam_width = TransformScore(beam_width);
@@ -27,6 +27,10 @@ namespace Moses
     int timeout;
 
     bool consensus; //! Use Consensus decoding  (DeNero et al 2009)
+
+    bool sentence_arena; //! allocate hypotheses and FF states from a per-sentence arena
+    size_t expansion_threads; //! threads expanding the hypotheses of one stack (normal search)
+    size_t prefetch_window; //! translation options to prefetch LM state for ahead of scoring (0: off)
     
     // reordering options
     // bool  reorderingConstraint; //! use additional reordering constraints
@@ -3,6 +3,7 @@
 #include "Translator.h"
 #include "TranslationRequest.h"
 #include "Server.h"
+#include "moses/StaticData.h"
 
 namespace MosesServer
 {
@@ -13,7 +14,9 @@ using namespace Moses;
 Translator::
 Translator(Server& server)
   : m_server(server),
-    m_threadPool(server.options().numThreads)
+    m_threadPool(server.options().numThreads,
+                 StaticData::Instance().UseWorkStealing(),
+                 StaticData::Instance().PinThreads())
 {
   // signature and help strings are documentation -- the client
   // can query this information with a system.methodSignature and
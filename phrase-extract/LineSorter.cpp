@@ -0,0 +1,169 @@
+/***********************************************************************
+ Moses - factored phrase-based language decoder
+ Copyright (C) 2010 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#include "LineSorter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <vector>
+
+#include "OutputFileStream.h"
+#include "util/exception.hh"
+#include "util/file_piece.hh"
+#include "util/file_stream.hh"
+#include "util/string_piece.hh"
+
+namespace MosesTraining
+{
+
+namespace
+{
+
+// the lines of buffer in byte order, without their '\n'
+void SortLines(const std::string &buffer, std::vector<StringPiece> &lines)
+{
+  lines.clear();
+  const char *begin = buffer.data();
+  const char *end = begin + buffer.size();
+  while (begin != end) {
+    const char *newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+    UTIL_THROW_IF2(!newline, "Line without a terminating newline");
+    lines.push_back(StringPiece(begin, newline - begin));
+    begin = newline + 1;
+  }
+  std::sort(lines.begin(), lines.end());
+}
+
+template <class Out> void WriteLines(const std::vector<StringPiece> &lines, bool unique, Out &out)
+{
+  for (size_t i = 0; i < lines.size(); ++i) {
+    if (unique && i > 0 && lines[i] == lines[i - 1]) {
+      continue;
+    }
+    out.write(lines[i].data(), lines[i].size());
+    out.put('\n');
+  }
+}
+
+struct RunLine {
+  StringPiece line;
+  size_t run;
+};
+
+// orders the priority queue of the merge by line, then by run
+struct LaterRunLine {
+  bool operator()(const RunLine &a, const RunLine &b) const {
+    if (a.line == b.line) {
+      return a.run > b.run;
+    }
+    return b.line < a.line;
+  }
+};
+
+}
+
+LineSorter::LineSorter(const std::string &outputFile, const std::string &tempPrefix,
+                       size_t bufferSize, bool unique)
+  : m_outputFile(outputFile)
+  , m_tempPrefix(tempPrefix)
+  , m_bufferSize(bufferSize)
+  , m_unique(unique)
+{
+}
+
+LineSorter::~LineSorter()
+{
+}
+
+void LineSorter::Add(const std::string &lines)
+{
+  m_buffer += lines;
+  if (m_buffer.size() >= m_bufferSize) {
+    WriteRun();
+  }
+}
+
+void LineSorter::WriteRun()
+{
+  std::vector<StringPiece> lines;
+  SortLines(m_buffer, lines);
+
+  m_runs.push_back(new util::scoped_fd(util::MakeTemp(m_tempPrefix)));
+  util::FileStream run(m_runs.back().get(), 1 << 20);
+  WriteLines(lines, m_unique, run);
+  run.flush();
+
+  // keeps the capacity for the next run
+  m_buffer.clear();
+}
+
+void LineSorter::Close()
+{
+  Moses::OutputFileStream out;
+  UTIL_THROW_IF2(!out.Open(m_outputFile), "Cannot open " << m_outputFile);
+
+  if (m_runs.empty()) {
+    std::vector<StringPiece> lines;
+    SortLines(m_buffer, lines);
+    WriteLines(lines, m_unique, out);
+  } else {
+    if (!m_buffer.empty()) {
+      WriteRun();
+    }
+
+    // each FilePiece closes the file of its run
+    boost::ptr_vector<util::FilePiece> runs;
+    std::priority_queue<RunLine, std::vector<RunLine>, LaterRunLine> queue;
+    for (size_t i = 0; i < m_runs.size(); ++i) {
+      util::SeekOrThrow(m_runs[i].get(), 0);
+      runs.push_back(new util::FilePiece(m_runs[i].release()));
+      RunLine next;
+      next.run = i;
+      if (runs.back().ReadLineOrEOF(next.line, '\n', false)) {
+        queue.push(next);
+      }
+    }
+    m_runs.clear();
+
+    std::string last;
+    bool first = true;
+    while (!queue.empty()) {
+      RunLine next = queue.top();
+      queue.pop();
+      if (!m_unique || first || next.line != StringPiece(last)) {
+        out.write(next.line.data(), next.line.size());
+        out.put('\n');
+        if (m_unique) {
+          last.assign(next.line.data(), next.line.size());
+        }
+        first = false;
+      }
+      // invalidates the line just written
+      if (runs[next.run].ReadLineOrEOF(next.line, '\n', false)) {
+        queue.push(next);
+      }
+    }
+  }
+
+  std::string().swap(m_buffer);
+  out.Close();
+}
+
+}
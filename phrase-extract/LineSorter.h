@@ -0,0 +1,68 @@
+/***********************************************************************
+ Moses - factored phrase-based language decoder
+ Copyright (C) 2010 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+
+#include <string>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include "util/file.hh"
+
+namespace MosesTraining
+{
+
+/** External sort of text lines in byte order, the order of LC_ALL=C sort.
+ *
+ * Lines are kept in memory until they take up the buffer size, then sorted
+ * and written to a temporary file as a run.  Close() merges the runs into
+ * the output file, which is compressed if its name ends in ".gz".
+ */
+class LineSorter
+{
+public:
+  /** tempPrefix is passed to util::MakeTemp, e.g. "/tmp/extract".
+   *  With unique, repeated lines are written once, as sort | uniq does.
+   */
+  LineSorter(const std::string &outputFile, const std::string &tempPrefix,
+             size_t bufferSize, bool unique = false);
+  ~LineSorter();
+
+  //! one or more lines, each terminated by '\n'
+  void Add(const std::string &lines);
+
+  //! sort and write the output file
+  void Close();
+
+private:
+  std::string m_outputFile;
+  std::string m_tempPrefix;
+  size_t m_bufferSize;
+  bool m_unique;
+
+  std::string m_buffer;
+  boost::ptr_vector<util::scoped_fd> m_runs; // temporary files, already unlinked
+
+  void WriteRun();
+
+  LineSorter(const LineSorter &);
+  LineSorter &operator=(const LineSorter &);
+};
+
+}
@@ -0,0 +1,113 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2012- University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#include "LineSorter.h"
+#include "InputFileStream.h"
+
+#define  BOOST_TEST_MODULE MosesTrainingLineSorter
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace MosesTraining;
+using namespace std;
+
+namespace
+{
+
+struct TempFiles {
+  boost::filesystem::path prefix;
+
+  TempFiles() : prefix(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()) {}
+  ~TempFiles() {
+    boost::filesystem::remove(Name("out.gz"));
+  }
+
+  string Name(const string &suffix) const {
+    return prefix.string() + suffix;
+  }
+};
+
+vector<string> MakeLines()
+{
+  vector<string> lines;
+  for (size_t i = 0; i < 5000; ++i) {
+    ostringstream line;
+    line << "w" << (i * 7919) % 997 << " ||| " << i % 13 << " |||";
+    lines.push_back(line.str());
+  }
+  // bytes above 127 sort after ASCII, as with LC_ALL=C
+  lines.push_back("\xc3\xa9 ||| 1 |||");
+  lines.push_back("");
+  return lines;
+}
+
+vector<string> Sort(const vector<string> &lines, size_t bufferSize, bool unique, const TempFiles &temp)
+{
+  {
+    LineSorter sorter(temp.Name("out.gz"), temp.Name("run."), bufferSize, unique);
+    for (size_t i = 0; i < lines.size(); ++i) {
+      sorter.Add(lines[i] + "\n");
+    }
+    sorter.Close();
+  }
+  Moses::InputFileStream in(temp.Name("out.gz"));
+  vector<string> sorted;
+  string line;
+  while (getline(in, line)) {
+    sorted.push_back(line);
+  }
+  return sorted;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(sort_in_memory)
+{
+  TempFiles temp;
+  vector<string> lines = MakeLines();
+  vector<string> sorted = Sort(lines, 1 << 30, false, temp);
+  std::sort(lines.begin(), lines.end());
+  BOOST_CHECK(sorted == lines);
+}
+
+BOOST_AUTO_TEST_CASE(sort_and_merge_runs)
+{
+  TempFiles temp;
+  vector<string> lines = MakeLines();
+  // a run every few hundred lines
+  vector<string> sorted = Sort(lines, 4096, false, temp);
+  std::sort(lines.begin(), lines.end());
+  BOOST_CHECK(sorted == lines);
+}
+
+BOOST_AUTO_TEST_CASE(unique_across_runs)
+{
+  TempFiles temp;
+  vector<string> lines = MakeLines();
+  vector<string> sorted = Sort(lines, 4096, true, temp);
+  std::sort(lines.begin(), lines.end());
+  lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+  BOOST_CHECK(sorted == lines);
+}
@@ -19,12 +19,22 @@
 #include <set>
 #include <vector>
 #include <limits>
+#include <algorithm>
+#include <deque>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#endif
 
 #include "SentenceAlignment.h"
 #include "tables-core.h"
 #include "InputFileStream.h"
 #include "OutputFileStream.h"
 #include "PhraseExtractionOptions.h"
+#include "LineSorter.h"
+#include "moses/ThreadPool.h"
 
 using namespace std;
 using namespace MosesTraining;
@@ -89,11 +99,11 @@ public:
   ExtractTask(
     size_t id, SentenceAlignment &sentence,
     PhraseExtractionOptions &initoptions,
-    Moses::OutputFileStream &extractFile,
-    Moses::OutputFileStream &extractFileInv,
-    Moses::OutputFileStream &extractFileOrientation,
-    Moses::OutputFileStream &extractFileContext,
-    Moses::OutputFileStream &extractFileContextInv):
+    std::ostream &extractFile,
+    std::ostream &extractFileInv,
+    std::ostream &extractFileOrientation,
+    std::ostream &extractFileContext,
+    std::ostream &extractFileContextInv):
     m_sentence(sentence),
     m_options(initoptions),
     m_extractFile(extractFile),
@@ -118,11 +128,64 @@ private:
 
   SentenceAlignment &m_sentence;
   const PhraseExtractionOptions &m_options;
-  Moses::OutputFileStream &m_extractFile;
-  Moses::OutputFileStream &m_extractFileInv;
-  Moses::OutputFileStream &m_extractFileOrientation;
-  Moses::OutputFileStream &m_extractFileContext;
-  Moses::OutputFileStream &m_extractFileContextInv;
+  std::ostream &m_extractFile;
+  std::ostream &m_extractFileInv;
+  std::ostream &m_extractFileOrientation;
+  std::ostream &m_extractFileContext;
+  std::ostream &m_extractFileContextInv;
+};
+
+enum ExtractFileType {
+  EXTRACT,
+  EXTRACT_INV,
+  EXTRACT_ORIENTATION,
+  EXTRACT_CONTEXT,
+  EXTRACT_CONTEXT_INV,
+  NUM_EXTRACT_FILES
+};
+
+/** The extract files, or the sorters that write them when extraction is done.
+ */
+class ExtractOutput
+{
+public:
+  Moses::OutputFileStream *files[NUM_EXTRACT_FILES]; // NULL if not written
+  boost::scoped_ptr<LineSorter> sorters[NUM_EXTRACT_FILES]; // NULL if not sorted
+
+  void Write(ExtractFileType type, const std::string &lines) {
+    if (sorters[type]) {
+      sorters[type]->Add(lines);
+    } else if (files[type]) {
+      *files[type] << lines;
+    }
+  }
+};
+
+/** Extracts the phrases of a block of sentences into memory, so that blocks
+ *  can be extracted in parallel and still be written in input order.
+ */
+class ExtractBlockTask : public Moses::Task
+{
+public:
+  ExtractBlockTask(PhraseExtractionOptions &options)
+    : m_options(options)
+    , m_done(false) {}
+
+  std::vector<SentenceAlignment> sentences;
+
+  void Run();
+
+  //! waits until the block has been extracted
+  void Write(ExtractOutput &output);
+
+private:
+  PhraseExtractionOptions &m_options;
+  std::ostringstream m_extracted[NUM_EXTRACT_FILES];
+  bool m_done;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+  boost::condition_variable m_finished;
+#endif
 };
 }
 
@@ -133,7 +196,8 @@ int main(int argc, char* argv[])
 
   if (argc < 6) {
     cerr << "syntax: extract en de align extract max-length [orientation [ --model [wbe|phrase|hier]-[msd|mslr|mono] ] ";
-    cerr<<"| --OnlyOutputSpanInfo | --NoTTable | --GZOutput | --IncludeSentenceId | --SentenceOffset n | --InstanceWeights filename ]\n";
+    cerr<<"| --OnlyOutputSpanInfo | --NoTTable | --GZOutput | --IncludeSentenceId | --SentenceOffset n | --InstanceWeights filename ";
+    cerr<<"| --Threads n | --SortedOutput | --SortBufferSize megabytes | --TempDir dir ]\n";
     exit(1);
   }
 
@@ -147,6 +211,10 @@ int main(int argc, char* argv[])
   const char* const &fileNameA = argv[3];
   const string fileNameExtract = string(argv[4]);
   PhraseExtractionOptions options(atoi(argv[5]));
+  size_t threadCount = 1;
+  bool sortedOutput = false;
+  size_t sortBufferSizeMB = 1024;
+  string tempDir;
 
   for(int i=6; i<argc; i++) {
     if (strcmp(argv[i],"--OnlyOutputSpanInfo") == 0) {
@@ -232,6 +300,19 @@ int main(int argc, char* argv[])
       ++i;
       string str = argv[i];
       options.placeholders = Tokenize(str.c_str(), ",");
+    } else if (strcmp(argv[i], "--Threads") == 0) {
+#ifdef WITH_THREADS
+      threadCount = std::max(atoi(argv[++i]), 1);
+#else
+      cerr << "thread support not compiled in." << '\n';
+      exit(1);
+#endif
+    } else if (strcmp(argv[i], "--SortedOutput") == 0) {
+      sortedOutput = true;
+    } else if (strcmp(argv[i], "--SortBufferSize") == 0) {
+      sortBufferSizeMB = std::max(atoi(argv[++i]), 1);
+    } else if (strcmp(argv[i], "--TempDir") == 0) {
+      tempDir = argv[++i];
     } else {
       cerr << "extract: syntax error, unknown option '" << string(argv[i]) << "'\n";
       exit(1);
@@ -245,6 +326,14 @@ int main(int argc, char* argv[])
     options.initWordType(REO_MSD);
   }
 
+  if (options.isOnlyOutputSpanInfo() && (threadCount > 1 || sortedOutput)) {
+    cerr << "extract: --OnlyOutputSpanInfo cannot be combined with --Threads or --SortedOutput" << endl;
+    exit(1);
+  }
+  // sentences are extracted in blocks, by a pool of threads if there are several
+  const bool extractBlocks = threadCount > 1 || sortedOutput;
+  const size_t sentencesPerBlock = 1000;
+
   // open input files
   Moses::InputFileStream eFile(fileNameE);
   Moses::InputFileStream fFile(fileNameF);
@@ -262,21 +351,56 @@ int main(int argc, char* argv[])
   }
 
   // open output files
-  if (options.isTranslationFlag()) {
-    string fileNameExtractInv = fileNameExtract + ".inv" + (options.isGzOutput()?".gz":"");
-    extractFile.Open( (fileNameExtract + (options.isGzOutput()?".gz":"")).c_str());
-    extractFileInv.Open(fileNameExtractInv.c_str());
-  }
-  if (options.isOrientationFlag()) {
-    string fileNameExtractOrientation = fileNameExtract + ".o" + (options.isGzOutput()?".gz":"");
-    extractFileOrientation.Open(fileNameExtractOrientation.c_str());
+  ExtractOutput output;
+  std::fill(output.files, output.files + NUM_EXTRACT_FILES, (Moses::OutputFileStream*) NULL);
+  if (sortedOutput) {
+    // named as by extract-parallel.perl; context lines are made unique, too
+    const string suffixes[NUM_EXTRACT_FILES] = { "", ".inv", ".o", ".context", ".context.inv" };
+    const bool written[NUM_EXTRACT_FILES] = {
+      options.isTranslationFlag(), options.isTranslationFlag(), options.isOrientationFlag(),
+      options.isFlexScoreFlag(), options.isFlexScoreFlag()
+    };
+    const size_t sorterCount = std::count(written, written + NUM_EXTRACT_FILES, true);
+    const string tempPrefix = tempDir.empty() ? fileNameExtract + ".sort." : tempDir + "/extract.sort.";
+    for (size_t type = 0; type < NUM_EXTRACT_FILES; ++type) {
+      if (written[type]) {
+        output.sorters[type].reset(new LineSorter(fileNameExtract + suffixes[type] + ".sorted.gz", tempPrefix,
+                                   (sortBufferSizeMB << 20) / std::max<size_t>(sorterCount, 1),
+                                   type == EXTRACT_CONTEXT || type == EXTRACT_CONTEXT_INV));
+      }
+    }
+  } else {
+    if (options.isTranslationFlag()) {
+      string fileNameExtractInv = fileNameExtract + ".inv" + (options.isGzOutput()?".gz":"");
+      extractFile.Open( (fileNameExtract + (options.isGzOutput()?".gz":"")).c_str());
+      extractFileInv.Open(fileNameExtractInv.c_str());
+      output.files[EXTRACT] = &extractFile;
+      output.files[EXTRACT_INV] = &extractFileInv;
+    }
+    if (options.isOrientationFlag()) {
+      string fileNameExtractOrientation = fileNameExtract + ".o" + (options.isGzOutput()?".gz":"");
+      extractFileOrientation.Open(fileNameExtractOrientation.c_str());
+      output.files[EXTRACT_ORIENTATION] = &extractFileOrientation;
+    }
+    if (options.isFlexScoreFlag()) {
+      string fileNameExtractContext = fileNameExtract + ".context"  + (options.isGzOutput()?".gz":"");
+      string fileNameExtractContextInv = fileNameExtract + ".context.inv"  + (options.isGzOutput()?".gz":"");
+      extractFileContext.Open(fileNameExtractContext.c_str());
+      extractFileContextInv.Open(fileNameExtractContextInv.c_str());
+      output.files[EXTRACT_CONTEXT] = &extractFileContext;
+      output.files[EXTRACT_CONTEXT_INV] = &extractFileContextInv;
+    }
   }
-  if (options.isFlexScoreFlag()) {
-    string fileNameExtractContext = fileNameExtract + ".context"  + (options.isGzOutput()?".gz":"");
-    string fileNameExtractContextInv = fileNameExtract + ".context.inv"  + (options.isGzOutput()?".gz":"");
-    extractFileContext.Open(fileNameExtractContext.c_str());
-    extractFileContextInv.Open(fileNameExtractContextInv.c_str());
+
+#ifdef WITH_THREADS
+  boost::scoped_ptr<Moses::ThreadPool> pool;
+  if (threadCount > 1) {
+    pool.reset(new Moses::ThreadPool(threadCount));
   }
+#endif
+  // blocks being extracted or waiting to be written, in input order
+  std::deque< boost::shared_ptr<ExtractBlockTask> > blocks;
+  boost::shared_ptr<ExtractBlockTask> block(new ExtractBlockTask(options));
 
   int i = sentenceOffset;
 
@@ -293,6 +417,39 @@ int main(int argc, char* argv[])
       getline(*iwFileP, weightString);
     }
 
+    if (extractBlocks) {
+      block->sentences.push_back(SentenceAlignment());
+      SentenceAlignment &sentence = block->sentences.back();
+      if (!sentence.create( englishString.c_str(),
+                            foreignString.c_str(),
+                            alignmentString.c_str(),
+                            weightString.c_str(),
+                            i, false)) {
+        block->sentences.pop_back();
+      } else if (options.placeholders.size()) {
+        sentence.invertAlignment();
+      }
+      if (block->sentences.size() < sentencesPerBlock) {
+        continue;
+      }
+#ifdef WITH_THREADS
+      if (pool) {
+        while (blocks.size() >= 2 * threadCount) {
+          blocks.front()->Write(output);
+          blocks.pop_front();
+        }
+        blocks.push_back(block);
+        pool->Submit(block);
+      } else
+#endif
+      {
+        block->Run();
+        block->Write(output);
+      }
+      block.reset(new ExtractBlockTask(options));
+      continue;
+    }
+
     SentenceAlignment sentence;
     // cout << "read in: " << englishString << " & " << foreignString << " & " << alignmentString << endl;
     //az: output src, tgt, and alingment line
@@ -318,12 +475,37 @@ int main(int argc, char* argv[])
     if (options.isOnlyOutputSpanInfo()) cout << "LOG: PHRASES_END:" << endl; //az: mark end of phrases
   }
 
+  // the last, partial block
+  if (!block->sentences.empty()) {
+    block->Run();
+    blocks.push_back(block);
+  }
+  while (!blocks.empty()) {
+    blocks.front()->Write(output);
+    blocks.pop_front();
+  }
+#ifdef WITH_THREADS
+  if (pool) {
+    pool->Stop(true);
+  }
+#endif
+
   eFile.Close();
   fFile.Close();
   aFile.Close();
 
+  if (sortedOutput) {
+    cerr << endl << "sorting" << flush;
+    for (size_t type = 0; type < NUM_EXTRACT_FILES; ++type) {
+      if (output.sorters[type]) {
+        output.sorters[type]->Close();
+        cerr << "." << flush;
+      }
+    }
+  }
+
   //az: only close if we actually opened it
-  if (!options.isOnlyOutputSpanInfo()) {
+  if (!options.isOnlyOutputSpanInfo() && !sortedOutput) {
     if (options.isTranslationFlag()) {
       extractFile.Close();
       extractFileInv.Close();
@@ -345,6 +527,37 @@ int main(int argc, char* argv[])
 
 namespace MosesTraining
 {
+void ExtractBlockTask::Run()
+{
+  for (size_t i = 0; i < sentences.size(); ++i) {
+    ExtractTask task(i, sentences[i], m_options,
+                     m_extracted[EXTRACT], m_extracted[EXTRACT_INV], m_extracted[EXTRACT_ORIENTATION],
+                     m_extracted[EXTRACT_CONTEXT], m_extracted[EXTRACT_CONTEXT_INV]);
+    task.Run();
+  }
+  std::vector<SentenceAlignment>().swap(sentences);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  m_done = true;
+#ifdef WITH_THREADS
+  m_finished.notify_all();
+#endif
+}
+
+void ExtractBlockTask::Write(ExtractOutput &output)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+  while (!m_done) {
+    m_finished.wait(lock);
+  }
+#endif
+  for (size_t type = 0; type < NUM_EXTRACT_FILES; ++type) {
+    output.Write(ExtractFileType(type), m_extracted[type].str());
+  }
+}
+
 void ExtractTask::Run()
 {
   extract(m_sentence);
@@ -273,72 +273,72 @@ void ScorerLR::createConstSmoothing(double weight, vector<double>& smoothing) co
   }
 }
 
-void Model::score_fe(const string& f, const string& e)
+void Model::score_fe(const ModelScore& counts, const string& f, const string& e, ostream& out) const
 {
   if (!fe)    //Make sure we do not do anything if it is not a fe model
     return;
-  outputFile << f << " ||| " << e << " |||";
+  out << f << " ||| " << e << " |||";
   //condition on the previous phrase
   if (previous) {
     vector<double> scores;
-    scorer->score(modelscore->get_scores_fe_prev(), scores);
+    scorer->score(counts.get_scores_fe_prev(), scores);
     double sum = 0;
     for(size_t i=0; i<scores.size(); ++i) {
       scores[i] += smoothing_prev[i];
       sum += scores[i];
     }
     for(size_t i=0; i<scores.size(); ++i) {
-      outputFile << " " << (scores[i]/sum);
+      out << " " << (scores[i]/sum);
     }
   }
   //condition on the next phrase
   if (next) {
     vector<double> scores;
-    scorer->score(modelscore->get_scores_fe_next(), scores);
+    scorer->score(counts.get_scores_fe_next(), scores);
     double sum = 0;
     for(size_t i=0; i<scores.size(); ++i) {
       scores[i] += smoothing_next[i];
       sum += scores[i];
     }
     for(size_t i=0; i<scores.size(); ++i) {
-      outputFile << " " << (scores[i]/sum);
+      out << " " << (scores[i]/sum);
     }
   }
-  outputFile << endl;
+  out << "\n";
 }
 
-void Model::score_f(const string& f)
+void Model::score_f(const ModelScore& counts, const string& f, ostream& out) const
 {
   if (fe)      //Make sure we do not do anything if it is not a f model
     return;
-  cout << f << " |||";
+  out << f << " |||";
   //condition on the previous phrase
   if (previous) {
     vector<double> scores;
-    scorer->score(modelscore->get_scores_f_prev(), scores);
+    scorer->score(counts.get_scores_f_prev(), scores);
     double sum = 0;
     for(size_t i=0; i<scores.size(); ++i) {
       scores[i] += smoothing_prev[i];
       sum += scores[i];
     }
     for(size_t i=0; i<scores.size(); ++i) {
-      outputFile << " " << (scores[i]/sum);
+      out << " " << (scores[i]/sum);
     }
   }
   //condition on the next phrase
   if (next) {
     vector<double> scores;
-    scorer->score(modelscore->get_scores_f_next(), scores);
+    scorer->score(counts.get_scores_f_next(), scores);
     double sum = 0;
     for(size_t i=0; i<scores.size(); ++i) {
       scores[i] += smoothing_next[i];
       sum += scores[i];
     }
     for(size_t i=0; i<scores.size(); ++i) {
-      outputFile << " " << (scores[i]/sum);
+      out << " " << (scores[i]/sum);
     }
   }
-  outputFile << endl;
+  out << "\n";
 }
 
 Model::Model(ModelScore* ms, Scorer* sc, const string& dir, const string& lang, const string& fn)
@@ -366,10 +366,19 @@ Model::Model(ModelScore* ms, Scorer* sc, const string& dir, const string& lang,
 Model::~Model()
 {
   outputFile.Close();
-  delete modelscore;
   delete scorer;
 }
 
+void Model::write(const string& lines)
+{
+  outputFile << lines;
+}
+
+const string& Model::getFilename() const
+{
+  return filename;
+}
+
 void Model::split_config(const string& config, string& dir, string& lang, string& orient)
 {
   istringstream is(config);
@@ -11,6 +11,7 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <ostream>
 
 #include "util/string_piece.hh"
 #include "../OutputFileStream.h"
@@ -119,7 +120,7 @@ public:
 class Model
 {
 private:
-  ModelScore* modelscore;
+  ModelScore* modelscore; //shared by the models of one kind, not owned
   Scorer* scorer;
 
   std::string filename;
@@ -141,8 +142,11 @@ public:
   static Model* createModel(ModelScore*, const std::string&, const std::string&);
   void createSmoothing(double w);
   void createConstSmoothing(double w);
-  void score_fe(const std::string& f, const std::string& e);
-  void score_f(const std::string& f);
+  //score with the counts of a part of the extract file, which need not be this model's
+  void score_fe(const ModelScore& counts, const std::string& f, const std::string& e, std::ostream& out) const;
+  void score_f(const ModelScore& counts, const std::string& f, std::ostream& out) const;
+  void write(const std::string& lines);
+  const std::string& getFilename() const;
   void zipFile();
 };
 
@@ -11,8 +11,18 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <algorithm>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#endif
 
 #include "util/exception.hh"
 #include "util/file_piece.hh"
@@ -21,12 +31,116 @@
 
 #include "InputFileStream.h"
 #include "reordering_classes.h"
+#include "moses/ThreadPool.h"
+#include "moses/FF/LexicalReordering/LexicalReorderingTableHashed.h"
+#include "moses/TranslationModel/CompactPT/LexicalReorderingTableCreator.h"
 
 using namespace std;
 
 void split_line(const StringPiece& line, StringPiece& foreign, StringPiece& english, StringPiece& wbe, StringPiece& phrase, StringPiece& hier, float& weight);
 void get_orientations(const StringPiece& pair, StringPiece& previous, StringPiece& next);
 
+//The counts of the models of each kind of orientation, NULL for kinds not scored
+struct OrientationCounts {
+  ModelScore* hier;
+  ModelScore* phrase;
+  ModelScore* wbe;
+
+  OrientationCounts() : hier(NULL), phrase(NULL), wbe(NULL) {}
+
+  ModelScore* get(const string& kind) const {
+    return kind == "hier" ? hier : (kind == "phrase" ? phrase : wbe);
+  }
+
+  void add_example(const StringPiece& w, const StringPiece& p, const StringPiece& h, float weight) {
+    StringPiece prev, next;
+    if (hier) {
+      get_orientations(h, prev, next);
+      hier->add_example(prev,next,weight);
+    }
+    if (phrase) {
+      get_orientations(p, prev, next);
+      phrase->add_example(prev,next,weight);
+    }
+    if (wbe) {
+      get_orientations(w, prev, next);
+      wbe->add_example(prev,next,weight);
+    }
+  }
+
+  void reset_fe() {
+    if (hier) hier->reset_fe();
+    if (phrase) phrase->reset_fe();
+    if (wbe) wbe->reset_fe();
+  }
+
+  void reset_f() {
+    if (hier) hier->reset_f();
+    if (phrase) phrase->reset_f();
+    if (wbe) wbe->reset_f();
+  }
+};
+
+//Scores the phrase pairs of a part of the sorted extract file that ends with
+//a source phrase, with counts of its own, and keeps the lines for each model
+class ScorePartTask : public Moses::Task
+{
+public:
+  ScorePartTask(string& lines, const vector<Model*>& models, const vector<string>& modelKinds,
+                const map<string,string>& modelTypes)
+    : m_models(models), m_done(false) {
+    m_lines.swap(lines);
+    for (map<string,string>::const_iterator it = modelTypes.begin(); it != modelTypes.end(); ++it) {
+      ModelScore* counts = ModelScore::createModelScore(it->second);
+      m_ownCounts.push_back(counts);
+      if (it->first == "hier") m_counts.hier = counts;
+      else if (it->first == "phrase") m_counts.phrase = counts;
+      else m_counts.wbe = counts;
+    }
+    for (size_t i=0; i<models.size(); ++i) {
+      m_modelCounts.push_back(m_counts.get(modelKinds[i]));
+      m_output.push_back(new ostringstream());
+    }
+  }
+
+  virtual void Run();
+
+  //waits until the part has been scored
+  void write();
+
+private:
+  string m_lines;
+  const vector<Model*>& m_models;
+  boost::ptr_vector<ModelScore> m_ownCounts;
+  OrientationCounts m_counts;
+  vector<const ModelScore*> m_modelCounts;
+  boost::ptr_vector<ostringstream> m_output;
+  bool m_done;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+  boost::condition_variable m_finished;
+#endif
+
+  void score_fe(const string& f, const string& e) {
+    for (size_t i=0; i<m_models.size(); ++i) {
+      m_models[i]->score_fe(*m_modelCounts[i], f, e, m_output[i]);
+    }
+  }
+
+  void score_f(const string& f) {
+    for (size_t i=0; i<m_models.size(); ++i) {
+      m_models[i]->score_f(*m_modelCounts[i], f, m_output[i]);
+    }
+  }
+};
+
+//The source phrase of an extract line
+StringPiece source_phrase(const StringPiece& line)
+{
+  util::TokenIter<util::MultiCharacter> pipes(line, util::MultiCharacter(" ||| "));
+  return pipes ? *pipes : StringPiece();
+}
+
 class FileFormatException : public util::Exception
 {
 public:
@@ -43,7 +157,7 @@ int main(int argc, char* argv[])
        << "scores lexical reordering models of several types (hierarchical, phrase-based and word-based-extraction\n";
 
   if (argc < 3) {
-    cerr << "syntax: score_reordering extractFile smoothingValue filepath (--model \"type max-orientation (specification-strings)\" )+\n";
+    cerr << "syntax: score_reordering extractFile smoothingValue filepath (--model \"type max-orientation (specification-strings)\" )+ [--Threads num] [--Compact | --Hashed]\n";
     exit(1);
   }
 
@@ -51,22 +165,41 @@ int main(int argc, char* argv[])
   double smoothingValue = atof(argv[2]);
   string filepath = argv[3];
 
-  util::FilePiece eFile(extractFileName);
 
   bool smoothWithCounts = false;
+  size_t threadCount = 1;
+  bool compact = false;
+  bool hashed = false;
   map<string,ModelScore*> modelScores;
+  map<string,string> modelTypes;
   vector<Model*> models;
+  vector<string> modelKinds;
   bool hier = false;
   bool phrase = false;
   bool wbe = false;
 
   StringPiece e,f,w,p,h;
-  StringPiece prev, next;
 
   int i = 4;
   while (i<argc) {
     if (strcmp(argv[i],"--SmoothWithCounts") == 0) {
       smoothWithCounts = true;
+    } else if (strcmp(argv[i],"--Threads") == 0) {
+#ifdef WITH_THREADS
+      threadCount = max(atoi(argv[++i]), 1);
+#else
+      cerr << "thread support not compiled in." << '\n';
+      exit(1);
+#endif
+    } else if (strcmp(argv[i],"--Compact") == 0) {
+#ifdef HAVE_CMPH
+      compact = true;
+#else
+      cerr << "CMPH support not compiled in, needed for --Compact." << '\n';
+      exit(1);
+#endif
+    } else if (strcmp(argv[i],"--Hashed") == 0) {
+      hashed = true;
     } else if (strcmp(argv[i],"--model") == 0) {
       if (i+1 >= argc) {
         cerr << "score: syntax error, no model information provided to the option" << argv[i] << endl;
@@ -76,6 +209,7 @@ int main(int argc, char* argv[])
       string m,t;
       is >> m >> t;
       modelScores[m] = ModelScore::createModelScore(t);
+      modelTypes[m] = t;
       if (m.compare("hier") == 0) {
         hier = true;
       } else if (m.compare("phrase") == 0) {
@@ -94,6 +228,7 @@ int main(int argc, char* argv[])
       //Store all models
       while (is >> config) {
         models.push_back(Model::createModel(modelScores[m],config,filepath));
+        modelKinds.push_back(m);
       }
     } else {
       cerr << "illegal option given to lexical reordering model score\n";
@@ -105,6 +240,11 @@ int main(int argc, char* argv[])
   ////////////////////////////////////
   //calculate smoothing
   if (smoothWithCounts) {
+    // in one thread, so that the smoothing does not depend on the number of threads
+    OrientationCounts counts;
+    if (hier) counts.hier = modelScores["hier"];
+    if (phrase) counts.phrase = modelScores["phrase"];
+    if (wbe) counts.wbe = modelScores["wbe"];
     util::FilePiece eFileForCounts(extractFileName);
     while (true) {
       StringPiece line;
@@ -115,18 +255,7 @@ int main(int argc, char* argv[])
       }
       float weight = 1;
       split_line(line,e,f,w,p,h,weight);
-      if (hier) {
-        get_orientations(h, prev, next);
-        modelScores["hier"]->add_example(prev,next,weight);
-      }
-      if (phrase) {
-        get_orientations(p, prev, next);
-        modelScores["phrase"]->add_example(prev,next,weight);
-      }
-      if (wbe) {
-        get_orientations(w, prev, next);
-        modelScores["wbe"]->add_example(prev,next,weight);
-      }
+      counts.add_example(w,p,h,weight);
     }
 
     // calculate smoothing for each model
@@ -143,15 +272,108 @@ int main(int argc, char* argv[])
 
   ////////////////////////////////////
   //calculate scores for reordering table
+  //in parts that end with a source phrase, scored in parallel and written in order
+  const size_t partSize = 1 << 24;
+#ifdef WITH_THREADS
+  boost::scoped_ptr<Moses::ThreadPool> pool;
+  if (threadCount > 1) {
+    pool.reset(new Moses::ThreadPool(threadCount));
+  }
+#endif
+  deque< boost::shared_ptr<ScorePartTask> > parts;
+
+  util::FilePiece eFile(extractFileName);
+  string lines, f_last;
+  StringPiece line;
+  while (eFile.ReadLineOrEOF(line)) {
+    StringPiece f_line = source_phrase(line);
+    if (lines.size() >= partSize && f_line != StringPiece(f_last)) {
+      boost::shared_ptr<ScorePartTask> part(new ScorePartTask(lines, models, modelKinds, modelTypes));
+#ifdef WITH_THREADS
+      if (pool) {
+        while (parts.size() >= 2 * threadCount) {
+          parts.front()->write();
+          parts.pop_front();
+        }
+        parts.push_back(part);
+        pool->Submit(part);
+      } else
+#endif
+      {
+        part->Run();
+        part->write();
+      }
+      lines.clear();
+    }
+    lines.append(line.data(), line.size());
+    lines += '\n';
+    f_last.assign(f_line.data(), f_line.size());
+  }
+  if (!lines.empty()) {
+    boost::shared_ptr<ScorePartTask> part(new ScorePartTask(lines, models, modelKinds, modelTypes));
+    part->Run();
+    parts.push_back(part);
+  }
+  while (!parts.empty()) {
+    parts.front()->write();
+    parts.pop_front();
+  }
+#ifdef WITH_THREADS
+  if (pool) {
+    pool->Stop(true);
+  }
+#endif
+
+  vector<string> filenames;
+  for (size_t i=0; i<models.size(); ++i) {
+    filenames.push_back(models[i]->getFilename());
+  }
+
+  // delete model objects (and close files)
+  for (size_t i=0; i<models.size(); ++i) {
+    delete models[i];
+  }
+  for(map<string,ModelScore*>::const_iterator it = modelScores.begin(); it != modelScores.end(); ++it) {
+    delete it->second;
+  }
+
+  ////////////////////////////////////
+  //binarise the tables, in place of the text tables
+  if (compact || hashed) {
+    for (size_t i=0; i<filenames.size(); ++i) {
+      const string textFile = filenames[i] + ".gz";
+      if (compact) {
+        Moses::LexicalReorderingTableCreator creator(textFile, filenames[i] + ".minlexr", "",
+            10, 16, true, 0
+#ifdef WITH_THREADS
+            , threadCount
+#endif
+                                                    );
+      }
+      if (hashed) {
+        Moses::InputFileStream textTable(textFile);
+        if (!Moses::LexicalReorderingTableHashed::Create(textTable, filenames[i])) {
+          cerr << "Could not binarise " << textFile << endl;
+          exit(1);
+        }
+      }
+      remove(textFile.c_str());
+    }
+  }
+  return 0;
+}
+
+void ScorePartTask::Run()
+{
   string f_current,e_current;
+  StringPiece f,e,w,p,h;
   bool first = true;
-  while (true) {
-    StringPiece line;
-    try {
-      line = eFile.ReadLine();
-    } catch (util::EndOfFileException &e) {
-      break;
-    }
+  StringPiece lines(m_lines);
+  while (!lines.empty()) {
+    size_t end = lines.find('\n');
+    StringPiece line = lines.substr(0, end);
+    lines = end == StringPiece::npos ? StringPiece() : lines.substr(end + 1);
+
     float weight = 1;
     split_line(line,f,e,w,p,h,weight);
 
@@ -161,55 +383,50 @@ int main(int argc, char* argv[])
       first = false;
     } else if (f.compare(f_current) != 0 || e.compare(e_current) != 0) {
       //fe - score
-      for (size_t i=0; i<models.size(); ++i) {
-        models[i]->score_fe(f_current,e_current);
-      }
+      score_fe(f_current,e_current);
       //reset
-      for(map<string,ModelScore*>::const_iterator it = modelScores.begin(); it != modelScores.end(); ++it) {
-        it->second->reset_fe();
-      }
+      m_counts.reset_fe();
 
       if (f.compare(f_current) != 0) {
         //f - score
-        for (size_t i=0; i<models.size(); ++i) {
-          models[i]->score_f(f_current);
-        }
+        score_f(f_current);
         //reset
-        for(map<string,ModelScore*>::const_iterator it = modelScores.begin(); it != modelScores.end(); ++it) {
-          it->second->reset_f();
-        }
+        m_counts.reset_f();
       }
       f_current = f.as_string();
       e_current = e.as_string();
     }
 
     // uppdate counts
-    if (hier) {
-      get_orientations(h, prev, next);
-      modelScores["hier"]->add_example(prev,next,weight);
-    }
-    if (phrase) {
-      get_orientations(p, prev, next);
-      modelScores["phrase"]->add_example(prev,next,weight);
-    }
-    if (wbe) {
-      get_orientations(w, prev, next);
-      modelScores["wbe"]->add_example(prev,next,weight);
-    }
+    m_counts.add_example(w,p,h,weight);
   }
   //Score the last phrases
-  for (size_t i=0; i<models.size(); ++i) {
-    models[i]->score_fe(f_current,e_current);
-  }
-  for (size_t i=0; i<models.size(); ++i) {
-    models[i]->score_f(f_current);
+  if (!first) {
+    score_fe(f_current,e_current);
+    score_f(f_current);
   }
+  string().swap(m_lines);
 
-  // delete model objects (and close files)
-  for (size_t i=0; i<models.size(); ++i) {
-    delete models[i];
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  m_done = true;
+#ifdef WITH_THREADS
+  m_finished.notify_all();
+#endif
+}
+
+void ScorePartTask::write()
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+  while (!m_done) {
+    m_finished.wait(lock);
+  }
+#endif
+  for (size_t i=0; i<m_models.size(); ++i) {
+    m_models[i]->write(m_output[i].str());
   }
-  return 0;
 }
 
 template <class It> StringPiece
@@ -25,8 +25,13 @@
 #include <set>
 #include <vector>
 #include <algorithm>
+#include <deque>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/unordered_map.hpp>
+#ifdef WITH_THREADS
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#endif
 
 #include "ScoreFeature.h"
 #include "tables-core.h"
@@ -36,6 +41,9 @@
 #include "OutputFileStream.h"
 
 #include "moses/Util.h"
+#ifdef WITH_THREADS
+#include "moses/ThreadPool.h"
+#endif
 
 using namespace boost::algorithm;
 using namespace MosesTraining;
@@ -89,6 +97,10 @@ std::set<std::string> targetSyntacticPreferencesLabelSet;
 std::map<std::string,size_t> targetSyntacticPreferencesLabels;
 std::vector<std::string> targetSyntacticPreferencesLabelsByIndex;
 
+#ifdef WITH_THREADS
+boost::mutex countOfCountsMutex;
+#endif
+
 std::vector<float> orientationClassPriorsL2R(4,0); // mono swap dleft dright
 std::vector<float> orientationClassPriorsR2L(4,0); // mono swap dleft dright
 
@@ -109,6 +121,13 @@ void writeLeftHandSideLabelCounts( const boost::unordered_map<std::string,float>
                                    const std::string &fileNameLeftHandSideSourceLabelCounts,
                                    const std::string &fileNameLeftHandSideTargetSourceLabelCounts );
 void writeLabelSet( const std::set<std::string> &labelSet, const std::string &fileName );
+void processExtract( std::istream &extractFile, int lineNumber, std::ostream &phraseTableFile,
+                     const ScoreFeatureManager& featureManager, const MaybeLog& maybeLogProb );
+#ifdef WITH_THREADS
+void processExtractInParallel( std::istream &extractFile, std::ostream &phraseTableFile,
+                               const ScoreFeatureManager& featureManager, const MaybeLog& maybeLogProb,
+                               size_t threadCount, size_t bufferSize );
+#endif
 void processPhrasePairs( std::vector< ExtractionPhrasePair* > &phrasePairsWithSameSource, std::ostream &phraseTableFile,
                          const ScoreFeatureManager& featureManager, const MaybeLog& maybeLogProb );
 void outputPhrasePair(const ExtractionPhrasePair &phrasePair, float, int, std::ostream &phraseTableFile, const ScoreFeatureManager &featureManager, const MaybeLog &maybeLog );
@@ -153,7 +172,9 @@ int main(int argc, char* argv[])
               "[--TargetSyntacticPreferences] "
               "[--UnpairedExtractFormat] "
               "[--ConditionOnTargetLHS] "
-              "[--CrossedNonTerm]"
+              "[--CrossedNonTerm] "
+              "[--Threads num] "
+              "[--BufferSize megabytes]"
               << std::endl;
     std::cerr << featureManager.usage() << std::endl;
     exit(1);
@@ -171,6 +192,8 @@ int main(int argc, char* argv[])
   std::string fileNameLeftHandSideTargetSyntacticPreferencesLabelCounts;
   std::string fileNameLeftHandSideRuleTargetTargetSyntacticPreferencesLabelCounts;
   std::string fileNamePhraseOrientationPriors;
+  size_t threadCount = 1;
+  size_t bufferSizeMB = 1024;
   // All unknown args are passed to feature manager.
   std::vector<std::string> featureArgs;
 
@@ -286,6 +309,17 @@ int main(int argc, char* argv[])
     } else if (strcmp(argv[i],"--NonTermContextTarget") == 0) {
       nonTermContextTarget = true;
       std::cerr << "non-term context (target)" << std::endl;
+    } else if (strcmp(argv[i],"--Threads") == 0) {
+#ifdef WITH_THREADS
+      threadCount = std::max( std::atoi( argv[++i] ), 1 );
+      std::cerr << "scoring with " << threadCount << " threads" << std::endl;
+#else
+      std::cerr << "ERROR: thread support not compiled in" << std::endl;
+      exit(1);
+#endif
+    } else if (strcmp(argv[i],"--BufferSize") == 0) {
+      bufferSizeMB = std::max( std::atoi( argv[++i] ), 1 );
+      std::cerr << "holding about " << bufferSizeMB << " MB of the extract file in memory" << std::endl;
     } else {
       featureArgs.push_back(argv[i]);
       ++i;
@@ -298,6 +332,13 @@ int main(int argc, char* argv[])
 
   MaybeLog maybeLogProb(logProbFlag, negLogProb);
 
+  // these collect labels and label counts in the order of the extract file
+  if (threadCount > 1 && !inverseFlag &&
+      (partsOfSpeechFlag || sourceSyntaxLabelsFlag || targetSyntacticPreferencesFlag)) {
+    std::cerr << "WARNING: scoring with a single thread, as label sets are collected" << std::endl;
+    threadCount = 1;
+  }
+
   // configure extra features
   if (!inverseFlag) {
     featureManager.configure(featureArgs);
@@ -346,6 +387,59 @@ int main(int argc, char* argv[])
     phraseTableFile = outputFile;
   }
 
+#ifdef WITH_THREADS
+  if (threadCount > 1) {
+    processExtractInParallel( extractFile, *phraseTableFile, featureManager, maybeLogProb,
+                              threadCount, bufferSizeMB << 20 );
+  } else
+#endif
+  {
+    processExtract( extractFile, 0, *phraseTableFile, featureManager, maybeLogProb );
+  }
+
+  // We've been printing progress dots to stderr.  End the line.
+  std::cerr << std::endl;
+
+  phraseTableFile->flush();
+  if (phraseTableFile != &std::cout) {
+    delete phraseTableFile;
+  }
+
+  // output count of count statistics
+  if (goodTuringFlag || kneserNeyFlag) {
+    writeCountOfCounts( fileNameCountOfCounts );
+  }
+
+  // source syntax labels
+  if (sourceSyntaxLabelsFlag && !inverseFlag) {
+    writeLabelSet( sourceLabelSet, fileNameSourceLabelSet );
+  }
+  if (sourceSyntaxLabelsFlag && sourceSyntaxLabelCountsLHSFlag && !inverseFlag) {
+    writeLeftHandSideLabelCounts( sourceLHSCounts,
+                                  targetLHSAndSourceLHSJointCounts,
+                                  fileNameLeftHandSideSourceLabelCounts,
+                                  fileNameLeftHandSideTargetSourceLabelCounts );
+  }
+
+  // parts-of-speech
+  if (partsOfSpeechFlag && !inverseFlag) {
+    writeLabelSet( partsOfSpeechSet, fileNamePartsOfSpeechSet );
+  }
+
+  // target syntactic preferences labels
+  if (targetSyntacticPreferencesFlag && !inverseFlag) {
+    writeLabelSet( targetSyntacticPreferencesLabelSet, fileNameTargetSyntacticPreferencesLabelSet );
+    writeLeftHandSideLabelCounts( targetSyntacticPreferencesLHSCounts,
+                                  ruleTargetLHSAndTargetSyntacticPreferencesLHSJointCounts,
+                                  fileNameLeftHandSideTargetSyntacticPreferencesLabelCounts,
+                                  fileNameLeftHandSideRuleTargetTargetSyntacticPreferencesLabelCounts );
+  }
+}
+
+
+void processExtract( std::istream &extractFile, int lineNumber, std::ostream &phraseTableFile,
+                     const ScoreFeatureManager& featureManager, const MaybeLog& maybeLogProb )
+{
   // loop through all extracted phrase translations
   std::string line, lastLine;
   ExtractionPhrasePair *phrasePair = NULL;
@@ -358,7 +452,7 @@ int main(int argc, char* argv[])
   std::string tmpAdditionalPropertiesString;
   float tmpCount=0.0f, tmpPcfgSum=0.0f;
 
-  int i=0;
+  int i=lineNumber;
   if ( getline(extractFile, line) ) {
     ++i;
     tmpPhraseSource = new PHRASE();
@@ -443,7 +537,7 @@ int main(int argc, char* argv[])
 
       if ( !phrasePairsWithSameSource.empty() &&
            !sourceMatch ) {
-        processPhrasePairs( phrasePairsWithSameSource, *phraseTableFile, featureManager, maybeLogProb );
+        processPhrasePairs( phrasePairsWithSameSource, phraseTableFile, featureManager, maybeLogProb );
         for ( std::vector< ExtractionPhrasePair* >::const_iterator iter=phrasePairsWithSameSource.begin();
               iter!=phrasePairsWithSameSource.end(); ++iter) {
           delete *iter;
@@ -475,52 +569,107 @@ int main(int argc, char* argv[])
 
   }
 
-  // We've been printing progress dots to stderr.  End the line.
-  std::cerr << std::endl;
-
-  processPhrasePairs( phrasePairsWithSameSource, *phraseTableFile, featureManager, maybeLogProb );
+  processPhrasePairs( phrasePairsWithSameSource, phraseTableFile, featureManager, maybeLogProb );
   for ( std::vector< ExtractionPhrasePair* >::const_iterator iter=phrasePairsWithSameSource.begin();
         iter!=phrasePairsWithSameSource.end(); ++iter) {
     delete *iter;
   }
   phrasePairsWithSameSource.clear();
+}
 
 
-  phraseTableFile->flush();
-  if (phraseTableFile != &std::cout) {
-    delete phraseTableFile;
+#ifdef WITH_THREADS
+/** Scores a partition of the sorted extract file that holds all phrase pairs
+ *  of its source phrases, keeping the phrase table lines until written.
+ */
+class ScorePartitionTask : public Moses::Task
+{
+public:
+  ScorePartitionTask( std::string &lines, int lineNumber,
+                      const ScoreFeatureManager& featureManager, const MaybeLog& maybeLogProb )
+    : m_lineNumber(lineNumber)
+    , m_featureManager(featureManager)
+    , m_maybeLogProb(maybeLogProb)
+    , m_done(false) {
+    m_lines.swap(lines);
+  }
+
+  virtual void Run() {
+    {
+      std::istringstream extract(m_lines);
+      processExtract( extract, m_lineNumber, m_output, m_featureManager, m_maybeLogProb );
+    }
+    std::string().swap(m_lines);
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_done = true;
+    m_finished.notify_all();
   }
 
-  // output count of count statistics
-  if (goodTuringFlag || kneserNeyFlag) {
-    writeCountOfCounts( fileNameCountOfCounts );
-  }
+  // waits until the partition has been scored
+  void Write( std::ostream &phraseTableFile ) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (!m_done) {
+      m_finished.wait(lock);
+    }
+    phraseTableFile << m_output.str();
+  }
+
+private:
+  std::string m_lines;
+  int m_lineNumber;
+  const ScoreFeatureManager& m_featureManager;
+  const MaybeLog& m_maybeLogProb;
+  std::ostringstream m_output;
+  boost::mutex m_mutex;
+  boost::condition_variable m_finished;
+  bool m_done;
+};
+
+void processExtractInParallel( std::istream &extractFile, std::ostream &phraseTableFile,
+                               const ScoreFeatureManager& featureManager, const MaybeLog& maybeLogProb,
+                               size_t threadCount, size_t bufferSize )
+{
+  // partitions read, being scored or waiting to be written; each takes about
+  // as much memory for its phrase table lines as for its extract lines
+  const size_t maxPartitions = 2 * threadCount;
+  const size_t partitionSize = std::max< size_t >( bufferSize / maxPartitions, 1 );
 
-  // source syntax labels
-  if (sourceSyntaxLabelsFlag && !inverseFlag) {
-    writeLabelSet( sourceLabelSet, fileNameSourceLabelSet );
-  }
-  if (sourceSyntaxLabelsFlag && sourceSyntaxLabelCountsLHSFlag && !inverseFlag) {
-    writeLeftHandSideLabelCounts( sourceLHSCounts,
-                                  targetLHSAndSourceLHSJointCounts,
-                                  fileNameLeftHandSideSourceLabelCounts,
-                                  fileNameLeftHandSideTargetSourceLabelCounts );
-  }
+  Moses::ThreadPool pool( threadCount );
+  std::deque< boost::shared_ptr< ScorePartitionTask > > partitions;
 
-  // parts-of-speech
-  if (partsOfSpeechFlag && !inverseFlag) {
-    writeLabelSet( partsOfSpeechSet, fileNamePartsOfSpeechSet );
+  std::string line, lines, source, lastSource;
+  int lineNumber = 0, partitionStart = 0;
+  while ( getline(extractFile, line) ) {
+    source.assign( line, 0, line.find("|||") );
+    // partitions end where the source phrase changes
+    if ( lines.size() >= partitionSize && source != lastSource ) {
+      while ( partitions.size() >= maxPartitions ) {
+        partitions.front()->Write( phraseTableFile );
+        partitions.pop_front();
+      }
+      partitions.push_back( boost::shared_ptr< ScorePartitionTask >(
+                              new ScorePartitionTask( lines, partitionStart, featureManager, maybeLogProb ) ) );
+      pool.Submit( partitions.back() );
+      partitionStart = lineNumber;
+    }
+    lines += line;
+    lines += '\n';
+    lastSource.swap( source );
+    ++lineNumber;
+  }
+  if ( !lines.empty() ) {
+    partitions.push_back( boost::shared_ptr< ScorePartitionTask >(
+                            new ScorePartitionTask( lines, partitionStart, featureManager, maybeLogProb ) ) );
+    pool.Submit( partitions.back() );
   }
 
-  // target syntactic preferences labels
-  if (targetSyntacticPreferencesFlag && !inverseFlag) {
-    writeLabelSet( targetSyntacticPreferencesLabelSet, fileNameTargetSyntacticPreferencesLabelSet );
-    writeLeftHandSideLabelCounts( targetSyntacticPreferencesLHSCounts,
-                                  ruleTargetLHSAndTargetSyntacticPreferencesLHSJointCounts,
-                                  fileNameLeftHandSideTargetSyntacticPreferencesLabelCounts,
-                                  fileNameLeftHandSideRuleTargetTargetSyntacticPreferencesLabelCounts );
+  while ( !partitions.empty() ) {
+    partitions.front()->Write( phraseTableFile );
+    partitions.pop_front();
   }
+  pool.Stop( true );
 }
+#endif
 
 
 void processLine( std::string line,
@@ -721,6 +870,9 @@ void outputPhrasePair(const ExtractionPhrasePair &phrasePair,
 
   // collect count of count statistics
   if (goodTuringFlag || kneserNeyFlag) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(countOfCountsMutex);
+#endif
     totalDistinct++;
     int countInt = count + 0.99999;
     if ((countInt <= COC_MAX) &&
@@ -1203,7 +1355,7 @@ void LexicalTable::load( const std::string &fileName )
     double prob = std::atof( token[2].c_str() );
     WORD_ID wordT = vcbT.storeIfNew( token[0] );
     WORD_ID wordS = vcbS.storeIfNew( token[1] );
-    ltable[ wordS ][ wordT ] = prob;
+    ltable[ PairKey( wordS, wordT ) ] = prob;
   }
   std::cerr << std::endl;
 }
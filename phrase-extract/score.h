@@ -21,20 +21,24 @@
 
 #include <string>
 #include <map>
+#include <stdint.h>
+
+#include <boost/unordered_map.hpp>
 
 namespace MosesTraining
 {
 class LexicalTable
 {
 public:
-  std::map< WORD_ID, std::map< WORD_ID, double > > ltable;
+  //! one hash for all word pairs, keyed by PairKey(); only read while scoring
+  boost::unordered_map< uint64_t, double > ltable;
   void load( const std::string &filePath );
-  double permissiveLookup( WORD_ID wordS, WORD_ID wordT ) {
-    // cout << endl << vcbS.getWord( wordS ) << "-" << vcbT.getWord( wordT ) << ":";
-    if (ltable.find( wordS ) == ltable.end()) return 1.0;
-    if (ltable[ wordS ].find( wordT ) == ltable[ wordS ].end()) return 1.0;
-    // cout << ltable[ wordS ][ wordT ];
-    return ltable[ wordS ][ wordT ];
+  static uint64_t PairKey( WORD_ID wordS, WORD_ID wordT ) {
+    return ((uint64_t)wordS << 32) | wordT;
+  }
+  double permissiveLookup( WORD_ID wordS, WORD_ID wordT ) const {
+    boost::unordered_map< uint64_t, double >::const_iterator found = ltable.find( PairKey( wordS, wordT ) );
+    return found == ltable.end() ? 1.0 : found->second;
   }
 };
 
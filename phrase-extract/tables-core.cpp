@@ -3,6 +3,8 @@
 #include "util/tokenize.hh"
 #include "tables-core.h"
 
+#include <limits>
+
 #define TABLE_LINE_MAX_LENGTH 1000
 #define UNKNOWNSTR	"UNK"
 
@@ -11,21 +13,45 @@ using namespace std;
 namespace MosesTraining
 {
 
+Vocabulary::Vocabulary()
+  : size(0)
+{
+  // never reallocated, so that readers need no lock
+  blocks.reserve( ((size_t)std::numeric_limits<WORD_ID>::max() >> BLOCK_BITS) + 1 );
+}
+
+Vocabulary::~Vocabulary()
+{
+  for( size_t i = 0; i < blocks.size(); ++i )
+    delete blocks[ i ];
+}
+
 WORD_ID Vocabulary::storeIfNew( const WORD& word )
 {
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock( mutex );
+#endif
   map<WORD, WORD_ID>::iterator i = lookup.find( word );
 
   if( i != lookup.end() )
     return i->second;
 
-  WORD_ID id = vocab.size();
-  vocab.push_back( word );
+  WORD_ID id = size++;
+  if( (id & (BLOCK_SIZE-1)) == 0 ) {
+    blocks.push_back( new vector< WORD >() );
+    // never reallocated, so that references to words stay valid
+    blocks.back()->reserve( BLOCK_SIZE );
+  }
+  blocks.back()->push_back( word );
   lookup[ word ] = id;
   return id;
 }
 
 WORD_ID Vocabulary::getWordID( const WORD& word )
 {
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock( mutex );
+#endif
   map<WORD, WORD_ID>::iterator i = lookup.find( word );
   if( i == lookup.end() )
     return 0;
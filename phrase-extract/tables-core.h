@@ -10,24 +10,47 @@
 #include <string>
 #include <queue>
 #include <map>
+#include <vector>
 #include <cmath>
 
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
 namespace MosesTraining
 {
 
 typedef std::string WORD;
 typedef unsigned int WORD_ID;
 
+/** Words are stored in blocks that never move, so getWord() needs no lock
+ *  while other threads store new words: every id a thread knows of was
+ *  handed out under the lock of storeIfNew() or getWordID().
+ */
 class Vocabulary
 {
 public:
-  std::map<WORD, WORD_ID>  lookup;
-  std::vector< WORD > vocab;
+  Vocabulary();
+  ~Vocabulary();
   WORD_ID storeIfNew( const WORD& );
   WORD_ID getWordID( const WORD& );
   inline WORD &getWord( const WORD_ID id ) {
-    return vocab[ id ];
+    return (*blocks[ id >> BLOCK_BITS ])[ id & (BLOCK_SIZE-1) ];
   }
+
+private:
+  static const size_t BLOCK_BITS = 16;
+  static const size_t BLOCK_SIZE = 1 << BLOCK_BITS;
+
+  std::map<WORD, WORD_ID>  lookup;
+  std::vector< std::vector< WORD >* > blocks; // reserved for all ids
+  WORD_ID size;
+#ifdef WITH_THREADS
+  boost::mutex mutex;
+#endif
+
+  Vocabulary(const Vocabulary &);
+  Vocabulary &operator=(const Vocabulary &);
 };
 
 typedef std::vector< WORD_ID > PHRASE;
@@ -0,0 +1,2 @@
+#!/bin/sh
+/usr/bin/bjam --sanity-test
@@ -44,7 +44,8 @@ class FilePiece {
     char get() {
       if (position_ == position_end_) {
         Shift();
-        if (at_end_) throw EndOfFileException();
+        // the last Shift sets at_end_ but can still return data
+        if (position_ == position_end_) throw EndOfFileException();
       }
       return *(position_++);
     }
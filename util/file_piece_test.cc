@@ -53,6 +53,17 @@ BOOST_AUTO_TEST_CASE(MMapReadLine) {
   BOOST_CHECK_THROW(test.get(), EndOfFileException);
 }
 
+/* get() up to the end of the last mapping */
+BOOST_AUTO_TEST_CASE(MMapGet) {
+  std::fstream ref(FileLocation().c_str(), std::ios::in | std::ios::binary);
+  FilePiece test(FileLocation().c_str(), NULL, 1);
+  char ref_char;
+  while (ref.get(ref_char)) {
+    BOOST_REQUIRE_EQUAL(ref_char, test.get());
+  }
+  BOOST_CHECK_THROW(test.get(), EndOfFileException);
+}
+
 #if !defined(_WIN32) && !defined(_WIN64) && !defined(__APPLE__)
 /* Apple isn't happy with the popen, fileno, dup.  And I don't want to
  * reimplement popen.  This is an issue with the test.